@@ -40,6 +40,9 @@ struct cso_cache {
    struct cso_hash *hashes[CSO_CACHE_MAX];
    int    max_size;
 
+   unsigned use_counter;   /* source of the last_use stamps */
+   struct cso_cache_stats stats[CSO_CACHE_MAX];
+
    cso_sanitize_callback sanitize_cb;
    void                 *sanitize_data;
 };
@@ -87,6 +90,25 @@ static INLINE struct cso_hash *_cso_hash_for_type(struct cso_cache *sc, enum cso
    return hash;
 }
 
+static INLINE unsigned *cso_last_use(void *state, enum cso_cache_type type)
+{
+   switch (type) {
+   case CSO_BLEND:
+      return &((struct cso_blend *)state)->last_use;
+   case CSO_SAMPLER:
+      return &((struct cso_sampler *)state)->last_use;
+   case CSO_DEPTH_STENCIL_ALPHA:
+      return &((struct cso_depth_stencil_alpha *)state)->last_use;
+   case CSO_RASTERIZER:
+      return &((struct cso_rasterizer *)state)->last_use;
+   case CSO_VELEMENTS:
+      return &((struct cso_velements *)state)->last_use;
+   default:
+      assert(0);
+      return NULL;
+   }
+}
+
 static void delete_blend_state(void *state, void *data)
 {
    struct cso_blend *cso = (struct cso_blend *)state;
@@ -157,11 +179,83 @@ static INLINE void sanitize_hash(struct cso_cache *sc,
                                  enum cso_cache_type type,
                                  int max_size)
 {
-   if (sc->sanitize_cb)
+   if (sc->sanitize_cb) {
+      int size = cso_hash_size(hash);
+
       sc->sanitize_cb(hash, type, max_size, sc->sanitize_data);
+      sc->stats[type].evictions += size - cso_hash_size(hash);
+   }
 }
 
 
+struct cso_lru_entry {
+   unsigned last_use;
+   unsigned key;
+   void *state;
+};
+
+static int cso_lru_entry_compare(const void *a, const void *b)
+{
+   const struct cso_lru_entry *ea = (const struct cso_lru_entry *)a;
+   const struct cso_lru_entry *eb = (const struct cso_lru_entry *)b;
+
+   /* Stamps are compared modulo 2^32 so that wrapping around is harmless. */
+   int diff = (int)(ea->last_use - eb->last_use);
+   return diff < 0 ? -1 : diff > 0;
+}
+
+/**
+ * Remove up to count of the least recently used states from the hash,
+ * skipping those delete_cb refuses to delete.
+ */
+void cso_hash_remove_lru(struct cso_hash *hash, enum cso_cache_type type,
+                         int count, cso_delete_callback delete_cb,
+                         void *user_data)
+{
+   int hash_size = cso_hash_size(hash);
+   struct cso_lru_entry *entries;
+   struct cso_hash_iter iter;
+   int i, n = 0;
+
+   if (count <= 0 || !hash_size)
+      return;
+
+   entries = MALLOC(hash_size * sizeof(*entries));
+   if (!entries)
+      return;
+
+   for (iter = cso_hash_first_node(hash); !cso_hash_iter_is_null(iter);
+        iter = cso_hash_iter_next(iter)) {
+      entries[n].state = cso_hash_iter_data(iter);
+      entries[n].key = cso_hash_iter_key(iter);
+      entries[n].last_use = *cso_last_use(entries[n].state, type);
+      n++;
+   }
+
+   qsort(entries, n, sizeof(*entries), cso_lru_entry_compare);
+
+   for (i = 0; i < n && count; i++) {
+      if (!delete_cb(entries[i].state, type, user_data))
+         continue;
+
+      iter = cso_hash_find(hash, entries[i].key);
+      while (cso_hash_iter_data(iter) != entries[i].state)
+         iter = cso_hash_iter_next(iter);
+      cso_hash_erase(hash, iter);
+      --count;
+   }
+
+   FREE(entries);
+}
+
+
+static boolean sanitize_delete_cb(void *state, enum cso_cache_type type,
+                                  void *user_data)
+{
+   delete_cso(state, type);
+   return TRUE;
+}
+
 static INLINE void sanitize_cb(struct cso_hash *hash, enum cso_cache_type type,
                                int max_size, void *user_data)
 {
@@ -172,14 +266,8 @@ static INLINE void sanitize_cb(struct cso_hash *hash, enum cso_cache_type type,
    int to_remove =  (max_size < max_entries) * max_entries/4;
    if (hash_size > max_size)
       to_remove += hash_size - max_size;
-   while (to_remove) {
-      /*remove elements until we're good */
-      /*fixme: currently we pick the nodes to remove at random*/
-      struct cso_hash_iter iter = cso_hash_first_node(hash);
-      void  *cso = cso_hash_take(hash, cso_hash_iter_key(iter));
-      delete_cso(cso, type);
-      --to_remove;
-   }
+
+   cso_hash_remove_lru(hash, type, to_remove, sanitize_delete_cb, NULL);
 }
 
 struct cso_hash_iter
@@ -190,6 +278,7 @@ cso_insert_state(struct cso_cache *sc,
    struct cso_hash *hash = _cso_hash_for_type(sc, type);
    sanitize_hash(sc, hash, type, sc->max_size);
 
+   *cso_last_use(state, type) = ++sc->use_counter;
    return cso_hash_insert(hash, hash_key, state);
 }
 
@@ -229,10 +318,14 @@ struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
    struct cso_hash_iter iter = cso_find_state(sc, hash_key, type);
    while (!cso_hash_iter_is_null(iter)) {
       void *iter_data = cso_hash_iter_data(iter);
-      if (!memcmp(iter_data, templ, size))
+      if (!memcmp(iter_data, templ, size)) {
+         *cso_last_use(iter_data, type) = ++sc->use_counter;
+         sc->stats[type].hits++;
          return iter;
+      }
       iter = cso_hash_iter_next(iter);
    }
+   sc->stats[type].misses++;
    return iter;
 }
 
@@ -245,7 +338,7 @@ void * cso_take_state(struct cso_cache *sc,
 
 struct cso_cache *cso_cache_create(void)
 {
-   struct cso_cache *sc = MALLOC_STRUCT(cso_cache);
+   struct cso_cache *sc = CALLOC_STRUCT(cso_cache);
    int i;
    if (sc == NULL)
       return NULL;
@@ -320,3 +413,9 @@ void cso_cache_set_sanitize_callback(struct cso_cache *sc,
    sc->sanitize_data = user_data;
 }
 
+void cso_cache_get_stats(struct cso_cache *sc, enum cso_cache_type type,
+                         struct cso_cache_stats *stats)
+{
+   *stats = sc->stats[type];
+   stats->entries = cso_hash_size(sc->hashes[type]);
+}
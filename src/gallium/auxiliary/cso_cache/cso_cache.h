@@ -101,6 +101,19 @@ typedef void (*cso_sanitize_callback)(struct cso_hash *hash,
                                       int max_size,
                                       void *user_data);
 
+/** Delete a cached state, return FALSE if it must be kept. */
+typedef boolean (*cso_delete_callback)(void *state,
+                                       enum cso_cache_type type,
+                                       void *user_data);
+
+struct cso_cache_stats {
+   unsigned hits;       /**< lookups which found a cached state */
+   unsigned misses;     /**< lookups which didn't */
+   unsigned evictions;  /**< states removed to bound the cache size */
+   unsigned entries;    /**< states currently cached */
+   unsigned fast_hits;  /**< sets of the bound state, see cso_context */
+};
+
 struct cso_cache;
 
 struct cso_blend {
@@ -108,6 +121,7 @@ struct cso_blend {
    void *data;
    cso_state_callback delete_state;
    struct pipe_context *context;
+   unsigned last_use;   /* LRU stamp, maintained by the cache */
 };
 
 struct cso_depth_stencil_alpha {
@@ -115,6 +129,7 @@ struct cso_depth_stencil_alpha {
    void *data;
    cso_state_callback delete_state;
    struct pipe_context *context;
+   unsigned last_use;   /* LRU stamp, maintained by the cache */
 };
 
 struct cso_rasterizer {
@@ -122,6 +137,7 @@ struct cso_rasterizer {
    void *data;
    cso_state_callback delete_state;
    struct pipe_context *context;
+   unsigned last_use;   /* LRU stamp, maintained by the cache */
 };
 
 struct cso_sampler {
@@ -129,6 +145,7 @@ struct cso_sampler {
    void *data;
    cso_state_callback delete_state;
    struct pipe_context *context;
+   unsigned last_use;   /* LRU stamp, maintained by the cache */
 };
 
 struct cso_velems_state {
@@ -141,6 +158,7 @@ struct cso_velements {
    void *data;
    cso_state_callback delete_state;
    struct pipe_context *context;
+   unsigned last_use;   /* LRU stamp, maintained by the cache */
 };
 
 unsigned cso_construct_key(void *item, int item_size);
@@ -168,6 +186,13 @@ void * cso_take_state(struct cso_cache *sc, unsigned hash_key,
 void cso_set_maximum_cache_size(struct cso_cache *sc, int number);
 int cso_maximum_cache_size(const struct cso_cache *sc);
 
+void cso_hash_remove_lru(struct cso_hash *hash, enum cso_cache_type type,
+                         int count, cso_delete_callback delete_cb,
+                         void *user_data);
+
+void cso_cache_get_stats(struct cso_cache *sc, enum cso_cache_type type,
+                         struct cso_cache_stats *stats);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -72,6 +72,11 @@ struct sampler_info
 
    struct pipe_sampler_view *views_saved[PIPE_MAX_SAMPLERS];
    unsigned nr_views_saved;
+
+   /* Template and handle of the last sampler created or found in the
+    * cache for each slot. */
+   struct pipe_sampler_state templ[PIPE_MAX_SAMPLERS];
+   void *templ_handle[PIPE_MAX_SAMPLERS];
 };
 
 
@@ -117,6 +122,24 @@ struct cso_context {
    struct pipe_blend_color blend_color;
    unsigned sample_mask, sample_mask_saved;
    struct pipe_stencil_ref stencil_ref, stencil_ref_saved;
+
+   /* Templates of the bound blend, depth/stencil/alpha, rasterizer and
+    * vertex elements states, so that setting the bound state again (which
+    * the state tracker does a lot) costs a single compare instead of a
+    * hash table lookup. A template is valid as long as its handle is the
+    * bound one.
+    */
+   struct pipe_blend_state blend_templ;
+   unsigned blend_templ_size;
+   void *blend_templ_handle;
+   struct pipe_depth_stencil_alpha_state depth_stencil_templ;
+   void *depth_stencil_templ_handle;
+   struct pipe_rasterizer_state rasterizer_templ;
+   void *rasterizer_templ_handle;
+   struct cso_velems_state velements_templ;
+   void *velements_templ_handle;
+
+   unsigned fast_hits[CSO_CACHE_MAX];
 };
 
 
@@ -126,6 +149,8 @@ static boolean delete_blend_state(struct cso_context *ctx, void *state)
 
    if (ctx->blend == cso->data)
       return FALSE;
+   if (ctx->blend_templ_handle == cso->data)
+      ctx->blend_templ_handle = NULL;
 
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
@@ -140,6 +165,8 @@ static boolean delete_depth_stencil_state(struct cso_context *ctx, void *state)
 
    if (ctx->depth_stencil == cso->data)
       return FALSE;
+   if (ctx->depth_stencil_templ_handle == cso->data)
+      ctx->depth_stencil_templ_handle = NULL;
 
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
@@ -151,6 +178,27 @@ static boolean delete_depth_stencil_state(struct cso_context *ctx, void *state)
 static boolean delete_sampler_state(struct cso_context *ctx, void *state)
 {
    struct cso_sampler *cso = (struct cso_sampler *)state;
+   unsigned shader, i;
+
+   for (shader = 0; shader < PIPE_SHADER_TYPES; shader++) {
+      struct sampler_info *info = &ctx->samplers[shader];
+
+      for (i = 0; i < PIPE_MAX_SAMPLERS; i++) {
+         if (info->samplers[i] == cso->data ||
+             info->hw.samplers[i] == cso->data ||
+             info->samplers_saved[i] == cso->data)
+            return FALSE;
+      }
+   }
+   for (shader = 0; shader < PIPE_SHADER_TYPES; shader++) {
+      struct sampler_info *info = &ctx->samplers[shader];
+
+      for (i = 0; i < PIPE_MAX_SAMPLERS; i++) {
+         if (info->templ_handle[i] == cso->data)
+            info->templ_handle[i] = NULL;
+      }
+   }
+
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
    FREE(state);
@@ -163,6 +211,8 @@ static boolean delete_rasterizer_state(struct cso_context *ctx, void *state)
 
    if (ctx->rasterizer == cso->data)
       return FALSE;
+   if (ctx->rasterizer_templ_handle == cso->data)
+      ctx->rasterizer_templ_handle = NULL;
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
    FREE(state);
@@ -176,6 +226,8 @@ static boolean delete_vertex_elements(struct cso_context *ctx,
 
    if (ctx->velements == cso->data)
       return FALSE;
+   if (ctx->velements_templ_handle == cso->data)
+      ctx->velements_templ_handle = NULL;
 
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
@@ -205,29 +257,26 @@ static INLINE boolean delete_cso(struct cso_context *ctx,
    return FALSE;
 }
 
+static boolean
+sanitize_delete_cso(void *state, enum cso_cache_type type, void *user_data)
+{
+   return delete_cso((struct cso_context *)user_data, state, type);
+}
+
 static INLINE void
 sanitize_hash(struct cso_hash *hash, enum cso_cache_type type,
               int max_size, void *user_data)
 {
-   struct cso_context *ctx = (struct cso_context *)user_data;
    /* if we're approach the maximum size, remove fourth of the entries
     * otherwise every subsequent call will go through the same */
    int hash_size = cso_hash_size(hash);
    int max_entries = (max_size > hash_size) ? max_size : hash_size;
    int to_remove =  (max_size < max_entries) * max_entries/4;
-   struct cso_hash_iter iter = cso_hash_first_node(hash);
    if (hash_size > max_size)
       to_remove += hash_size - max_size;
-   while (to_remove) {
-      /*remove elements until we're good */
-      /*fixme: currently we pick the nodes to remove at random*/
-      void *cso = cso_hash_iter_data(iter);
-      if (delete_cso(ctx, cso, type)) {
-         iter = cso_hash_erase(hash, iter);
-         --to_remove;
-      } else
-         iter = cso_hash_iter_next(iter);
-   }
+
+   /* the bound states are kept */
+   cso_hash_remove_lru(hash, type, to_remove, sanitize_delete_cso, user_data);
 }
 
 static void cso_init_vbuf(struct cso_context *cso)
@@ -355,6 +404,14 @@ void cso_destroy_context( struct cso_context *ctx )
 }
 
 
+void
+cso_get_cache_stats(struct cso_context *ctx, enum cso_cache_type type,
+                    struct cso_cache_stats *stats)
+{
+   cso_cache_get_stats(ctx->cache, type, stats);
+   stats->fast_hits = ctx->fast_hits[type];
+}
+
 /* Those function will either find the state of the given template
  * in the cache or they will create a new state from the given
  * template, insert it in the cache and return it.
@@ -375,6 +432,14 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
    key_size = templ->independent_blend_enable ?
       sizeof(struct pipe_blend_state) :
       (char *)&(templ->rt[1]) - (char *)templ;
+
+   if (ctx->blend && ctx->blend == ctx->blend_templ_handle &&
+       key_size == ctx->blend_templ_size &&
+       !memcmp(templ, &ctx->blend_templ, key_size)) {
+      ctx->fast_hits[CSO_BLEND]++;
+      return PIPE_OK;
+   }
+
    hash_key = cso_construct_key((void*)templ, key_size);
    iter = cso_find_state_template(ctx->cache, hash_key, CSO_BLEND,
                                   (void*)templ, key_size);
@@ -402,6 +467,10 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
       handle = ((struct cso_blend *)cso_hash_iter_data(iter))->data;
    }
 
+   memcpy(&ctx->blend_templ, templ, key_size);
+   ctx->blend_templ_size = key_size;
+   ctx->blend_templ_handle = handle;
+
    if (ctx->blend != handle) {
       ctx->blend = handle;
       ctx->pipe->bind_blend_state(ctx->pipe, handle);
@@ -431,13 +500,22 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
                             const struct pipe_depth_stencil_alpha_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_depth_stencil_alpha_state);
-   unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_DEPTH_STENCIL_ALPHA,
-                                                       (void*)templ, key_size);
+   unsigned hash_key;
+   struct cso_hash_iter iter;
    void *handle;
 
+   if (ctx->depth_stencil &&
+       ctx->depth_stencil == ctx->depth_stencil_templ_handle &&
+       !memcmp(templ, &ctx->depth_stencil_templ, key_size)) {
+      ctx->fast_hits[CSO_DEPTH_STENCIL_ALPHA]++;
+      return PIPE_OK;
+   }
+
+   hash_key = cso_construct_key((void*)templ, key_size);
+   iter = cso_find_state_template(ctx->cache, hash_key,
+                                  CSO_DEPTH_STENCIL_ALPHA,
+                                  (void*)templ, key_size);
+
    if (cso_hash_iter_is_null(iter)) {
       struct cso_depth_stencil_alpha *cso =
          MALLOC(sizeof(struct cso_depth_stencil_alpha));
@@ -465,6 +543,9 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
                 cso_hash_iter_data(iter))->data;
    }
 
+   ctx->depth_stencil_templ = *templ;
+   ctx->depth_stencil_templ_handle = handle;
+
    if (ctx->depth_stencil != handle) {
       ctx->depth_stencil = handle;
       ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe, handle);
@@ -494,13 +575,20 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
                                    const struct pipe_rasterizer_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_rasterizer_state);
-   unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_RASTERIZER,
-                                                       (void*)templ, key_size);
+   unsigned hash_key;
+   struct cso_hash_iter iter;
    void *handle = NULL;
 
+   if (ctx->rasterizer && ctx->rasterizer == ctx->rasterizer_templ_handle &&
+       !memcmp(templ, &ctx->rasterizer_templ, key_size)) {
+      ctx->fast_hits[CSO_RASTERIZER]++;
+      return PIPE_OK;
+   }
+
+   hash_key = cso_construct_key((void*)templ, key_size);
+   iter = cso_find_state_template(ctx->cache, hash_key, CSO_RASTERIZER,
+                                  (void*)templ, key_size);
+
    if (cso_hash_iter_is_null(iter)) {
       struct cso_rasterizer *cso = MALLOC(sizeof(struct cso_rasterizer));
       if (!cso)
@@ -524,6 +612,9 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
       handle = ((struct cso_rasterizer *)cso_hash_iter_data(iter))->data;
    }
 
+   ctx->rasterizer_templ = *templ;
+   ctx->rasterizer_templ_handle = handle;
+
    if (ctx->rasterizer != handle) {
       ctx->rasterizer = handle;
       ctx->pipe->bind_rasterizer_state(ctx->pipe, handle);
@@ -838,6 +929,14 @@ cso_set_vertex_elements(struct cso_context *ctx,
       return PIPE_OK;
    }
 
+   if (ctx->velements && ctx->velements == ctx->velements_templ_handle &&
+       count == ctx->velements_templ.count &&
+       !memcmp(states, ctx->velements_templ.velems,
+               sizeof(struct pipe_vertex_element) * count)) {
+      ctx->fast_hits[CSO_VELEMENTS]++;
+      return PIPE_OK;
+   }
+
    /* Need to include the count into the stored state data too.
     * Otherwise first few count pipe_vertex_elements could be identical
     * even if count is different, and there's no guarantee the hash would
@@ -875,6 +974,9 @@ cso_set_vertex_elements(struct cso_context *ctx,
       handle = ((struct cso_velements *)cso_hash_iter_data(iter))->data;
    }
 
+   memcpy(&ctx->velements_templ, &velems_state, key_size);
+   ctx->velements_templ_handle = handle;
+
    if (ctx->velements != handle) {
       ctx->velements = handle;
       ctx->pipe->bind_vertex_elements_state(ctx->pipe, handle);
@@ -981,6 +1083,12 @@ unsigned cso_get_aux_vertex_buffer_slot(struct cso_context *ctx)
    return ctx->aux_vertex_buffer_index;
 }
 
+void cso_enable_vbuf_cache(struct cso_context *ctx)
+{
+   if (ctx->vbuf)
+      u_vbuf_enable_cache(ctx->vbuf);
+}
+
 
 /**************** fragment/vertex sampler view state *************************/
 
@@ -994,11 +1102,19 @@ single_sampler(struct cso_context *ctx,
 
    if (templ != NULL) {
       unsigned key_size = sizeof(struct pipe_sampler_state);
-      unsigned hash_key = cso_construct_key((void*)templ, key_size);
-      struct cso_hash_iter iter =
-         cso_find_state_template(ctx->cache,
-                                 hash_key, CSO_SAMPLER,
-                                 (void *) templ, key_size);
+      unsigned hash_key;
+      struct cso_hash_iter iter;
+
+      if (info->templ_handle[idx] &&
+          !memcmp(templ, &info->templ[idx], key_size)) {
+         ctx->fast_hits[CSO_SAMPLER]++;
+         info->samplers[idx] = info->templ_handle[idx];
+         return PIPE_OK;
+      }
+
+      hash_key = cso_construct_key((void*)templ, key_size);
+      iter = cso_find_state_template(ctx->cache, hash_key, CSO_SAMPLER,
+                                     (void *) templ, key_size);
 
       if (cso_hash_iter_is_null(iter)) {
          struct cso_sampler *cso = MALLOC(sizeof(struct cso_sampler));
@@ -1022,6 +1138,9 @@ single_sampler(struct cso_context *ctx,
       else {
          handle = ((struct cso_sampler *)cso_hash_iter_data(iter))->data;
       }
+
+      info->templ[idx] = *templ;
+      info->templ_handle[idx] = handle;
    }
 
    info->samplers[idx] = handle;
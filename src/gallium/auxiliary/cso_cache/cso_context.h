@@ -32,6 +32,7 @@
 #include "pipe/p_context.h"
 #include "pipe/p_state.h"
 #include "pipe/p_defines.h"
+#include "cso_cache/cso_cache.h"
 
 
 #ifdef	__cplusplus
@@ -47,6 +48,14 @@ void cso_release_all( struct cso_context *ctx );
 
 void cso_destroy_context( struct cso_context *cso );
 
+/**
+ * Return the cache counters for a state type. fast_hits counts the
+ * set calls which matched the bound state and skipped the hash lookup.
+ */
+void
+cso_get_cache_stats(struct cso_context *cso, enum cso_cache_type type,
+                    struct cso_cache_stats *stats);
+
 
 
 enum pipe_error cso_set_blend( struct cso_context *cso,
@@ -111,6 +120,10 @@ void cso_save_aux_vertex_buffer_slot(struct cso_context *ctx);
 void cso_restore_aux_vertex_buffer_slot(struct cso_context *ctx);
 unsigned cso_get_aux_vertex_buffer_slot(struct cso_context *ctx);
 
+/* Enable the translated vertex buffer cache of u_vbuf, if it's in use.
+ * The caller takes on the duties described at u_vbuf_enable_cache. */
+void cso_enable_vbuf_cache(struct cso_context *ctx);
+
 
 void cso_set_stream_outputs(struct cso_context *ctx,
                             unsigned num_targets,
@@ -30,410 +30,452 @@
   *   Zack Rusin <zack@tungstengraphics.com>
   */
 
+#include "pipe/p_config.h"
 #include "util/u_debug.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 
 #include "cso_hash.h"
 
-#define MAX(a, b) ((a > b) ? (a) : (b))
+#if defined(PIPE_ARCH_SSE)
+#include <emmintrin.h>
+#endif
 
-static const int MinNumBits = 4;
 
-static const unsigned char prime_deltas[] = {
-   0,  0,  1,  3,  1,  5,  3,  3,  1,  9,  7,  5,  3,  9, 25,  3,
-   1, 21,  3, 21,  7, 15,  9,  5,  3, 29, 15,  0,  0,  0,  0,  0
-};
+/*
+ * The table is a power of two array of slots, each holding a key and a
+ * value inline, plus one control byte per slot:
+ *
+ *  - CTRL_EMPTY: the slot has not been used since the last rehash;
+ *  - CTRL_DELETED: a tombstone left by erase;
+ *  - 0..127: the slot is used and this is 7 bits of the hashed key.
+ *
+ * Slots are split in aligned groups of CTRL_GROUP. Lookups compare the
+ * control bytes of a whole group against the 7 bit tag at once, so only
+ * slots whose tag matches are ever touched, and move on to the next group
+ * of the (triangular) probe sequence only when the group has no empty
+ * slot.
+ *
+ * Since a slot belongs to exactly one group, the probe state of a by-key
+ * iterator can be recomputed from its slot and key, which keeps iterators
+ * small enough to be passed around in registers.
+ */
 
-static int primeForNumBits(int numBits)
-{
-   return (1 << numBits) + prime_deltas[numBits];
-}
+#define CTRL_EMPTY   ((signed char)-128)
+#define CTRL_DELETED ((signed char)-2)
 
-/*
-    Returns the smallest integer n such that
-    primeForNumBits(n) >= hint.
-*/
-static int countBits(int hint)
-{
-   int numBits = 0;
-   int bits = hint;
+#define CTRL_GROUP 16
 
-   while (bits > 1) {
-      bits >>= 1;
-      numBits++;
-   }
+#define MIN_NUM_SLOTS CTRL_GROUP
 
-   if (numBits >= (int)sizeof(prime_deltas)) {
-      numBits = sizeof(prime_deltas) - 1;
-   } else if (primeForNumBits(numBits) < hint) {
-      ++numBits;
-   }
-   return numBits;
-}
 
-struct cso_node {
-   struct cso_node *next;
+struct cso_hash_slot {
    unsigned key;
    void *value;
 };
 
-struct cso_hash_data {
-   struct cso_node *fakeNext;
-   struct cso_node **buckets;
-   int size;
-   int nodeSize;
-   short userNumBits;
-   short numBits;
-   int numBuckets;
-};
-
 struct cso_hash {
-   union {
-      struct cso_hash_data *d;
-      struct cso_node      *e;
-   } data;
+   signed char *ctrl;
+   struct cso_hash_slot *slots;
+   unsigned num_slots;     /**< power of two, or zero */
+   unsigned size;          /**< number of live entries */
+   unsigned growth_left;   /**< empty slots we may still fill */
 };
 
-static void *cso_data_allocate_node(struct cso_hash_data *hash)
+
+static INLINE unsigned
+cso_hash_mix(unsigned key)
 {
-   return MALLOC(hash->nodeSize);
+   /* Keys are often already hashes, but some users pass pointers or small
+    * integers, so spread the bits before using them (murmur3 finalizer).
+    */
+   key ^= key >> 16;
+   key *= 0x85ebca6b;
+   key ^= key >> 13;
+   key *= 0xc2b2ae35;
+   key ^= key >> 16;
+   return key;
 }
 
-static void cso_free_node(struct cso_node *node)
+/** First slot of the first group to probe. */
+static INLINE unsigned
+cso_hash_start(const struct cso_hash *hash, unsigned h)
 {
-   FREE(node);
+   return ((h >> 7) * CTRL_GROUP) & (hash->num_slots - 1);
 }
 
-static struct cso_node *
-cso_hash_create_node(struct cso_hash *hash,
-                      unsigned akey, void *avalue,
-                      struct cso_node **anextNode)
+static INLINE signed char
+cso_hash_tag(unsigned h)
 {
-   struct cso_node *node = cso_data_allocate_node(hash->data.d);
+   return (signed char)(h & 0x7f);
+}
 
-   if (!node)
-      return NULL;
+static INLINE unsigned
+cso_hash_capacity(unsigned num_slots)
+{
+   /* Maximum load factor of 7/8. */
+   return num_slots - num_slots / 8;
+}
 
-   node->key = akey;
-   node->value = avalue;
 
-   node->next = (struct cso_node*)(*anextNode);
-   *anextNode = node;
-   ++hash->data.d->size;
-   return node;
+#if defined(PIPE_ARCH_SSE)
+
+static INLINE unsigned
+ctrl_match(const signed char *ctrl, signed char tag)
+{
+   __m128i group = _mm_load_si128((const __m128i *)ctrl);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag)));
 }
 
-static void cso_data_rehash(struct cso_hash_data *hash, int hint)
+static INLINE unsigned
+ctrl_match_empty_or_deleted(const signed char *ctrl)
 {
-   if (hint < 0) {
-      hint = countBits(-hint);
-      if (hint < MinNumBits)
-         hint = MinNumBits;
-      hash->userNumBits = (short)hint;
-      while (primeForNumBits(hint) < (hash->size >> 1))
-         ++hint;
-   } else if (hint < MinNumBits) {
-      hint = MinNumBits;
-   }
+   /* Both special values are below -1, tags are not. */
+   __m128i group = _mm_load_si128((const __m128i *)ctrl);
+   return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), group));
+}
 
-   if (hash->numBits != hint) {
-      struct cso_node *e = (struct cso_node *)(hash);
-      struct cso_node **oldBuckets = hash->buckets;
-      int oldNumBuckets = hash->numBuckets;
-      int  i = 0;
-
-      hash->numBits = (short)hint;
-      hash->numBuckets = primeForNumBits(hint);
-      hash->buckets = MALLOC(sizeof(struct cso_node*) * hash->numBuckets);
-      for (i = 0; i < hash->numBuckets; ++i)
-         hash->buckets[i] = e;
-
-      for (i = 0; i < oldNumBuckets; ++i) {
-         struct cso_node *firstNode = oldBuckets[i];
-         while (firstNode != e) {
-            unsigned h = firstNode->key;
-            struct cso_node *lastNode = firstNode;
-            struct cso_node *afterLastNode;
-            struct cso_node **beforeFirstNode;
-            
-            while (lastNode->next != e && lastNode->next->key == h)
-               lastNode = lastNode->next;
-
-            afterLastNode = lastNode->next;
-            beforeFirstNode = &hash->buckets[h % hash->numBuckets];
-            while (*beforeFirstNode != e)
-               beforeFirstNode = &(*beforeFirstNode)->next;
-            lastNode->next = *beforeFirstNode;
-            *beforeFirstNode = firstNode;
-            firstNode = afterLastNode;
-         }
-      }
-      FREE(oldBuckets);
-   }
+static INLINE unsigned
+ctrl_match_full(const signed char *ctrl)
+{
+   __m128i group = _mm_load_si128((const __m128i *)ctrl);
+   return ~_mm_movemask_epi8(group) & 0xffff;
 }
 
-static void cso_data_might_grow(struct cso_hash_data *hash)
+#else
+
+static INLINE unsigned
+ctrl_match(const signed char *ctrl, signed char tag)
 {
-   if (hash->size >= hash->numBuckets)
-      cso_data_rehash(hash, hash->numBits + 1);
+   unsigned mask = 0;
+   unsigned i;
+   for (i = 0; i < CTRL_GROUP; i++)
+      mask |= (unsigned)(ctrl[i] == tag) << i;
+   return mask;
 }
 
-static void cso_data_has_shrunk(struct cso_hash_data *hash)
+static INLINE unsigned
+ctrl_match_empty_or_deleted(const signed char *ctrl)
 {
-   if (hash->size <= (hash->numBuckets >> 3) &&
-       hash->numBits > hash->userNumBits) {
-      int max = MAX(hash->numBits-2, hash->userNumBits);
-      cso_data_rehash(hash,  max);
-   }
+   unsigned mask = 0;
+   unsigned i;
+   for (i = 0; i < CTRL_GROUP; i++)
+      mask |= (unsigned)(ctrl[i] < -1) << i;
+   return mask;
 }
 
-static struct cso_node *cso_data_first_node(struct cso_hash_data *hash)
+static INLINE unsigned
+ctrl_match_full(const signed char *ctrl)
 {
-   struct cso_node *e = (struct cso_node *)(hash);
-   struct cso_node **bucket = hash->buckets;
-   int n = hash->numBuckets;
-   while (n--) {
-      if (*bucket != e)
-         return *bucket;
-      ++bucket;
-   }
-   return e;
+   unsigned mask = 0;
+   unsigned i;
+   for (i = 0; i < CTRL_GROUP; i++)
+      mask |= (unsigned)(ctrl[i] >= 0) << i;
+   return mask;
 }
 
-static struct cso_node **cso_hash_find_node(struct cso_hash *hash, unsigned akey)
+#endif
+
+
+/**
+ * Find the first empty or deleted slot on the probe sequence of h.
+ */
+static unsigned
+cso_hash_find_free(const struct cso_hash *hash, unsigned h)
 {
-   struct cso_node **node;
-
-   if (hash->data.d->numBuckets) {
-      node = (struct cso_node **)(&hash->data.d->buckets[akey % hash->data.d->numBuckets]);
-      assert(*node == hash->data.e || (*node)->next);
-      while (*node != hash->data.e && (*node)->key != akey)
-         node = &(*node)->next;
-   } else {
-      node = (struct cso_node **)((const struct cso_node * const *)(&hash->data.e));
+   unsigned mask = hash->num_slots - 1;
+   unsigned pos = cso_hash_start(hash, h);
+   unsigned stride = 0;
+
+   for (;;) {
+      unsigned free_mask = ctrl_match_empty_or_deleted(hash->ctrl + pos);
+      if (free_mask)
+         return pos + ffs(free_mask) - 1;
+      stride += CTRL_GROUP;
+      pos = (pos + stride) & mask;
    }
-   return node;
 }
 
-struct cso_hash_iter cso_hash_insert(struct cso_hash *hash,
-                                       unsigned key, void *data)
+
+/**
+ * Look for key on the probe sequence of h, starting with the candidates in
+ * match of the group at pos. Returns the slot or -1.
+ */
+static INLINE int
+cso_hash_probe(const struct cso_hash *hash, unsigned key, unsigned h,
+               unsigned pos, unsigned stride, unsigned match)
 {
-   cso_data_might_grow(hash->data.d);
-
-   {
-      struct cso_node **nextNode = cso_hash_find_node(hash, key);
-      struct cso_node *node = cso_hash_create_node(hash, key, data, nextNode);
-      if (!node) {
-         struct cso_hash_iter null_iter = {hash, 0};
-         return null_iter;
+   unsigned mask = hash->num_slots - 1;
+   signed char tag = cso_hash_tag(h);
+
+   for (;;) {
+      while (match) {
+         unsigned i = pos + ffs(match) - 1;
+         if (hash->slots[i].key == key)
+            return i;
+         match &= match - 1;
       }
 
-      {
-         struct cso_hash_iter iter = {hash, node};
-         return iter;
-      }
+      /* Entries are never placed past a group with an empty slot. */
+      if (ctrl_match(hash->ctrl + pos, CTRL_EMPTY))
+         return -1;
+
+      stride += CTRL_GROUP;
+      pos = (pos + stride) & mask;
+      match = ctrl_match(hash->ctrl + pos, tag);
    }
 }
 
-struct cso_hash * cso_hash_create(void)
+
+static boolean
+cso_hash_resize(struct cso_hash *hash, unsigned num_slots)
 {
-   struct cso_hash *hash = MALLOC_STRUCT(cso_hash);
-   if (!hash)
-      return NULL;
-
-   hash->data.d = MALLOC_STRUCT(cso_hash_data);
-   if (!hash->data.d) {
-      FREE(hash);
-      return NULL;
+   signed char *old_ctrl = hash->ctrl;
+   struct cso_hash_slot *old_slots = hash->slots;
+   unsigned old_num_slots = hash->num_slots;
+   signed char *ctrl;
+   unsigned i;
+
+   ctrl = align_malloc(num_slots + num_slots * sizeof(struct cso_hash_slot),
+                       CTRL_GROUP);
+   if (!ctrl)
+      return FALSE;
+
+   hash->ctrl = ctrl;
+   hash->slots = (struct cso_hash_slot *)(ctrl + num_slots);
+   hash->num_slots = num_slots;
+   hash->growth_left = cso_hash_capacity(num_slots) - hash->size;
+   memset(ctrl, CTRL_EMPTY, num_slots);
+
+   for (i = 0; i < old_num_slots; i++) {
+      if (old_ctrl[i] >= 0) {
+         unsigned h = cso_hash_mix(old_slots[i].key);
+         unsigned j = cso_hash_find_free(hash, h);
+         ctrl[j] = cso_hash_tag(h);
+         hash->slots[j] = old_slots[i];
+      }
    }
 
-   hash->data.d->fakeNext = 0;
-   hash->data.d->buckets = 0;
-   hash->data.d->size = 0;
-   hash->data.d->nodeSize = sizeof(struct cso_node);
-   hash->data.d->userNumBits = (short)MinNumBits;
-   hash->data.d->numBits = 0;
-   hash->data.d->numBuckets = 0;
+   align_free(old_ctrl);
+   return TRUE;
+}
 
-   return hash;
+
+struct cso_hash * cso_hash_create(void)
+{
+   return CALLOC_STRUCT(cso_hash);
 }
 
 void cso_hash_delete(struct cso_hash *hash)
 {
-   struct cso_node *e_for_x = (struct cso_node *)(hash->data.d);
-   struct cso_node **bucket = (struct cso_node **)(hash->data.d->buckets);
-   int n = hash->data.d->numBuckets;
-   while (n--) {
-      struct cso_node *cur = *bucket++;
-      while (cur != e_for_x) {
-         struct cso_node *next = cur->next;
-         cso_free_node(cur);
-         cur = next;
-      }
-   }
-   FREE(hash->data.d->buckets);
-   FREE(hash->data.d);
+   align_free(hash->ctrl);
    FREE(hash);
 }
 
-struct cso_hash_iter cso_hash_find(struct cso_hash *hash,
-                                     unsigned key)
+int cso_hash_size(struct cso_hash *hash)
 {
-   struct cso_node **nextNode = cso_hash_find_node(hash, key);
-   struct cso_hash_iter iter = {hash, *nextNode};
-   return iter;
+   return hash->size;
 }
 
-unsigned cso_hash_iter_key(struct cso_hash_iter iter)
+
+static INLINE struct cso_hash_iter
+cso_hash_make_iter(struct cso_hash *hash, int slot, boolean by_key)
 {
-   if (!iter.node || iter.hash->data.e == iter.node)
-      return 0;
-   return iter.node->key;
+   struct cso_hash_iter iter;
+   iter.hash = hash;
+   iter.slot = slot;
+   iter.by_key = by_key;
+   return iter;
 }
 
-void * cso_hash_iter_data(struct cso_hash_iter iter)
+
+struct cso_hash_iter cso_hash_insert(struct cso_hash *hash,
+                                       unsigned key, void *data)
 {
-   if (!iter.node || iter.hash->data.e == iter.node)
-      return 0;
-   return iter.node->value;
+   unsigned h = cso_hash_mix(key);
+   unsigned i;
+
+   if (!hash->num_slots) {
+      if (!cso_hash_resize(hash, MIN_NUM_SLOTS))
+         return cso_hash_make_iter(hash, -1, FALSE);
+   }
+
+   i = cso_hash_find_free(hash, h);
+
+   if (hash->ctrl[i] == CTRL_EMPTY && !hash->growth_left) {
+      /* Out of empty slots. If many of the used ones are tombstones,
+       * rehashing at the same size is enough to reclaim them.
+       */
+      unsigned num_slots = hash->num_slots;
+      if (hash->size > cso_hash_capacity(num_slots) / 2)
+         num_slots *= 2;
+      if (!cso_hash_resize(hash, num_slots))
+         return cso_hash_make_iter(hash, -1, FALSE);
+      i = cso_hash_find_free(hash, h);
+   }
+
+   if (hash->ctrl[i] == CTRL_EMPTY)
+      --hash->growth_left;
+
+   hash->ctrl[i] = cso_hash_tag(h);
+   hash->slots[i].key = key;
+   hash->slots[i].value = data;
+   ++hash->size;
+
+   return cso_hash_make_iter(hash, i, TRUE);
 }
 
-static struct cso_node *cso_hash_data_next(struct cso_node *node)
+
+/**
+ * Find the next used slot at or after i, in table order.
+ */
+static int
+cso_hash_scan(const struct cso_hash *hash, unsigned i)
 {
-   union {
-      struct cso_node *next;
-      struct cso_node *e;
-      struct cso_hash_data *d;
-   } a;
-   int start;
-   struct cso_node **bucket;
-   int n;
-
-   a.next = node->next;
-   if (!a.next) {
-      debug_printf("iterating beyond the last element\n");
-      return 0;
-   }
-   if (a.next->next)
-      return a.next;
-
-   start = (node->key % a.d->numBuckets) + 1;
-   bucket = a.d->buckets + start;
-   n = a.d->numBuckets - start;
-   while (n--) {
-      if (*bucket != a.e)
-         return *bucket;
-      ++bucket;
+   unsigned pos = i & ~(CTRL_GROUP - 1);
+   unsigned full;
+
+   if (pos >= hash->num_slots)
+      return -1;
+
+   full = ctrl_match_full(hash->ctrl + pos) & (~0u << (i - pos));
+   while (!full) {
+      pos += CTRL_GROUP;
+      if (pos >= hash->num_slots)
+         return -1;
+      full = ctrl_match_full(hash->ctrl + pos);
    }
-   return a.e;
+   return pos + ffs(full) - 1;
 }
 
 
-static struct cso_node *cso_hash_data_prev(struct cso_node *node)
+/**
+ * Find the next slot after the given one that holds the same key.
+ */
+static int
+cso_hash_next_with_key(const struct cso_hash *hash, unsigned slot)
 {
-   union {
-      struct cso_node *e;
-      struct cso_hash_data *d;
-   } a;
-   int start;
-   struct cso_node *sentinel;
-   struct cso_node **bucket;
-
-   a.e = node;
-   while (a.e->next)
-      a.e = a.e->next;
-
-   if (node == a.e)
-      start = a.d->numBuckets - 1;
-   else
-      start = node->key % a.d->numBuckets;
-
-   sentinel = node;
-   bucket = a.d->buckets + start;
-   while (start >= 0) {
-      if (*bucket != sentinel) {
-         struct cso_node *prev = *bucket;
-         while (prev->next != sentinel)
-            prev = prev->next;
-         return prev;
-      }
+   unsigned mask = hash->num_slots - 1;
+   unsigned key = hash->slots[slot].key;
+   unsigned h = cso_hash_mix(key);
+   unsigned group = slot & ~(CTRL_GROUP - 1);
+   unsigned pos = cso_hash_start(hash, h);
+   unsigned stride = 0;
+   unsigned match;
+
+   /* Replay the probe sequence up to the slot's group. Entries erased
+    * from under the iterator keep their key, so this works for them too.
+    */
+   while (pos != group) {
+      stride += CTRL_GROUP;
+      pos = (pos + stride) & mask;
+   }
+
+   match = ctrl_match(hash->ctrl + pos, cso_hash_tag(h));
+   match &= ~0u << (slot - pos) << 1;
+   return cso_hash_probe(hash, key, h, pos, stride, match);
+}
 
-      sentinel = a.e;
-      --bucket;
-      --start;
+
+struct cso_hash_iter cso_hash_find(struct cso_hash *hash,
+                                     unsigned key)
+{
+   unsigned h, pos;
+   int slot = -1;
+
+   if (hash->num_slots) {
+      h = cso_hash_mix(key);
+      pos = cso_hash_start(hash, h);
+      slot = cso_hash_probe(hash, key, h, pos, 0,
+                            ctrl_match(hash->ctrl + pos, cso_hash_tag(h)));
    }
-   debug_printf("iterating backward beyond first element\n");
-   return a.e;
+
+   return cso_hash_make_iter(hash, slot, TRUE);
+}
+
+unsigned cso_hash_iter_key(struct cso_hash_iter iter)
+{
+   if (iter.slot < 0)
+      return 0;
+   return iter.hash->slots[iter.slot].key;
+}
+
+void * cso_hash_iter_data(struct cso_hash_iter iter)
+{
+   if (iter.slot < 0)
+      return 0;
+   return iter.hash->slots[iter.slot].value;
 }
 
 struct cso_hash_iter cso_hash_iter_next(struct cso_hash_iter iter)
 {
-   struct cso_hash_iter next = {iter.hash, cso_hash_data_next(iter.node)};
-   return next;
+   if (iter.slot < 0) {
+      debug_printf("iterating beyond the last element\n");
+      return iter;
+   }
+
+   if (iter.by_key)
+      iter.slot = cso_hash_next_with_key(iter.hash, iter.slot);
+   else
+      iter.slot = cso_hash_scan(iter.hash, iter.slot + 1);
+   return iter;
 }
 
 int cso_hash_iter_is_null(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.node == iter.hash->data.e)
-      return 1;
-   return 0;
+   return iter.slot < 0;
 }
 
 void * cso_hash_take(struct cso_hash *hash,
                       unsigned akey)
 {
-   struct cso_node **node = cso_hash_find_node(hash, akey);
-   if (*node != hash->data.e) {
-      void *t = (*node)->value;
-      struct cso_node *next = (*node)->next;
-      cso_free_node(*node);
-      *node = next;
-      --hash->data.d->size;
-      cso_data_has_shrunk(hash->data.d);
-      return t;
-   }
-   return 0;
+   struct cso_hash_iter iter = cso_hash_find(hash, akey);
+
+   if (iter.slot < 0)
+      return 0;
+
+   hash->ctrl[iter.slot] = CTRL_DELETED;
+   --hash->size;
+   return hash->slots[iter.slot].value;
 }
 
 struct cso_hash_iter cso_hash_iter_prev(struct cso_hash_iter iter)
 {
-   struct cso_hash_iter prev = {iter.hash,
-                                 cso_hash_data_prev(iter.node)};
-   return prev;
-}
+   struct cso_hash *hash = iter.hash;
+   int i = iter.slot < 0 ? (int)hash->num_slots : iter.slot;
 
-struct cso_hash_iter cso_hash_first_node(struct cso_hash *hash)
-{
-   struct cso_hash_iter iter = {hash, cso_data_first_node(hash->data.d)};
-   return iter;
+   /* Always table order, even for iterators from cso_hash_find(). */
+   while (--i >= 0) {
+      if (hash->ctrl[i] >= 0)
+         return cso_hash_make_iter(hash, i, FALSE);
+   }
+   debug_printf("iterating backward beyond first element\n");
+   return cso_hash_make_iter(hash, -1, FALSE);
 }
 
-int cso_hash_size(struct cso_hash *hash)
+struct cso_hash_iter cso_hash_first_node(struct cso_hash *hash)
 {
-   return hash->data.d->size;
+   return cso_hash_make_iter(hash, cso_hash_scan(hash, 0), FALSE);
 }
 
 struct cso_hash_iter cso_hash_erase(struct cso_hash *hash, struct cso_hash_iter iter)
 {
-   struct cso_hash_iter ret = iter;
-   struct cso_node *node = iter.node;
-   struct cso_node **node_ptr;
-
-   if (node == hash->data.e)
+   if (iter.slot < 0)
       return iter;
 
-   ret = cso_hash_iter_next(ret);
-   node_ptr = (struct cso_node**)(&hash->data.d->buckets[node->key % hash->data.d->numBuckets]);
-   while (*node_ptr != node)
-      node_ptr = &(*node_ptr)->next;
-   *node_ptr = node->next;
-   cso_free_node(node);
-   --hash->data.d->size;
-   return ret;
+   assert(hash->ctrl[iter.slot] >= 0);
+
+   /* Leave a tombstone so that probe sequences through this slot still
+    * reach the entries past it. The table is never shrunk here, which keeps
+    * the returned iterator valid.
+    */
+   hash->ctrl[iter.slot] = CTRL_DELETED;
+   --hash->size;
+
+   return cso_hash_iter_next(iter);
 }
 
 boolean cso_hash_contains(struct cso_hash *hash, unsigned key)
 {
-   struct cso_node **node = cso_hash_find_node(hash, key);
-   return (*node != hash->data.e);
+   return !cso_hash_iter_is_null(cso_hash_find(hash, key));
 }
@@ -30,13 +30,14 @@
  * Hash table implementation.
  * 
  * This file provides a hash implementation that is capable of dealing
- * with collisions. It stores colliding entries in linked list. All
- * functions operating on the hash return an iterator. The iterator
- * itself points to the collision list. If there wasn't any collision
- * the list will have just one entry, otherwise client code should
- * iterate over the entries to find the exact entry among ones that
- * had the same key (e.g. memcmp could be used on the data to check
- * that)
+ * with collisions. Entries are stored inline in a single open-addressed
+ * array, with a parallel array of one byte control words (empty, deleted,
+ * or 7 bits of the hashed key) that is probed sixteen slots at a time.
+ * All functions operating on the hash return an iterator. An iterator
+ * returned by cso_hash_find() walks only the entries that share its key,
+ * so client code should iterate over them to find the exact entry among
+ * ones that had the same key (e.g. memcmp could be used on the data to
+ * check that). Iterators from cso_hash_first_node() walk the whole table.
  * 
  * @author Zack Rusin <zack@tungstengraphics.com>
  */
@@ -52,12 +53,12 @@ extern "C" {
 
 
 struct cso_hash;
-struct cso_node;
 
 
 struct cso_hash_iter {
    struct cso_hash *hash;
-   struct cso_node  *node;
+   int slot;           /**< -1 for the null iterator */
+   boolean by_key;     /**< only visit entries with the same key */
 };
 
 
@@ -70,9 +71,10 @@ int              cso_hash_size(struct cso_hash *hash);
 
 /**
  * Adds a data with the given key to the hash. If entry with the given
- * key is already in the hash, this current entry is instered before it
- * in the collision list.
- * Function returns iterator pointing to the inserted item in the hash.
+ * key is already in the hash, both entries are kept and will be visited
+ * when iterating from cso_hash_find().
+ * Function returns iterator pointing to the inserted item in the hash,
+ * or a null iterator if out of memory.
  */
 struct cso_hash_iter cso_hash_insert(struct cso_hash *hash, unsigned key,
                                      void *data);
@@ -81,7 +83,8 @@ struct cso_hash_iter cso_hash_insert(struct cso_hash *hash, unsigned key,
  * Note that the data itself is not erased and if it was a malloc'ed pointer
  * it will have to be freed after calling this function by the callee.
  * Function returns iterator pointing to the item after the removed one in
- * the hash.
+ * the hash, in the same iteration order as the passed iterator.
+ * Removal never resizes the table, so other iterators stay valid.
  */
 struct cso_hash_iter cso_hash_erase(struct cso_hash *hash, struct cso_hash_iter iter);
 
@@ -92,7 +95,9 @@ void  *cso_hash_take(struct cso_hash *hash, unsigned key);
 struct cso_hash_iter cso_hash_first_node(struct cso_hash *hash);
 
 /**
- * Return an iterator pointing to the first entry in the collision list.
+ * Return an iterator pointing to the first entry with the given key.
+ * Advancing it with cso_hash_iter_next() yields the remaining entries
+ * with that key and then a null iterator.
  */
 struct cso_hash_iter cso_hash_find(struct cso_hash *hash, unsigned key);
 
@@ -79,6 +79,36 @@ os_time_get_nano(void)
 }
 
 
+int64_t
+os_time_get_thread_cpu_nano(void)
+{
+#if defined(PIPE_OS_LINUX)
+
+   struct timespec tv;
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &tv);
+   return tv.tv_nsec + tv.tv_sec*INT64_C(1000000000);
+
+#elif defined(PIPE_SUBSYSTEM_WINDOWS_USER)
+
+   FILETIME creation, exit, kernel, user;
+   ULARGE_INTEGER k, u;
+   if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+      return os_time_get_nano();
+   k.LowPart = kernel.dwLowDateTime;
+   k.HighPart = kernel.dwHighDateTime;
+   u.LowPart = user.dwLowDateTime;
+   u.HighPart = user.dwHighDateTime;
+   /* 100 ns units */
+   return (int64_t)(k.QuadPart + u.QuadPart) * 100;
+
+#else
+
+   return os_time_get_nano();
+
+#endif
+}
+
+
 #if defined(PIPE_SUBSYSTEM_WINDOWS_USER)
 
 void
@@ -57,6 +57,16 @@ int64_t
 os_time_get_nano(void);
 
 
+/*
+ * Get the CPU time consumed by the calling thread, in nanoseconds.
+ *
+ * Falls back to os_time_get_nano() where per-thread CPU clocks are not
+ * available.
+ */
+int64_t
+os_time_get_thread_cpu_nano(void);
+
+
 /*
  * Get the current time in microseconds from an unknown base.
  */
@@ -158,12 +158,31 @@ pb_slab_range_manager_create(struct pb_manager *provider,
  * Time-based buffer cache.
  *
  * This manager keeps a cache of destroyed buffers during a time interval. 
+ * Expired buffers are freed when buffers are created or destroyed, on the
+ * calling thread.
  */
 struct pb_manager *
 pb_cache_manager_create(struct pb_manager *provider, 
                      	unsigned usecs); 
 
 
+struct pb_cache_stats
+{
+   uint64_t hits;         /**< buffers created from the cache */
+   uint64_t misses;       /**< buffers created by the provider */
+   uint64_t expired;      /**< cached buffers freed after the time interval */
+   unsigned num_buffers;  /**< buffers currently in the cache */
+   uint64_t cached_size;  /**< bytes currently held by the cache */
+};
+
+/**
+ * Get the statistics of a manager made by pb_cache_manager_create().
+ */
+void
+pb_cache_manager_get_stats(struct pb_manager *mgr,
+                           struct pb_cache_stats *stats);
+
+
 struct pb_fence_ops;
 
 /** 
@@ -28,6 +28,14 @@
 /**
  * \file
  * Buffer cache.
+ *
+ * Destroyed buffers are kept in buckets by power-of-two size class, each
+ * with its own lock and sorted by destruction time, so finding a buffer
+ * only looks at the two size classes which can hold compatible buffers.
+ * Expired buffers are freed from a bucket whenever a buffer is returned to
+ * it, and from all the buckets every now and then, so that memory is
+ * returned even when a size class stops being used. This all happens on
+ * the threads calling the manager, like the provider expects.
  * 
  * \author Jose Fonseca <jrfonseca-at-tungstengraphics-dot-com>
  * \author Thomas Hellström <thomas-at-tungstengraphics-dot-com>
@@ -38,6 +46,7 @@
 #include "util/u_debug.h"
 #include "os/os_thread.h"
 #include "util/u_memory.h"
+#include "util/u_math.h"
 #include "util/u_double_list.h"
 #include "util/u_time.h"
 
@@ -51,6 +60,13 @@
 #define SUPER(__derived) (&(__derived)->base)
 
 
+/** One bucket per power-of-two size class. */
+#define PB_CACHE_NUM_BUCKETS 32
+
+/** How often all the buckets are checked for expired buffers, at most. */
+#define PB_CACHE_SWEEP_USECS 50000
+
+
 struct pb_cache_manager;
 
 
@@ -71,17 +87,33 @@ struct pb_cache_buffer
 };
 
 
+/**
+ * Cached buffers of one size class, oldest first.
+ */
+struct pb_cache_bucket
+{
+   pipe_mutex mutex;
+
+   struct list_head delayed;
+   pb_size numDelayed;
+
+   /* Statistics, see pb_cache_stats. */
+   uint64_t hits, misses, expired;
+   uint64_t cachedSize;
+};
+
+
 struct pb_cache_manager
 {
    struct pb_manager base;
 
    struct pb_manager *provider;
    unsigned usecs;
-   
-   pipe_mutex mutex;
-   
-   struct list_head delayed;
-   pb_size numDelayed;
+
+   struct pb_cache_bucket buckets[PB_CACHE_NUM_BUCKETS];
+
+   pipe_mutex sweep_mutex;
+   int64_t last_sweep;
 };
 
 
@@ -101,17 +133,26 @@ pb_cache_manager(struct pb_manager *mgr)
 }
 
 
+static INLINE unsigned
+pb_cache_bucket_index(pb_size size)
+{
+   return size ? util_logbase2(size) : 0;
+}
+
+
 /**
  * Actually destroy the buffer.
+ *
+ * The bucket holding the buffer must be locked.
  */
 static INLINE void
-_pb_cache_buffer_destroy(struct pb_cache_buffer *buf)
+_pb_cache_buffer_destroy(struct pb_cache_bucket *bucket,
+                         struct pb_cache_buffer *buf)
 {
-   struct pb_cache_manager *mgr = buf->mgr;
-
    LIST_DEL(&buf->head);
-   assert(mgr->numDelayed);
-   --mgr->numDelayed;
+   assert(bucket->numDelayed);
+   --bucket->numDelayed;
+   bucket->cachedSize -= buf->base.size;
    assert(!pipe_is_referenced(&buf->base.reference));
    pb_reference(&buf->buffer, NULL);
    FREE(buf);
@@ -119,26 +160,24 @@ _pb_cache_buffer_destroy(struct pb_cache_buffer *buf)
 
 
 /**
- * Free as many cache buffers from the list head as possible. 
+ * Free the expired buffers at the head of a locked bucket.
  */
 static void
-_pb_cache_buffer_list_check_free(struct pb_cache_manager *mgr)
+_pb_cache_bucket_check_free(struct pb_cache_bucket *bucket, int64_t now)
 {
    struct list_head *curr, *next;
    struct pb_cache_buffer *buf;
-   int64_t now;
-   
-   now = os_time_get();
-   
-   curr = mgr->delayed.next;
+
+   curr = bucket->delayed.next;
    next = curr->next;
-   while(curr != &mgr->delayed) {
+   while(curr != &bucket->delayed) {
       buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
 
       if(!os_time_timeout(buf->start, buf->end, now))
 	 break;
-	 
-      _pb_cache_buffer_destroy(buf);
+
+      _pb_cache_buffer_destroy(bucket, buf);
+      bucket->expired++;
 
       curr = next; 
       next = curr->next;
@@ -146,22 +185,56 @@ _pb_cache_buffer_list_check_free(struct pb_cache_manager *mgr)
 }
 
 
+/**
+ * Free the expired buffers of all the buckets, if that hasn't been done
+ * for a while.
+ */
+static void
+pb_cache_manager_sweep(struct pb_cache_manager *mgr, int64_t now)
+{
+   unsigned i;
+
+   pipe_mutex_lock(mgr->sweep_mutex);
+   if (now - mgr->last_sweep < PB_CACHE_SWEEP_USECS) {
+      pipe_mutex_unlock(mgr->sweep_mutex);
+      return;
+   }
+   mgr->last_sweep = now;
+   pipe_mutex_unlock(mgr->sweep_mutex);
+
+   for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++) {
+      struct pb_cache_bucket *bucket = &mgr->buckets[i];
+
+      pipe_mutex_lock(bucket->mutex);
+      if (bucket->numDelayed)
+         _pb_cache_bucket_check_free(bucket, now);
+      pipe_mutex_unlock(bucket->mutex);
+   }
+}
+
+
 static void
 pb_cache_buffer_destroy(struct pb_buffer *_buf)
 {
    struct pb_cache_buffer *buf = pb_cache_buffer(_buf);   
    struct pb_cache_manager *mgr = buf->mgr;
+   struct pb_cache_bucket *bucket =
+      &mgr->buckets[pb_cache_bucket_index(buf->base.size)];
 
-   pipe_mutex_lock(mgr->mutex);
+   pipe_mutex_lock(bucket->mutex);
    assert(!pipe_is_referenced(&buf->base.reference));
    
-   _pb_cache_buffer_list_check_free(mgr);
-   
    buf->start = os_time_get();
    buf->end = buf->start + mgr->usecs;
-   LIST_ADDTAIL(&buf->head, &mgr->delayed);
-   ++mgr->numDelayed;
-   pipe_mutex_unlock(mgr->mutex);
+
+   _pb_cache_bucket_check_free(bucket, buf->start);
+   
+   LIST_ADDTAIL(&buf->head, &bucket->delayed);
+   ++bucket->numDelayed;
+   bucket->cachedSize += buf->base.size;
+   pipe_mutex_unlock(bucket->mutex);
+
+   pb_cache_manager_sweep(mgr, buf->start);
 }
 
 
@@ -256,68 +329,73 @@ pb_cache_is_buffer_compat(struct pb_cache_buffer *buf,
 }
 
 
-static struct pb_buffer *
-pb_cache_manager_create_buffer(struct pb_manager *_mgr, 
-                               pb_size size,
-                               const struct pb_desc *desc)
+/**
+ * Take a buffer compatible with the description out of a bucket.
+ */
+static struct pb_cache_buffer *
+pb_cache_bucket_find(struct pb_cache_bucket *bucket,
+                     pb_size size,
+                     const struct pb_desc *desc)
 {
-   struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
-   struct pb_cache_buffer *buf;
+   struct pb_cache_buffer *buf = NULL;
    struct pb_cache_buffer *curr_buf;
-   struct list_head *curr, *next;
-   int64_t now;
-   int ret = 0;
-
-   pipe_mutex_lock(mgr->mutex);
+   struct list_head *curr;
+   int ret;
 
-   buf = NULL;
-   curr = mgr->delayed.next;
-   next = curr->next;
-   
-   /* search in the expired buffers, freeing them in the process */
-   now = os_time_get();
-   while(curr != &mgr->delayed) {
+   pipe_mutex_lock(bucket->mutex);
+   for (curr = bucket->delayed.next; curr != &bucket->delayed;
+        curr = curr->next) {
       curr_buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-      if(!buf && (ret = pb_cache_is_buffer_compat(curr_buf, size, desc) > 0))
+      ret = pb_cache_is_buffer_compat(curr_buf, size, desc);
+      if (ret > 0) {
          buf = curr_buf;
-      else if(os_time_timeout(curr_buf->start, curr_buf->end, now))
-         _pb_cache_buffer_destroy(curr_buf);
-      else
-         /* This buffer (and all hereafter) are still hot in cache */
+         LIST_DEL(&buf->head);
+         --bucket->numDelayed;
+         bucket->cachedSize -= buf->base.size;
          break;
+      }
+      /* The buffers after a busy one were released later, so they are
+       * most likely busy too. */
       if (ret == -1)
          break;
-      curr = next; 
-      next = curr->next;
    }
+   pipe_mutex_unlock(bucket->mutex);
+
+   return buf;
+}
+
+
+static struct pb_buffer *
+pb_cache_manager_create_buffer(struct pb_manager *_mgr, 
+                               pb_size size,
+                               const struct pb_desc *desc)
+{
+   struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
+   struct pb_cache_bucket *bucket;
+   struct pb_cache_buffer *buf;
+   unsigned index = pb_cache_bucket_index(size);
+
+   pb_cache_manager_sweep(mgr, os_time_get());
+
+   /* Compatible buffers are in [size, 2*size), which spans this size class
+    * and the next one. */
+   buf = pb_cache_bucket_find(&mgr->buckets[index], size, desc);
+   if (!buf && index + 1 < PB_CACHE_NUM_BUCKETS)
+      buf = pb_cache_bucket_find(&mgr->buckets[index + 1], size, desc);
+
+   bucket = &mgr->buckets[index];
+   pipe_mutex_lock(bucket->mutex);
+   if (buf)
+      bucket->hits++;
+   else
+      bucket->misses++;
+   pipe_mutex_unlock(bucket->mutex);
 
-   /* keep searching in the hot buffers */
-   if(!buf && ret != -1) {
-      while(curr != &mgr->delayed) {
-         curr_buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-         ret = pb_cache_is_buffer_compat(curr_buf, size, desc);
-         if (ret > 0) {
-            buf = curr_buf;
-            break;
-         }
-         if (ret == -1)
-            break;
-         /* no need to check the timeout here */
-         curr = next;
-         next = curr->next;
-      }
-   }
-   
    if(buf) {
-      LIST_DEL(&buf->head);
-      --mgr->numDelayed;
-      pipe_mutex_unlock(mgr->mutex);
       /* Increase refcount */
       pipe_reference_init(&buf->base.reference, 1);
       return &buf->base;
    }
-   
-   pipe_mutex_unlock(mgr->mutex);
 
    buf = CALLOC_STRUCT(pb_cache_buffer);
    if(!buf)
@@ -359,17 +437,22 @@ pb_cache_manager_flush(struct pb_manager *_mgr)
    struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
    struct list_head *curr, *next;
    struct pb_cache_buffer *buf;
+   unsigned i;
 
-   pipe_mutex_lock(mgr->mutex);
-   curr = mgr->delayed.next;
-   next = curr->next;
-   while(curr != &mgr->delayed) {
-      buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-      _pb_cache_buffer_destroy(buf);
-      curr = next; 
+   for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++) {
+      struct pb_cache_bucket *bucket = &mgr->buckets[i];
+
+      pipe_mutex_lock(bucket->mutex);
+      curr = bucket->delayed.next;
       next = curr->next;
+      while(curr != &bucket->delayed) {
+         buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
+         _pb_cache_buffer_destroy(bucket, buf);
+         curr = next; 
+         next = curr->next;
+      }
+      pipe_mutex_unlock(bucket->mutex);
    }
-   pipe_mutex_unlock(mgr->mutex);
    
    assert(mgr->provider->flush);
    if(mgr->provider->flush)
@@ -378,18 +461,49 @@ pb_cache_manager_flush(struct pb_manager *_mgr)
 
 
 static void
-pb_cache_manager_destroy(struct pb_manager *mgr)
+pb_cache_manager_destroy(struct pb_manager *_mgr)
 {
-   pb_cache_manager_flush(mgr);
+   struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
+   unsigned i;
+
+   pb_cache_manager_flush(_mgr);
+
+   for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++)
+      pipe_mutex_destroy(mgr->buckets[i].mutex);
+   pipe_mutex_destroy(mgr->sweep_mutex);
    FREE(mgr);
 }
 
 
+void
+pb_cache_manager_get_stats(struct pb_manager *_mgr,
+                           struct pb_cache_stats *stats)
+{
+   struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
+   unsigned i;
+
+   memset(stats, 0, sizeof *stats);
+
+   for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++) {
+      struct pb_cache_bucket *bucket = &mgr->buckets[i];
+
+      pipe_mutex_lock(bucket->mutex);
+      stats->hits += bucket->hits;
+      stats->misses += bucket->misses;
+      stats->expired += bucket->expired;
+      stats->num_buffers += bucket->numDelayed;
+      stats->cached_size += bucket->cachedSize;
+      pipe_mutex_unlock(bucket->mutex);
+   }
+}
+
+
 struct pb_manager *
 pb_cache_manager_create(struct pb_manager *provider, 
                      	unsigned usecs) 
 {
    struct pb_cache_manager *mgr;
+   unsigned i;
 
    if(!provider)
       return NULL;
@@ -403,9 +517,13 @@ pb_cache_manager_create(struct pb_manager *provider,
    mgr->base.flush = pb_cache_manager_flush;
    mgr->provider = provider;
    mgr->usecs = usecs;
-   LIST_INITHEAD(&mgr->delayed);
-   mgr->numDelayed = 0;
-   pipe_mutex_init(mgr->mutex);
-      
+
+   for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++) {
+      LIST_INITHEAD(&mgr->buckets[i].delayed);
+      pipe_mutex_init(mgr->buckets[i].mutex);
+   }
+   pipe_mutex_init(mgr->sweep_mutex);
+   mgr->last_sweep = os_time_get();
+
    return &mgr->base;
 }
@@ -35,6 +35,7 @@
 
 #include "pipe/p_compiler.h"
 #include "pipe/p_defines.h"
+#include "os/os_time.h"
 #include "util/u_memory.h"
 #include "util/u_debug.h"
 
@@ -52,19 +53,92 @@ struct pb_validate_entry
 };
 
 
+/**
+ * Slot of the buffer -> entry index.
+ *
+ * Slots whose stamp differs from pb_validate::stamp are empty, so the whole
+ * index is cleared between submissions by bumping the stamp.
+ */
+struct pb_validate_slot
+{
+   struct pb_buffer *buf;
+   unsigned stamp;
+   unsigned entry;
+};
+
+
 struct pb_validate
 {
    struct pb_validate_entry *entries;
    unsigned used;
    unsigned size;
+
+   /** Open-addressed index, twice the size of entries */
+   struct pb_validate_slot *index;
+   unsigned stamp;
+
+   struct pb_validate_stats stats;
 };
 
 
+static INLINE unsigned
+pb_validate_hash(const struct pb_validate *vl, const struct pb_buffer *buf)
+{
+   uintptr_t key = (uintptr_t)buf;
+   unsigned h = (unsigned)((key ^ (key >> 16 >> 16)) >> 4);
+   h ^= h >> 13;
+   h *= 0x9e3779b1;
+   h ^= h >> 16;
+   return h & (vl->size * 2 - 1);
+}
+
+
+/**
+ * Find the index slot for a buffer: either the one holding its entry, or
+ * the empty one where it should be inserted.
+ */
+static INLINE struct pb_validate_slot *
+pb_validate_lookup(struct pb_validate *vl, const struct pb_buffer *buf)
+{
+   unsigned mask = vl->size * 2 - 1;
+   unsigned i = pb_validate_hash(vl, buf);
+
+   while(vl->index[i].stamp == vl->stamp && vl->index[i].buf != buf)
+      i = (i + 1) & mask;
+
+   return &vl->index[i];
+}
+
+
+/**
+ * Switch to a new, zeroed, index sized for the current entries table.
+ */
+static void
+pb_validate_set_index(struct pb_validate *vl,
+                      struct pb_validate_slot *index)
+{
+   unsigned i;
+
+   FREE(vl->index);
+   vl->index = index;
+   vl->stamp = 1;
+
+   for(i = 0; i < vl->used; ++i) {
+      struct pb_validate_slot *slot = pb_validate_lookup(vl, vl->entries[i].buf);
+      slot->buf = vl->entries[i].buf;
+      slot->stamp = vl->stamp;
+      slot->entry = i;
+   }
+}
+
+
 enum pipe_error
 pb_validate_add_buffer(struct pb_validate *vl,
                        struct pb_buffer *buf,
                        unsigned flags)
 {
+   struct pb_validate_slot *slot;
+
    assert(buf);
    if(!buf)
       return PIPE_ERROR;
@@ -73,12 +147,20 @@ pb_validate_add_buffer(struct pb_validate *vl,
    assert(!(flags & ~PB_USAGE_GPU_READ_WRITE));
    flags &= PB_USAGE_GPU_READ_WRITE;
 
-   /* We only need to store one reference for each buffer, so avoid storing
-    * consecutive references for the same buffer. It might not be the most 
-    * common pattern, but it is easy to implement.
+   /* Consecutive references for the same buffer are the most common
+    * pattern, so check for those before hashing.
     */
    if(vl->used && vl->entries[vl->used - 1].buf == buf) {
       vl->entries[vl->used - 1].flags |= flags;
+      ++vl->stats.num_duplicates;
+      return PIPE_OK;
+   }
+
+   /* We only need to store one reference for each buffer. */
+   slot = pb_validate_lookup(vl, buf);
+   if(slot->stamp == vl->stamp) {
+      vl->entries[slot->entry].flags |= flags;
+      ++vl->stats.num_duplicates;
       return PIPE_OK;
    }
    
@@ -86,27 +168,41 @@ pb_validate_add_buffer(struct pb_validate *vl,
    if(vl->used == vl->size) {
       unsigned new_size;
       struct pb_validate_entry *new_entries;
+      struct pb_validate_slot *new_index;
       
       new_size = vl->size * 2;
       if(!new_size)
 	 return PIPE_ERROR_OUT_OF_MEMORY;
 
+      new_index = (struct pb_validate_slot *)CALLOC(new_size * 2, sizeof(struct pb_validate_slot));
+      if(!new_index)
+         return PIPE_ERROR_OUT_OF_MEMORY;
+
       new_entries = (struct pb_validate_entry *)REALLOC(vl->entries,
                                                         vl->size*sizeof(struct pb_validate_entry),
                                                         new_size*sizeof(struct pb_validate_entry));
-      if(!new_entries)
+      if(!new_entries) {
+         FREE(new_index);
          return PIPE_ERROR_OUT_OF_MEMORY;
+      }
       
       memset(new_entries + vl->size, 0, (new_size - vl->size)*sizeof(struct pb_validate_entry));
       
       vl->size = new_size;
       vl->entries = new_entries;
+      pb_validate_set_index(vl, new_index);
+
+      slot = pb_validate_lookup(vl, buf);
    }
    
    assert(!vl->entries[vl->used].buf);
    pb_reference(&vl->entries[vl->used].buf, buf);
    vl->entries[vl->used].flags = flags;
+   slot->buf = buf;
+   slot->stamp = vl->stamp;
+   slot->entry = vl->used;
    ++vl->used;
+   ++vl->stats.num_buffers;
    
    return PIPE_OK;
 }
@@ -131,6 +227,7 @@ pb_validate_foreach(struct pb_validate *vl,
 enum pipe_error
 pb_validate_validate(struct pb_validate *vl) 
 {
+   int64_t start = os_time_get_nano();
    unsigned i;
    
    for(i = 0; i < vl->used; ++i) {
@@ -139,10 +236,12 @@ pb_validate_validate(struct pb_validate *vl)
       if(ret != PIPE_OK) {
          while(i--)
             pb_validate(vl->entries[i].buf, NULL, 0);
+         vl->stats.validate_ns += os_time_get_nano() - start;
          return ret;
       }
    }
 
+   vl->stats.validate_ns += os_time_get_nano() - start;
    return PIPE_OK;
 }
 
@@ -151,12 +250,30 @@ void
 pb_validate_fence(struct pb_validate *vl,
                   struct pipe_fence_handle *fence)
 {
+   int64_t start = os_time_get_nano();
    unsigned i;
    for(i = 0; i < vl->used; ++i) {
       pb_fence(vl->entries[i].buf, fence);
       pb_reference(&vl->entries[i].buf, NULL);
    }
    vl->used = 0;
+
+   /* Empty the index, keeping its storage for the next submission. */
+   if(++vl->stamp == 0) {
+      memset(vl->index, 0, vl->size * 2 * sizeof *vl->index);
+      vl->stamp = 1;
+   }
+
+   ++vl->stats.num_submissions;
+   vl->stats.fence_ns += os_time_get_nano() - start;
+}
+
+
+void
+pb_validate_get_stats(struct pb_validate *vl,
+                      struct pb_validate_stats *stats)
+{
+   *stats = vl->stats;
 }
 
 
@@ -166,6 +283,7 @@ pb_validate_destroy(struct pb_validate *vl)
    unsigned i;
    for(i = 0; i < vl->used; ++i)
       pb_reference(&vl->entries[i].buf, NULL);
+   FREE(vl->index);
    FREE(vl->entries);
    FREE(vl);
 }
@@ -187,6 +305,13 @@ pb_validate_create()
       return NULL;
    }
 
+   vl->index = (struct pb_validate_slot *)CALLOC(vl->size * 2, sizeof(struct pb_validate_slot));
+   if(!vl->index) {
+      FREE(vl->entries);
+      FREE(vl);
+      return NULL;
+   }
+   vl->stamp = 1;
+
    return vl;
 }
-
@@ -56,6 +56,25 @@ struct pipe_fence_handle;
 struct pb_validate;
 
 
+/**
+ * Counters accumulated over the life of a validation list.
+ */
+struct pb_validate_stats
+{
+   unsigned num_submissions;  /**< calls to pb_validate_fence() */
+   unsigned num_buffers;      /**< distinct buffers added */
+   unsigned num_duplicates;   /**< references merged into an existing entry */
+   uint64_t validate_ns;      /**< time spent in pb_validate_validate() */
+   uint64_t fence_ns;         /**< time spent in pb_validate_fence() */
+};
+
+
+/**
+ * Add a buffer reference to the list.
+ *
+ * Each buffer is stored only once per submission, no matter how many times
+ * it is added; the flags of every reference are merged.
+ */
 enum pipe_error
 pb_validate_add_buffer(struct pb_validate *vl,
                        struct pb_buffer *buf,
@@ -77,12 +96,18 @@ pb_validate_validate(struct pb_validate *vl);
 /**
  * Fence all buffers and clear the list.
  * 
- * Should be called right after issuing commands to the hardware.
+ * Should be called right after issuing commands to the hardware. The list
+ * keeps its storage, so it can be reused for the next submission without
+ * reallocating.
  */
 void
 pb_validate_fence(struct pb_validate *vl,
                   struct pipe_fence_handle *fence);
 
+void
+pb_validate_get_stats(struct pb_validate *vl,
+                      struct pb_validate_stats *stats);
+
 struct pb_validate *
 pb_validate_create(void);
 
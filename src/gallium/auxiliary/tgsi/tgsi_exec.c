@@ -69,14 +69,33 @@
 #define TILE_BOTTOM_LEFT  2
 #define TILE_BOTTOM_RIGHT 3
 
+#if defined(PIPE_ARCH_SSE)
+#include "util/u_sse.h"
+
+/*
+ * A tgsi_exec_channel is exactly one SSE register wide, so the simple
+ * per-component micro ops below map onto a single SSE instruction.
+ * Temporaries often live on the stack without any alignment guarantee,
+ * hence the unaligned loads/stores.
+ */
+#define CHAN_LOADF(c)      _mm_loadu_ps((c)->f)
+#define CHAN_STOREF(c, v)  _mm_storeu_ps((c)->f, (v))
+#define CHAN_LOADI(c)      _mm_loadu_si128((const __m128i *)(c)->i)
+#define CHAN_STOREI(c, v)  _mm_storeu_si128((__m128i *)(c)->i, (v))
+#endif
+
 static void
 micro_abs(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREF(dst, _mm_andnot_ps(_mm_set1_ps(-0.0f), CHAN_LOADF(src)));
+#else
    dst->f[0] = fabsf(src->f[0]);
    dst->f[1] = fabsf(src->f[1]);
    dst->f[2] = fabsf(src->f[2]);
    dst->f[3] = fabsf(src->f[3]);
+#endif
 }
 
 static void
@@ -243,10 +262,14 @@ static void
 micro_ineg(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREI(dst, _mm_sub_epi32(_mm_setzero_si128(), CHAN_LOADI(src)));
+#else
    dst->i[0] = -src->i[0];
    dst->i[1] = -src->i[1];
    dst->i[2] = -src->i[2];
    dst->i[3] = -src->i[3];
+#endif
 }
 
 static void
@@ -272,10 +295,16 @@ micro_lrp(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128 s2 = CHAN_LOADF(src2);
+   __m128 d = _mm_sub_ps(CHAN_LOADF(src1), s2);
+   CHAN_STOREF(dst, _mm_add_ps(_mm_mul_ps(CHAN_LOADF(src0), d), s2));
+#else
    dst->f[0] = src0->f[0] * (src1->f[0] - src2->f[0]) + src2->f[0];
    dst->f[1] = src0->f[1] * (src1->f[1] - src2->f[1]) + src2->f[1];
    dst->f[2] = src0->f[2] * (src1->f[2] - src2->f[2]) + src2->f[2];
    dst->f[3] = src0->f[3] * (src1->f[3] - src2->f[3]) + src2->f[3];
+#endif
 }
 
 static void
@@ -284,26 +313,38 @@ micro_mad(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128 m = _mm_mul_ps(CHAN_LOADF(src0), CHAN_LOADF(src1));
+   CHAN_STOREF(dst, _mm_add_ps(m, CHAN_LOADF(src2)));
+#else
    dst->f[0] = src0->f[0] * src1->f[0] + src2->f[0];
    dst->f[1] = src0->f[1] * src1->f[1] + src2->f[1];
    dst->f[2] = src0->f[2] * src1->f[2] + src2->f[2];
    dst->f[3] = src0->f[3] * src1->f[3] + src2->f[3];
+#endif
 }
 
 static void
 micro_mov(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREF(dst, CHAN_LOADF(src));
+#else
    dst->u[0] = src->u[0];
    dst->u[1] = src->u[1];
    dst->u[2] = src->u[2];
    dst->u[3] = src->u[3];
+#endif
 }
 
 static void
 micro_rcp(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREF(dst, _mm_div_ps(_mm_set1_ps(1.0f), CHAN_LOADF(src)));
+#else
 #if 0 /* for debugging */
    assert(src->f[0] != 0.0f);
    assert(src->f[1] != 0.0f);
@@ -314,6 +355,7 @@ micro_rcp(union tgsi_exec_channel *dst,
    dst->f[1] = 1.0f / src->f[1];
    dst->f[2] = 1.0f / src->f[2];
    dst->f[3] = 1.0f / src->f[3];
+#endif
 }
 
 static void
@@ -330,6 +372,10 @@ static void
 micro_rsq(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128 a = _mm_andnot_ps(_mm_set1_ps(-0.0f), CHAN_LOADF(src));
+   CHAN_STOREF(dst, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(a)));
+#else
 #if 0 /* for debugging */
    assert(src->f[0] != 0.0f);
    assert(src->f[1] != 0.0f);
@@ -340,6 +386,7 @@ micro_rsq(union tgsi_exec_channel *dst,
    dst->f[1] = 1.0f / sqrtf(fabsf(src->f[1]));
    dst->f[2] = 1.0f / sqrtf(fabsf(src->f[2]));
    dst->f[3] = 1.0f / sqrtf(fabsf(src->f[3]));
+#endif
 }
 
 static void
@@ -347,10 +394,15 @@ micro_seq(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128 m = _mm_cmpeq_ps(CHAN_LOADF(src0), CHAN_LOADF(src1));
+   CHAN_STOREF(dst, _mm_and_ps(m, _mm_set1_ps(1.0f)));
+#else
    dst->f[0] = src0->f[0] == src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] == src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] == src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] == src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -358,10 +410,15 @@ micro_sge(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128 m = _mm_cmpge_ps(CHAN_LOADF(src0), CHAN_LOADF(src1));
+   CHAN_STOREF(dst, _mm_and_ps(m, _mm_set1_ps(1.0f)));
+#else
    dst->f[0] = src0->f[0] >= src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] >= src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] >= src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] >= src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -389,10 +446,15 @@ micro_sgt(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128 m = _mm_cmpgt_ps(CHAN_LOADF(src0), CHAN_LOADF(src1));
+   CHAN_STOREF(dst, _mm_and_ps(m, _mm_set1_ps(1.0f)));
+#else
    dst->f[0] = src0->f[0] > src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] > src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] > src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] > src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -410,10 +472,15 @@ micro_sle(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128 m = _mm_cmple_ps(CHAN_LOADF(src0), CHAN_LOADF(src1));
+   CHAN_STOREF(dst, _mm_and_ps(m, _mm_set1_ps(1.0f)));
+#else
    dst->f[0] = src0->f[0] <= src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] <= src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] <= src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] <= src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -421,10 +488,15 @@ micro_slt(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128 m = _mm_cmplt_ps(CHAN_LOADF(src0), CHAN_LOADF(src1));
+   CHAN_STOREF(dst, _mm_and_ps(m, _mm_set1_ps(1.0f)));
+#else
    dst->f[0] = src0->f[0] < src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] < src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] < src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] < src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -432,10 +504,15 @@ micro_sne(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128 m = _mm_cmpneq_ps(CHAN_LOADF(src0), CHAN_LOADF(src1));
+   CHAN_STOREF(dst, _mm_and_ps(m, _mm_set1_ps(1.0f)));
+#else
    dst->f[0] = src0->f[0] != src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] != src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] != src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] != src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -882,10 +959,14 @@ micro_add(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREF(dst, _mm_add_ps(CHAN_LOADF(src0), CHAN_LOADF(src1)));
+#else
    dst->f[0] = src0->f[0] + src1->f[0];
    dst->f[1] = src0->f[1] + src1->f[1];
    dst->f[2] = src0->f[2] + src1->f[2];
    dst->f[3] = src0->f[3] + src1->f[3];
+#endif
 }
 
 static void
@@ -950,10 +1031,16 @@ micro_lt(
    const union tgsi_exec_channel *src2,
    const union tgsi_exec_channel *src3 )
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128 m = _mm_cmplt_ps(CHAN_LOADF(src0), CHAN_LOADF(src1));
+   CHAN_STOREF(dst, _mm_or_ps(_mm_and_ps(m, CHAN_LOADF(src2)),
+                              _mm_andnot_ps(m, CHAN_LOADF(src3))));
+#else
    dst->f[0] = src0->f[0] < src1->f[0] ? src2->f[0] : src3->f[0];
    dst->f[1] = src0->f[1] < src1->f[1] ? src2->f[1] : src3->f[1];
    dst->f[2] = src0->f[2] < src1->f[2] ? src2->f[2] : src3->f[2];
    dst->f[3] = src0->f[3] < src1->f[3] ? src2->f[3] : src3->f[3];
+#endif
 }
 
 static void
@@ -961,10 +1048,14 @@ micro_max(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREF(dst, _mm_max_ps(CHAN_LOADF(src0), CHAN_LOADF(src1)));
+#else
    dst->f[0] = src0->f[0] > src1->f[0] ? src0->f[0] : src1->f[0];
    dst->f[1] = src0->f[1] > src1->f[1] ? src0->f[1] : src1->f[1];
    dst->f[2] = src0->f[2] > src1->f[2] ? src0->f[2] : src1->f[2];
    dst->f[3] = src0->f[3] > src1->f[3] ? src0->f[3] : src1->f[3];
+#endif
 }
 
 static void
@@ -972,10 +1063,14 @@ micro_min(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREF(dst, _mm_min_ps(CHAN_LOADF(src0), CHAN_LOADF(src1)));
+#else
    dst->f[0] = src0->f[0] < src1->f[0] ? src0->f[0] : src1->f[0];
    dst->f[1] = src0->f[1] < src1->f[1] ? src0->f[1] : src1->f[1];
    dst->f[2] = src0->f[2] < src1->f[2] ? src0->f[2] : src1->f[2];
    dst->f[3] = src0->f[3] < src1->f[3] ? src0->f[3] : src1->f[3];
+#endif
 }
 
 static void
@@ -983,10 +1078,14 @@ micro_mul(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREF(dst, _mm_mul_ps(CHAN_LOADF(src0), CHAN_LOADF(src1)));
+#else
    dst->f[0] = src0->f[0] * src1->f[0];
    dst->f[1] = src0->f[1] * src1->f[1];
    dst->f[2] = src0->f[2] * src1->f[2];
    dst->f[3] = src0->f[3] * src1->f[3];
+#endif
 }
 
 static void
@@ -994,10 +1093,14 @@ micro_neg(
    union tgsi_exec_channel *dst,
    const union tgsi_exec_channel *src )
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREF(dst, _mm_xor_ps(_mm_set1_ps(-0.0f), CHAN_LOADF(src)));
+#else
    dst->f[0] = -src->f[0];
    dst->f[1] = -src->f[1];
    dst->f[2] = -src->f[2];
    dst->f[3] = -src->f[3];
+#endif
 }
 
 static void
@@ -1024,10 +1127,14 @@ micro_sub(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREF(dst, _mm_sub_ps(CHAN_LOADF(src0), CHAN_LOADF(src1)));
+#else
    dst->f[0] = src0->f[0] - src1->f[0];
    dst->f[1] = src0->f[1] - src1->f[1];
    dst->f[2] = src0->f[2] - src1->f[2];
    dst->f[3] = src0->f[3] - src1->f[3];
+#endif
 }
 
 static void
@@ -3149,20 +3256,28 @@ static void
 micro_i2f(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREF(dst, _mm_cvtepi32_ps(CHAN_LOADI(src)));
+#else
    dst->f[0] = (float)src->i[0];
    dst->f[1] = (float)src->i[1];
    dst->f[2] = (float)src->i[2];
    dst->f[3] = (float)src->i[3];
+#endif
 }
 
 static void
 micro_not(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREI(dst, _mm_xor_si128(CHAN_LOADI(src), _mm_set1_epi32(~0)));
+#else
    dst->u[0] = ~src->u[0];
    dst->u[1] = ~src->u[1];
    dst->u[2] = ~src->u[2];
    dst->u[3] = ~src->u[3];
+#endif
 }
 
 static void
@@ -3181,10 +3296,14 @@ micro_and(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREI(dst, _mm_and_si128(CHAN_LOADI(src0), CHAN_LOADI(src1)));
+#else
    dst->u[0] = src0->u[0] & src1->u[0];
    dst->u[1] = src0->u[1] & src1->u[1];
    dst->u[2] = src0->u[2] & src1->u[2];
    dst->u[3] = src0->u[3] & src1->u[3];
+#endif
 }
 
 static void
@@ -3192,10 +3311,14 @@ micro_or(union tgsi_exec_channel *dst,
          const union tgsi_exec_channel *src0,
          const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREI(dst, _mm_or_si128(CHAN_LOADI(src0), CHAN_LOADI(src1)));
+#else
    dst->u[0] = src0->u[0] | src1->u[0];
    dst->u[1] = src0->u[1] | src1->u[1];
    dst->u[2] = src0->u[2] | src1->u[2];
    dst->u[3] = src0->u[3] | src1->u[3];
+#endif
 }
 
 static void
@@ -3203,10 +3326,14 @@ micro_xor(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREI(dst, _mm_xor_si128(CHAN_LOADI(src0), CHAN_LOADI(src1)));
+#else
    dst->u[0] = src0->u[0] ^ src1->u[0];
    dst->u[1] = src0->u[1] ^ src1->u[1];
    dst->u[2] = src0->u[2] ^ src1->u[2];
    dst->u[3] = src0->u[3] ^ src1->u[3];
+#endif
 }
 
 static void
@@ -3246,10 +3373,17 @@ micro_imax(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128i a = CHAN_LOADI(src0);
+   __m128i b = CHAN_LOADI(src1);
+   __m128i m = _mm_cmpgt_epi32(a, b);
+   CHAN_STOREI(dst, _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)));
+#else
    dst->i[0] = src0->i[0] > src1->i[0] ? src0->i[0] : src1->i[0];
    dst->i[1] = src0->i[1] > src1->i[1] ? src0->i[1] : src1->i[1];
    dst->i[2] = src0->i[2] > src1->i[2] ? src0->i[2] : src1->i[2];
    dst->i[3] = src0->i[3] > src1->i[3] ? src0->i[3] : src1->i[3];
+#endif
 }
 
 static void
@@ -3257,10 +3391,17 @@ micro_imin(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128i a = CHAN_LOADI(src0);
+   __m128i b = CHAN_LOADI(src1);
+   __m128i m = _mm_cmplt_epi32(a, b);
+   CHAN_STOREI(dst, _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)));
+#else
    dst->i[0] = src0->i[0] < src1->i[0] ? src0->i[0] : src1->i[0];
    dst->i[1] = src0->i[1] < src1->i[1] ? src0->i[1] : src1->i[1];
    dst->i[2] = src0->i[2] < src1->i[2] ? src0->i[2] : src1->i[2];
    dst->i[3] = src0->i[3] < src1->i[3] ? src0->i[3] : src1->i[3];
+#endif
 }
 
 static void
@@ -3268,10 +3409,15 @@ micro_isge(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128i m = _mm_cmplt_epi32(CHAN_LOADI(src0), CHAN_LOADI(src1));
+   CHAN_STOREI(dst, _mm_xor_si128(m, _mm_set1_epi32(~0)));
+#else
    dst->i[0] = src0->i[0] >= src1->i[0] ? -1 : 0;
    dst->i[1] = src0->i[1] >= src1->i[1] ? -1 : 0;
    dst->i[2] = src0->i[2] >= src1->i[2] ? -1 : 0;
    dst->i[3] = src0->i[3] >= src1->i[3] ? -1 : 0;
+#endif
 }
 
 static void
@@ -3290,10 +3436,14 @@ micro_islt(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREI(dst, _mm_cmplt_epi32(CHAN_LOADI(src0), CHAN_LOADI(src1)));
+#else
    dst->i[0] = src0->i[0] < src1->i[0] ? -1 : 0;
    dst->i[1] = src0->i[1] < src1->i[1] ? -1 : 0;
    dst->i[2] = src0->i[2] < src1->i[2] ? -1 : 0;
    dst->i[3] = src0->i[3] < src1->i[3] ? -1 : 0;
+#endif
 }
 
 static void
@@ -3321,10 +3471,14 @@ micro_uadd(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREI(dst, _mm_add_epi32(CHAN_LOADI(src0), CHAN_LOADI(src1)));
+#else
    dst->u[0] = src0->u[0] + src1->u[0];
    dst->u[1] = src0->u[1] + src1->u[1];
    dst->u[2] = src0->u[2] + src1->u[2];
    dst->u[3] = src0->u[3] + src1->u[3];
+#endif
 }
 
 static void
@@ -3399,10 +3553,14 @@ micro_useq(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   CHAN_STOREI(dst, _mm_cmpeq_epi32(CHAN_LOADI(src0), CHAN_LOADI(src1)));
+#else
    dst->u[0] = src0->u[0] == src1->u[0] ? ~0 : 0;
    dst->u[1] = src0->u[1] == src1->u[1] ? ~0 : 0;
    dst->u[2] = src0->u[2] == src1->u[2] ? ~0 : 0;
    dst->u[3] = src0->u[3] == src1->u[3] ? ~0 : 0;
+#endif
 }
 
 static void
@@ -3443,10 +3601,15 @@ micro_usne(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128i m = _mm_cmpeq_epi32(CHAN_LOADI(src0), CHAN_LOADI(src1));
+   CHAN_STOREI(dst, _mm_xor_si128(m, _mm_set1_epi32(~0)));
+#else
    dst->u[0] = src0->u[0] != src1->u[0] ? ~0 : 0;
    dst->u[1] = src0->u[1] != src1->u[1] ? ~0 : 0;
    dst->u[2] = src0->u[2] != src1->u[2] ? ~0 : 0;
    dst->u[3] = src0->u[3] != src1->u[3] ? ~0 : 0;
+#endif
 }
 
 static void
@@ -32,8 +32,16 @@
 
 #include "pipe/p_config.h"
 #include "pipe/p_state.h"
+#include "util/u_debug.h"
 #include "translate.h"
 
+
+/* Compiling a key with LLVM takes far longer than running the generic
+ * path for a typical draw, so the LLVM backend is only used on request.
+ */
+DEBUG_GET_ONCE_BOOL_OPTION(translate_llvm, "TRANSLATE_LLVM", FALSE)
+
+
 struct translate *translate_create( const struct translate_key *key )
 {
    struct translate *translate = NULL;
@@ -42,10 +50,14 @@ struct translate *translate_create( const struct translate_key *key )
    translate = translate_sse2_create( key );
    if (translate)
       return translate;
-#else
-   (void)translate;
 #endif
 
+   if (debug_get_option_translate_llvm()) {
+      translate = translate_llvm_create( key );
+      if (translate)
+         return translate;
+   }
+
    return translate_generic_create( key );
 }
 
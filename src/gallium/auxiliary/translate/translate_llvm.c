@@ -0,0 +1,605 @@
+/**************************************************************************
+ *
+ * Copyright 2012 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * LLVM-generated vertex fetch/emit.
+ *
+ * Builds one loop per index size (linear, 8, 16 and 32-bit elements) which
+ * fetches every element with lp_build_fetch_rgba_aos() and writes it to the
+ * output vertex.  Unlike translate_sse.c this works on any host LLVM
+ * supports, and picks up whatever vector ISA (e.g. AVX) the host has.
+ *
+ * Only keys whose outputs are either verbatim copies of the input or
+ * 32-bit float formats are handled; anything else is left to
+ * translate_generic.c.
+ */
+
+
+#include "pipe/p_config.h"
+#include "pipe/p_compiler.h"
+#include "util/u_memory.h"
+#include "util/u_math.h"
+#include "util/u_format.h"
+
+#include "translate.h"
+
+
+#if HAVE_LLVM
+
+#include "gallivm/lp_bld.h"
+#include "gallivm/lp_bld_arit.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_format.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_struct.h"
+#include "gallivm/lp_bld_type.h"
+
+
+/**
+ * Per vertex buffer state read by the generated code.
+ * Keep in sync with create_jit_buffer_type().
+ */
+struct translate_llvm_buffer {
+   const uint8_t *base_ptr;
+   uint32_t stride;
+   uint32_t max_index;
+};
+
+#define TRANSLATE_LLVM_BUFFER_BASE_PTR   0
+#define TRANSLATE_LLVM_BUFFER_STRIDE     1
+#define TRANSLATE_LLVM_BUFFER_MAX_INDEX  2
+
+
+typedef void
+(*translate_llvm_jit_func)(const struct translate_llvm_buffer *buffers,
+                           const void *elts,
+                           unsigned start,
+                           unsigned count,
+                           unsigned instance_id,
+                           void *output_buffer);
+
+
+struct translate_llvm {
+   struct translate translate;
+
+   struct gallivm_state *gallivm;
+   LLVMTypeRef buffer_ptr_type;
+
+   /* index size in bytes: 0 (linear), 1, 2, 4 */
+   LLVMValueRef function[4];
+   translate_llvm_jit_func jit_func[4];
+
+   struct translate_llvm_buffer buffer[PIPE_MAX_ATTRIBS];
+   unsigned nr_buffers;
+};
+
+
+static INLINE struct translate_llvm *
+translate_llvm(struct translate *translate)
+{
+   return (struct translate_llvm *)translate;
+}
+
+
+static unsigned
+index_size_slot(unsigned index_size)
+{
+   switch (index_size) {
+   case 0: return 0;
+   case 1: return 1;
+   case 2: return 2;
+   default:
+      assert(index_size == 4);
+      return 3;
+   }
+}
+
+
+/**
+ * Whether the element can be copied verbatim.
+ */
+static boolean
+element_is_copy(const struct translate_element *elem)
+{
+   const struct util_format_description *desc =
+      util_format_description(elem->input_format);
+
+   return elem->type == TRANSLATE_ELEMENT_NORMAL &&
+          elem->input_format == elem->output_format &&
+          desc->block.width == 1 &&
+          desc->block.height == 1 &&
+          !(desc->block.bits & 7);
+}
+
+
+/**
+ * Number of float channels written for a R32[G32[B32[A32]]]_FLOAT output,
+ * or zero if the output format is something else.
+ */
+static unsigned
+float_output_channels(enum pipe_format format)
+{
+   switch (format) {
+   case PIPE_FORMAT_R32_FLOAT:          return 1;
+   case PIPE_FORMAT_R32G32_FLOAT:       return 2;
+   case PIPE_FORMAT_R32G32B32_FLOAT:    return 3;
+   case PIPE_FORMAT_R32G32B32A32_FLOAT: return 4;
+   default:
+      return 0;
+   }
+}
+
+
+static boolean
+key_is_supported(const struct translate_key *key)
+{
+   unsigned i;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      const struct translate_element *elem = &key->element[i];
+
+      if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID) {
+         if (elem->output_format != PIPE_FORMAT_R32_FLOAT &&
+             elem->output_format != PIPE_FORMAT_R32_USCALED &&
+             elem->output_format != PIPE_FORMAT_R32_SSCALED)
+            return FALSE;
+      }
+      else if (!element_is_copy(elem)) {
+         const struct util_format_description *desc =
+            util_format_description(elem->input_format);
+
+         if (!desc ||
+             desc->block.width != 1 ||
+             desc->block.height != 1 ||
+             desc->channel[0].pure_integer ||
+             !float_output_channels(elem->output_format))
+            return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+static LLVMTypeRef
+create_jit_buffer_type(struct gallivm_state *gallivm)
+{
+   LLVMContextRef context = gallivm->context;
+   LLVMTypeRef elem_types[3];
+   LLVMTypeRef buffer_type;
+
+   elem_types[TRANSLATE_LLVM_BUFFER_BASE_PTR] =
+      LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+   elem_types[TRANSLATE_LLVM_BUFFER_STRIDE] = LLVMInt32TypeInContext(context);
+   elem_types[TRANSLATE_LLVM_BUFFER_MAX_INDEX] = LLVMInt32TypeInContext(context);
+
+   buffer_type = LLVMStructTypeInContext(context, elem_types,
+                                         Elements(elem_types), 0);
+
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_buffer, base_ptr,
+                          gallivm->target, buffer_type,
+                          TRANSLATE_LLVM_BUFFER_BASE_PTR);
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_buffer, stride,
+                          gallivm->target, buffer_type,
+                          TRANSLATE_LLVM_BUFFER_STRIDE);
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_buffer, max_index,
+                          gallivm->target, buffer_type,
+                          TRANSLATE_LLVM_BUFFER_MAX_INDEX);
+   LP_CHECK_STRUCT_SIZE(struct translate_llvm_buffer,
+                        gallivm->target, buffer_type);
+
+   return LLVMPointerType(buffer_type, 0);
+}
+
+
+/**
+ * Return a pointer to element 'elem' of vertex 'index' in its source
+ * buffer.
+ */
+static LLVMValueRef
+generate_src_ptr(struct gallivm_state *gallivm,
+                 struct lp_build_context *bld,
+                 LLVMValueRef buffers_ptr,
+                 const struct translate_element *elem,
+                 LLVMValueRef index,
+                 LLVMValueRef instance_id)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef buffer_index = lp_build_const_int32(gallivm, elem->input_buffer);
+   LLVMValueRef buffer_ptr;
+   LLVMValueRef base_ptr, stride, offset;
+
+   buffer_ptr = LLVMBuildGEP(builder, buffers_ptr, &buffer_index, 1, "");
+   base_ptr = lp_build_struct_get(gallivm, buffer_ptr,
+                                  TRANSLATE_LLVM_BUFFER_BASE_PTR, "base_ptr");
+   stride = lp_build_struct_get(gallivm, buffer_ptr,
+                                TRANSLATE_LLVM_BUFFER_STRIDE, "stride");
+
+   if (elem->instance_divisor) {
+      /* XXX like translate_generic, no clamping for per-instance data */
+      index = LLVMBuildUDiv(builder, instance_id,
+                            lp_build_const_int32(gallivm, elem->instance_divisor),
+                            "instance_divisor");
+   }
+   else {
+      LLVMValueRef max_index =
+         lp_build_struct_get(gallivm, buffer_ptr,
+                             TRANSLATE_LLVM_BUFFER_MAX_INDEX, "max_index");
+      /* clamp to avoid going out of bounds */
+      index = lp_build_min(bld, index, max_index);
+   }
+
+   offset = LLVMBuildMul(builder, index, stride, "");
+   offset = LLVMBuildAdd(builder, offset,
+                         lp_build_const_int32(gallivm, elem->input_offset), "");
+
+   return LLVMBuildGEP(builder, base_ptr, &offset, 1, "src");
+}
+
+
+static void
+generate_store_float(struct gallivm_state *gallivm,
+                     LLVMValueRef dst_ptr,
+                     unsigned chan,
+                     LLVMValueRef value)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef float_ptr_type =
+      LLVMPointerType(LLVMFloatTypeInContext(gallivm->context), 0);
+   LLVMValueRef index = lp_build_const_int32(gallivm, chan);
+   LLVMValueRef ptr;
+
+   ptr = LLVMBuildBitCast(builder, dst_ptr, float_ptr_type, "");
+   ptr = LLVMBuildGEP(builder, ptr, &index, 1, "");
+   lp_set_store_alignment(LLVMBuildStore(builder, value, ptr), 1);
+}
+
+
+static void
+generate_element(struct gallivm_state *gallivm,
+                 struct lp_build_context *bld,
+                 LLVMValueRef buffers_ptr,
+                 const struct translate_element *elem,
+                 LLVMValueRef index,
+                 LLVMValueRef instance_id,
+                 LLVMValueRef vertex_ptr)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef offset = lp_build_const_int32(gallivm, elem->output_offset);
+   LLVMValueRef dst_ptr = LLVMBuildGEP(builder, vertex_ptr, &offset, 1, "dst");
+
+   if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID) {
+      LLVMValueRef value = instance_id;
+
+      if (elem->output_format == PIPE_FORMAT_R32_FLOAT) {
+         value = LLVMBuildUIToFP(builder, value,
+                                 LLVMFloatTypeInContext(gallivm->context), "");
+         generate_store_float(gallivm, dst_ptr, 0, value);
+      }
+      else {
+         LLVMTypeRef int_ptr_type =
+            LLVMPointerType(LLVMInt32TypeInContext(gallivm->context), 0);
+         LLVMValueRef ptr = LLVMBuildBitCast(builder, dst_ptr, int_ptr_type, "");
+         lp_set_store_alignment(LLVMBuildStore(builder, value, ptr), 1);
+      }
+   }
+   else if (element_is_copy(elem)) {
+      const struct util_format_description *desc =
+         util_format_description(elem->input_format);
+      LLVMValueRef src_ptr = generate_src_ptr(gallivm, bld, buffers_ptr, elem,
+                                              index, instance_id);
+      LLVMTypeRef copy_type =
+         LLVMIntTypeInContext(gallivm->context, desc->block.bits);
+      LLVMTypeRef copy_ptr_type = LLVMPointerType(copy_type, 0);
+      LLVMValueRef value;
+
+      src_ptr = LLVMBuildBitCast(builder, src_ptr, copy_ptr_type, "");
+      dst_ptr = LLVMBuildBitCast(builder, dst_ptr, copy_ptr_type, "");
+
+      value = LLVMBuildLoad(builder, src_ptr, "");
+      lp_set_load_alignment(value, 1);
+      lp_set_store_alignment(LLVMBuildStore(builder, value, dst_ptr), 1);
+   }
+   else {
+      const struct util_format_description *desc =
+         util_format_description(elem->input_format);
+      unsigned nr_channels = float_output_channels(elem->output_format);
+      LLVMValueRef zero = lp_build_const_int32(gallivm, 0);
+      LLVMValueRef src_ptr = generate_src_ptr(gallivm, bld, buffers_ptr, elem,
+                                              index, instance_id);
+      LLVMValueRef rgba;
+      unsigned chan;
+
+      rgba = lp_build_fetch_rgba_aos(gallivm, desc, lp_float32_vec4_type(),
+                                     src_ptr, zero, zero, zero);
+
+      for (chan = 0; chan < nr_channels; chan++) {
+         LLVMValueRef value =
+            LLVMBuildExtractElement(builder, rgba,
+                                    lp_build_const_int32(gallivm, chan), "");
+         generate_store_float(gallivm, dst_ptr, chan, value);
+      }
+   }
+}
+
+
+/**
+ * Generate the loop for the given index size.  The loop body always runs
+ * at least once, so callers must not pass a zero count.
+ */
+static void
+generate_function(struct translate_llvm *p, unsigned index_size)
+{
+   struct gallivm_state *gallivm = p->gallivm;
+   const struct translate_key *key = &p->translate.key;
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef int8_ptr_type = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(context);
+   LLVMTypeRef arg_types[6];
+   LLVMTypeRef func_type;
+   LLVMValueRef function;
+   LLVMValueRef buffers_ptr, elts_ptr, start, count, instance_id, output_ptr;
+   LLVMValueRef end;
+   LLVMBasicBlockRef block;
+   struct lp_build_context bld;
+   struct lp_build_loop_state loop;
+   unsigned i;
+
+   arg_types[0] = p->buffer_ptr_type;   /* buffers */
+   arg_types[1] = int8_ptr_type;        /* elts */
+   arg_types[2] = int32_type;           /* start */
+   arg_types[3] = int32_type;           /* count */
+   arg_types[4] = int32_type;           /* instance_id */
+   arg_types[5] = int8_ptr_type;        /* output_buffer */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                arg_types, Elements(arg_types), 0);
+
+   function = LLVMAddFunction(gallivm->module, "translate", func_type);
+   LLVMSetFunctionCallConv(function, LLVMCCallConv);
+   p->function[index_size_slot(index_size)] = function;
+
+   buffers_ptr = LLVMGetParam(function, 0);
+   elts_ptr    = LLVMGetParam(function, 1);
+   start       = LLVMGetParam(function, 2);
+   count       = LLVMGetParam(function, 3);
+   instance_id = LLVMGetParam(function, 4);
+   output_ptr  = LLVMGetParam(function, 5);
+
+   lp_build_name(buffers_ptr, "buffers");
+   lp_build_name(elts_ptr, "elts");
+   lp_build_name(start, "start");
+   lp_build_name(count, "count");
+   lp_build_name(instance_id, "instance_id");
+   lp_build_name(output_ptr, "output_buffer");
+
+   block = LLVMAppendBasicBlockInContext(context, function, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_context_init(&bld, gallivm, lp_type_uint(32));
+
+   if (index_size) {
+      LLVMTypeRef elt_type = LLVMIntTypeInContext(context, index_size * 8);
+      elts_ptr = LLVMBuildBitCast(builder, elts_ptr,
+                                  LLVMPointerType(elt_type, 0), "");
+   }
+
+   end = LLVMBuildAdd(builder, start, count, "");
+
+   lp_build_loop_begin(&loop, gallivm, start);
+   {
+      LLVMValueRef index = loop.counter;
+      LLVMValueRef vertex, vertex_ptr;
+
+      if (index_size) {
+         LLVMValueRef elt_ptr =
+            LLVMBuildGEP(builder, elts_ptr, &loop.counter, 1, "");
+         index = LLVMBuildLoad(builder, elt_ptr, "elt");
+         if (index_size < 4)
+            index = LLVMBuildZExt(builder, index, int32_type, "");
+      }
+
+      vertex = LLVMBuildSub(builder, loop.counter, start, "");
+      vertex = LLVMBuildMul(builder, vertex,
+                            lp_build_const_int32(gallivm, key->output_stride),
+                            "");
+      vertex_ptr = LLVMBuildGEP(builder, output_ptr, &vertex, 1, "vertex");
+
+      for (i = 0; i < key->nr_elements; i++) {
+         generate_element(gallivm, &bld, buffers_ptr, &key->element[i],
+                          index, instance_id, vertex_ptr);
+      }
+   }
+   lp_build_loop_end(&loop, end, NULL);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, function);
+}
+
+
+static void PIPE_CDECL
+llvm_run_elts(struct translate *translate,
+              const unsigned *elts,
+              unsigned count,
+              unsigned instance_id,
+              void *output_buffer)
+{
+   struct translate_llvm *p = translate_llvm(translate);
+
+   if (count)
+      p->jit_func[3](p->buffer, elts, 0, count, instance_id, output_buffer);
+}
+
+
+static void PIPE_CDECL
+llvm_run_elts16(struct translate *translate,
+                const uint16_t *elts,
+                unsigned count,
+                unsigned instance_id,
+                void *output_buffer)
+{
+   struct translate_llvm *p = translate_llvm(translate);
+
+   if (count)
+      p->jit_func[2](p->buffer, elts, 0, count, instance_id, output_buffer);
+}
+
+
+static void PIPE_CDECL
+llvm_run_elts8(struct translate *translate,
+               const uint8_t *elts,
+               unsigned count,
+               unsigned instance_id,
+               void *output_buffer)
+{
+   struct translate_llvm *p = translate_llvm(translate);
+
+   if (count)
+      p->jit_func[1](p->buffer, elts, 0, count, instance_id, output_buffer);
+}
+
+
+static void PIPE_CDECL
+llvm_run(struct translate *translate,
+         unsigned start,
+         unsigned count,
+         unsigned instance_id,
+         void *output_buffer)
+{
+   struct translate_llvm *p = translate_llvm(translate);
+
+   if (count)
+      p->jit_func[0](p->buffer, NULL, start, count, instance_id, output_buffer);
+}
+
+
+static void
+llvm_set_buffer(struct translate *translate,
+                unsigned buf,
+                const void *ptr,
+                unsigned stride,
+                unsigned max_index)
+{
+   struct translate_llvm *p = translate_llvm(translate);
+
+   if (buf < p->nr_buffers) {
+      p->buffer[buf].base_ptr = ptr;
+      p->buffer[buf].stride = stride;
+      p->buffer[buf].max_index = max_index;
+   }
+}
+
+
+static void
+llvm_release(struct translate *translate)
+{
+   struct translate_llvm *p = translate_llvm(translate);
+   unsigned i;
+
+   if (p->gallivm) {
+      for (i = 0; i < Elements(p->function); i++) {
+         if (p->function[i]) {
+            gallivm_free_function(p->gallivm, p->function[i],
+                                  (const void *)p->jit_func[i]);
+         }
+      }
+      gallivm_destroy(p->gallivm);
+   }
+
+   FREE(p);
+}
+
+
+struct translate *
+translate_llvm_create(const struct translate_key *key)
+{
+   static const unsigned index_sizes[4] = { 0, 1, 2, 4 };
+   struct translate_llvm *p;
+   unsigned i;
+
+   if (!key_is_supported(key))
+      return NULL;
+
+   lp_build_init();
+
+   p = CALLOC_STRUCT(translate_llvm);
+   if (!p)
+      return NULL;
+
+   p->translate.key = *key;
+   p->translate.release = llvm_release;
+   p->translate.set_buffer = llvm_set_buffer;
+   p->translate.run_elts = llvm_run_elts;
+   p->translate.run_elts16 = llvm_run_elts16;
+   p->translate.run_elts8 = llvm_run_elts8;
+   p->translate.run = llvm_run;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      if (key->element[i].type == TRANSLATE_ELEMENT_NORMAL)
+         p->nr_buffers = MAX2(p->nr_buffers, key->element[i].input_buffer + 1);
+   }
+
+   p->gallivm = gallivm_create();
+   if (!p->gallivm)
+      goto fail;
+
+   p->buffer_ptr_type = create_jit_buffer_type(p->gallivm);
+
+   for (i = 0; i < Elements(index_sizes); i++)
+      generate_function(p, index_sizes[i]);
+
+   gallivm_compile_module(p->gallivm);
+
+   for (i = 0; i < Elements(index_sizes); i++) {
+      p->jit_func[i] = (translate_llvm_jit_func)
+         gallivm_jit_function(p->gallivm, p->function[i]);
+      if (!p->jit_func[i])
+         goto fail;
+   }
+
+   return &p->translate;
+
+fail:
+   llvm_release(&p->translate);
+   return NULL;
+}
+
+
+#else /* !HAVE_LLVM */
+
+struct translate *
+translate_llvm_create(const struct translate_key *key)
+{
+   return NULL;
+}
+
+#endif /* !HAVE_LLVM */
@@ -51,6 +51,15 @@
 
 #define INVALID_PTR ((void*)~0)
 
+/* How many rectangles a batch accumulates before it's drawn. */
+#define BLITTER_BATCH_MAX_RECTS 64
+
+enum blitter_batch_type {
+   BLITTER_BATCH_NONE,
+   BLITTER_BATCH_BLIT,
+   BLITTER_BATCH_CLEAR
+};
+
 struct blitter_context_priv
 {
    struct blitter_context base;
@@ -115,6 +124,16 @@ struct blitter_context_priv
    unsigned dst_width;
    unsigned dst_height;
 
+   /* The batch being recorded, see util_blitter_begin_blit_batch. */
+   enum blitter_batch_type batch_type;
+   boolean batch_empty;     /**< nothing to blit, rectangles are ignored */
+   boolean batch_scissor;
+   struct pipe_sampler_view *batch_src;
+   unsigned batch_src_width0, batch_src_height0;
+   union pipe_color_union batch_color;
+   unsigned batch_num_vertices;
+   float batch_vertices[BLITTER_BATCH_MAX_RECTS * 6][2][4];
+
    boolean has_geometry_shader;
    boolean vertex_has_integers;
    boolean has_stream_out;
@@ -318,6 +337,8 @@ void util_blitter_destroy(struct blitter_context *blitter)
    struct pipe_context *pipe = blitter->pipe;
    int i;
 
+   assert(ctx->batch_type == BLITTER_BATCH_NONE);
+
    for (i = 0; i <= PIPE_MASK_RGBA; i++) {
       pipe->delete_blend_state(pipe, ctx->blend[i]);
    }
@@ -539,9 +560,9 @@ static void blitter_restore_textures(struct blitter_context_priv *ctx)
    ctx->base.saved_num_sampler_views = ~0;
 }
 
-static void blitter_set_rectangle(struct blitter_context_priv *ctx,
-                                  int x1, int y1, int x2, int y2,
-                                  float depth)
+static void blitter_set_rectangle_vertices(struct blitter_context_priv *ctx,
+                                           int x1, int y1, int x2, int y2,
+                                           float depth)
 {
    int i;
 
@@ -560,8 +581,10 @@ static void blitter_set_rectangle(struct blitter_context_priv *ctx,
 
    for (i = 0; i < 4; i++)
       ctx->vertices[i][0][2] = depth; /*z*/
+}
 
-   /* viewport */
+static void blitter_set_viewport(struct blitter_context_priv *ctx)
+{
    ctx->viewport.scale[0] = 0.5f * ctx->dst_width;
    ctx->viewport.scale[1] = 0.5f * ctx->dst_height;
    ctx->viewport.scale[2] = 1.0f;
@@ -573,6 +596,14 @@ static void blitter_set_rectangle(struct blitter_context_priv *ctx,
    ctx->base.pipe->set_viewport_state(ctx->base.pipe, &ctx->viewport);
 }
 
+static void blitter_set_rectangle(struct blitter_context_priv *ctx,
+                                  int x1, int y1, int x2, int y2,
+                                  float depth)
+{
+   blitter_set_rectangle_vertices(ctx, x1, y1, x2, y2, depth);
+   blitter_set_viewport(ctx);
+}
+
 static void blitter_set_clear_color(struct blitter_context_priv *ctx,
                                     const union pipe_color_union *color)
 {
@@ -1222,52 +1253,53 @@ void util_blitter_copy_texture(struct blitter_context *blitter,
    pipe_sampler_view_reference(&src_view, NULL);
 }
 
-void util_blitter_blit_generic(struct blitter_context *blitter,
-                               struct pipe_surface *dst,
-                               int dstx, int dsty,
-                               unsigned dst_width, unsigned dst_height,
-                               struct pipe_sampler_view *src,
-                               const struct pipe_box *srcbox,
-                               unsigned src_width0, unsigned src_height0,
-                               unsigned mask, unsigned filter,
-                               const struct pipe_scissor_state *scissor,
-                               boolean copy_all_samples)
+/**
+ * Return which parts of the mask can be blitted between the two views.
+ */
+static unsigned blitter_get_blit_mask(struct blitter_context_priv *ctx,
+                                      struct pipe_surface *dst,
+                                      struct pipe_sampler_view *src,
+                                      unsigned mask)
 {
-   struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
-   struct pipe_context *pipe = ctx->base.pipe;
-   struct pipe_framebuffer_state fb_state;
-   enum pipe_texture_target src_target = src->texture->target;
-   boolean has_depth, has_stencil, has_color;
-   boolean blit_stencil, blit_depth, blit_color;
-   void *sampler_state;
    const struct util_format_description *src_desc =
          util_format_description(src->format);
    const struct util_format_description *dst_desc =
          util_format_description(dst->format);
+   unsigned blit_mask = 0;
 
-   has_color = src_desc->colorspace != UTIL_FORMAT_COLORSPACE_ZS &&
-               dst_desc->colorspace != UTIL_FORMAT_COLORSPACE_ZS;
-   has_depth = util_format_has_depth(src_desc) &&
-               util_format_has_depth(dst_desc);
-   has_stencil = util_format_has_stencil(src_desc) &&
-                 util_format_has_stencil(dst_desc);
+   if (src_desc->colorspace != UTIL_FORMAT_COLORSPACE_ZS &&
+       dst_desc->colorspace != UTIL_FORMAT_COLORSPACE_ZS)
+      blit_mask |= mask & PIPE_MASK_RGBA;
 
-   blit_color = has_color && (mask & PIPE_MASK_RGBA);
-   blit_depth = has_depth && (mask & PIPE_MASK_Z);
-   blit_stencil = has_stencil && (mask & PIPE_MASK_S) &&
-                  ctx->has_stencil_export;
+   if (util_format_has_depth(src_desc) &&
+       util_format_has_depth(dst_desc))
+      blit_mask |= mask & PIPE_MASK_Z;
 
-   if (!blit_stencil && !blit_depth && !blit_color) {
-      return;
-   }
+   if (util_format_has_stencil(src_desc) &&
+       util_format_has_stencil(dst_desc) &&
+       ctx->has_stencil_export)
+      blit_mask |= mask & PIPE_MASK_S;
 
-   /* Sanity checks. */
-   if (dst->texture == src->texture &&
-       dst->u.tex.level == src->u.tex.first_level) {
-      assert(!is_overlap(dstx, dsty, 0, srcbox));
-   }
-   /* XXX should handle 3d regions */
-   assert(srcbox->depth == 1);
+   return blit_mask;
+}
+
+/**
+ * Bind all the states a blit from src to dst needs, except for the sample
+ * mask and the vertices.  The mask must come from blitter_get_blit_mask.
+ */
+static void blitter_begin_blit(struct blitter_context_priv *ctx,
+                               struct pipe_surface *dst,
+                               struct pipe_sampler_view *src,
+                               unsigned mask, boolean linear,
+                               const struct pipe_scissor_state *scissor)
+{
+   struct pipe_context *pipe = ctx->base.pipe;
+   struct pipe_framebuffer_state fb_state;
+   boolean blit_stencil, blit_depth;
+   void *sampler_state;
+
+   blit_depth = (mask & PIPE_MASK_Z) != 0;
+   blit_stencil = (mask & PIPE_MASK_S) != 0;
 
    /* Check whether the states are properly saved. */
    blitter_set_running_flag(ctx);
@@ -1319,10 +1351,9 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
    }
 
    /* Set the linear filter only for scaled color non-MSAA blits. */
-   if (filter == PIPE_TEX_FILTER_LINEAR &&
+   if (linear &&
        !blit_depth && !blit_stencil &&
-       src->texture->nr_samples <= 1 &&
-       (dst_width != abs(srcbox->width) || dst_height != abs(srcbox->height))) {
+       src->texture->nr_samples <= 1) {
       sampler_state = ctx->sampler_state_linear;
    } else {
       sampler_state = ctx->sampler_state;
@@ -1375,11 +1406,71 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
 
    blitter_set_common_draw_rect_state(ctx, scissor != NULL);
    blitter_set_dst_dimensions(ctx, dst->width, dst->height);
+}
 
-   if ((src_target == PIPE_TEXTURE_1D ||
-        src_target == PIPE_TEXTURE_2D ||
-        src_target == PIPE_TEXTURE_RECT) &&
-       src->texture->nr_samples <= 1) {
+static void blitter_end_blit(struct blitter_context_priv *ctx,
+                             boolean scissor)
+{
+   struct pipe_context *pipe = ctx->base.pipe;
+
+   blitter_restore_vertex_states(ctx);
+   blitter_restore_fragment_states(ctx);
+   blitter_restore_textures(ctx);
+   blitter_restore_fb_state(ctx);
+   if (scissor) {
+      pipe->set_scissor_state(pipe, &ctx->base.saved_scissor);
+   }
+   blitter_restore_render_cond(ctx);
+   blitter_unset_running_flag(ctx);
+}
+
+/* Whether the texture coordinates of a blit from this view fit
+ * UTIL_BLITTER_ATTRIB_TEXCOORD, so that draw_rectangle can be used. */
+static boolean blitter_is_blit_rectangle(struct pipe_sampler_view *src)
+{
+   enum pipe_texture_target src_target = src->texture->target;
+
+   return (src_target == PIPE_TEXTURE_1D ||
+           src_target == PIPE_TEXTURE_2D ||
+           src_target == PIPE_TEXTURE_RECT) &&
+          src->texture->nr_samples <= 1;
+}
+
+void util_blitter_blit_generic(struct blitter_context *blitter,
+                               struct pipe_surface *dst,
+                               int dstx, int dsty,
+                               unsigned dst_width, unsigned dst_height,
+                               struct pipe_sampler_view *src,
+                               const struct pipe_box *srcbox,
+                               unsigned src_width0, unsigned src_height0,
+                               unsigned mask, unsigned filter,
+                               const struct pipe_scissor_state *scissor,
+                               boolean copy_all_samples)
+{
+   struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
+   struct pipe_context *pipe = ctx->base.pipe;
+   boolean scaled;
+
+   mask = blitter_get_blit_mask(ctx, dst, src, mask);
+   if (!mask) {
+      return;
+   }
+
+   /* Sanity checks. */
+   if (dst->texture == src->texture &&
+       dst->u.tex.level == src->u.tex.first_level) {
+      assert(!is_overlap(dstx, dsty, 0, srcbox));
+   }
+   /* XXX should handle 3d regions */
+   assert(srcbox->depth == 1);
+
+   scaled = dst_width != abs(srcbox->width) ||
+            dst_height != abs(srcbox->height);
+
+   blitter_begin_blit(ctx, dst, src, mask,
+                      filter == PIPE_TEX_FILTER_LINEAR && scaled, scissor);
+
+   if (blitter_is_blit_rectangle(src)) {
       /* Draw the quad with the draw_rectangle callback. */
 
       /* Set texture coordinates. - use a pipe color union
@@ -1423,15 +1514,7 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
       }
    }
 
-   blitter_restore_vertex_states(ctx);
-   blitter_restore_fragment_states(ctx);
-   blitter_restore_textures(ctx);
-   blitter_restore_fb_state(ctx);
-   if (scissor) {
-      pipe->set_scissor_state(pipe, &ctx->base.saved_scissor);
-   }
-   blitter_restore_render_cond(ctx);
-   blitter_unset_running_flag(ctx);
+   blitter_end_blit(ctx, scissor != NULL);
 }
 
 void
@@ -1468,21 +1551,12 @@ util_blitter_blit(struct blitter_context *blitter,
    pipe_sampler_view_reference(&src_view, NULL);
 }
 
-/* Clear a region of a color surface to a constant value. */
-void util_blitter_clear_render_target(struct blitter_context *blitter,
-                                      struct pipe_surface *dstsurf,
-                                      const union pipe_color_union *color,
-                                      unsigned dstx, unsigned dsty,
-                                      unsigned width, unsigned height)
+static void blitter_begin_clear_render_target(struct blitter_context_priv *ctx,
+                                              struct pipe_surface *dstsurf)
 {
-   struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
    struct pipe_context *pipe = ctx->base.pipe;
    struct pipe_framebuffer_state fb_state;
 
-   assert(dstsurf->texture);
-   if (!dstsurf->texture)
-      return;
-
    /* check the saved state */
    blitter_set_running_flag(ctx);
    blitter_check_saved_vertex_states(ctx);
@@ -1507,9 +1581,10 @@ void util_blitter_clear_render_target(struct blitter_context *blitter,
 
    blitter_set_common_draw_rect_state(ctx, FALSE);
    blitter_set_dst_dimensions(ctx, dstsurf->width, dstsurf->height);
-   blitter->draw_rectangle(blitter, dstx, dsty, dstx+width, dsty+height, 0,
-                           UTIL_BLITTER_ATTRIB_COLOR, color);
+}
 
+static void blitter_end_clear_render_target(struct blitter_context_priv *ctx)
+{
    blitter_restore_vertex_states(ctx);
    blitter_restore_fragment_states(ctx);
    blitter_restore_fb_state(ctx);
@@ -1517,6 +1592,207 @@ void util_blitter_clear_render_target(struct blitter_context *blitter,
    blitter_unset_running_flag(ctx);
 }
 
+/* Clear a region of a color surface to a constant value. */
+void util_blitter_clear_render_target(struct blitter_context *blitter,
+                                      struct pipe_surface *dstsurf,
+                                      const union pipe_color_union *color,
+                                      unsigned dstx, unsigned dsty,
+                                      unsigned width, unsigned height)
+{
+   struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
+
+   assert(dstsurf->texture);
+   if (!dstsurf->texture)
+      return;
+
+   blitter_begin_clear_render_target(ctx, dstsurf);
+   blitter->draw_rectangle(blitter, dstx, dsty, dstx+width, dsty+height, 0,
+                           UTIL_BLITTER_ATTRIB_COLOR, color);
+   blitter_end_clear_render_target(ctx);
+}
+
+/* Draw the rectangles queued so far as one triangle list. */
+static void blitter_flush_batch(struct blitter_context_priv *ctx)
+{
+   struct pipe_resource *buf = NULL;
+   unsigned offset = 0;
+
+   if (!ctx->batch_num_vertices)
+      return;
+
+   u_upload_data(ctx->upload, 0,
+                 ctx->batch_num_vertices * sizeof(ctx->batch_vertices[0]),
+                 ctx->batch_vertices, &offset, &buf);
+   u_upload_unmap(ctx->upload);
+   util_draw_vertex_buffer(ctx->base.pipe, NULL, buf, ctx->base.vb_slot,
+                           offset, PIPE_PRIM_TRIANGLES,
+                           ctx->batch_num_vertices, 2);
+   pipe_resource_reference(&buf, NULL);
+
+   ctx->batch_num_vertices = 0;
+}
+
+/* Queue the rectangle in ctx->vertices as two triangles. */
+static void blitter_queue_rectangle(struct blitter_context_priv *ctx)
+{
+   static const unsigned order[6] = {0, 1, 2, 0, 2, 3};
+   unsigned i;
+
+   if (ctx->batch_num_vertices + 6 > Elements(ctx->batch_vertices))
+      blitter_flush_batch(ctx);
+
+   for (i = 0; i < 6; i++) {
+      memcpy(ctx->batch_vertices[ctx->batch_num_vertices++],
+             ctx->vertices[order[i]], sizeof(ctx->vertices[0]));
+   }
+}
+
+/* Whether the rectangles must be passed to a driver-provided
+ * draw_rectangle callback one by one. */
+static boolean blitter_has_custom_draw_rectangle(struct blitter_context_priv *ctx)
+{
+   return ctx->base.draw_rectangle != util_blitter_draw_rectangle;
+}
+
+void util_blitter_begin_blit_batch(struct blitter_context *blitter,
+                                   struct pipe_surface *dst,
+                                   struct pipe_sampler_view *src,
+                                   unsigned src_width0, unsigned src_height0,
+                                   unsigned mask, unsigned filter,
+                                   const struct pipe_scissor_state *scissor)
+{
+   struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
+
+   assert(ctx->batch_type == BLITTER_BATCH_NONE);
+
+   ctx->batch_type = BLITTER_BATCH_BLIT;
+   ctx->batch_num_vertices = 0;
+   ctx->batch_scissor = scissor != NULL;
+
+   mask = blitter_get_blit_mask(ctx, dst, src, mask);
+   ctx->batch_empty = !mask;
+   if (ctx->batch_empty)
+      return;
+
+   /* Scaling isn't known yet, so the linear filter is used whenever it's
+    * asked for.  It gives the same result as nearest for unscaled
+    * rectangles. */
+   blitter_begin_blit(ctx, dst, src, mask,
+                      filter == PIPE_TEX_FILTER_LINEAR, scissor);
+   ctx->base.pipe->set_sample_mask(ctx->base.pipe, ~0);
+   blitter_set_viewport(ctx);
+
+   pipe_sampler_view_reference(&ctx->batch_src, src);
+   ctx->batch_src_width0 = src_width0;
+   ctx->batch_src_height0 = src_height0;
+}
+
+void util_blitter_batch_blit(struct blitter_context *blitter,
+                             int dstx, int dsty,
+                             unsigned dst_width, unsigned dst_height,
+                             const struct pipe_box *srcbox)
+{
+   struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
+   struct pipe_sampler_view *src = ctx->batch_src;
+
+   assert(ctx->batch_type == BLITTER_BATCH_BLIT);
+   assert(srcbox->depth == 1);
+
+   if (ctx->batch_empty)
+      return;
+
+   if (blitter_is_blit_rectangle(src)) {
+      union pipe_color_union coord;
+
+      get_texcoords(src, ctx->batch_src_width0, ctx->batch_src_height0,
+                    srcbox->x, srcbox->y,
+                    srcbox->x+srcbox->width, srcbox->y+srcbox->height, coord.f);
+
+      if (blitter_has_custom_draw_rectangle(ctx)) {
+         blitter->draw_rectangle(blitter, dstx, dsty,
+                                 dstx+dst_width, dsty+dst_height, 0,
+                                 UTIL_BLITTER_ATTRIB_TEXCOORD, &coord);
+         return;
+      }
+      set_texcoords_in_vertices(coord.f, &ctx->vertices[0][1][0], 8);
+   } else {
+      blitter_set_texcoords(ctx, src,
+                            ctx->batch_src_width0, ctx->batch_src_height0,
+                            srcbox->z, 0, srcbox->x, srcbox->y,
+                            srcbox->x + srcbox->width,
+                            srcbox->y + srcbox->height);
+   }
+
+   blitter_set_rectangle_vertices(ctx, dstx, dsty,
+                                  dstx+dst_width, dsty+dst_height, 0);
+   blitter_queue_rectangle(ctx);
+}
+
+void util_blitter_begin_clear_batch(struct blitter_context *blitter,
+                                    struct pipe_surface *dstsurf,
+                                    const union pipe_color_union *color)
+{
+   struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
+
+   assert(ctx->batch_type == BLITTER_BATCH_NONE);
+   assert(dstsurf->texture);
+
+   ctx->batch_type = BLITTER_BATCH_CLEAR;
+   ctx->batch_num_vertices = 0;
+   ctx->batch_empty = !dstsurf->texture;
+   if (ctx->batch_empty)
+      return;
+
+   blitter_begin_clear_render_target(ctx, dstsurf);
+   blitter_set_viewport(ctx);
+   blitter_set_clear_color(ctx, color);
+
+   /* A custom draw_rectangle gets the color with each rectangle. */
+   ctx->batch_color = *color;
+}
+
+void util_blitter_batch_clear(struct blitter_context *blitter,
+                              unsigned dstx, unsigned dsty,
+                              unsigned width, unsigned height)
+{
+   struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
+
+   assert(ctx->batch_type == BLITTER_BATCH_CLEAR);
+
+   if (ctx->batch_empty)
+      return;
+
+   if (blitter_has_custom_draw_rectangle(ctx)) {
+      blitter->draw_rectangle(blitter, dstx, dsty, dstx+width, dsty+height, 0,
+                              UTIL_BLITTER_ATTRIB_COLOR, &ctx->batch_color);
+      return;
+   }
+
+   blitter_set_rectangle_vertices(ctx, dstx, dsty,
+                                  dstx+width, dsty+height, 0);
+   blitter_queue_rectangle(ctx);
+}
+
+void util_blitter_end_batch(struct blitter_context *blitter)
+{
+   struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
+
+   assert(ctx->batch_type != BLITTER_BATCH_NONE);
+
+   if (!ctx->batch_empty) {
+      blitter_flush_batch(ctx);
+
+      if (ctx->batch_type == BLITTER_BATCH_BLIT) {
+         blitter_end_blit(ctx, ctx->batch_scissor);
+         pipe_sampler_view_reference(&ctx->batch_src, NULL);
+      } else {
+         blitter_end_clear_render_target(ctx);
+      }
+   }
+
+   ctx->batch_type = BLITTER_BATCH_NONE;
+}
+
 /* Clear a region of a depth stencil surface. */
 void util_blitter_clear_depth_stencil(struct blitter_context *blitter,
                                       struct pipe_surface *dstsurf,
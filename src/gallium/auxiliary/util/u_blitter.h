@@ -248,6 +248,55 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
 void util_blitter_blit(struct blitter_context *blitter,
 		       const struct pipe_blit_info *info);
 
+/**
+ * Batched version of util_blitter_blit_generic, for many small rectangles
+ * sharing the same views and blit parameters.
+ *
+ * util_blitter_begin_blit_batch binds all the states, each
+ * util_blitter_batch_blit queues one rectangle, and util_blitter_end_batch
+ * draws the queued rectangles with as few draw calls as possible and
+ * restores the saved states.  No other pipe or blitter functions may be
+ * called between begin and end.
+ *
+ * The states which must be saved are the same as for
+ * util_blitter_blit_generic.  The linear filter is used for all rectangles
+ * if requested, scaled or not, and MSAA sources are handled as with
+ * copy_all_samples = FALSE.
+ */
+void util_blitter_begin_blit_batch(struct blitter_context *blitter,
+                                   struct pipe_surface *dst,
+                                   struct pipe_sampler_view *src,
+                                   unsigned src_width0, unsigned src_height0,
+                                   unsigned mask, unsigned filter,
+                                   const struct pipe_scissor_state *scissor);
+
+void util_blitter_batch_blit(struct blitter_context *blitter,
+                             int dstx, int dsty,
+                             unsigned dst_width, unsigned dst_height,
+                             const struct pipe_box *srcbox);
+
+/**
+ * Batched version of util_blitter_clear_render_target, for clearing many
+ * regions of one surface to the same color.  Use util_blitter_end_batch
+ * to finish the batch.
+ *
+ * The states which must be saved are the same as for
+ * util_blitter_clear_render_target.
+ */
+void util_blitter_begin_clear_batch(struct blitter_context *blitter,
+                                    struct pipe_surface *dst,
+                                    const union pipe_color_union *color);
+
+void util_blitter_batch_clear(struct blitter_context *blitter,
+                              unsigned dstx, unsigned dsty,
+                              unsigned width, unsigned height);
+
+/**
+ * Draw everything queued since util_blitter_begin_*_batch and restore
+ * the saved states.
+ */
+void util_blitter_end_batch(struct blitter_context *blitter);
+
 /**
  * Helper function to initialize a view for copy_texture_view.
  * The parameters must match copy_texture_view.
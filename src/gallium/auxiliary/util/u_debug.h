@@ -412,6 +412,9 @@ debug_memory_begin(void);
 void 
 debug_memory_end(unsigned long beginning);
 
+void
+debug_memory_slab_report(void);
+
 
 #ifdef DEBUG
 struct pipe_context;
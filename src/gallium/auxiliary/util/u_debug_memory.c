@@ -43,6 +43,10 @@
 #include "util/u_debug.h" 
 #include "util/u_debug_stack.h" 
 #include "util/u_double_list.h" 
+#include "util/u_slab.h"
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(slab_stats, "GALLIUM_SLAB_STATS", FALSE)
 
 
 #define DEBUG_MEMORY_MAGIC 0x6e34090aU 
@@ -286,6 +290,27 @@ debug_realloc(const char *file, unsigned line, const char *function,
    return new_ptr;
 }
 
+static void
+debug_memory_slab_stats(const char *name,
+                        const struct util_slab_stats *stats,
+                        void *data)
+{
+   debug_printf("%s: %u live, %u allocs, %u frees (%u from other threads), "
+                "%u pages, %u thread caches\n",
+                name, stats->num_allocs - stats->num_frees,
+                stats->num_allocs, stats->num_frees, stats->num_remote_frees,
+                stats->num_pages, stats->num_caches);
+}
+
+/**
+ * Print the allocation counters of all named slab pools.
+ */
+void
+debug_memory_slab_report(void)
+{
+   util_slab_foreach_stats(debug_memory_slab_stats, NULL);
+}
+
 unsigned long
 debug_memory_begin(void)
 {
@@ -298,6 +323,9 @@ debug_memory_end(unsigned long start_no)
    size_t total_size = 0;
    struct list_head *entry;
 
+   if (debug_get_option_slab_stats())
+      debug_memory_slab_report();
+
    if(start_no == last_no)
       return;
 
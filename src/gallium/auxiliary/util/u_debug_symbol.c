@@ -200,21 +200,6 @@ debug_symbol_print(const void *addr)
 struct util_hash_table* symbols_hash;
 pipe_static_mutex(symbols_mutex);
 
-static unsigned hash_ptr(void* p)
-{
-   return (unsigned)(uintptr_t)p;
-}
-
-static int compare_ptr(void* a, void* b)
-{
-   if(a == b)
-      return 0;
-   else if(a < b)
-      return -1;
-   else
-      return 1;
-}
-
 const char*
 debug_symbol_name_cached(const void *addr)
 {
@@ -230,7 +215,7 @@ debug_symbol_name_cached(const void *addr)
 
    pipe_mutex_lock(symbols_mutex);
    if(!symbols_hash)
-      symbols_hash = util_hash_table_create(hash_ptr, compare_ptr);
+      symbols_hash = util_hash_table_create_ptr_keys();
    name = util_hash_table_get(symbols_hash, (void*)addr);
    if(!name)
    {
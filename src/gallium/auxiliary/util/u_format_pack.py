@@ -583,6 +583,76 @@ def generate_pack_kernel(format, src_channel, src_native_type):
         print '         memcpy(dst, &pixel, sizeof pixel);'
     
 
+def simd_swizzle(swizzles):
+    '''Generate the UTIL_FORMAT_SIMD_SWIZZLE() expression for a swizzle.'''
+
+    names = []
+    for swizzle in swizzles:
+        if swizzle is None or swizzle == SWIZZLE_NONE:
+            swizzle = SWIZZLE_0
+        names.append('UTIL_FORMAT_SWIZZLE_%s' % 'XYZW01'[swizzle])
+    return 'UTIL_FORMAT_SIMD_SWIZZLE(%s)' % ', '.join(names)
+
+
+def is_format_4x8unorm(format):
+    '''Plain RGB formats made of four 8-bit unorm (or padding) channels.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return False
+    for channel in format.channels:
+        if channel.size != 8:
+            return False
+        if channel.type != VOID and (channel.type != UNSIGNED or not channel.norm or channel.pure):
+            return False
+    return True
+
+
+def is_format_4x16float(format):
+    '''Plain RGB formats made of four half float (or padding) channels,
+    which are not swizzled.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return False
+    for channel in format.channels:
+        if channel.size != 16 or channel.type not in (VOID, FLOAT):
+            return False
+    for i in range(4):
+        if format.swizzles[i] not in (i, SWIZZLE_0, SWIZZLE_1):
+            return False
+    return True
+
+
+def simd_row_function(format, pack, suffix):
+    '''Return the u_format_simd.h call which converts a whole rectangle
+    for this format, or None if there is none.'''
+
+    args = 'dst_row, dst_stride, src_row, src_stride, width, height'
+
+    if format.name == 'PIPE_FORMAT_B5G6R5_UNORM' and suffix == 'rgba_8unorm':
+        if pack:
+            return 'util_format_b5g6r5_unorm_pack_rgba_8unorm_simd(%s)' % args
+        else:
+            return 'util_format_b5g6r5_unorm_unpack_rgba_8unorm_simd(%s)' % args
+
+    if is_format_4x8unorm(format):
+        if pack:
+            swizzle = simd_swizzle(format.inv_swizzles())
+        else:
+            swizzle = simd_swizzle(format.swizzles)
+        if suffix == 'rgba_8unorm':
+            return 'util_format_swizzle_4x8_simd(%s, %s)' % (args, swizzle)
+        if suffix == 'rgba_float':
+            if pack:
+                return 'util_format_pack_4x8unorm_float_simd(%s, %s)' % (args, swizzle)
+            else:
+                return 'util_format_unpack_4x8unorm_float_simd(%s, %s)' % (args, swizzle)
+
+    if is_format_4x16float(format) and suffix == 'rgba_float' and not pack:
+        return 'util_format_unpack_4x16float_float_simd(%s, %s)' % (args, simd_swizzle(format.swizzles))
+
+    return None
+
+
 def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     '''Generate the function to unpack pixels from a particular format'''
 
@@ -592,6 +662,12 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     print 'util_format_%s_unpack_%s(%s *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, dst_suffix, dst_native_type)
     print '{'
 
+    simd = simd_row_function(format, False, dst_suffix)
+    if simd:
+        print '#if defined(PIPE_ARCH_SSE) && !defined(PIPE_ARCH_BIG_ENDIAN)'
+        print '   %s;' % simd
+        print '#else'
+
     if is_format_supported(format):
         print '   unsigned x, y;'
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
@@ -608,6 +684,9 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
         print '      dst_row += dst_stride/sizeof(*dst_row);'
         print '   }'
 
+    if simd:
+        print '#endif'
+
     print '}'
     print
     
@@ -621,6 +700,12 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
     print 'util_format_%s_pack_%s(uint8_t *dst_row, unsigned dst_stride, const %s *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, src_suffix, src_native_type)
     print '{'
     
+    simd = simd_row_function(format, True, src_suffix)
+    if simd:
+        print '#if defined(PIPE_ARCH_SSE) && !defined(PIPE_ARCH_BIG_ENDIAN)'
+        print '   %s;' % simd
+        print '#else'
+
     if is_format_supported(format):
         print '   unsigned x, y;'
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
@@ -636,7 +721,10 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
         print '      dst_row += dst_stride;'
         print '      src_row += src_stride/sizeof(*src_row);'
         print '   }'
-        
+
+    if simd:
+        print '#endif'
+
     print '}'
     print
     
@@ -668,6 +756,7 @@ def generate(formats):
     print '#include "u_half.h"'
     print '#include "u_format.h"'
     print '#include "u_format_other.h"'
+    print '#include "u_format_simd.h"'
     print '#include "u_format_srgb.h"'
     print '#include "u_format_yuv.h"'
     print '#include "u_format_zs.h"'
@@ -0,0 +1,513 @@
+/**************************************************************************
+ *
+ * Copyright 2010 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * SIMD row converters used by the generated pack/unpack functions.
+ *
+ * Only SSE2 is required. The SSSE3 byte shuffle is used when the CPU has
+ * it and util_cpu_detect() has been called, which all the drivers do.
+ * u_sse.h provides it even when the compiler isn't targeting SSSE3.
+ */
+
+
+#include "u_cpu_detect.h"
+#include "u_format.h"
+#include "u_format_simd.h"
+#include "u_half.h"
+#include "u_math.h"
+#include "u_sse.h"
+
+#if defined(PIPE_ARCH_SSE)
+
+
+static INLINE unsigned
+swizzle_chan(uint32_t swizzle, unsigned chan)
+{
+   return (swizzle >> (chan * 8)) & 0xff;
+}
+
+
+/**
+ * Scalar version of the 4x8 byte shuffle, for the row tails.
+ */
+static INLINE uint32_t
+swizzle_4x8(uint32_t value, uint32_t swizzle)
+{
+   uint32_t result = 0;
+   unsigned j;
+
+   for (j = 0; j < 4; j++) {
+      unsigned s = swizzle_chan(swizzle, j);
+      if (s <= UTIL_FORMAT_SWIZZLE_W)
+         result |= ((value >> (s * 8)) & 0xff) << (j * 8);
+      else if (s == UTIL_FORMAT_SWIZZLE_1)
+         result |= 0xffU << (j * 8);
+   }
+
+   return result;
+}
+
+
+/**
+ * Precomputed state for shuffling the bytes of four 4x8 pixels at once.
+ */
+struct swizzle_4x8_sse
+{
+   boolean identity;
+   unsigned nr_shifts;
+   struct {
+      __m128i count;
+      __m128i mask;
+      boolean left;
+   } shifts[4];
+   __m128i ones;
+   boolean ssse3;
+   __m128i shuffle;
+};
+
+
+static void
+swizzle_4x8_sse_init(struct swizzle_4x8_sse *sw, uint32_t swizzle)
+{
+   uint32_t ones = 0;
+   unsigned j;
+   uint8_t shuffle[16];
+
+   sw->identity = TRUE;
+   sw->nr_shifts = 0;
+
+   for (j = 0; j < 4; j++) {
+      unsigned s = swizzle_chan(swizzle, j);
+
+      if (s != j)
+         sw->identity = FALSE;
+
+      if (s <= UTIL_FORMAT_SWIZZLE_W) {
+         /* Move byte s to byte j with a single shift and mask. */
+         unsigned i = sw->nr_shifts++;
+         sw->shifts[i].left = j > s;
+         sw->shifts[i].count = _mm_cvtsi32_si128(j > s ? (j - s) * 8 : (s - j) * 8);
+         sw->shifts[i].mask = _mm_set1_epi32((int)(0xffU << (j * 8)));
+      }
+      else if (s == UTIL_FORMAT_SWIZZLE_1) {
+         ones |= 0xffU << (j * 8);
+      }
+
+      {
+         unsigned p;
+         for (p = 0; p < 4; p++)
+            shuffle[p * 4 + j] = s <= UTIL_FORMAT_SWIZZLE_W ? p * 4 + s : 0x80;
+      }
+   }
+
+   sw->ones = _mm_set1_epi32(ones);
+
+   sw->ssse3 = util_cpu_caps.has_ssse3;
+   sw->shuffle = _mm_loadu_si128((const __m128i *)shuffle);
+}
+
+
+static INLINE __m128i
+swizzle_4x8_sse(const struct swizzle_4x8_sse *sw, __m128i v)
+{
+   __m128i result;
+   unsigned i;
+
+   if (sw->identity)
+      return v;
+
+   if (sw->ssse3)
+      return _mm_or_si128(_mm_shuffle_epi8(v, sw->shuffle), sw->ones);
+
+   result = sw->ones;
+   for (i = 0; i < sw->nr_shifts; i++) {
+      __m128i t = sw->shifts[i].left ? _mm_sll_epi32(v, sw->shifts[i].count)
+                                     : _mm_srl_epi32(v, sw->shifts[i].count);
+      result = _mm_or_si128(result, _mm_and_si128(t, sw->shifts[i].mask));
+   }
+
+   return result;
+}
+
+
+void
+util_format_swizzle_4x8_simd(uint8_t *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height, uint32_t swizzle)
+{
+   struct swizzle_4x8_sse sw;
+   unsigned x, y;
+
+   swizzle_4x8_sse_init(&sw, swizzle);
+
+   for (y = 0; y < height; y++) {
+      const uint8_t *src = src_row;
+      uint8_t *dst = dst_row;
+
+      for (x = 0; x + 4 <= width; x += 4) {
+         __m128i v = _mm_loadu_si128((const __m128i *)src);
+         _mm_storeu_si128((__m128i *)dst, swizzle_4x8_sse(&sw, v));
+         src += 16;
+         dst += 16;
+      }
+
+      for (; x < width; x++) {
+         uint32_t value;
+         memcpy(&value, src, 4);
+         value = swizzle_4x8(value, swizzle);
+         memcpy(dst, &value, 4);
+         src += 4;
+         dst += 4;
+      }
+
+      src_row += src_stride;
+      dst_row += dst_stride;
+   }
+}
+
+
+/**
+ * Lane mask and values for the destination channels which are constant.
+ */
+static INLINE void
+constant_lanes(uint32_t swizzle, __m128 *mask, __m128 *value)
+{
+   union fi m[4], v[4];
+   unsigned j;
+
+   for (j = 0; j < 4; j++) {
+      unsigned s = swizzle_chan(swizzle, j);
+      m[j].ui = s > UTIL_FORMAT_SWIZZLE_W ? ~0U : 0;
+      v[j].f = s == UTIL_FORMAT_SWIZZLE_1 ? 1.0f : 0.0f;
+   }
+
+   *mask = _mm_setr_ps(m[0].f, m[1].f, m[2].f, m[3].f);
+   *value = _mm_setr_ps(v[0].f, v[1].f, v[2].f, v[3].f);
+}
+
+
+static INLINE __m128
+select_ps(__m128 mask, __m128 a, __m128 b)
+{
+   return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+
+void
+util_format_unpack_4x8unorm_float_simd(float *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height, uint32_t swizzle)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+   struct swizzle_4x8_sse sw;
+   __m128 const_mask, const_value;
+   unsigned x, y;
+
+   swizzle_4x8_sse_init(&sw, swizzle);
+   constant_lanes(swizzle, &const_mask, &const_value);
+
+   for (y = 0; y < height; y++) {
+      const uint8_t *src = src_row;
+      float *dst = dst_row;
+
+      for (x = 0; x + 4 <= width; x += 4) {
+         __m128i v = swizzle_4x8_sse(&sw, _mm_loadu_si128((const __m128i *)src));
+         __m128i lo = _mm_unpacklo_epi8(v, zero);
+         __m128i hi = _mm_unpackhi_epi8(v, zero);
+         __m128 p0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+         __m128 p1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+         __m128 p2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+         __m128 p3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+
+         _mm_storeu_ps(dst + 0, select_ps(const_mask, const_value, _mm_mul_ps(p0, scale)));
+         _mm_storeu_ps(dst + 4, select_ps(const_mask, const_value, _mm_mul_ps(p1, scale)));
+         _mm_storeu_ps(dst + 8, select_ps(const_mask, const_value, _mm_mul_ps(p2, scale)));
+         _mm_storeu_ps(dst + 12, select_ps(const_mask, const_value, _mm_mul_ps(p3, scale)));
+         src += 16;
+         dst += 16;
+      }
+
+      for (; x < width; x++) {
+         unsigned j;
+         for (j = 0; j < 4; j++) {
+            unsigned s = swizzle_chan(swizzle, j);
+            if (s <= UTIL_FORMAT_SWIZZLE_W)
+               dst[j] = ubyte_to_float(src[s]);
+            else
+               dst[j] = s == UTIL_FORMAT_SWIZZLE_1 ? 1.0f : 0.0f;
+         }
+         src += 4;
+         dst += 4;
+      }
+
+      src_row += src_stride;
+      dst_row += dst_stride/sizeof(*dst_row);
+   }
+}
+
+
+/**
+ * Vector version of float_to_ubyte(), with the same results.
+ */
+static INLINE __m128i
+float_to_ubyte_sse(__m128 f)
+{
+   const __m128i ieee_0996 = _mm_set1_epi32(0x3f7f0000);
+   const __m128i ubyte_max = _mm_set1_epi32(0xff);
+   __m128i bits = _mm_castps_si128(f);
+   __m128i neg = _mm_cmplt_epi32(bits, _mm_setzero_si128());
+   __m128i sat = _mm_cmpgt_epi32(bits, _mm_sub_epi32(ieee_0996, _mm_set1_epi32(1)));
+   __m128 t = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.0f/256.0f)),
+                         _mm_set1_ps(32768.0f));
+   __m128i result = _mm_and_si128(_mm_castps_si128(t), ubyte_max);
+
+   result = _mm_andnot_si128(_mm_or_si128(neg, sat), result);
+   return _mm_or_si128(result, _mm_and_si128(sat, ubyte_max));
+}
+
+
+void
+util_format_pack_4x8unorm_float_simd(uint8_t *dst_row, unsigned dst_stride, const float *src_row, unsigned src_stride, unsigned width, unsigned height, uint32_t swizzle)
+{
+   struct swizzle_4x8_sse sw;
+   unsigned x, y;
+
+   swizzle_4x8_sse_init(&sw, swizzle);
+
+   for (y = 0; y < height; y++) {
+      const float *src = src_row;
+      uint8_t *dst = dst_row;
+
+      for (x = 0; x + 4 <= width; x += 4) {
+         __m128i p0 = float_to_ubyte_sse(_mm_loadu_ps(src + 0));
+         __m128i p1 = float_to_ubyte_sse(_mm_loadu_ps(src + 4));
+         __m128i p2 = float_to_ubyte_sse(_mm_loadu_ps(src + 8));
+         __m128i p3 = float_to_ubyte_sse(_mm_loadu_ps(src + 12));
+         __m128i v = _mm_packus_epi16(_mm_packs_epi32(p0, p1),
+                                      _mm_packs_epi32(p2, p3));
+
+         _mm_storeu_si128((__m128i *)dst, swizzle_4x8_sse(&sw, v));
+         src += 16;
+         dst += 16;
+      }
+
+      for (; x < width; x++) {
+         unsigned j;
+         for (j = 0; j < 4; j++) {
+            unsigned s = swizzle_chan(swizzle, j);
+            dst[j] = s <= UTIL_FORMAT_SWIZZLE_W ? float_to_ubyte(src[s]) : 0;
+         }
+         src += 4;
+         dst += 4;
+      }
+
+      dst_row += dst_stride;
+      src_row += src_stride/sizeof(*src_row);
+   }
+}
+
+
+/**
+ * Vector version of util_half_to_float(), with the same results.
+ */
+static INLINE __m128
+half_to_float_sse(__m128i h)
+{
+   union fi infnan, magic;
+   __m128 f;
+   __m128i sign;
+
+   infnan.ui = 0x8f << 23;
+   infnan.f = 65536.0f;
+   magic.ui = 0xef << 23;
+
+   /* Exponent / Mantissa */
+   f = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13));
+
+   /* Adjust */
+   f = _mm_mul_ps(f, _mm_set1_ps(magic.f));
+
+   /* Inf / NaN */
+   f = _mm_or_ps(f, _mm_and_ps(_mm_cmpge_ps(f, _mm_set1_ps(infnan.f)),
+                               _mm_castsi128_ps(_mm_set1_epi32(0xff << 23))));
+
+   /* Sign */
+   sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+   return _mm_or_ps(f, _mm_castsi128_ps(sign));
+}
+
+
+void
+util_format_unpack_4x16float_float_simd(float *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height, uint32_t swizzle)
+{
+   const __m128i zero = _mm_setzero_si128();
+   __m128 const_mask, const_value;
+   unsigned x, y;
+
+   constant_lanes(swizzle, &const_mask, &const_value);
+
+   for (y = 0; y < height; y++) {
+      const uint16_t *src = (const uint16_t *)src_row;
+      float *dst = dst_row;
+
+      for (x = 0; x + 2 <= width; x += 2) {
+         __m128i v = _mm_loadu_si128((const __m128i *)src);
+         __m128 p0 = half_to_float_sse(_mm_unpacklo_epi16(v, zero));
+         __m128 p1 = half_to_float_sse(_mm_unpackhi_epi16(v, zero));
+
+         _mm_storeu_ps(dst + 0, select_ps(const_mask, const_value, p0));
+         _mm_storeu_ps(dst + 4, select_ps(const_mask, const_value, p1));
+         src += 8;
+         dst += 8;
+      }
+
+      for (; x < width; x++) {
+         unsigned j;
+         for (j = 0; j < 4; j++) {
+            unsigned s = swizzle_chan(swizzle, j);
+            if (s <= UTIL_FORMAT_SWIZZLE_W) {
+               assert(s == j);
+               dst[j] = util_half_to_float(src[s]);
+            }
+            else
+               dst[j] = s == UTIL_FORMAT_SWIZZLE_1 ? 1.0f : 0.0f;
+         }
+         src += 4;
+         dst += 4;
+      }
+
+      src_row += src_stride;
+      dst_row += dst_stride/sizeof(*dst_row);
+   }
+}
+
+
+void
+util_format_b5g6r5_unorm_unpack_rgba_8unorm_simd(uint8_t *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   const __m128i mask5 = _mm_set1_epi16(0x1f);
+   const __m128i mask6 = _mm_set1_epi16(0x3f);
+   const __m128i alpha = _mm_set1_epi16((short)0xff00);
+   unsigned x, y;
+
+   for (y = 0; y < height; y++) {
+      const uint8_t *src = src_row;
+      uint8_t *dst = dst_row;
+
+      for (x = 0; x + 8 <= width; x += 8) {
+         __m128i v = _mm_loadu_si128((const __m128i *)src);
+         __m128i r = _mm_srli_epi16(v, 11);
+         __m128i g = _mm_and_si128(_mm_srli_epi16(v, 5), mask6);
+         __m128i b = _mm_and_si128(v, mask5);
+         __m128i rg, ba;
+
+         /*
+          * Exact replacements for x * 0xff / 0x1f and x * 0xff / 0x3f
+          * which fit in 16 bits.
+          */
+         r = _mm_srli_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(1053)), 7);
+         b = _mm_srli_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(1053)), 7);
+         g = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(g, _mm_set1_epi16(259)),
+                                          _mm_set1_epi16(3)), 6);
+
+         rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+         ba = _mm_or_si128(b, alpha);
+         _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(rg, ba));
+         _mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(rg, ba));
+         src += 16;
+         dst += 32;
+      }
+
+      for (; x < width; x++) {
+         uint16_t value = *(const uint16_t *)src;
+         uint16_t b = value & 0x1f;
+         uint16_t g = (value >> 5) & 0x3f;
+         uint16_t r = value >> 11;
+         dst[0] = (uint8_t)(((uint32_t)r) * 0xff / 0x1f);
+         dst[1] = (uint8_t)(((uint32_t)g) * 0xff / 0x3f);
+         dst[2] = (uint8_t)(((uint32_t)b) * 0xff / 0x1f);
+         dst[3] = 255;
+         src += 2;
+         dst += 4;
+      }
+
+      src_row += src_stride;
+      dst_row += dst_stride;
+   }
+}
+
+
+static INLINE __m128i
+pack_565_sse(__m128i v)
+{
+   const __m128i mask = _mm_set1_epi32(0xff);
+   __m128i r = _mm_and_si128(v, mask);
+   __m128i g = _mm_and_si128(_mm_srli_epi32(v, 8), mask);
+   __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), mask);
+   __m128i value;
+
+   value = _mm_srli_epi32(b, 3);
+   value = _mm_or_si128(value, _mm_slli_epi32(_mm_srli_epi32(g, 2), 5));
+   value = _mm_or_si128(value, _mm_slli_epi32(_mm_srli_epi32(r, 3), 11));
+
+   /* Sign extend so that the saturating pack keeps all 16 bits. */
+   return _mm_srai_epi32(_mm_slli_epi32(value, 16), 16);
+}
+
+
+void
+util_format_b5g6r5_unorm_pack_rgba_8unorm_simd(uint8_t *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   unsigned x, y;
+
+   for (y = 0; y < height; y++) {
+      const uint8_t *src = src_row;
+      uint8_t *dst = dst_row;
+
+      for (x = 0; x + 8 <= width; x += 8) {
+         __m128i lo = pack_565_sse(_mm_loadu_si128((const __m128i *)src));
+         __m128i hi = pack_565_sse(_mm_loadu_si128((const __m128i *)(src + 16)));
+         _mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(lo, hi));
+         src += 32;
+         dst += 16;
+      }
+
+      for (; x < width; x++) {
+         uint16_t value = 0;
+         value |= ((uint16_t)(src[2] >> 3)) & 0x1f;
+         value |= (((uint16_t)(src[1] >> 2)) & 0x3f) << 5;
+         value |= ((uint16_t)(src[0] >> 3)) << 11;
+         *(uint16_t *)dst = value;
+         src += 4;
+         dst += 2;
+      }
+
+      dst_row += dst_stride;
+      src_row += src_stride;
+   }
+}
+
+#endif /* PIPE_ARCH_SSE */
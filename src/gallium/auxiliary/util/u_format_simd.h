@@ -0,0 +1,91 @@
+/**************************************************************************
+ *
+ * Copyright 2010 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * SIMD row converters for the most common pixel layouts.
+ *
+ * The pack/unpack functions generated by u_format_pack.py call into these
+ * for the formats they can handle. Results are bit-identical to the
+ * generated scalar code.
+ *
+ * Swizzles are packed with UTIL_FORMAT_SIMD_SWIZZLE(), one
+ * UTIL_FORMAT_SWIZZLE_x value per destination channel. For the pack
+ * direction the swizzle maps format channels to rgba source channels.
+ */
+
+
+#ifndef U_FORMAT_SIMD_H_
+#define U_FORMAT_SIMD_H_
+
+
+#include "pipe/p_compiler.h"
+
+
+#define UTIL_FORMAT_SIMD_SWIZZLE(x, y, z, w) \
+   ((uint32_t)(x) | ((uint32_t)(y) << 8) | ((uint32_t)(z) << 16) | ((uint32_t)(w) << 24))
+
+
+/**
+ * Shuffle the bytes of 4x8-bit pixels. Constant 1 swizzles give 0xff.
+ */
+void
+util_format_swizzle_4x8_simd(uint8_t *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height, uint32_t swizzle);
+
+
+/**
+ * 4x8-bit unorm pixels to rgba floats.
+ */
+void
+util_format_unpack_4x8unorm_float_simd(float *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height, uint32_t swizzle);
+
+
+/**
+ * rgba floats to 4x8-bit unorm pixels.
+ */
+void
+util_format_pack_4x8unorm_float_simd(uint8_t *dst_row, unsigned dst_stride, const float *src_row, unsigned src_stride, unsigned width, unsigned height, uint32_t swizzle);
+
+
+/**
+ * 4x16-bit half float pixels to rgba floats. Every destination channel
+ * must either come from the same source channel or be a constant.
+ */
+void
+util_format_unpack_4x16float_float_simd(float *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height, uint32_t swizzle);
+
+
+void
+util_format_b5g6r5_unorm_unpack_rgba_8unorm_simd(uint8_t *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height);
+
+
+void
+util_format_b5g6r5_unorm_pack_rgba_8unorm_simd(uint8_t *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height);
+
+
+#endif /* U_FORMAT_SIMD_H_ */
@@ -50,9 +50,15 @@
 #include "util/u_texture.h"
 #include "util/u_half.h"
 #include "util/u_surface.h"
+#include "util/u_cpu_detect.h"
+#include "os/os_thread.h"
 
 #include "cso_cache/cso_context.h"
 
+#if defined(PIPE_ARCH_SSE)
+#include <emmintrin.h>
+#endif
+
 
 struct gen_mipmap_state
 {
@@ -903,7 +909,7 @@ do_row_3D(enum dtype datatype, uint comps, int srcWidth,
 
 
 
-static void
+static boolean
 format_to_type_comps(enum pipe_format pformat,
                      enum dtype *datatype, uint *comps)
 {
@@ -922,37 +928,36 @@ format_to_type_comps(enum pipe_format pformat,
    case PIPE_FORMAT_R8G8B8_SRGB:
       *datatype = DTYPE_UBYTE;
       *comps = 4;
-      return;
+      return TRUE;
    case PIPE_FORMAT_B5G5R5X1_UNORM:
    case PIPE_FORMAT_B5G5R5A1_UNORM:
       *datatype = DTYPE_USHORT_1_5_5_5_REV;
       *comps = 4;
-      return;
+      return TRUE;
    case PIPE_FORMAT_B4G4R4A4_UNORM:
       *datatype = DTYPE_USHORT_4_4_4_4;
       *comps = 4;
-      return;
+      return TRUE;
    case PIPE_FORMAT_B5G6R5_UNORM:
       *datatype = DTYPE_USHORT_5_6_5;
       *comps = 3;
-      return;
+      return TRUE;
    case PIPE_FORMAT_L8_UNORM:
    case PIPE_FORMAT_L8_SRGB:
    case PIPE_FORMAT_A8_UNORM:
    case PIPE_FORMAT_I8_UNORM:
       *datatype = DTYPE_UBYTE;
       *comps = 1;
-      return;
+      return TRUE;
    case PIPE_FORMAT_L8A8_UNORM:
    case PIPE_FORMAT_L8A8_SRGB:
       *datatype = DTYPE_UBYTE;
       *comps = 2;
-      return;
+      return TRUE;
    default:
-      assert(0);
       *datatype = DTYPE_UBYTE;
       *comps = 0;
-      break;
+      return FALSE;
    }
 }
 
@@ -965,7 +970,10 @@ reduce_1d(enum pipe_format pformat,
    enum dtype datatype;
    uint comps;
 
-   format_to_type_comps(pformat, &datatype, &comps);
+   if (!format_to_type_comps(pformat, &datatype, &comps)) {
+      assert(0);
+      return;
+   }
 
    /* we just duplicate the input row, kind of hack, saves code */
    do_row(datatype, comps,
@@ -991,7 +999,10 @@ reduce_2d(enum pipe_format pformat,
    ubyte *dst;
    int row;
 
-   format_to_type_comps(pformat, &datatype, &comps);
+   if (!format_to_type_comps(pformat, &datatype, &comps)) {
+      assert(0);
+      return;
+   }
 
    if (!srcRowStride)
       srcRowStride = bpt * srcWidth;
@@ -1031,7 +1042,10 @@ reduce_3d(enum pipe_format pformat,
    enum dtype datatype;
    uint comps;
 
-   format_to_type_comps(pformat, &datatype, &comps);
+   if (!format_to_type_comps(pformat, &datatype, &comps)) {
+      assert(0);
+      return;
+   }
 
    /* XXX I think we should rather assert those strides */
    if (!srcImageStride)
@@ -1214,11 +1228,427 @@ make_3d_mipmap(struct gen_mipmap_state *ctx,
 }
 
 
+/*
+ * Multithreaded CPU mipmap generation.
+ *
+ * Levels are generated in groups of MIPMAP_CPU_LEVELS. The rows of the
+ * last level of a group are split in bands, and each band is produced by
+ * reducing the rows it depends on through all the levels of the group in
+ * turn, so the intermediate rows are still in cache when they are read
+ * back. Bands don't share any destination rows, so they are handed out to
+ * worker threads without further synchronization.
+ */
+
+#define MIPMAP_CPU_LEVELS       4
+#define MIPMAP_CPU_BAND_SIZE    (256 * 1024)  /* source bytes per band */
+#define MIPMAP_CPU_MIN_PIXELS   (256 * 256)   /* smaller levels use one thread */
+#define MIPMAP_CPU_MAX_THREADS  8
+
+DEBUG_GET_ONCE_NUM_OPTION(mipmap_threads, "U_GEN_MIPMAP_THREADS", 0)
+
+
+enum mipmap_cpu_filter
+{
+   MIPMAP_CPU_BYTES,    /**< all channels are 8-bit unsigned */
+   MIPMAP_CPU_DTYPE,    /**< do_row() knows the format */
+   MIPMAP_CPU_FLOAT     /**< through the rgba_float pack/unpack functions */
+};
+
+
+struct mipmap_cpu_level
+{
+   struct pipe_transfer *transfer;
+   ubyte *map;
+   unsigned width, height;
+};
+
+
+struct mipmap_cpu_job
+{
+   const struct util_format_description *desc;
+   enum mipmap_cpu_filter filter;
+   enum dtype datatype;
+   uint comps;
+   unsigned bpp;
+
+   /** levels[0] is the source of the group */
+   struct mipmap_cpu_level levels[MIPMAP_CPU_LEVELS + 1];
+   unsigned nr_levels;
+
+   unsigned band_rows;  /**< rows of the last level per band */
+   unsigned nr_bands;
+
+   pipe_mutex mutex;
+   unsigned next_band;
+};
+
+
+struct mipmap_cpu_worker
+{
+   struct mipmap_cpu_job *job;
+   float *scratch;      /**< three rgba float rows, for MIPMAP_CPU_FLOAT */
+};
+
+
+/**
+ * Box filter a row of pixels whose channels are all 8-bit unsigned.
+ * Same results as the DTYPE_UBYTE cases of do_row().
+ */
+static void
+reduce_row_bytes(unsigned bpp, int srcWidth,
+                 const ubyte *rowA, const ubyte *rowB,
+                 int dstWidth, ubyte *dst)
+{
+   const unsigned next = (srcWidth == dstWidth) ? 0 : bpp;
+   const unsigned step = bpp + next;
+   unsigned i = 0, c;
+
+#if defined(PIPE_ARCH_SSE)
+   if (bpp == 4 && next) {
+      const __m128i zero = _mm_setzero_si128();
+
+      for (; i + 4 <= (unsigned) dstWidth; i += 4) {
+         const __m128i a0 = _mm_loadu_si128((const __m128i *)(rowA + i * 8));
+         const __m128i a1 = _mm_loadu_si128((const __m128i *)(rowA + i * 8 + 16));
+         const __m128i b0 = _mm_loadu_si128((const __m128i *)(rowB + i * 8));
+         const __m128i b1 = _mm_loadu_si128((const __m128i *)(rowB + i * 8 + 16));
+         /* vertical sums, two source pixels per register */
+         __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+         __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+         __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+         __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+         /* horizontal sums */
+         __m128i d0 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+         __m128i d1 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+
+         d0 = _mm_srli_epi16(d0, 2);
+         d1 = _mm_srli_epi16(d1, 2);
+         _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_packus_epi16(d0, d1));
+      }
+   }
+#endif
+
+   for (; i < (unsigned) dstWidth; i++) {
+      const ubyte *a = rowA + i * step;
+      const ubyte *b = rowB + i * step;
+
+      for (c = 0; c < bpp; c++)
+         dst[i * bpp + c] = (a[c] + a[next + c] + b[c] + b[next + c]) >> 2;
+   }
+}
+
+
+/**
+ * Box filter a row of pixels of any format with float pack/unpack
+ * functions.
+ */
+static void
+reduce_row_float(const struct util_format_description *desc, float *scratch,
+                 int srcWidth, const ubyte *rowA, const ubyte *rowB,
+                 int dstWidth, ubyte *dst)
+{
+   const unsigned next = (srcWidth == dstWidth) ? 0 : 4;
+   const unsigned step = 4 + next;
+   float *a = scratch;
+   float *b = a + srcWidth * 4;
+   float *d = b + srcWidth * 4;
+   unsigned i = 0, c;
+
+   desc->unpack_rgba_float(a, 0, rowA, 0, srcWidth, 1);
+   if (rowB != rowA)
+      desc->unpack_rgba_float(b, 0, rowB, 0, srcWidth, 1);
+   else
+      b = a;
+
+#if defined(PIPE_ARCH_SSE)
+   for (; i < (unsigned) dstWidth; i++) {
+      const float *pa = a + i * step;
+      const float *pb = b + i * step;
+      __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(pa), _mm_loadu_ps(pa + next)),
+                              _mm_add_ps(_mm_loadu_ps(pb), _mm_loadu_ps(pb + next)));
+      _mm_storeu_ps(d + i * 4, _mm_mul_ps(sum, _mm_set1_ps(0.25F)));
+   }
+#endif
+
+   for (; i < (unsigned) dstWidth; i++) {
+      const float *pa = a + i * step;
+      const float *pb = b + i * step;
+
+      for (c = 0; c < 4; c++)
+         d[i * 4 + c] = ((pa[c] + pa[next + c]) + (pb[c] + pb[next + c])) * 0.25F;
+   }
+
+   desc->pack_rgba_float(dst, 0, d, 0, dstWidth, 1);
+}
+
+
+/**
+ * Produce rows [row0, row1) of a level of the group from the level above.
+ */
+static void
+mipmap_cpu_reduce_rows(const struct mipmap_cpu_job *job, float *scratch,
+                       unsigned level, unsigned row0, unsigned row1)
+{
+   const struct mipmap_cpu_level *src = &job->levels[level - 1];
+   const struct mipmap_cpu_level *dst = &job->levels[level];
+   const unsigned src_stride = src->transfer->stride;
+   const unsigned dst_stride = dst->transfer->stride;
+   unsigned row;
+
+   for (row = row0; row < row1; row++) {
+      const ubyte *rowA, *rowB;
+      ubyte *rowDst = dst->map + row * dst_stride;
+
+      if (src->height > 1) {
+         rowA = src->map + 2 * row * src_stride;
+         rowB = rowA + src_stride;
+      }
+      else {
+         rowA = rowB = src->map;
+      }
+
+      switch (job->filter) {
+      case MIPMAP_CPU_BYTES:
+         reduce_row_bytes(job->bpp, src->width, rowA, rowB,
+                          dst->width, rowDst);
+         break;
+      case MIPMAP_CPU_DTYPE:
+         do_row(job->datatype, job->comps, src->width, rowA, rowB,
+                dst->width, rowDst);
+         break;
+      case MIPMAP_CPU_FLOAT:
+         reduce_row_float(job->desc, scratch, src->width, rowA, rowB,
+                          dst->width, rowDst);
+         break;
+      }
+   }
+}
+
+
+static void
+mipmap_cpu_band(const struct mipmap_cpu_job *job, float *scratch,
+                unsigned band)
+{
+   const unsigned last = job->nr_levels - 1;
+   unsigned row0[MIPMAP_CPU_LEVELS + 1], row1[MIPMAP_CPU_LEVELS + 1];
+   unsigned level;
+
+   row0[last] = band * job->band_rows;
+   row1[last] = MIN2(row0[last] + job->band_rows, job->levels[last].height);
+
+   /* rows each level of the band depends on */
+   for (level = last; level > 1; level--) {
+      if (job->levels[level - 1].height > 1) {
+         row0[level - 1] = 2 * row0[level];
+         row1[level - 1] = 2 * row1[level];
+         /* odd heights: the last band also does the row nothing reads */
+         if (row1[level] == job->levels[level].height)
+            row1[level - 1] = job->levels[level - 1].height;
+      }
+      else {
+         row0[level - 1] = 0;
+         row1[level - 1] = 1;
+      }
+   }
+
+   for (level = 1; level <= last; level++)
+      mipmap_cpu_reduce_rows(job, scratch, level, row0[level], row1[level]);
+}
+
+
+static void
+mipmap_cpu_run(struct mipmap_cpu_worker *worker)
+{
+   struct mipmap_cpu_job *job = worker->job;
+
+   for (;;) {
+      unsigned band;
+
+      pipe_mutex_lock(job->mutex);
+      band = job->next_band++;
+      pipe_mutex_unlock(job->mutex);
+
+      if (band >= job->nr_bands)
+         break;
+
+      mipmap_cpu_band(job, worker->scratch, band);
+   }
+}
+
+
+static PIPE_THREAD_ROUTINE(mipmap_cpu_thread, param)
+{
+   mipmap_cpu_run((struct mipmap_cpu_worker *) param);
+   return 0;
+}
+
+
+static unsigned
+mipmap_cpu_nr_threads(void)
+{
+   unsigned nr_threads = debug_get_option_mipmap_threads();
+
+   if (!nr_threads) {
+      util_cpu_detect();
+      nr_threads = util_cpu_caps.nr_cpus;
+   }
+
+   return CLAMP(nr_threads, 1, MIPMAP_CPU_MAX_THREADS);
+}
+
+
+/**
+ * Generate a group of levels, all mapped in job->levels.
+ */
+static boolean
+mipmap_cpu_group(struct mipmap_cpu_job *job)
+{
+   struct mipmap_cpu_worker workers[MIPMAP_CPU_MAX_THREADS];
+   pipe_thread threads[MIPMAP_CPU_MAX_THREADS];
+   const struct mipmap_cpu_level *src = &job->levels[0];
+   const struct mipmap_cpu_level *last = &job->levels[job->nr_levels - 1];
+   unsigned src_rows_per_row = 1 << (job->nr_levels - 1);
+   unsigned row_size = src->width * job->bpp * src_rows_per_row;
+   unsigned nr_threads = 1, i;
+
+   job->band_rows = MAX2(MIPMAP_CPU_BAND_SIZE / MAX2(row_size, 1), 1);
+   job->nr_bands = (last->height + job->band_rows - 1) / job->band_rows;
+   job->next_band = 0;
+
+   if (src->width * src->height >= MIPMAP_CPU_MIN_PIXELS)
+      nr_threads = MIN2(mipmap_cpu_nr_threads(), job->nr_bands);
+
+   for (i = 0; i < nr_threads; i++) {
+      workers[i].job = job;
+      workers[i].scratch = NULL;
+      if (job->filter == MIPMAP_CPU_FLOAT) {
+         /* two source rows and one destination row */
+         workers[i].scratch = MALLOC(src->width * 3 * 4 * sizeof(float));
+         if (!workers[i].scratch)
+            break;
+      }
+   }
+   if (i == 0)
+      return FALSE;
+   nr_threads = i;
+
+   for (i = 1; i < nr_threads; i++)
+      threads[i] = pipe_thread_create(mipmap_cpu_thread, &workers[i]);
+
+   /* the calling thread takes its share too */
+   mipmap_cpu_run(&workers[0]);
+
+   for (i = 1; i < nr_threads; i++) {
+      if (threads[i])
+         pipe_thread_wait(threads[i]);
+   }
+
+   for (i = 0; i < nr_threads; i++)
+      FREE(workers[i].scratch);
+
+   return TRUE;
+}
+
+
+/**
+ * Generate mipmap levels on the CPU, splitting the work among threads.
+ * 3D and 1D array textures aren't handled.
+ * \param layer  cube face or array layer
+ * \return FALSE if the format or target isn't supported, or on failure.
+ */
+boolean
+util_gen_mipmap_cpu(struct pipe_context *pipe,
+                    struct pipe_resource *pt,
+                    uint layer, uint baseLevel, uint lastLevel)
+{
+   struct mipmap_cpu_job job;
+   boolean success = TRUE;
+   uint level, chan;
+
+   switch (pt->target) {
+   case PIPE_TEXTURE_1D:
+   case PIPE_TEXTURE_2D:
+   case PIPE_TEXTURE_RECT:
+   case PIPE_TEXTURE_CUBE:
+   case PIPE_TEXTURE_2D_ARRAY:
+      break;
+   default:
+      return FALSE;
+   }
+
+   memset(&job, 0, sizeof job);
+   job.desc = util_format_description(pt->format);
+   if (!job.desc ||
+       job.desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       job.desc->block.width != 1 || job.desc->block.height != 1 ||
+       util_format_is_depth_or_stencil(pt->format))
+      return FALSE;
+
+   job.bpp = job.desc->block.bits / 8;
+
+   job.filter = MIPMAP_CPU_BYTES;
+   for (chan = 0; chan < 4; chan++) {
+      const struct util_format_channel_description *channel =
+         &job.desc->channel[chan];
+
+      if (channel->size &&
+          (channel->size != 8 ||
+           (channel->type != UTIL_FORMAT_TYPE_UNSIGNED &&
+            channel->type != UTIL_FORMAT_TYPE_VOID)))
+         job.filter = MIPMAP_CPU_FLOAT;
+   }
+
+   if (job.filter == MIPMAP_CPU_FLOAT) {
+      if (format_to_type_comps(pt->format, &job.datatype, &job.comps))
+         job.filter = MIPMAP_CPU_DTYPE;
+      else if (!job.desc->unpack_rgba_float || !job.desc->pack_rgba_float)
+         return FALSE;
+   }
+
+   pipe_mutex_init(job.mutex);
+
+   for (level = baseLevel; success && level < lastLevel;
+        level += job.nr_levels - 1) {
+      uint i;
+
+      job.nr_levels = MIN2(lastLevel - level, MIPMAP_CPU_LEVELS) + 1;
+
+      for (i = 0; i < job.nr_levels; i++) {
+         struct mipmap_cpu_level *l = &job.levels[i];
+
+         l->width = u_minify(pt->width0, level + i);
+         l->height = u_minify(pt->height0, level + i);
+         l->map = pipe_transfer_map(pipe, pt, level + i, layer,
+                                    i == 0 ? PIPE_TRANSFER_READ :
+                                    i == job.nr_levels - 1 ?
+                                    PIPE_TRANSFER_WRITE :
+                                    PIPE_TRANSFER_READ_WRITE,
+                                    0, 0, l->width, l->height,
+                                    &l->transfer);
+         if (!l->map)
+            break;
+      }
+
+      success = i == job.nr_levels && mipmap_cpu_group(&job);
+
+      while (i--)
+         pipe->transfer_unmap(pipe, job.levels[i].transfer);
+   }
+
+   pipe_mutex_destroy(job.mutex);
+
+   return success;
+}
+
+
 static void
 fallback_gen_mipmap(struct gen_mipmap_state *ctx,
                     struct pipe_resource *pt,
                     uint layer, uint baseLevel, uint lastLevel)
 {
+   if (util_gen_mipmap_cpu(ctx->pipe, pt, layer, baseLevel, lastLevel))
+      return;
+
    switch (pt->target) {
    case PIPE_TEXTURE_1D:
       make_1d_mipmap(ctx, pt, layer, baseLevel, lastLevel);
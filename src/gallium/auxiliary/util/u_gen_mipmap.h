@@ -57,6 +57,12 @@ util_gen_mipmap(struct gen_mipmap_state *ctx,
                 uint layer, uint baseLevel, uint lastLevel, uint filter);
 
 
+extern boolean
+util_gen_mipmap_cpu(struct pipe_context *pipe,
+                    struct pipe_resource *pt,
+                    uint layer, uint baseLevel, uint lastLevel);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -98,6 +98,27 @@ util_hash_table_create(unsigned (*hash)(void *key),
 }
 
 
+static unsigned
+pointer_hash(void *key)
+{
+   return (unsigned)(uintptr_t)key;
+}
+
+
+static int
+pointer_compare(void *key1, void *key2)
+{
+   return key1 != key2;
+}
+
+
+struct util_hash_table *
+util_hash_table_create_ptr_keys(void)
+{
+   return util_hash_table_create(pointer_hash, pointer_compare);
+}
+
+
 static INLINE struct cso_hash_iter
 util_hash_table_find_iter(struct util_hash_table *ht,
                           void *key,
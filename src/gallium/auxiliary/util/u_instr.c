@@ -0,0 +1,318 @@
+/**************************************************************************
+ *
+ * Copyright 2013 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Lightweight instrumentation.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_config.h"
+#include "os/os_thread.h"
+#include "os/os_time.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_instr.h"
+
+
+#define UTIL_INSTR_MAX_EVENTS 4096
+
+
+struct util_instr_event
+{
+   int64_t start;
+   int64_t duration;
+   unsigned counter;
+};
+
+
+/**
+ * Per-thread state, allocated the first time a thread hits a probe and
+ * kept until exit so that its values still count.
+ */
+struct util_instr_thread
+{
+   struct util_instr_thread *next;
+   unsigned index;
+
+   uint64_t calls[UTIL_INSTR_MAX_COUNTERS];
+   uint64_t value[UTIL_INSTR_MAX_COUNTERS];
+
+   /** Ring of the most recent timer events */
+   unsigned num_events;
+   struct util_instr_event events[UTIL_INSTR_MAX_EVENTS];
+};
+
+
+boolean util_instr_enabled = FALSE;
+
+static boolean util_instr_initialized = FALSE;
+static boolean util_instr_cpu_clock = FALSE;
+static const char *util_instr_filename = NULL;
+
+pipe_static_mutex(util_instr_mutex);
+
+static struct util_instr_counter *util_instr_counters[UTIL_INSTR_MAX_COUNTERS];
+static unsigned util_instr_num_counters = 0;
+
+static struct util_instr_thread *util_instr_threads = NULL;
+static unsigned util_instr_num_threads = 0;
+
+static pipe_tsd util_instr_tsd;
+
+
+static void
+util_instr_atexit(void)
+{
+   util_instr_dump(util_instr_filename);
+}
+
+
+/**
+ * Read the options. Called with the mutex held.
+ */
+static void
+util_instr_init(void)
+{
+   const char *clock;
+
+   util_instr_initialized = TRUE;
+
+#if defined(PIPE_OS_UNIX)
+   if (!debug_get_bool_option("GALLIUM_INSTR", FALSE))
+      return;
+
+   clock = debug_get_option("GALLIUM_INSTR_CLOCK", "wall");
+   util_instr_cpu_clock = strcmp(clock, "cpu") == 0;
+
+   /* The totals are printed at exit even without an event file. */
+   util_instr_filename = debug_get_option("GALLIUM_INSTR_FILE", NULL);
+   atexit(util_instr_atexit);
+
+   pipe_tsd_init(&util_instr_tsd);
+   util_instr_enabled = TRUE;
+#else
+   /* pipe_tsd is not implemented elsewhere. */
+   (void)clock;
+#endif
+}
+
+
+void
+util_instr_register(struct util_instr_counter *counter)
+{
+   pipe_mutex_lock(util_instr_mutex);
+
+   if (!util_instr_initialized)
+      util_instr_init();
+
+   if (counter->id < 0 && util_instr_num_counters < UTIL_INSTR_MAX_COUNTERS) {
+      counter->id = util_instr_num_counters;
+      util_instr_counters[util_instr_num_counters++] = counter;
+   }
+
+   pipe_mutex_unlock(util_instr_mutex);
+}
+
+
+int64_t
+util_instr_now(void)
+{
+   return util_instr_cpu_clock ? os_time_get_thread_cpu_nano()
+                               : os_time_get_nano();
+}
+
+
+static struct util_instr_thread *
+util_instr_get_thread(void)
+{
+   struct util_instr_thread *thread = pipe_tsd_get(&util_instr_tsd);
+
+   if (!thread) {
+      thread = CALLOC_STRUCT(util_instr_thread);
+      if (!thread)
+         return NULL;
+
+      pipe_mutex_lock(util_instr_mutex);
+      thread->index = util_instr_num_threads++;
+      thread->next = util_instr_threads;
+      util_instr_threads = thread;
+      pipe_mutex_unlock(util_instr_mutex);
+
+      pipe_tsd_set(&util_instr_tsd, thread);
+   }
+
+   return thread;
+}
+
+
+void
+util_instr_end_slow(struct util_instr_counter *counter, int64_t start)
+{
+   int64_t end = util_instr_now();
+   struct util_instr_thread *thread;
+   struct util_instr_event *event;
+
+   if (counter->id < 0)
+      return;
+
+   thread = util_instr_get_thread();
+   if (!thread)
+      return;
+
+   thread->calls[counter->id] += 1;
+   thread->value[counter->id] += end - start;
+
+   event = &thread->events[thread->num_events++ % UTIL_INSTR_MAX_EVENTS];
+   event->start = start;
+   event->duration = end - start;
+   event->counter = counter->id;
+}
+
+
+void
+util_instr_add_slow(struct util_instr_counter *counter, uint64_t value)
+{
+   struct util_instr_thread *thread;
+
+   if (counter->id < 0)
+      return;
+
+   thread = util_instr_get_thread();
+   if (!thread)
+      return;
+
+   thread->calls[counter->id] += 1;
+   thread->value[counter->id] += value;
+}
+
+
+void
+util_instr_foreach(util_instr_callback callback, void *data)
+{
+   unsigned i, num_counters;
+
+   pipe_mutex_lock(util_instr_mutex);
+   num_counters = util_instr_num_counters;
+   pipe_mutex_unlock(util_instr_mutex);
+
+   for (i = 0; i < num_counters; i++) {
+      struct util_instr_total total;
+      struct util_instr_thread *thread;
+
+      total.name = util_instr_counters[i]->name;
+      total.timer = util_instr_counters[i]->timer;
+      total.calls = 0;
+      total.value = 0;
+
+      /* Threads only ever get prepended, so the list can be walked
+       * while others are added. The sums are not atomic with respect to
+       * running probes, which is fine for statistics.
+       */
+      pipe_mutex_lock(util_instr_mutex);
+      thread = util_instr_threads;
+      pipe_mutex_unlock(util_instr_mutex);
+
+      for (; thread; thread = thread->next) {
+         total.calls += thread->calls[i];
+         total.value += thread->value[i];
+      }
+
+      callback(&total, data);
+   }
+}
+
+
+static void
+util_instr_print_total(const struct util_instr_total *total, void *data)
+{
+   (void)data;
+
+   if (!total->calls)
+      return;
+
+   if (total->timer)
+      debug_printf("%-32s %10llu calls %12.3f ms %10.3f us/call\n",
+                   total->name, (unsigned long long)total->calls,
+                   total->value / 1e6, total->value / 1e3 / total->calls);
+   else
+      debug_printf("%-32s %10llu calls %12llu\n",
+                   total->name, (unsigned long long)total->calls,
+                   (unsigned long long)total->value);
+}
+
+
+boolean
+util_instr_dump(const char *filename)
+{
+   struct util_instr_thread *thread;
+   const char *separator = "";
+   FILE *stream;
+
+   util_instr_foreach(util_instr_print_total, NULL);
+
+   if (!filename)
+      return TRUE;
+
+   stream = fopen(filename, "wt");
+   if (!stream)
+      return FALSE;
+
+   fprintf(stream, "{\"traceEvents\":[\n");
+
+   pipe_mutex_lock(util_instr_mutex);
+
+   for (thread = util_instr_threads; thread; thread = thread->next) {
+      unsigned num = MIN2(thread->num_events, UTIL_INSTR_MAX_EVENTS);
+      unsigned i;
+
+      /* Oldest first. */
+      for (i = thread->num_events - num; i != thread->num_events; i++) {
+         const struct util_instr_event *event =
+            &thread->events[i % UTIL_INSTR_MAX_EVENTS];
+
+         fprintf(stream,
+                 "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                 "\"ts\":%.3f,\"dur\":%.3f}",
+                 separator, util_instr_counters[event->counter]->name,
+                 thread->index, event->start / 1e3, event->duration / 1e3);
+         separator = ",\n";
+      }
+   }
+
+   pipe_mutex_unlock(util_instr_mutex);
+
+   fprintf(stream, "\n]}\n");
+   fclose(stream);
+   return TRUE;
+}
@@ -0,0 +1,154 @@
+/**************************************************************************
+ *
+ * Copyright 2013 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Lightweight instrumentation: named counters, scoped timers and a
+ * per-thread event log.
+ *
+ * Instrumentation is off unless GALLIUM_INSTR is set, in which case every
+ * probe costs a load and a branch. Counters are declared statically and
+ * registered once at init time:
+ *
+ *    static struct util_instr_counter draw_time =
+ *       UTIL_INSTR_TIMER_INIT("softpipe:draw");
+ *
+ *    util_instr_register(&draw_time);
+ *    ...
+ *    int64_t start = util_instr_begin();
+ *    ...
+ *    util_instr_end(&draw_time, start);
+ *
+ * Values are accumulated per thread, so probes never contend. Timers use
+ * the monotonic clock, or the thread CPU clock if GALLIUM_INSTR_CLOCK=cpu.
+ * If GALLIUM_INSTR_FILE is set, the recent timer events of every thread are
+ * written there at exit, in the Chrome trace event format
+ * (chrome://tracing), and the totals are printed with debug_printf.
+ */
+
+#ifndef U_INSTR_H
+#define U_INSTR_H
+
+
+#include "pipe/p_compiler.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define UTIL_INSTR_MAX_COUNTERS 64
+
+
+struct util_instr_counter
+{
+   const char *name;
+   boolean timer;   /**< value is in nanoseconds */
+   int id;          /**< -1 until registered */
+};
+
+#define UTIL_INSTR_COUNTER_INIT(_name) { _name, FALSE, -1 }
+#define UTIL_INSTR_TIMER_INIT(_name) { _name, TRUE, -1 }
+
+
+/**
+ * Totals of one counter over all threads.
+ */
+struct util_instr_total
+{
+   const char *name;
+   boolean timer;
+   uint64_t calls;
+   uint64_t value;
+};
+
+
+extern boolean util_instr_enabled;
+
+
+/**
+ * Register a counter. Must be called before the counter is used from more
+ * than one thread; registering twice is harmless.
+ */
+void
+util_instr_register(struct util_instr_counter *counter);
+
+int64_t
+util_instr_now(void);
+
+void
+util_instr_end_slow(struct util_instr_counter *counter, int64_t start);
+
+void
+util_instr_add_slow(struct util_instr_counter *counter, uint64_t value);
+
+
+/** Start a scoped timer; pass the result to util_instr_end(). */
+static INLINE int64_t
+util_instr_begin(void)
+{
+   return util_instr_enabled ? util_instr_now() : 0;
+}
+
+static INLINE void
+util_instr_end(struct util_instr_counter *counter, int64_t start)
+{
+   if (util_instr_enabled && start)
+      util_instr_end_slow(counter, start);
+}
+
+static INLINE void
+util_instr_add(struct util_instr_counter *counter, uint64_t value)
+{
+   if (util_instr_enabled)
+      util_instr_add_slow(counter, value);
+}
+
+
+typedef void (*util_instr_callback)(const struct util_instr_total *total,
+                                    void *data);
+
+/**
+ * Call back with the totals of every registered counter.
+ */
+void
+util_instr_foreach(util_instr_callback callback, void *data);
+
+/**
+ * Write the event logs of all threads to a file. Returns FALSE on error.
+ */
+boolean
+util_instr_dump(const char *filename);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_INSTR_H */
@@ -22,6 +22,7 @@
 
 #include "util/u_slab.h"
 
+#include "util/u_atomic.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_simple_list.h"
@@ -30,6 +31,12 @@
 
 #define UTIL_SLAB_MAGIC 0xcafe4321
 
+#if defined(PIPE_OS_LINUX) || defined(PIPE_OS_BSD) || defined(PIPE_OS_SOLARIS) || defined(PIPE_OS_APPLE) || defined(PIPE_OS_HAIKU) || defined(PIPE_OS_CYGWIN)
+#define UTIL_SLAB_HAVE_TSD 1
+#else
+#define UTIL_SLAB_HAVE_TSD 0
+#endif
+
 /* The block is either allocated memory or free space. */
 struct util_slab_block {
    /* The header. */
@@ -38,10 +45,45 @@ struct util_slab_block {
 
    intptr_t magic;
 
+   /* The thread cache the page belongs to, or NULL. */
+   struct util_slab_cache *owner;
+
    /* Memory after the last member is dedicated to the block itself.
     * The allocated size is always larger than this structure. */
 };
 
+/* The thread caches of the calling thread, indexed by pool slot.
+ * A slot is reused once its pool is destroyed, so each entry also
+ * remembers the serial number of the pool it was created for. */
+struct util_slab_thread_slot {
+   unsigned serial;
+   struct util_slab_cache *cache;
+};
+
+struct util_slab_thread {
+   struct util_slab_thread_slot *slots;
+   unsigned num_slots;
+   struct util_slab_thread *next;
+};
+
+/* All live pools, indexed by slot. */
+pipe_static_mutex(util_slab_pools_mutex);
+static struct util_slab_mempool **util_slab_pools;
+static unsigned util_slab_num_pools;
+static unsigned util_slab_num_live_pools;
+static unsigned util_slab_next_serial = 1;
+
+#if UTIL_SLAB_HAVE_TSD
+/* pipe_tsd has no destructors, which are needed to hand the caches of
+ * exiting threads over. The key only exists while there are pools, so
+ * the destructor can't outlive the code it points to. */
+static pthread_key_t util_slab_tsd;
+static boolean util_slab_tsd_created;
+
+/* Per-thread data of all threads, so it can be freed with the key. */
+static struct util_slab_thread *util_slab_threads;
+#endif
+
 static struct util_slab_block *
 util_slab_get_block(struct util_slab_mempool *pool,
                     struct util_slab_page *page, unsigned index)
@@ -51,43 +93,56 @@ util_slab_get_block(struct util_slab_mempool *pool,
            (pool->block_size * index));
 }
 
-static void util_slab_add_new_page(struct util_slab_mempool *pool)
+static struct util_slab_block *
+util_slab_add_new_page(struct util_slab_mempool *pool,
+                       struct util_slab_cache *owner,
+                       struct util_slab_block *first_free)
 {
    struct util_slab_page *page;
    struct util_slab_block *block;
    int i;
 
    page = MALLOC(pool->page_size);
-   insert_at_tail(&pool->list, page);
+   if (!page)
+      return first_free;
 
    /* Mark all blocks as free. */
    for (i = 0; i < pool->num_blocks-1; i++) {
       block = util_slab_get_block(pool, page, i);
       block->next_free = util_slab_get_block(pool, page, i+1);
       block->magic = UTIL_SLAB_MAGIC;
+      block->owner = owner;
    }
 
    block = util_slab_get_block(pool, page, pool->num_blocks-1);
-   block->next_free = pool->first_free;
+   block->next_free = first_free;
    block->magic = UTIL_SLAB_MAGIC;
-   pool->first_free = util_slab_get_block(pool, page, 0);
+   block->owner = owner;
+
+   insert_at_tail(&pool->list, page);
    pool->num_pages++;
 
 #if 0
    fprintf(stderr, "New page! Num of pages: %i\n", pool->num_pages);
 #endif
+
+   return util_slab_get_block(pool, page, 0);
 }
 
 static void *util_slab_alloc_st(struct util_slab_mempool *pool)
 {
    struct util_slab_block *block;
 
-   if (!pool->first_free)
-      util_slab_add_new_page(pool);
+   if (!pool->first_free) {
+      pool->first_free = util_slab_add_new_page(pool, NULL, NULL);
+      if (!pool->first_free)
+         return NULL;
+   }
 
    block = pool->first_free;
    assert(block->magic == UTIL_SLAB_MAGIC);
    pool->first_free = block->next_free;
+   pool->num_allocs++;
 
    return (uint8_t*)block + sizeof(struct util_slab_block);
 }
@@ -101,6 +156,7 @@ static void util_slab_free_st(struct util_slab_mempool *pool, void *ptr)
    assert(block->magic == UTIL_SLAB_MAGIC);
    block->next_free = pool->first_free;
    pool->first_free = block;
+   pool->num_frees++;
 }
 
 static void *util_slab_alloc_mt(struct util_slab_mempool *pool)
@@ -120,18 +176,307 @@ static void util_slab_free_mt(struct util_slab_mempool *pool, void *ptr)
    pipe_mutex_unlock(pool->mutex);
 }
 
+#if UTIL_SLAB_HAVE_TSD
+
+/**
+ * Return the calling thread's cache for the pool, or NULL if the thread
+ * hasn't allocated from it yet.
+ */
+static INLINE struct util_slab_cache *
+util_slab_find_cache(struct util_slab_mempool *pool)
+{
+   struct util_slab_thread *thread = pthread_getspecific(util_slab_tsd);
+
+   if (thread &&
+       pool->slot < thread->num_slots &&
+       thread->slots[pool->slot].serial == pool->serial)
+      return thread->slots[pool->slot].cache;
+
+   return NULL;
+}
+
+/**
+ * Thread exit handler. The caches of the thread are left to the next
+ * threads using their pools, together with their free blocks and the
+ * blocks still in use elsewhere.
+ */
+static void
+util_slab_thread_exit(void *data)
+{
+   struct util_slab_thread *thread, **link;
+   unsigned slot;
+
+   pipe_mutex_lock(util_slab_pools_mutex);
+
+   /* The data is gone already if the last pool was destroyed meanwhile. */
+   for (link = &util_slab_threads; *link != data; link = &(*link)->next) {
+      if (!*link) {
+         pipe_mutex_unlock(util_slab_pools_mutex);
+         return;
+      }
+   }
+   thread = *link;
+   *link = thread->next;
+
+   for (slot = 0; slot < thread->num_slots; slot++) {
+      struct util_slab_mempool *pool;
+
+      if (slot >= util_slab_num_pools)
+         break;
+
+      pool = util_slab_pools[slot];
+      if (pool && thread->slots[slot].cache &&
+          thread->slots[slot].serial == pool->serial) {
+         pipe_mutex_lock(pool->mutex);
+         thread->slots[slot].cache->orphaned = TRUE;
+         pipe_mutex_unlock(pool->mutex);
+      }
+   }
+   pipe_mutex_unlock(util_slab_pools_mutex);
+
+   FREE(thread->slots);
+   FREE(thread);
+}
+
+static struct util_slab_cache *
+util_slab_create_cache(struct util_slab_mempool *pool)
+{
+   struct util_slab_thread *thread = pthread_getspecific(util_slab_tsd);
+   struct util_slab_cache *cache;
+
+   if (!thread) {
+      thread = CALLOC_STRUCT(util_slab_thread);
+      if (!thread)
+         return NULL;
+      pthread_setspecific(util_slab_tsd, thread);
+
+      pipe_mutex_lock(util_slab_pools_mutex);
+      thread->next = util_slab_threads;
+      util_slab_threads = thread;
+      pipe_mutex_unlock(util_slab_pools_mutex);
+   }
+
+   if (pool->slot >= thread->num_slots) {
+      unsigned num_slots = MAX2(pool->slot + 1, thread->num_slots * 2);
+      struct util_slab_thread_slot *slots =
+         REALLOC(thread->slots,
+                 thread->num_slots * sizeof(*slots),
+                 num_slots * sizeof(*slots));
+      if (!slots)
+         return NULL;
+      memset(slots + thread->num_slots, 0,
+             (num_slots - thread->num_slots) * sizeof(*slots));
+      thread->slots = slots;
+      thread->num_slots = num_slots;
+   }
+
+   pipe_mutex_lock(pool->mutex);
+   for (cache = pool->caches; cache; cache = cache->next) {
+      if (cache->orphaned) {
+         cache->orphaned = FALSE;
+         break;
+      }
+   }
+   pipe_mutex_unlock(pool->mutex);
+
+   if (!cache) {
+      cache = CALLOC_STRUCT(util_slab_cache);
+      if (!cache)
+         return NULL;
+
+      pipe_mutex_lock(pool->mutex);
+      cache->next = pool->caches;
+      pool->caches = cache;
+      pipe_mutex_unlock(pool->mutex);
+   }
+
+   thread->slots[pool->slot].serial = pool->serial;
+   thread->slots[pool->slot].cache = cache;
+
+   return cache;
+}
+
+static void *util_slab_alloc_tc(struct util_slab_mempool *pool)
+{
+   struct util_slab_cache *cache = util_slab_find_cache(pool);
+   struct util_slab_block *block;
+
+   if (!cache) {
+      cache = util_slab_create_cache(pool);
+      if (!cache)
+         return NULL;
+   }
+
+   if (!cache->first_free) {
+      /* Take back everything other threads have freed.  Taking the whole
+       * list at once is what keeps the push side free of ABA issues. */
+      void *remote;
+
+      do {
+         remote = cache->remote_free;
+      } while (remote &&
+               p_atomic_cmpxchg_ptr(&cache->remote_free, remote, NULL) != remote);
+
+      cache->first_free = remote;
+
+      if (!cache->first_free) {
+         pipe_mutex_lock(pool->mutex);
+         cache->first_free = util_slab_add_new_page(pool, cache, NULL);
+         pipe_mutex_unlock(pool->mutex);
+
+         if (!cache->first_free)
+            return NULL;
+      }
+   }
+
+   block = cache->first_free;
+   assert(block->magic == UTIL_SLAB_MAGIC);
+   assert(block->owner == cache);
+   cache->first_free = block->next_free;
+   cache->num_allocs++;
+
+   return (uint8_t*)block + sizeof(struct util_slab_block);
+}
+
+static void util_slab_free_tc(struct util_slab_mempool *pool, void *ptr)
+{
+   struct util_slab_block *block =
+         (struct util_slab_block*)
+         ((uint8_t*)ptr - sizeof(struct util_slab_block));
+   struct util_slab_cache *owner = block->owner;
+
+   assert(block->magic == UTIL_SLAB_MAGIC);
+
+   if (owner == util_slab_find_cache(pool)) {
+      block->next_free = owner->first_free;
+      owner->first_free = block;
+      owner->num_frees++;
+   }
+   else {
+      void *head;
+
+      do {
+         head = owner->remote_free;
+         block->next_free = head;
+      } while (p_atomic_cmpxchg_ptr(&owner->remote_free, head, block) != head);
+
+      p_atomic_inc(&owner->num_remote_frees);
+   }
+}
+
+#endif /* UTIL_SLAB_HAVE_TSD */
+
 void util_slab_set_thread_safety(struct util_slab_mempool *pool,
                                     enum util_slab_threading threading)
 {
+   /* Thread caches own their pages, so the mode can't be changed once
+    * something has been allocated. */
+   assert(pool->num_pages == 0 || (pool->threading == UTIL_SLAB_THREAD_CACHED) ==
+                                  (threading == UTIL_SLAB_THREAD_CACHED));
+
+#if !UTIL_SLAB_HAVE_TSD
+   if (threading == UTIL_SLAB_THREAD_CACHED)
+      threading = UTIL_SLAB_MULTITHREADED;
+#endif
+
    pool->threading = threading;
 
-   if (threading) {
+   switch (threading) {
+#if UTIL_SLAB_HAVE_TSD
+   case UTIL_SLAB_THREAD_CACHED:
+      pool->alloc = util_slab_alloc_tc;
+      pool->free = util_slab_free_tc;
+      break;
+#endif
+   case UTIL_SLAB_MULTITHREADED:
       pool->alloc = util_slab_alloc_mt;
       pool->free = util_slab_free_mt;
-   } else {
+      break;
+   default:
       pool->alloc = util_slab_alloc_st;
       pool->free = util_slab_free_st;
+      break;
+   }
+}
+
+static void util_slab_register(struct util_slab_mempool *pool)
+{
+   unsigned slot;
+
+   pipe_mutex_lock(util_slab_pools_mutex);
+
+#if UTIL_SLAB_HAVE_TSD
+   if (!util_slab_tsd_created) {
+      if (pthread_key_create(&util_slab_tsd, util_slab_thread_exit) != 0) {
+         perror("pthread_key_create(): failed to allocate key for thread specific data");
+         exit(-1);
+      }
+      util_slab_tsd_created = TRUE;
+   }
+#endif
+
+   for (slot = 0; slot < util_slab_num_pools; slot++) {
+      if (!util_slab_pools[slot])
+         break;
+   }
+
+   if (slot == util_slab_num_pools) {
+      unsigned num_pools = MAX2(16, util_slab_num_pools * 2);
+      struct util_slab_mempool **pools =
+         REALLOC(util_slab_pools,
+                 util_slab_num_pools * sizeof(*pools),
+                 num_pools * sizeof(*pools));
+      if (pools) {
+         memset(pools + util_slab_num_pools, 0,
+                (num_pools - util_slab_num_pools) * sizeof(*pools));
+         util_slab_pools = pools;
+         util_slab_num_pools = num_pools;
+      }
+   }
+
+   pool->serial = util_slab_next_serial++;
+   util_slab_num_live_pools++;
+   if (slot < util_slab_num_pools) {
+      pool->slot = slot;
+      util_slab_pools[slot] = pool;
+   }
+   else {
+      /* Not reachable from the thread slots, so no thread caches. */
+      pool->slot = ~0;
+   }
+
+   pipe_mutex_unlock(util_slab_pools_mutex);
+}
+
+static void util_slab_unregister(struct util_slab_mempool *pool)
+{
+   pipe_mutex_lock(util_slab_pools_mutex);
+   if (pool->slot < util_slab_num_pools)
+      util_slab_pools[pool->slot] = NULL;
+
+   if (--util_slab_num_live_pools == 0) {
+      /* Nothing refers to the slots or the thread data any more, drop
+       * them together with the key. */
+#if UTIL_SLAB_HAVE_TSD
+      if (util_slab_tsd_created) {
+         while (util_slab_threads) {
+            struct util_slab_thread *thread = util_slab_threads;
+
+            util_slab_threads = thread->next;
+            FREE(thread->slots);
+            FREE(thread);
+         }
+
+         pthread_key_delete(util_slab_tsd);
+         util_slab_tsd_created = FALSE;
+      }
+#endif
+
+      FREE(util_slab_pools);
+      util_slab_pools = NULL;
+      util_slab_num_pools = 0;
    }
+   pipe_mutex_unlock(util_slab_pools_mutex);
 }
 
 void util_slab_create(struct util_slab_mempool *pool,
@@ -148,17 +493,29 @@ void util_slab_create(struct util_slab_mempool *pool,
    pool->page_size = sizeof(struct util_slab_page) +
                      num_blocks * pool->block_size;
    pool->first_free = NULL;
+   pool->num_allocs = 0;
+   pool->num_frees = 0;
+   pool->caches = NULL;
+   pool->name = NULL;
 
    make_empty_list(&pool->list);
 
    pipe_mutex_init(pool->mutex);
 
+   util_slab_register(pool);
+
+   if (pool->slot == ~0 && threading == UTIL_SLAB_THREAD_CACHED)
+      threading = UTIL_SLAB_MULTITHREADED;
+
    util_slab_set_thread_safety(pool, threading);
 }
 
 void util_slab_destroy(struct util_slab_mempool *pool)
 {
    struct util_slab_page *page, *temp;
+   struct util_slab_cache *cache, *next;
+
+   util_slab_unregister(pool);
 
    if (pool->list.next) {
       foreach_s(page, temp, &pool->list) {
@@ -167,5 +524,66 @@ void util_slab_destroy(struct util_slab_mempool *pool)
       }
    }
 
+   /* Stale thread slots are told apart by the pool serial number, so the
+    * caches can go away without visiting the threads. */
+   for (cache = pool->caches; cache; cache = next) {
+      next = cache->next;
+      FREE(cache);
+   }
+   pool->caches = NULL;
+
    pipe_mutex_destroy(pool->mutex);
 }
+
+void util_slab_set_name(struct util_slab_mempool *pool, const char *name)
+{
+   pool->name = name;
+}
+
+void util_slab_get_stats(struct util_slab_mempool *pool,
+                         struct util_slab_stats *stats)
+{
+   struct util_slab_cache *cache;
+
+   memset(stats, 0, sizeof *stats);
+
+   pipe_mutex_lock(pool->mutex);
+
+   stats->num_pages = pool->num_pages;
+   stats->num_allocs = pool->num_allocs;
+   stats->num_frees = pool->num_frees;
+
+   /* The per-thread counters are read without synchronization, which is
+    * good enough for statistics. */
+   for (cache = pool->caches; cache; cache = cache->next) {
+      unsigned num_remote_frees = p_atomic_read(&cache->num_remote_frees);
+
+      stats->num_caches++;
+      stats->num_allocs += cache->num_allocs;
+      stats->num_frees += cache->num_frees + num_remote_frees;
+      stats->num_remote_frees += num_remote_frees;
+   }
+
+   pipe_mutex_unlock(pool->mutex);
+}
+
+/**
+ * Call the callback with the statistics of every pool that has been
+ * given a name.
+ */
+void util_slab_foreach_stats(util_slab_stats_callback callback, void *data)
+{
+   unsigned slot;
+
+   pipe_mutex_lock(util_slab_pools_mutex);
+   for (slot = 0; slot < util_slab_num_pools; slot++) {
+      struct util_slab_mempool *pool = util_slab_pools[slot];
+      struct util_slab_stats stats;
+
+      if (pool && pool->name) {
+         util_slab_get_stats(pool, &stats);
+         callback(pool->name, &stats, data);
+      }
+   }
+   pipe_mutex_unlock(util_slab_pools_mutex);
+}
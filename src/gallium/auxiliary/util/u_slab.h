@@ -30,6 +30,13 @@
  *
  * Candidates: transfer_map
  *
+ * Pools created with UTIL_SLAB_THREAD_CACHED give every thread its own
+ * free list, so the common case takes no lock.  A block freed by a thread
+ * other than the one which allocated it is pushed onto the owner's remote
+ * free list with a compare-and-swap and picked up by the owner the next
+ * time its local list runs dry.  Only adding a new page takes the pool
+ * mutex.
+ *
  * @author Marek Olšák
  */
 
@@ -40,7 +47,8 @@
 
 enum util_slab_threading {
    UTIL_SLAB_SINGLETHREADED = FALSE,
-   UTIL_SLAB_MULTITHREADED = TRUE
+   UTIL_SLAB_MULTITHREADED = TRUE,
+   UTIL_SLAB_THREAD_CACHED
 };
 
 /* The page is an array of blocks (allocations). */
@@ -52,6 +60,32 @@ struct util_slab_page {
     * The allocated size is always larger than this structure. */
 };
 
+/* Per-thread state of a UTIL_SLAB_THREAD_CACHED pool. */
+struct util_slab_cache {
+   /* Only touched by the owning thread. */
+   struct util_slab_block *first_free;
+   unsigned num_allocs;
+   unsigned num_frees;
+
+   /* Blocks freed by other threads, pushed without a lock. */
+   void *remote_free;
+   int32_t num_remote_frees;
+
+   /* The owning thread has exited, and the next thread to use the pool
+    * takes the cache over. Protected by the pool mutex. */
+   boolean orphaned;
+
+   struct util_slab_cache *next;
+};
+
+struct util_slab_stats {
+   unsigned num_pages;
+   unsigned num_caches;
+   unsigned num_allocs;
+   unsigned num_frees;
+   unsigned num_remote_frees;
+};
+
 struct util_slab_mempool {
    /* Public members. */
    void *(*alloc)(struct util_slab_mempool *pool);
@@ -66,8 +100,17 @@ struct util_slab_mempool {
    unsigned page_size;
    unsigned num_blocks;
    unsigned num_pages;
+   unsigned num_allocs;
+   unsigned num_frees;
    enum util_slab_threading threading;
 
+   /* Thread caches, and the slot/serial pair used to find them. */
+   struct util_slab_cache *caches;
+   unsigned slot;
+   unsigned serial;
+
+   const char *name;
+
    pipe_mutex mutex;
 };
 
@@ -81,6 +124,17 @@ void util_slab_destroy(struct util_slab_mempool *pool);
 void util_slab_set_thread_safety(struct util_slab_mempool *pool,
                                  enum util_slab_threading threading);
 
+void util_slab_set_name(struct util_slab_mempool *pool, const char *name);
+
+void util_slab_get_stats(struct util_slab_mempool *pool,
+                         struct util_slab_stats *stats);
+
+typedef void (*util_slab_stats_callback)(const char *name,
+                                         const struct util_slab_stats *stats,
+                                         void *data);
+
+void util_slab_foreach_stats(util_slab_stats_callback callback, void *data);
+
 #define util_slab_alloc(pool)     (pool)->alloc(pool)
 #define util_slab_free(pool, ptr) (pool)->free(pool, ptr)
 
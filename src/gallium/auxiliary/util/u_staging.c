@@ -26,9 +26,25 @@
 
 #include "util/u_staging.h"
 #include "pipe/p_context.h"
+#include "pipe/p_screen.h"
 #include "util/u_memory.h"
 #include "util/u_inlines.h"
 
+
+struct util_staging_entry {
+   struct pipe_resource *resource;
+   struct pipe_fence_handle *fence;
+   unsigned last_used;
+};
+
+struct util_staging_pool {
+   struct pipe_context *pipe;
+   struct util_staging_entry *entries;
+   unsigned num_entries;
+   unsigned max_entries;
+   unsigned stamp;
+};
+
 static void
 util_staging_resource_template(struct pipe_resource *pt, unsigned width, unsigned height, unsigned depth, struct pipe_resource *template)
 {
@@ -130,3 +146,164 @@ util_staging_transfer_destroy(struct pipe_context *pipe, struct pipe_transfer *p
    pipe_resource_reference(&ptx->resource, NULL);
    FREE(ptx);
 }
+
+
+struct util_staging_pool *
+util_staging_pool_create(struct pipe_context *pipe, unsigned max_resources)
+{
+   struct util_staging_pool *pool = CALLOC_STRUCT(util_staging_pool);
+   if (!pool)
+      return NULL;
+
+   pool->entries = CALLOC(max_resources, sizeof(struct util_staging_entry));
+   if (!pool->entries) {
+      FREE(pool);
+      return NULL;
+   }
+
+   pool->pipe = pipe;
+   pool->max_entries = max_resources;
+   return pool;
+}
+
+static void
+util_staging_pool_release_entry(struct util_staging_pool *pool,
+                                struct util_staging_entry *entry)
+{
+   struct pipe_screen *screen = pool->pipe->screen;
+
+   if (entry->fence)
+      screen->fence_reference(screen, &entry->fence, NULL);
+   pipe_resource_reference(&entry->resource, NULL);
+}
+
+void
+util_staging_pool_destroy(struct util_staging_pool *pool)
+{
+   unsigned i;
+
+   for (i = 0; i < pool->num_entries; ++i)
+      util_staging_pool_release_entry(pool, &pool->entries[i]);
+
+   FREE(pool->entries);
+   FREE(pool);
+}
+
+static boolean
+util_staging_template_matches(const struct pipe_resource *res,
+                              const struct pipe_resource *templ)
+{
+   return res->target == templ->target &&
+          res->format == templ->format &&
+          res->width0 == templ->width0 &&
+          res->height0 == templ->height0 &&
+          res->depth0 == templ->depth0 &&
+          res->array_size == templ->array_size &&
+          res->last_level == templ->last_level &&
+          res->nr_samples == templ->nr_samples &&
+          res->usage == templ->usage &&
+          res->bind == templ->bind &&
+          res->flags == templ->flags;
+}
+
+void
+util_staging_pool_fence(struct util_staging_pool *pool,
+                        struct pipe_fence_handle *fence)
+{
+   struct pipe_screen *screen = pool->pipe->screen;
+   unsigned i;
+
+   for (i = 0; i < pool->num_entries; ++i) {
+      if (!pool->entries[i].fence)
+         screen->fence_reference(screen, &pool->entries[i].fence, fence);
+   }
+}
+
+struct pipe_resource *
+util_staging_pool_get(struct util_staging_pool *pool,
+                      const struct pipe_resource *templ)
+{
+   struct pipe_screen *screen = pool->pipe->screen;
+   struct pipe_resource *res = NULL;
+   boolean unfenced = FALSE;
+   unsigned i;
+
+   for (i = 0; i < pool->num_entries; ++i) {
+      struct util_staging_entry *entry = &pool->entries[i];
+
+      if (!util_staging_template_matches(entry->resource, templ))
+         continue;
+
+      /* Released without a fence, the commands using it may not even
+       * have been flushed yet.
+       */
+      if (!entry->fence) {
+         unfenced = TRUE;
+         continue;
+      }
+
+      if (!screen->fence_signalled(screen, entry->fence))
+         continue;
+      screen->fence_reference(screen, &entry->fence, NULL);
+
+      /* Hand over our reference and fill the hole with the last entry. */
+      res = entry->resource;
+      *entry = pool->entries[--pool->num_entries];
+      memset(&pool->entries[pool->num_entries], 0, sizeof *entry);
+      return res;
+   }
+
+   /* Nothing is ready. Flush once so that the unfenced matches become
+    * reusable later on, but don't wait for them.
+    */
+   if (unfenced) {
+      struct pipe_fence_handle *fence = NULL;
+
+      pool->pipe->flush(pool->pipe, &fence);
+      if (fence) {
+         util_staging_pool_fence(pool, fence);
+         screen->fence_reference(screen, &fence, NULL);
+      }
+   }
+
+   return screen->resource_create(screen, templ);
+}
+
+void
+util_staging_pool_put(struct util_staging_pool *pool,
+                      struct pipe_resource **res,
+                      struct pipe_fence_handle *fence)
+{
+   struct pipe_screen *screen = pool->pipe->screen;
+   struct util_staging_entry *entry;
+
+   if (!*res)
+      return;
+
+   if (!pool->max_entries) {
+      pipe_resource_reference(res, NULL);
+      return;
+   }
+
+   if (pool->num_entries == pool->max_entries) {
+      /* Evict the least recently released resource. */
+      unsigned i, oldest = 0;
+      for (i = 1; i < pool->num_entries; ++i) {
+         if (pool->stamp - pool->entries[i].last_used >
+             pool->stamp - pool->entries[oldest].last_used)
+            oldest = i;
+      }
+      entry = &pool->entries[oldest];
+      util_staging_pool_release_entry(pool, entry);
+   }
+   else {
+      entry = &pool->entries[pool->num_entries++];
+   }
+
+   /* Steal the caller's reference. */
+   entry->resource = *res;
+   *res = NULL;
+   if (fence)
+      screen->fence_reference(screen, &entry->fence, fence);
+   entry->last_used = pool->stamp++;
+}
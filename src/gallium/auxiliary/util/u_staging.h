@@ -39,6 +39,9 @@
 
 #include "pipe/p_state.h"
 
+struct pipe_fence_handle;
+struct util_staging_pool;
+
 struct util_staging_transfer {
    struct pipe_transfer base;
 
@@ -60,4 +63,41 @@ util_staging_transfer_init(struct pipe_context *pipe,
 void
 util_staging_transfer_destroy(struct pipe_context *pipe, struct pipe_transfer *ptx);
 
+
+/* Staging resource pool.
+ *
+ * Keeps released resources around so that repeated uploads of the same
+ * shape reuse them instead of creating a new resource each time. Resources
+ * are matched on their whole template (target, format, dimensions, bind and
+ * usage flags), since callers usually copy or sample the resource as a
+ * whole. A resource is only handed out again once the fence of its last
+ * use has signalled. Resources released without a fence get the fence of
+ * the next flush, either one passed to util_staging_pool_fence() or one
+ * the pool issues itself when it runs out of ready resources.
+ *
+ * A pool belongs to one context and is not thread safe.
+ */
+struct util_staging_pool *
+util_staging_pool_create(struct pipe_context *pipe, unsigned max_resources);
+
+void
+util_staging_pool_destroy(struct util_staging_pool *pool);
+
+/* returns a referenced resource matching templ, recycled if possible */
+struct pipe_resource *
+util_staging_pool_get(struct util_staging_pool *pool,
+                      const struct pipe_resource *templ);
+
+/* gives the resource back to the pool and clears *res; fence covers the
+ * last use of the resource, NULL if that use has not been flushed yet */
+void
+util_staging_pool_put(struct util_staging_pool *pool,
+                      struct pipe_resource **res,
+                      struct pipe_fence_handle *fence);
+
+/* attaches a fence to all resources released without one since */
+void
+util_staging_pool_fence(struct util_staging_pool *pool,
+                        struct pipe_fence_handle *fence);
+
 #endif
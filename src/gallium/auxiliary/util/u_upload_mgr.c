@@ -27,17 +27,42 @@
 
 /* Helper utility for uploading user buffers & other data, and
  * coalescing small buffers into larger ones.
+ *
+ * By default, a new upload buffer is created whenever the current one is
+ * full. In ring mode (u_upload_create_ring), a single buffer is reused
+ * instead: space is handed out circularly and the range written before
+ * each fence passed to u_upload_fence() is reclaimed once the fence
+ * signals. If the ring runs into space the GPU may still be reading from,
+ * it is grown up to its maximum size, and after that the manager waits
+ * for the fences it has. Space written since the last fence may be used
+ * by commands which haven't even been submitted yet, so it is never
+ * reused; if that is all there is, a new buffer is started instead.
+ * Since all writes go to space the GPU is done with, the buffer is always
+ * mapped unsynchronized.
  */
 
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
 #include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "util/u_debug.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 
 #include "u_upload_mgr.h"
 
 
+#define U_UPLOAD_MAX_FENCES 16
+
+DEBUG_GET_ONCE_BOOL_OPTION(upload_ring, "U_UPLOAD_RING", TRUE)
+
+/* End of the ring space written before a fence. */
+struct u_upload_fence {
+   struct pipe_fence_handle *fence;
+   unsigned end;
+   unsigned wraps;  /* Value of u_upload_mgr::head_wraps at the fence. */
+};
+
 struct u_upload_mgr {
    struct pipe_context *pipe;
 
@@ -51,6 +76,19 @@ struct u_upload_mgr {
    unsigned size;   /* Actual size of the upload buffer. */
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
+
+   /* Ring mode. "offset" is the head of the ring. The space in use by the
+    * GPU starts at "tail"; the head is ahead of the tail by a wrap around
+    * the end of the buffer if head_wraps != tail_wraps. */
+   boolean ring;
+   unsigned max_size;      /* Maximum size the ring may grow to. */
+   unsigned tail;
+   unsigned head_wraps, tail_wraps;
+   unsigned dirty_start, dirty_end; /* Range written since the mapping. */
+   struct u_upload_fence fences[U_UPLOAD_MAX_FENCES]; /* Oldest first. */
+   unsigned num_fences;
+
+   struct u_upload_stats stats;
 };
 
 
@@ -72,14 +110,41 @@ struct u_upload_mgr *u_upload_create( struct pipe_context *pipe,
    return upload;
 }
 
+struct u_upload_mgr *u_upload_create_ring( struct pipe_context *pipe,
+                                           unsigned size,
+                                           unsigned max_size,
+                                           unsigned alignment,
+                                           unsigned bind )
+{
+   struct u_upload_mgr *upload = u_upload_create(pipe, size, alignment, bind);
+   if (!upload)
+      return NULL;
+
+   if (debug_get_option_upload_ring()) {
+      upload->ring = TRUE;
+      upload->max_size = MAX2(size, max_size);
+   }
+   return upload;
+}
+
 void u_upload_unmap( struct u_upload_mgr *upload )
 {
    if (upload->transfer) {
-      struct pipe_box *box = &upload->transfer->box;
-      if ((int) upload->offset > box->x) {
+      if (upload->ring) {
+         if (upload->dirty_end > upload->dirty_start) {
+            pipe_buffer_flush_mapped_range(upload->pipe, upload->transfer,
+                                           upload->dirty_start,
+                                           upload->dirty_end -
+                                           upload->dirty_start);
+         }
+      }
+      else {
+         struct pipe_box *box = &upload->transfer->box;
+         if ((int) upload->offset > box->x) {
 
-         pipe_buffer_flush_mapped_range(upload->pipe, upload->transfer,
-                                        box->x, upload->offset - box->x);
+            pipe_buffer_flush_mapped_range(upload->pipe, upload->transfer,
+                                           box->x, upload->offset - box->x);
+         }
       }
       pipe_transfer_unmap(upload->pipe, upload->transfer);
       upload->transfer = NULL;
@@ -87,6 +152,18 @@ void u_upload_unmap( struct u_upload_mgr *upload )
    }
 }
 
+/* Forget all the fences of the ring, e.g. when its buffer is replaced. */
+static void
+u_upload_ring_release_fences( struct u_upload_mgr *upload )
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   unsigned i;
+
+   for (i = 0; i < upload->num_fences; i++)
+      screen->fence_reference(screen, &upload->fences[i].fence, NULL);
+   upload->num_fences = 0;
+}
+
 /* Release old buffer.
  * 
  * This must usually be called prior to firing the command stream
@@ -95,11 +172,16 @@ void u_upload_unmap( struct u_upload_mgr *upload )
  *
  * Can improve this with a change to pipe_buffer_write to use the
  * DONT_WAIT bit, but for now, it's easiest just to grab a new buffer.
+ *
+ * The ring is kept, it doesn't need to be released.
  */
 void u_upload_flush( struct u_upload_mgr *upload )
 {
    /* Unmap and unreference the upload buffer. */
    u_upload_unmap(upload);
+   if (upload->ring)
+      return;
+
    pipe_resource_reference( &upload->buffer, NULL );
    upload->size = 0;
 }
@@ -107,11 +189,52 @@ void u_upload_flush( struct u_upload_mgr *upload )
 
 void u_upload_destroy( struct u_upload_mgr *upload )
 {
-   u_upload_flush( upload );
+   u_upload_unmap( upload );
+   u_upload_ring_release_fences( upload );
+   pipe_resource_reference( &upload->buffer, NULL );
    FREE( upload );
 }
 
 
+void u_upload_fence( struct u_upload_mgr *upload,
+                     struct pipe_fence_handle *fence )
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   struct u_upload_fence *last;
+
+   if (!upload->ring || !upload->buffer)
+      return;
+
+   last = upload->num_fences ?
+          &upload->fences[upload->num_fences - 1] : NULL;
+
+   /* Nothing written since the last fence. */
+   if (last && last->end == upload->offset &&
+       last->wraps == upload->head_wraps)
+      return;
+   if (!last && upload->tail == upload->offset &&
+       upload->tail_wraps == upload->head_wraps)
+      return;
+
+   /* A fence signals after all the fences before it, so if there are too
+    * many, the newest one can just be extended. */
+   if (upload->num_fences < U_UPLOAD_MAX_FENCES)
+      last = &upload->fences[upload->num_fences++];
+
+   screen->fence_reference(screen, &last->fence, fence);
+   last->end = upload->offset;
+   last->wraps = upload->head_wraps;
+}
+
+
+void u_upload_get_stats( struct u_upload_mgr *upload,
+                         struct u_upload_stats *stats )
+{
+   *stats = upload->stats;
+   stats->size = upload->size;
+}
+
+
 static enum pipe_error 
 u_upload_alloc_buffer( struct u_upload_mgr *upload,
                        unsigned min_size )
@@ -120,7 +243,10 @@ u_upload_alloc_buffer( struct u_upload_mgr *upload,
 
    /* Release the old buffer, if present:
     */
-   u_upload_flush( upload );
+   u_upload_unmap( upload );
+   u_upload_ring_release_fences( upload );
+   pipe_resource_reference( &upload->buffer, NULL );
+   upload->size = 0;
 
    /* Allocate a new one: 
     */
@@ -133,6 +259,7 @@ u_upload_alloc_buffer( struct u_upload_mgr *upload,
    if (upload->buffer == NULL) {
       return PIPE_ERROR_OUT_OF_MEMORY;
    }
+   upload->stats.buffers_created++;
 
    /* Map the new buffer. */
    upload->map = pipe_buffer_map_range(upload->pipe, upload->buffer,
@@ -149,9 +276,149 @@ u_upload_alloc_buffer( struct u_upload_mgr *upload,
 
    upload->size = size;
    upload->offset = 0;
+   upload->tail = 0;
+   upload->head_wraps = upload->tail_wraps = 0;
+   upload->dirty_start = size;
+   upload->dirty_end = 0;
+   return PIPE_OK;
+}
+
+
+/* Move the tail of the ring past the space covered by signalled fences.
+ * If wait is set, wait for the oldest fence if none has signalled. */
+static void
+u_upload_ring_reclaim( struct u_upload_mgr *upload, boolean wait )
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   unsigned i, n = 0;
+
+   for (i = 0; i < upload->num_fences; i++) {
+      struct pipe_fence_handle *fence = upload->fences[i].fence;
+
+      /* A NULL fence means the flush completed synchronously. */
+      if (fence && !screen->fence_signalled(screen, fence)) {
+         if (!wait || n)
+            break;
+         upload->stats.stalls++;
+         screen->fence_finish(screen, fence, PIPE_TIMEOUT_INFINITE);
+      }
+      upload->tail = upload->fences[i].end;
+      upload->tail_wraps = upload->fences[i].wraps;
+      screen->fence_reference(screen, &upload->fences[i].fence, NULL);
+      n++;
+   }
+
+   if (n) {
+      upload->num_fences -= n;
+      memmove(upload->fences, upload->fences + n,
+              upload->num_fences * sizeof(upload->fences[0]));
+      memset(upload->fences + upload->num_fences, 0,
+             n * sizeof(upload->fences[0]));
+   }
+
+   /* Restart from the beginning of the buffer once the GPU caught up. */
+   if (upload->tail == upload->offset &&
+       upload->tail_wraps == upload->head_wraps) {
+      assert(!upload->num_fences);
+      upload->offset = upload->tail = 0;
+   }
+}
+
+
+/* Find space for a sub-allocation in the ring, without waiting.
+ * Return the offset or ~0 if there is no space. */
+static unsigned
+u_upload_ring_find_space( struct u_upload_mgr *upload,
+                          unsigned alloc_offset,
+                          unsigned alloc_size )
+{
+   unsigned offset = MAX2(upload->offset, alloc_offset);
+
+   if (upload->head_wraps == upload->tail_wraps) {
+      /* Free space is [head, size) and [0, tail). */
+      if (offset + alloc_size <= upload->size)
+         return offset;
+
+      if (alloc_offset + alloc_size <= upload->tail) {
+         upload->offset = 0;
+         upload->head_wraps++;
+         return alloc_offset;
+      }
+   }
+   else {
+      /* Free space is [head, tail). */
+      if (offset + alloc_size <= upload->tail)
+         return offset;
+   }
+   return ~0;
+}
+
+
+static enum pipe_error
+u_upload_ring_alloc( struct u_upload_mgr *upload,
+                     unsigned alloc_offset,
+                     unsigned alloc_size,
+                     unsigned *out_offset )
+{
+   unsigned offset;
+
+   if (upload->buffer) {
+      offset = u_upload_ring_find_space(upload, alloc_offset, alloc_size);
+      if (offset != ~0)
+         goto done;
+
+      u_upload_ring_reclaim(upload, FALSE);
+      offset = u_upload_ring_find_space(upload, alloc_offset, alloc_size);
+      if (offset != ~0)
+         goto done;
+   }
+
+   /* Grow the ring rather than wait for the GPU, up to the maximum size. */
+   if (!upload->buffer || upload->size < upload->max_size ||
+       alloc_offset + alloc_size > upload->size) {
+      unsigned size = MIN2(upload->size * 2, upload->max_size);
+      enum pipe_error ret;
+
+      ret = u_upload_alloc_buffer(upload,
+                                  MAX2(size, alloc_offset + alloc_size));
+      if (ret != PIPE_OK)
+         return ret;
+
+      offset = alloc_offset;
+      goto done;
+   }
+
+   /* Wait for the space covered by fences. */
+   while (upload->num_fences) {
+      u_upload_ring_reclaim(upload, TRUE);
+      offset = u_upload_ring_find_space(upload, alloc_offset, alloc_size);
+      if (offset != ~0)
+         goto done;
+   }
+
+   /* The rest may still be needed by commands the user hasn't flushed,
+    * so start over in a new buffer. The old one lives on as long as those
+    * commands reference it. */
+   {
+      enum pipe_error ret;
+
+      ret = u_upload_alloc_buffer(upload,
+                                  MAX2(upload->size,
+                                       alloc_offset + alloc_size));
+      if (ret != PIPE_OK)
+         return ret;
+
+      offset = alloc_offset;
+   }
+
+done:
+   upload->dirty_start = MIN2(upload->dirty_start, offset);
+   upload->dirty_end = MAX2(upload->dirty_end, offset + alloc_size);
+   *out_offset = offset;
    return PIPE_OK;
 }
 
+
 enum pipe_error u_upload_alloc( struct u_upload_mgr *upload,
                                 unsigned min_out_offset,
                                 unsigned size,
@@ -163,32 +430,58 @@ enum pipe_error u_upload_alloc( struct u_upload_mgr *upload,
    unsigned alloc_offset = align(min_out_offset, upload->alignment);
    unsigned offset;
 
-   /* Make sure we have enough space in the upload buffer
-    * for the sub-allocation. */
-   if (MAX2(upload->offset, alloc_offset) + alloc_size > upload->size) {
-      enum pipe_error ret = u_upload_alloc_buffer(upload,
-                                                  alloc_offset + alloc_size);
+   if (upload->ring) {
+      enum pipe_error ret = u_upload_ring_alloc(upload, alloc_offset,
+                                                alloc_size, &offset);
       if (ret != PIPE_OK)
          return ret;
+
+      /* The ring only hands out space the GPU is done with. */
+      if (!upload->map) {
+         upload->map = pipe_buffer_map_range(upload->pipe, upload->buffer,
+                                             0, upload->size,
+                                             PIPE_TRANSFER_WRITE |
+                                             PIPE_TRANSFER_FLUSH_EXPLICIT |
+                                             PIPE_TRANSFER_UNSYNCHRONIZED,
+                                             &upload->transfer);
+         if (!upload->map) {
+            pipe_resource_reference(outbuf, NULL);
+            *ptr = NULL;
+            upload->transfer = NULL;
+            return PIPE_ERROR_OUT_OF_MEMORY;
+         }
+         upload->dirty_start = offset;
+         upload->dirty_end = offset + alloc_size;
+      }
    }
+   else {
+      /* Make sure we have enough space in the upload buffer
+       * for the sub-allocation. */
+      if (MAX2(upload->offset, alloc_offset) + alloc_size > upload->size) {
+         enum pipe_error ret = u_upload_alloc_buffer(upload,
+                                                     alloc_offset + alloc_size);
+         if (ret != PIPE_OK)
+            return ret;
+      }
 
-   offset = MAX2(upload->offset, alloc_offset);
+      offset = MAX2(upload->offset, alloc_offset);
 
-   if (!upload->map) {
-      upload->map = pipe_buffer_map_range(upload->pipe, upload->buffer,
-					  offset, upload->size - offset,
-					  PIPE_TRANSFER_WRITE |
-					  PIPE_TRANSFER_FLUSH_EXPLICIT |
-					  PIPE_TRANSFER_UNSYNCHRONIZED,
-					  &upload->transfer);
       if (!upload->map) {
-         pipe_resource_reference(outbuf, NULL);
-         *ptr = NULL;
-         upload->transfer = NULL;
-         return PIPE_ERROR_OUT_OF_MEMORY;
+         upload->map = pipe_buffer_map_range(upload->pipe, upload->buffer,
+                                             offset, upload->size - offset,
+                                             PIPE_TRANSFER_WRITE |
+                                             PIPE_TRANSFER_FLUSH_EXPLICIT |
+                                             PIPE_TRANSFER_UNSYNCHRONIZED,
+                                             &upload->transfer);
+         if (!upload->map) {
+            pipe_resource_reference(outbuf, NULL);
+            *ptr = NULL;
+            upload->transfer = NULL;
+            return PIPE_ERROR_OUT_OF_MEMORY;
+         }
+
+         upload->map -= offset;
       }
-
-      upload->map -= offset;
    }
 
    assert(offset < upload->buffer->width0);
@@ -201,6 +494,7 @@ enum pipe_error u_upload_alloc( struct u_upload_mgr *upload,
    *out_offset = offset;
 
    upload->offset = offset + alloc_size;
+   upload->stats.bytes_uploaded += size;
    return PIPE_OK;
 }
 
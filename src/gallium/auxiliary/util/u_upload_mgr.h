@@ -35,9 +35,18 @@
 #include "pipe/p_compiler.h"
 
 struct pipe_context;
+struct pipe_fence_handle;
 struct pipe_resource;
 
 
+struct u_upload_stats {
+   uint64_t bytes_uploaded;   /* Bytes handed out by u_upload_alloc. */
+   unsigned buffers_created;  /* Upload buffers created, incl. ring growth. */
+   unsigned stalls;           /* Waits for the GPU to release ring space. */
+   unsigned size;             /* Size of the current upload buffer. */
+};
+
+
 /**
  * Create the upload manager.
  *
@@ -51,6 +60,30 @@ struct u_upload_mgr *u_upload_create( struct pipe_context *pipe,
                                       unsigned alignment,
                                       unsigned bind );
 
+/**
+ * Create an upload manager in ring mode.
+ *
+ * The upload buffer is reused circularly instead of being replaced when
+ * full. Space is reclaimed when the fences passed to u_upload_fence()
+ * signal; if it runs out, the ring grows up to max_size, and then the
+ * manager waits for those fences or starts a new buffer. It never flushes
+ * the context itself.
+ *
+ * Only use this if the fences are passed on, and if nothing uploaded
+ * before a fence is used by commands submitted after it, e.g. by state
+ * which stays bound across the flush.
+ *
+ * Ring mode can be disabled with U_UPLOAD_RING=0.
+ *
+ * \param size          Initial size of the ring, in bytes.
+ * \param max_size      Size the ring may grow to, in bytes.
+ */
+struct u_upload_mgr *u_upload_create_ring( struct pipe_context *pipe,
+                                           unsigned size,
+                                           unsigned max_size,
+                                           unsigned alignment,
+                                           unsigned bind );
+
 /**
  * Destroy the upload manager.
  */
@@ -66,6 +99,21 @@ void u_upload_destroy( struct u_upload_mgr *upload );
  */
 void u_upload_flush( struct u_upload_mgr *upload );
 
+/**
+ * Tell a ring upload manager that everything uploaded so far is used by
+ * commands which have been flushed with the given fence.
+ *
+ * Does nothing in the default mode.
+ */
+void u_upload_fence( struct u_upload_mgr *upload,
+                     struct pipe_fence_handle *fence );
+
+/**
+ * Get the upload counters.
+ */
+void u_upload_get_stats( struct u_upload_mgr *upload,
+                         struct u_upload_stats *stats );
+
 /**
  * Unmap upload buffer
  *
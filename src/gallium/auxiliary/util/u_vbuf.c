@@ -81,16 +81,42 @@
  * rate down.
  *
  *
+ * 3) Translated buffer cache (u_vbuf_cache_*)
+ *
+ * Translating vertices out of static buffers every draw is wasteful, so
+ * when all the buffers being translated are real buffers created with
+ * PIPE_USAGE_STATIC or PIPE_USAGE_IMMUTABLE and the indices are not being
+ * unrolled, the whole buffer is translated once into a buffer of its own,
+ * which is kept around for the following draws. The cache is limited
+ * in size and the least recently used entries are evicted first.
+ *
+ * The cache only works if every write to a buffer is known, so it is off
+ * unless the user of the module enables it with u_vbuf_enable_cache() and
+ * then calls u_vbuf_invalidate_buffer() whenever the contents of a buffer
+ * change and before a buffer is released. Each cached source buffer has
+ * a write stamp in a table shared by all contexts, so a write through one
+ * context invalidates the translations cached by the others. The source
+ * buffers are not referenced by the cache, they are identified by their
+ * address, and the stamp bump on release keeps a new buffer at the same
+ * address from matching. The same stamps guard the min/max indices
+ * remembered for static index buffers.
+ *
+ *
  * If there is nothing to do, it forwards every command to the driver.
  * The module also has its own CSO cache of vertex element states.
  */
 
 #include "util/u_vbuf.h"
 
+#include "os/os_thread.h"
 #include "util/u_dump.h"
 #include "util/u_format.h"
+#include "util/u_hash.h"
+#include "util/u_hash_table.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
+#include "util/u_minmax_index.h"
+#include "util/u_simple_list.h"
 #include "util/u_upload_mgr.h"
 #include "translate/translate.h"
 #include "translate/translate_cache.h"
@@ -140,6 +166,54 @@ enum {
    VB_NUM = 3
 };
 
+/* Identifies the vertex data a cached translation was made from. */
+struct u_vbuf_cache_key {
+   struct translate_key key;
+   uint32_t vb_mask;
+   struct {
+      /* Not referenced, only compared. The buffer's stamp is bumped when it
+       * is released, so a new buffer at the same address never matches. */
+      struct pipe_resource *buffer;
+      unsigned buffer_offset;
+      unsigned stride;
+   } src[PIPE_MAX_ATTRIBS];
+};
+
+struct u_vbuf_cache_entry {
+   struct u_vbuf_cache_entry *next, *prev;   /* LRU list, MRU first */
+
+   unsigned hash;
+   struct u_vbuf_cache_key key;
+   /* Write stamps of the source buffers at translation time. */
+   unsigned stamp[PIPE_MAX_ATTRIBS];
+
+   /* The translated vertices [0, count). */
+   struct pipe_resource *buffer;
+   unsigned count;
+};
+
+/* Write stamp of a buffer referenced by cache entries. */
+struct u_vbuf_buffer_stamp {
+   unsigned stamp;
+   unsigned refcount;
+};
+
+/* Cached min/max indices of a static index buffer. */
+struct u_vbuf_minmax_buffer {
+   struct pipe_resource *buffer; /* not referenced, like the cache keys */
+   struct util_minmax_cache cache;
+};
+
+#define U_VBUF_MINMAX_BUFFERS 16
+
+#define U_VBUF_CACHE_DEFAULT_SIZE (16 * 1024 * 1024)
+
+DEBUG_GET_ONCE_NUM_OPTION(vbuf_cache_size, "U_VBUF_CACHE_SIZE",
+                          U_VBUF_CACHE_DEFAULT_SIZE)
+
+pipe_static_mutex(stamps_mutex);
+static struct util_hash_table *stamps_hash = NULL;
+
 struct u_vbuf {
    struct u_vbuf_caps caps;
 
@@ -184,12 +258,26 @@ struct u_vbuf {
    uint32_t incompatible_vb_mask; /* each bit describes a corresp. buffer */
    /* Which buffer has a non-zero stride. */
    uint32_t nonzero_stride_vb_mask; /* each bit describes a corresp. buffer */
+
+   /* Translated buffer and min/max index caches, see u_vbuf_enable_cache. */
+   boolean cache_enabled;
+   struct cso_hash *cache_hash;
+   struct u_vbuf_cache_entry cache_lru;
+   unsigned cache_max_size;
+   struct u_vbuf_cache_stats cache_stats;
+
+   /* Min/max index cache, replaced round-robin. */
+   struct u_vbuf_minmax_buffer minmax_buffer[U_VBUF_MINMAX_BUFFERS];
+   unsigned minmax_next;
 };
 
 static void *
 u_vbuf_create_vertex_elements(struct u_vbuf *mgr, unsigned count,
                               const struct pipe_vertex_element *attribs);
 static void u_vbuf_delete_vertex_elements(struct u_vbuf *mgr, void *cso);
+static void u_vbuf_cache_destroy_entry(struct u_vbuf *mgr,
+                                       struct u_vbuf_cache_entry *entry);
+static void u_vbuf_minmax_release(struct u_vbuf_minmax_buffer *slot);
 
 
 void u_vbuf_get_caps(struct pipe_screen *screen, struct u_vbuf_caps *caps)
@@ -250,9 +338,18 @@ u_vbuf_create(struct pipe_context *pipe,
    mgr->uploader = u_upload_create(pipe, 1024 * 1024, 4,
                                    PIPE_BIND_VERTEX_BUFFER);
 
+   mgr->cache_hash = cso_hash_create();
+   make_empty_list(&mgr->cache_lru);
+
    return mgr;
 }
 
+void u_vbuf_enable_cache(struct u_vbuf *mgr)
+{
+   mgr->cache_enabled = TRUE;
+   mgr->cache_max_size = debug_get_option_vbuf_cache_size();
+}
+
 /* u_vbuf uses its own caching for vertex elements, because it needs to keep
  * its own preprocessed state per vertex element CSO. */
 static struct u_vbuf_elements *
@@ -317,12 +414,381 @@ void u_vbuf_destroy(struct u_vbuf *mgr)
    }
    pipe_resource_reference(&mgr->aux_vertex_buffer_saved.buffer, NULL);
 
+   while (!is_empty_list(&mgr->cache_lru)) {
+      u_vbuf_cache_destroy_entry(mgr, last_elem(&mgr->cache_lru));
+   }
+   cso_hash_delete(mgr->cache_hash);
+
+   for (i = 0; i < U_VBUF_MINMAX_BUFFERS; i++) {
+      u_vbuf_minmax_release(&mgr->minmax_buffer[i]);
+   }
+
    translate_cache_destroy(mgr->translate_cache);
    u_upload_destroy(mgr->uploader);
    cso_cache_delete(mgr->cso_cache);
    FREE(mgr);
 }
 
+/**
+ * Return the current write stamp of a buffer, and keep it in the table
+ * until the matching u_vbuf_unref_stamp_locked().
+ */
+static unsigned
+u_vbuf_ref_stamp_locked(struct pipe_resource *buffer)
+{
+   struct u_vbuf_buffer_stamp *stamp;
+
+   if (!stamps_hash)
+      stamps_hash = util_hash_table_create_ptr_keys();
+
+   stamp = util_hash_table_get(stamps_hash, buffer);
+   if (!stamp) {
+      stamp = CALLOC_STRUCT(u_vbuf_buffer_stamp);
+      util_hash_table_set(stamps_hash, buffer, stamp);
+   }
+   stamp->refcount++;
+   return stamp->stamp;
+}
+
+static void
+u_vbuf_unref_stamp_locked(struct pipe_resource *buffer)
+{
+   struct u_vbuf_buffer_stamp *stamp =
+      util_hash_table_get(stamps_hash, buffer);
+
+   assert(stamp && stamp->refcount);
+   if (!--stamp->refcount) {
+      util_hash_table_remove(stamps_hash, buffer);
+      FREE(stamp);
+   }
+}
+
+/** Current write stamp of a buffer referenced with u_vbuf_ref_stamp_locked. */
+static unsigned
+u_vbuf_get_stamp_locked(struct pipe_resource *buffer)
+{
+   struct u_vbuf_buffer_stamp *stamp =
+      util_hash_table_get(stamps_hash, buffer);
+
+   assert(stamp);
+   return stamp->stamp;
+}
+
+/**
+ * Record the current write stamps of the source buffers of an entry, and
+ * keep them in the table for as long as the entry lives.
+ */
+static void
+u_vbuf_cache_ref_stamps(struct u_vbuf_cache_entry *entry)
+{
+   uint32_t mask = entry->key.vb_mask;
+
+   pipe_mutex_lock(stamps_mutex);
+   while (mask) {
+      unsigned i = u_bit_scan(&mask);
+      entry->stamp[i] = u_vbuf_ref_stamp_locked(entry->key.src[i].buffer);
+   }
+   pipe_mutex_unlock(stamps_mutex);
+}
+
+static void
+u_vbuf_cache_unref_stamps(struct u_vbuf_cache_entry *entry)
+{
+   uint32_t mask = entry->key.vb_mask;
+
+   pipe_mutex_lock(stamps_mutex);
+   while (mask) {
+      unsigned i = u_bit_scan(&mask);
+      u_vbuf_unref_stamp_locked(entry->key.src[i].buffer);
+   }
+   pipe_mutex_unlock(stamps_mutex);
+}
+
+/**
+ * Whether none of the source buffers have been written since the entry
+ * was created.
+ */
+static boolean
+u_vbuf_cache_entry_is_valid(struct u_vbuf_cache_entry *entry)
+{
+   uint32_t mask = entry->key.vb_mask;
+   boolean valid = TRUE;
+
+   pipe_mutex_lock(stamps_mutex);
+   while (mask) {
+      unsigned i = u_bit_scan(&mask);
+
+      if (u_vbuf_get_stamp_locked(entry->key.src[i].buffer) !=
+          entry->stamp[i]) {
+         valid = FALSE;
+         break;
+      }
+   }
+   pipe_mutex_unlock(stamps_mutex);
+   return valid;
+}
+
+void u_vbuf_invalidate_buffer(struct pipe_resource *buffer)
+{
+   struct u_vbuf_buffer_stamp *stamp;
+
+   if (!buffer)
+      return;
+
+   pipe_mutex_lock(stamps_mutex);
+   if (stamps_hash) {
+      stamp = util_hash_table_get(stamps_hash, buffer);
+      if (stamp)
+         stamp->stamp++;
+   }
+   pipe_mutex_unlock(stamps_mutex);
+}
+
+static unsigned
+u_vbuf_cache_entry_size(struct u_vbuf_cache_entry *entry)
+{
+   return entry->buffer->width0;
+}
+
+static void
+u_vbuf_cache_destroy_entry(struct u_vbuf *mgr,
+                           struct u_vbuf_cache_entry *entry)
+{
+   struct cso_hash_iter iter = cso_hash_find(mgr->cache_hash, entry->hash);
+
+   while (cso_hash_iter_data(iter) != entry) {
+      assert(!cso_hash_iter_is_null(iter));
+      iter = cso_hash_iter_next(iter);
+   }
+   cso_hash_erase(mgr->cache_hash, iter);
+   remove_from_list(entry);
+
+   mgr->cache_stats.size -= u_vbuf_cache_entry_size(entry);
+   mgr->cache_stats.num_entries--;
+
+   u_vbuf_cache_unref_stamps(entry);
+   pipe_resource_reference(&entry->buffer, NULL);
+   FREE(entry);
+}
+
+/**
+ * Whether the translation of the buffers in vb_mask can be cached.
+ */
+static boolean
+u_vbuf_cache_is_cacheable(struct u_vbuf *mgr, uint32_t vb_mask)
+{
+   if (!mgr->cache_enabled || !mgr->cache_max_size ||
+       (vb_mask & mgr->user_vb_mask))
+      return FALSE;
+
+   while (vb_mask) {
+      unsigned i = u_bit_scan(&vb_mask);
+      struct pipe_vertex_buffer *vb = &mgr->vertex_buffer[i];
+
+      if (vb->user_buffer || !vb->buffer ||
+          (vb->buffer->usage != PIPE_USAGE_STATIC &&
+           vb->buffer->usage != PIPE_USAGE_IMMUTABLE)) {
+         return FALSE;
+      }
+   }
+   return TRUE;
+}
+
+static void
+u_vbuf_cache_make_key(struct u_vbuf *mgr, struct u_vbuf_cache_key *ckey,
+                      const struct translate_key *key, uint32_t vb_mask)
+{
+   memset(ckey, 0, sizeof(*ckey));
+   memcpy(&ckey->key, key, translate_keysize(key));
+   ckey->vb_mask = vb_mask;
+
+   while (vb_mask) {
+      unsigned i = u_bit_scan(&vb_mask);
+      struct pipe_vertex_buffer *vb = &mgr->vertex_buffer[i];
+
+      ckey->src[i].buffer = vb->buffer;
+      ckey->src[i].buffer_offset = vb->buffer_offset;
+      ckey->src[i].stride = vb->stride;
+   }
+}
+
+static struct u_vbuf_cache_entry *
+u_vbuf_cache_lookup(struct u_vbuf *mgr, const struct u_vbuf_cache_key *ckey,
+                    unsigned hash)
+{
+   struct cso_hash_iter iter = cso_hash_find(mgr->cache_hash, hash);
+
+   while (!cso_hash_iter_is_null(iter)) {
+      struct u_vbuf_cache_entry *entry = cso_hash_iter_data(iter);
+
+      if (cso_hash_iter_key(iter) != hash)
+         break;
+
+      if (!memcmp(&entry->key, ckey, sizeof(*ckey))) {
+         if (u_vbuf_cache_entry_is_valid(entry))
+            return entry;
+
+         mgr->cache_stats.invalidations++;
+         u_vbuf_cache_destroy_entry(mgr, entry);
+         return NULL;
+      }
+      iter = cso_hash_iter_next(iter);
+   }
+   return NULL;
+}
+
+/**
+ * Translate all the vertices of the source buffers into a new buffer and
+ * add it to the cache.
+ */
+static struct u_vbuf_cache_entry *
+u_vbuf_cache_translate(struct u_vbuf *mgr, const struct u_vbuf_cache_key *ckey,
+                       unsigned hash)
+{
+   const struct translate_key *key = &ckey->key;
+   struct pipe_transfer *vb_transfer[PIPE_MAX_ATTRIBS] = {0};
+   struct pipe_transfer *out_transfer;
+   struct u_vbuf_cache_entry *entry;
+   struct translate *tr;
+   unsigned count = ~0, size, i;
+   uint32_t mask;
+   uint8_t *out_map;
+
+   /* Determine how many vertices the source buffers hold. */
+   for (i = 0; i < key->nr_elements; i++) {
+      const struct translate_element *te = &key->element[i];
+      const struct pipe_vertex_buffer *vb =
+         &mgr->vertex_buffer[te->input_buffer];
+      unsigned end = vb->buffer_offset + te->input_offset +
+                     util_format_get_blocksize(te->input_format);
+
+      if (end > vb->buffer->width0)
+         return NULL;
+
+      if (vb->stride) {
+         count = MIN2(count, (vb->buffer->width0 - end) / vb->stride + 1);
+      } else {
+         count = MIN2(count, 1);
+      }
+   }
+
+   size = key->output_stride * count;
+   if (!size || size > mgr->cache_max_size / 4)
+      return NULL;
+
+   /* Make room. */
+   while (mgr->cache_stats.size + size > mgr->cache_max_size) {
+      assert(!is_empty_list(&mgr->cache_lru));
+      u_vbuf_cache_destroy_entry(mgr, last_elem(&mgr->cache_lru));
+      mgr->cache_stats.evictions++;
+   }
+
+   entry = CALLOC_STRUCT(u_vbuf_cache_entry);
+   if (!entry)
+      return NULL;
+
+   entry->buffer = pipe_buffer_create(mgr->pipe->screen,
+                                      PIPE_BIND_VERTEX_BUFFER,
+                                      PIPE_USAGE_IMMUTABLE, size);
+   if (!entry->buffer) {
+      FREE(entry);
+      return NULL;
+   }
+
+   memcpy(&entry->key, ckey, sizeof(*ckey));
+   entry->hash = hash;
+   entry->count = count;
+
+   /* Take the stamps before reading, so that concurrent writes are
+    * noticed on the next lookup. */
+   u_vbuf_cache_ref_stamps(entry);
+
+   tr = translate_cache_find(mgr->translate_cache, &entry->key.key);
+
+   mask = ckey->vb_mask;
+   while (mask) {
+      struct pipe_vertex_buffer *vb;
+      uint8_t *map;
+
+      i = u_bit_scan(&mask);
+      vb = &mgr->vertex_buffer[i];
+
+      map = pipe_buffer_map_range(mgr->pipe, vb->buffer, vb->buffer_offset,
+                                  vb->buffer->width0 - vb->buffer_offset,
+                                  PIPE_TRANSFER_READ, &vb_transfer[i]);
+      tr->set_buffer(tr, i, map, vb->stride, count - 1);
+   }
+
+   out_map = pipe_buffer_map(mgr->pipe, entry->buffer,
+                             PIPE_TRANSFER_WRITE |
+                             PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+                             &out_transfer);
+   tr->run(tr, 0, count, 0, out_map);
+   pipe_buffer_unmap(mgr->pipe, out_transfer);
+
+   mask = ckey->vb_mask;
+   while (mask) {
+      i = u_bit_scan(&mask);
+      if (vb_transfer[i]) {
+         pipe_buffer_unmap(mgr->pipe, vb_transfer[i]);
+      }
+   }
+
+   cso_hash_insert(mgr->cache_hash, hash, entry);
+   insert_at_head(&mgr->cache_lru, entry);
+   mgr->cache_stats.size += u_vbuf_cache_entry_size(entry);
+   mgr->cache_stats.max_size = MAX2(mgr->cache_stats.max_size,
+                                    mgr->cache_stats.size);
+   mgr->cache_stats.num_entries++;
+   return entry;
+}
+
+/**
+ * Try to get the translated vertices [start, start+num) from the cache,
+ * translating the buffers in vb_mask as a whole if they aren't there yet.
+ */
+static boolean
+u_vbuf_cache_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
+                               uint32_t vb_mask, unsigned out_vb,
+                               int start, unsigned num)
+{
+   struct u_vbuf_cache_key ckey;
+   struct u_vbuf_cache_entry *entry;
+   unsigned hash;
+
+   if (start < 0 || !u_vbuf_cache_is_cacheable(mgr, vb_mask))
+      return FALSE;
+
+   u_vbuf_cache_make_key(mgr, &ckey, key, vb_mask);
+   hash = util_hash_crc32(&ckey, sizeof(ckey));
+
+   entry = u_vbuf_cache_lookup(mgr, &ckey, hash);
+   if (entry) {
+      mgr->cache_stats.hits++;
+      move_to_head(&mgr->cache_lru, entry);
+   } else {
+      mgr->cache_stats.misses++;
+      entry = u_vbuf_cache_translate(mgr, &ckey, hash);
+      if (!entry)
+         return FALSE;
+   }
+
+   if (start + num > entry->count)
+      return FALSE;
+
+   mgr->real_vertex_buffer[out_vb].buffer_offset = 0;
+   mgr->real_vertex_buffer[out_vb].stride = key->output_stride;
+   pipe_resource_reference(&mgr->real_vertex_buffer[out_vb].buffer,
+                           entry->buffer);
+   return TRUE;
+}
+
+void u_vbuf_get_cache_stats(struct u_vbuf *mgr,
+                            struct u_vbuf_cache_stats *stats)
+{
+   *stats = mgr->cache_stats;
+}
+
 static void
 u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
                          unsigned vb_mask, unsigned out_vb,
@@ -336,6 +802,12 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
    uint8_t *out_map;
    unsigned out_offset, mask;
 
+   if (!unroll_indices &&
+       u_vbuf_cache_translate_buffers(mgr, key, vb_mask, out_vb,
+                                      start_vertex, num_vertices)) {
+      return;
+   }
+
    /* Get a translate object. */
    tr = translate_cache_find(mgr->translate_cache, key);
 
@@ -993,103 +1465,109 @@ static boolean u_vbuf_mapping_vertex_buffer_blocks(struct u_vbuf *mgr)
             mgr->nonzero_stride_vb_mask)) != 0;
 }
 
-static void u_vbuf_get_minmax_index(struct pipe_context *pipe,
+static void u_vbuf_minmax_release(struct u_vbuf_minmax_buffer *slot)
+{
+   if (!slot->buffer)
+      return;
+
+   pipe_mutex_lock(stamps_mutex);
+   u_vbuf_unref_stamp_locked(slot->buffer);
+   pipe_mutex_unlock(stamps_mutex);
+   slot->buffer = NULL;
+}
+
+/**
+ * Return the min/max cache of an index buffer along with the buffer's
+ * current write stamp, adding the buffer to the cache if needed.
+ */
+static struct util_minmax_cache *
+u_vbuf_minmax_cache(struct u_vbuf *mgr, struct pipe_resource *buffer,
+                    unsigned *stamp)
+{
+   struct u_vbuf_minmax_buffer *slot = NULL;
+   unsigned i;
+
+   for (i = 0; i < U_VBUF_MINMAX_BUFFERS; i++) {
+      if (mgr->minmax_buffer[i].buffer == buffer) {
+         slot = &mgr->minmax_buffer[i];
+         break;
+      }
+   }
+
+   if (slot) {
+      pipe_mutex_lock(stamps_mutex);
+      *stamp = u_vbuf_get_stamp_locked(buffer);
+      pipe_mutex_unlock(stamps_mutex);
+      return &slot->cache;
+   }
+
+   slot = &mgr->minmax_buffer[mgr->minmax_next];
+   mgr->minmax_next = (mgr->minmax_next + 1) % U_VBUF_MINMAX_BUFFERS;
+   u_vbuf_minmax_release(slot);
+
+   slot->buffer = buffer;
+   pipe_mutex_lock(stamps_mutex);
+   *stamp = u_vbuf_ref_stamp_locked(buffer);
+   pipe_mutex_unlock(stamps_mutex);
+   util_minmax_cache_init(&slot->cache, *stamp);
+   return &slot->cache;
+}
+
+static void u_vbuf_get_minmax_index(struct u_vbuf *mgr,
                                     struct pipe_index_buffer *ib,
                                     const struct pipe_draw_info *info,
                                     int *out_min_index,
                                     int *out_max_index)
 {
    struct pipe_transfer *transfer = NULL;
+   struct util_minmax_cache *cache = NULL;
    const void *indices;
-   unsigned i;
-   unsigned restart_index = info->restart_index;
+   unsigned offset = ib->offset + info->start * ib->index_size;
+   unsigned stamp = 0, min_index, max_index;
+
+   /* Static index buffers are usually drawn from with the same ranges
+    * every frame, so remember the results. */
+   if (mgr->cache_enabled && !ib->user_buffer &&
+       (ib->buffer->usage == PIPE_USAGE_STATIC ||
+        ib->buffer->usage == PIPE_USAGE_IMMUTABLE)) {
+      cache = u_vbuf_minmax_cache(mgr, ib->buffer, &stamp);
+
+      if (util_minmax_cache_lookup(cache, stamp, offset, info->count,
+                                   ib->index_size, info->primitive_restart,
+                                   info->restart_index,
+                                   &min_index, &max_index)) {
+         *out_min_index = min_index;
+         *out_max_index = max_index;
+         return;
+      }
+   }
 
    if (ib->user_buffer) {
-      indices = (uint8_t*)ib->user_buffer +
-                ib->offset + info->start * ib->index_size;
+      indices = (uint8_t*)ib->user_buffer + offset;
    } else {
-      indices = pipe_buffer_map_range(pipe, ib->buffer,
-                                      ib->offset + info->start * ib->index_size,
+      indices = pipe_buffer_map_range(mgr->pipe, ib->buffer, offset,
                                       info->count * ib->index_size,
                                       PIPE_TRANSFER_READ, &transfer);
    }
 
-   switch (ib->index_size) {
-   case 4: {
-      const unsigned *ui_indices = (const unsigned*)indices;
-      unsigned max_ui = 0;
-      unsigned min_ui = ~0U;
-      if (info->primitive_restart) {
-         for (i = 0; i < info->count; i++) {
-            if (ui_indices[i] != restart_index) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < info->count; i++) {
-            if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-            if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-         }
-      }
-      *out_min_index = min_ui;
-      *out_max_index = max_ui;
-      break;
-   }
-   case 2: {
-      const unsigned short *us_indices = (const unsigned short*)indices;
-      unsigned max_us = 0;
-      unsigned min_us = ~0U;
-      if (info->primitive_restart) {
-         for (i = 0; i < info->count; i++) {
-            if (us_indices[i] != restart_index) {
-               if (us_indices[i] > max_us) max_us = us_indices[i];
-               if (us_indices[i] < min_us) min_us = us_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < info->count; i++) {
-            if (us_indices[i] > max_us) max_us = us_indices[i];
-            if (us_indices[i] < min_us) min_us = us_indices[i];
-         }
-      }
-      *out_min_index = min_us;
-      *out_max_index = max_us;
-      break;
-   }
-   case 1: {
-      const unsigned char *ub_indices = (const unsigned char*)indices;
-      unsigned max_ub = 0;
-      unsigned min_ub = ~0U;
-      if (info->primitive_restart) {
-         for (i = 0; i < info->count; i++) {
-            if (ub_indices[i] != restart_index) {
-               if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-               if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < info->count; i++) {
-            if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-            if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-         }
-      }
-      *out_min_index = min_ub;
-      *out_max_index = max_ub;
-      break;
-   }
-   default:
-      assert(0);
-      *out_min_index = 0;
-      *out_max_index = 0;
-   }
+   assert(ib->index_size == 1 || ib->index_size == 2 ||
+          ib->index_size == 4);
+   util_get_minmax_index(indices, ib->index_size, info->count,
+                         info->primitive_restart, info->restart_index,
+                         &min_index, &max_index);
 
    if (transfer) {
-      pipe_buffer_unmap(pipe, transfer);
+      pipe_buffer_unmap(mgr->pipe, transfer);
    }
+
+   if (cache) {
+      util_minmax_cache_add(cache, stamp, offset, info->count,
+                            ib->index_size, info->primitive_restart,
+                            info->restart_index, min_index, max_index);
+   }
+
+   *out_min_index = min_index;
+   *out_max_index = max_index;
 }
 
 static void u_vbuf_set_driver_vertex_buffers(struct u_vbuf *mgr)
@@ -1138,7 +1616,7 @@ void u_vbuf_draw_vbo(struct u_vbuf *mgr, const struct pipe_draw_info *info)
             min_index = info->min_index;
             max_index = info->max_index;
          } else {
-            u_vbuf_get_minmax_index(mgr->pipe, &mgr->index_buffer, info,
+            u_vbuf_get_minmax_index(mgr, &mgr->index_buffer, info,
                                     &min_index, &max_index);
          }
 
@@ -59,6 +59,17 @@ struct u_vbuf_caps {
    unsigned user_vertex_buffers:1;
 };
 
+/* Statistics of the translated vertex buffer cache. */
+struct u_vbuf_cache_stats {
+   uint64_t hits;
+   uint64_t misses;
+   uint64_t evictions;
+   uint64_t invalidations;  /* entries dropped because the source changed */
+   unsigned num_entries;
+   unsigned size;           /* bytes currently held by the cache */
+   unsigned max_size;       /* high water mark of size */
+};
+
 
 void u_vbuf_get_caps(struct pipe_screen *screen, struct u_vbuf_caps *caps);
 
@@ -84,4 +95,14 @@ void u_vbuf_restore_vertex_elements(struct u_vbuf *mgr);
 void u_vbuf_save_aux_vertex_buffer_slot(struct u_vbuf *mgr);
 void u_vbuf_restore_aux_vertex_buffer_slot(struct u_vbuf *mgr);
 
+/* Translated buffer cache.
+ *
+ * It is off by default. Whoever enables it must call
+ * u_vbuf_invalidate_buffer() on every write to a buffer, in any context,
+ * and before the buffer is released. */
+void u_vbuf_enable_cache(struct u_vbuf *mgr);
+void u_vbuf_get_cache_stats(struct u_vbuf *mgr,
+                            struct u_vbuf_cache_stats *stats);
+void u_vbuf_invalidate_buffer(struct pipe_resource *buffer);
+
 #endif
@@ -36,6 +36,7 @@
 #include "util/u_prim.h"
 
 #include "lp_context.h"
+#include "lp_perf.h"
 #include "lp_state.h"
 #include "lp_query.h"
 
@@ -56,10 +57,13 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    struct draw_context *draw = lp->draw;
    const void *mapped_indices = NULL;
    unsigned i;
+   int64_t start;
 
    if (!llvmpipe_check_render_cond(lp))
       return;
 
+   start = util_instr_begin();
+
    if (lp->dirty)
       llvmpipe_update_derived( lp );
 
@@ -121,6 +125,8 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
     * internally when this condition is seen?)
     */
    draw_flush(draw);
+
+   util_instr_end(&lp_instr_draw, start);
 }
 
 
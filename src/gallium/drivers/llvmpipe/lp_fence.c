@@ -30,6 +30,7 @@
 #include "util/u_memory.h"
 #include "lp_debug.h"
 #include "lp_fence.h"
+#include "lp_screen.h"
 
 
 /**
@@ -39,17 +40,22 @@
  * thread hits a fence command, it'll increment the fence counter.  When
  * the counter == the rank, the fence is finished.
  *
+ * \param screen  the screen whose fence pool to allocate from.
  * \param rank  the expected finished value of the fence counter.
  */
 struct lp_fence *
-lp_fence_create(unsigned rank)
+lp_fence_create(struct pipe_screen *screen, unsigned rank)
 {
    static int fence_id;
-   struct lp_fence *fence = CALLOC_STRUCT(lp_fence);
+   struct util_slab_mempool *pool = &llvmpipe_screen(screen)->fence_pool;
+   struct lp_fence *fence = util_slab_alloc(pool);
 
    if (!fence)
       return NULL;
 
+   memset(fence, 0, sizeof *fence);
+   fence->pool = pool;
+
    pipe_reference_init(&fence->reference, 1);
 
    pipe_mutex_init(fence->mutex);
@@ -74,7 +80,7 @@ lp_fence_destroy(struct lp_fence *fence)
 
    pipe_mutex_destroy(fence->mutex);
    pipe_condvar_destroy(fence->signalled);
-   FREE(fence);
+   util_slab_free(fence->pool, fence);
 }
 
 
@@ -36,6 +36,7 @@
 
 
 struct pipe_screen;
+struct util_slab_mempool;
 
 
 struct lp_fence
@@ -49,11 +50,13 @@ struct lp_fence
    boolean issued;
    unsigned rank;
    unsigned count;
+
+   struct util_slab_mempool *pool;  /**< where the fence was allocated */
 };
 
 
 struct lp_fence *
-lp_fence_create(unsigned rank);
+lp_fence_create(struct pipe_screen *screen, unsigned rank);
 
 
 void
@@ -33,6 +33,22 @@
 
 struct lp_counters lp_count;
 
+struct util_instr_counter lp_instr_draw =
+   UTIL_INSTR_TIMER_INIT("llvmpipe:draw_vbo");
+struct util_instr_counter lp_instr_flush =
+   UTIL_INSTR_TIMER_INIT("llvmpipe:setup_flush");
+struct util_instr_counter lp_instr_rasterize_scene =
+   UTIL_INSTR_TIMER_INIT("llvmpipe:rasterize_scene");
+
+
+void
+lp_register_instr(void)
+{
+   util_instr_register(&lp_instr_draw);
+   util_instr_register(&lp_instr_flush);
+   util_instr_register(&lp_instr_rasterize_scene);
+}
+
 
 void
 lp_reset_counters(void)
@@ -34,6 +34,7 @@
 #define LP_PERF_H
 
 #include "pipe/p_compiler.h"
+#include "util/u_instr.h"
 
 /**
  * Various counters
@@ -80,6 +81,16 @@ extern struct lp_counters lp_count;
 #endif
 
 
+/** Timers reported through util_instr, see lp_register_instr() */
+extern struct util_instr_counter lp_instr_draw;
+extern struct util_instr_counter lp_instr_flush;
+extern struct util_instr_counter lp_instr_rasterize_scene;
+
+
+extern void
+lp_register_instr(void);
+
+
 extern void
 lp_reset_counters(void);
 
@@ -610,6 +610,8 @@ static void
 rasterize_scene(struct lp_rasterizer_task *task,
                 struct lp_scene *scene)
 {
+   int64_t start = util_instr_begin();
+
    task->scene = scene;
 
    if (!task->rast->no_rast && !scene->discard) {
@@ -643,6 +645,8 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 
    task->scene = NULL;
+
+   util_instr_end(&lp_instr_rasterize_scene, start);
 }
 
 
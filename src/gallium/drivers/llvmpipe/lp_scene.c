@@ -34,6 +34,7 @@
 #include "lp_scene.h"
 #include "lp_fence.h"
 #include "lp_debug.h"
+#include "lp_screen.h"
 
 
 #define RESOURCE_REF_SZ 32
@@ -242,12 +243,13 @@ lp_scene_end_rasterization(struct lp_scene *scene )
    /* Free all scene data blocks:
     */
    {
+      struct llvmpipe_screen *screen = llvmpipe_screen(scene->pipe->screen);
       struct data_block_list *list = &scene->data;
       struct data_block *block, *tmp;
 
       for (block = list->head->next; block; block = tmp) {
          tmp = block->next;
-	 FREE(block);
+         util_slab_free(&screen->data_block_pool, block);
       }
 
       list->head->next = NULL;
@@ -302,7 +304,8 @@ lp_scene_new_data_block( struct lp_scene *scene )
       return NULL;
    }
    else {
-      struct data_block *block = MALLOC_STRUCT(data_block);
+      struct llvmpipe_screen *screen = llvmpipe_screen(scene->pipe->screen);
+      struct data_block *block = util_slab_alloc(&screen->data_block_pool);
       if (block == NULL)
          return NULL;
       
@@ -44,9 +44,11 @@
 #include "lp_screen.h"
 #include "lp_context.h"
 #include "lp_debug.h"
+#include "lp_perf.h"
 #include "lp_public.h"
 #include "lp_limits.h"
 #include "lp_rast.h"
+#include "lp_scene.h"
 
 #include "state_tracker/sw_winsys.h"
 
@@ -403,6 +405,10 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
 
    pipe_mutex_destroy(screen->rast_mutex);
 
+   util_slab_destroy(&screen->fence_pool);
+   util_slab_destroy(&screen->transfer_pool);
+   util_slab_destroy(&screen->data_block_pool);
+
    FREE(screen);
 }
 
@@ -478,6 +484,8 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
 
    LP_PERF = debug_get_flags_option("LP_PERF", lp_perf_flags, 0 );
 
+   lp_register_instr();
+
    screen = CALLOC_STRUCT(llvmpipe_screen);
    if (!screen)
       return NULL;
@@ -520,6 +528,16 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    }
    pipe_mutex_init(screen->rast_mutex);
 
+   util_slab_create(&screen->fence_pool, sizeof(struct lp_fence),
+                    64, UTIL_SLAB_THREAD_CACHED);
+   util_slab_set_name(&screen->fence_pool, "llvmpipe fences");
+   util_slab_create(&screen->transfer_pool, sizeof(struct llvmpipe_transfer),
+                    64, UTIL_SLAB_THREAD_CACHED);
+   util_slab_set_name(&screen->transfer_pool, "llvmpipe transfers");
+   util_slab_create(&screen->data_block_pool, sizeof(struct data_block),
+                    4, UTIL_SLAB_THREAD_CACHED);
+   util_slab_set_name(&screen->data_block_pool, "llvmpipe scene data");
+
    util_format_s3tc_init();
 
    return &screen->base;
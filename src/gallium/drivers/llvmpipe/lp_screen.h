@@ -37,6 +37,7 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
+#include "util/u_slab.h"
 #include "gallivm/lp_bld.h"
 
 
@@ -57,6 +58,13 @@ struct llvmpipe_screen
 
    struct lp_rasterizer *rast;
    pipe_mutex rast_mutex;
+
+   /* Small objects which are created and destroyed all the time, often
+    * on different threads.
+    */
+   struct util_slab_mempool fence_pool;
+   struct util_slab_mempool transfer_pool;
+   struct util_slab_mempool data_block_pool;
 };
 
 
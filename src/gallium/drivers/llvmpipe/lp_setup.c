@@ -46,6 +46,7 @@
 #include "lp_texture.h"
 #include "lp_debug.h"
 #include "lp_fence.h"
+#include "lp_perf.h"
 #include "lp_query.h"
 #include "lp_rast.h"
 #include "lp_setup_context.h"
@@ -188,7 +189,8 @@ begin_binning( struct lp_setup_context *setup )
 
    /* Always create a fence:
     */
-   scene->fence = lp_fence_create(MAX2(1, setup->num_threads));
+   scene->fence = lp_fence_create(setup->pipe->screen,
+                                  MAX2(1, setup->num_threads));
    if (!scene->fence)
       return FALSE;
 
@@ -348,8 +350,12 @@ lp_setup_flush( struct lp_setup_context *setup,
                 struct pipe_fence_handle **fence,
                 const char *reason)
 {
+   int64_t start = util_instr_begin();
+
    set_scene_state( setup, SETUP_FLUSHED, reason );
 
+   util_instr_end(&lp_instr_flush, start);
+
    if (fence) {
       lp_fence_reference((struct lp_fence **)fence, setup->last_fence);
    }
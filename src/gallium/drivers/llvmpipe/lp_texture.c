@@ -675,9 +675,10 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
       llvmpipe->dirty |= LP_NEW_CONSTANTS;
    }
 
-   lpt = CALLOC_STRUCT(llvmpipe_transfer);
+   lpt = util_slab_alloc(&screen->transfer_pool);
    if (!lpt)
       return NULL;
+   memset(lpt, 0, sizeof *lpt);
    pt = &lpt->base;
    pipe_resource_reference(&pt->resource, resource);
    pt->box = *box;
@@ -739,6 +740,8 @@ static void
 llvmpipe_transfer_unmap(struct pipe_context *pipe,
                         struct pipe_transfer *transfer)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+
    assert(transfer->resource);
 
    llvmpipe_resource_unmap(transfer->resource,
@@ -751,7 +754,7 @@ llvmpipe_transfer_unmap(struct pipe_context *pipe,
     */
    assert (transfer->resource);
    pipe_resource_reference(&transfer->resource, NULL);
-   FREE(transfer);
+   util_slab_free(&screen->transfer_pool, transfer);
 }
 
 unsigned int
@@ -38,6 +38,8 @@ C_SOURCES = \
 	sp_quad_depth_test.c \
 	sp_quad_fs.c \
 	sp_quad_blend.c \
+	sp_quad_fused.c \
+	sp_rast.c \
 	sp_screen.c \
         sp_setup.c \
 	sp_state_blend.c \
@@ -44,6 +44,7 @@
 #include "sp_context.h"
 #include "sp_flush.h"
 #include "sp_prim_vbuf.h"
+#include "sp_rast.h"
 #include "sp_state.h"
 #include "sp_surface.h"
 #include "sp_tile_cache.h"
@@ -74,17 +75,10 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->draw)
       draw_destroy( softpipe->draw );
 
-   if (softpipe->quad.shade)
-      softpipe->quad.shade->destroy( softpipe->quad.shade );
+   if (softpipe->rast)
+      sp_rast_destroy( softpipe->rast );
 
-   if (softpipe->quad.depth_test)
-      softpipe->quad.depth_test->destroy( softpipe->quad.depth_test );
-
-   if (softpipe->quad.blend)
-      softpipe->quad.blend->destroy( softpipe->quad.blend );
-
-   if (softpipe->quad.pstipple)
-      softpipe->quad.pstipple->destroy( softpipe->quad.pstipple );
+   sp_destroy_quad_pipeline( &softpipe->quad );
 
    for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
       sp_destroy_tile_cache(softpipe->cbuf_cache[i]);
@@ -186,7 +180,7 @@ softpipe_create_context( struct pipe_screen *screen,
 {
    struct softpipe_screen *sp_screen = softpipe_screen(screen);
    struct softpipe_context *softpipe = CALLOC_STRUCT(softpipe_context);
-   uint i, sh;
+   uint i, sh, num_threads;
 
    util_init_math();
 
@@ -220,13 +214,19 @@ softpipe_create_context( struct pipe_screen *screen,
    softpipe->pipe.create_video_decoder = vl_create_decoder;
    softpipe->pipe.create_video_buffer = vl_video_buffer_create;
 
+   num_threads = debug_get_num_option( "SOFTPIPE_NUM_THREADS", 0 );
+   num_threads = CLAMP(num_threads, 1, SP_MAX_THREADS);
+
    /*
     * Alloc caches for accessing drawing surfaces and textures.
     * Must be before quad stage setup!
+    * Each rasterizer thread gets its own band of the surface caches.
     */
    for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
-      softpipe->cbuf_cache[i] = sp_create_tile_cache( &softpipe->pipe );
-   softpipe->zsbuf_cache = sp_create_tile_cache( &softpipe->pipe );
+      softpipe->cbuf_cache[i] = sp_create_tile_cache( &softpipe->pipe,
+                                                      num_threads );
+   softpipe->zsbuf_cache = sp_create_tile_cache( &softpipe->pipe,
+                                                 num_threads );
 
    /* Allocate texture caches */
    for (sh = 0; sh < Elements(softpipe->tex_cache); sh++) {
@@ -240,10 +240,20 @@ softpipe_create_context( struct pipe_screen *screen,
    softpipe->fs_machine = tgsi_exec_machine_create();
 
    /* setup quad rendering stages */
-   softpipe->quad.shade = sp_quad_shade_stage(softpipe);
-   softpipe->quad.depth_test = sp_quad_depth_test_stage(softpipe);
-   softpipe->quad.blend = sp_quad_blend_stage(softpipe);
-   softpipe->quad.pstipple = sp_quad_polygon_stipple_stage(softpipe);
+   softpipe->quad_thread.machine = softpipe->fs_machine;
+   softpipe->quad_thread.samplers = (struct tgsi_sampler **)
+      softpipe->tgsi.samplers_list[PIPE_SHADER_FRAGMENT];
+   softpipe->quad_thread.occlusion_count = &softpipe->occlusion_count;
+
+   if (!sp_create_quad_pipeline(softpipe, &softpipe->quad,
+                                &softpipe->quad_thread))
+      goto fail;
+
+   if (num_threads > 1) {
+      softpipe->rast = sp_rast_create(softpipe, num_threads);
+      if (!softpipe->rast)
+         goto fail;
+   }
 
 
    /*
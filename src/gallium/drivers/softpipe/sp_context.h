@@ -51,6 +51,7 @@ struct draw_context;
 struct draw_stage;
 struct softpipe_tile_cache;
 struct softpipe_tex_tile_cache;
+struct sp_rast;
 struct sp_fragment_shader;
 struct sp_vertex_shader;
 struct sp_velems_state;
@@ -149,13 +150,11 @@ struct softpipe_context {
    } pstipple;
 
    /** Software quad rendering pipeline */
-   struct {
-      struct quad_stage *shade;
-      struct quad_stage *depth_test;
-      struct quad_stage *blend;
-      struct quad_stage *pstipple;
-      struct quad_stage *first; /**< points to one of the above stages */
-   } quad;
+   struct quad_pipeline quad;
+   struct quad_thread_state quad_thread;
+
+   /** Rasterizer threads, NULL when quads are processed in place */
+   struct sp_rast *rast;
 
    /** TGSI exec things */
    struct {
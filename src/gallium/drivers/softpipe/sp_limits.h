@@ -40,4 +40,8 @@
 #define MAX_HEIGHT (1 << (SP_MAX_TEXTURE_2D_LEVELS - 1))
 
 
+/** Max number of quad rasterization threads */
+#define SP_MAX_THREADS 8
+
+
 #endif /* SP_LIMITS_H */
@@ -35,6 +35,14 @@
 #include "tgsi/tgsi_exec.h"
 
 
+/**
+ * Max number of quads (2x2 pixel blocks) to process per batch.
+ * This can't be arbitrarily increased since we depend on some 32-bit
+ * bitmasks (two bits per quad).
+ */
+#define MAX_QUADS 16
+
+
 #define QUAD_PRIM_POINT 1
 #define QUAD_PRIM_LINE  2
 #define QUAD_PRIM_TRI   3
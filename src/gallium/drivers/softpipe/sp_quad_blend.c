@@ -59,6 +59,7 @@ struct blend_quad_stage
    boolean clamp[PIPE_MAX_COLOR_BUFS];  /**< clamp colors to [0,1]? */
    enum format base_format[PIPE_MAX_COLOR_BUFS];
    enum util_format_type format_type[PIPE_MAX_COLOR_BUFS];
+   const struct util_format_description *format_desc[PIPE_MAX_COLOR_BUFS];
 };
 
 
@@ -871,7 +872,7 @@ clamp_colors(float (*quadColor)[4])
 /**
  * If we're drawing to a luminance, luminance/alpha or intensity surface
  * we have to adjust (rebase) the fragment/quad colors before writing them
- * to the tile cache.  The tile cache always stores RGBA colors but if
+ * to the tile cache.  The tile cache may store RGBA colors but if
  * we're caching a L/A surface (for example) we need to be sure that R=G=B
  * so that subsequent reads from the surface cache appear to return L/A
  * values.
@@ -932,8 +933,10 @@ blend_fallback(struct quad_stage *qs,
       /* which blend/mask state index to use: */
       const uint blend_buf = blend->independent_blend_enable ? cbuf : 0;
       float dest[4][TGSI_QUAD_SIZE];
+      struct softpipe_tile_cache *tc = softpipe->cbuf_cache[cbuf];
+      const struct util_format_description *desc = bqs->format_desc[cbuf];
       struct softpipe_cached_tile *tile
-         = sp_get_cached_tile(softpipe->cbuf_cache[cbuf],
+         = sp_get_cached_tile(tc,
                               quads[0]->input.x0, 
                               quads[0]->input.y0);
       const boolean clamp = bqs->clamp[cbuf];
@@ -976,13 +979,7 @@ blend_fallback(struct quad_stage *qs,
 
          /* get/swizzle dest colors
           */
-         for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-            int x = itx + (j & 1);
-            int y = ity + (j >> 1);
-            for (i = 0; i < 4; i++) {
-               dest[i][j] = tile->data.color[y][x][i];
-            }
-         }
+         sp_tile_get_quad_rgba(tc, desc, tile, itx, ity, dest);
 
 
          if (blend->logicop_enable) {
@@ -1008,15 +1005,7 @@ blend_fallback(struct quad_stage *qs,
    
          /* Output color values
           */
-         for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-            if (quad->inout.mask & (1 << j)) {
-               int x = itx + (j & 1);
-               int y = ity + (j >> 1);
-               for (i = 0; i < 4; i++) { /* loop over color chans */
-                  tile->data.color[y][x][i] = quadColor[i][j];
-               }
-            }
-         }
+         sp_tile_put_quad_rgba(tc, desc, tile, itx, ity, quad->inout.mask, quadColor);
       }
    }
 }
@@ -1032,10 +1021,12 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
    float one_minus_alpha[TGSI_QUAD_SIZE];
    float dest[4][TGSI_QUAD_SIZE];
    float source[4][TGSI_QUAD_SIZE];
-   uint i, j, q;
+   uint q;
 
+   struct softpipe_tile_cache *tc = qs->softpipe->cbuf_cache[0];
+   const struct util_format_description *desc = bqs->format_desc[0];
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(tc,
                            quads[0]->input.x0, 
                            quads[0]->input.y0);
 
@@ -1047,13 +1038,7 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
       const int ity = (quad->input.y0 & (TILE_SIZE-1));
       
       /* get/swizzle dest colors */
-      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-         int x = itx + (j & 1);
-         int y = ity + (j >> 1);
-         for (i = 0; i < 4; i++) {
-            dest[i][j] = tile->data.color[y][x][i];
-         }
-      }
+      sp_tile_get_quad_rgba(tc, desc, tile, itx, ity, dest);
 
       /* If fixed-point dest color buffer, need to clamp the incoming
        * fragment colors now.
@@ -1087,15 +1072,7 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
 
       rebase_colors(bqs->base_format[0], quadColor);
 
-      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-         if (quad->inout.mask & (1 << j)) {
-            int x = itx + (j & 1);
-            int y = ity + (j >> 1);
-            for (i = 0; i < 4; i++) { /* loop over color chans */
-               tile->data.color[y][x][i] = quadColor[i][j];
-            }
-         }
-      }
+      sp_tile_put_quad_rgba(tc, desc, tile, itx, ity, quad->inout.mask, quadColor);
    }
 }
 
@@ -1106,10 +1083,12 @@ blend_single_add_one_one(struct quad_stage *qs,
 {
    const struct blend_quad_stage *bqs = blend_quad_stage(qs);
    float dest[4][TGSI_QUAD_SIZE];
-   uint i, j, q;
+   uint q;
 
+   struct softpipe_tile_cache *tc = qs->softpipe->cbuf_cache[0];
+   const struct util_format_description *desc = bqs->format_desc[0];
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(tc,
                            quads[0]->input.x0, 
                            quads[0]->input.y0);
 
@@ -1120,13 +1099,7 @@ blend_single_add_one_one(struct quad_stage *qs,
       const int ity = (quad->input.y0 & (TILE_SIZE-1));
       
       /* get/swizzle dest colors */
-      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-         int x = itx + (j & 1);
-         int y = ity + (j >> 1);
-         for (i = 0; i < 4; i++) {
-            dest[i][j] = tile->data.color[y][x][i];
-         }
-      }
+      sp_tile_get_quad_rgba(tc, desc, tile, itx, ity, dest);
      
       /* If fixed-point dest color buffer, need to clamp the incoming
        * fragment colors now.
@@ -1149,15 +1122,7 @@ blend_single_add_one_one(struct quad_stage *qs,
 
       rebase_colors(bqs->base_format[0], quadColor);
 
-      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-         if (quad->inout.mask & (1 << j)) {
-            int x = itx + (j & 1);
-            int y = ity + (j >> 1);
-            for (i = 0; i < 4; i++) { /* loop over color chans */
-               tile->data.color[y][x][i] = quadColor[i][j];
-            }
-         }
-      }
+      sp_tile_put_quad_rgba(tc, desc, tile, itx, ity, quad->inout.mask, quadColor);
    }
 }
 
@@ -1174,10 +1139,12 @@ single_output_color(struct quad_stage *qs,
                     unsigned nr)
 {
    const struct blend_quad_stage *bqs = blend_quad_stage(qs);
-   uint i, j, q;
+   uint q;
 
+   struct softpipe_tile_cache *tc = qs->softpipe->cbuf_cache[0];
+   const struct util_format_description *desc = bqs->format_desc[0];
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(tc,
                            quads[0]->input.x0, 
                            quads[0]->input.y0);
 
@@ -1192,15 +1159,7 @@ single_output_color(struct quad_stage *qs,
 
       rebase_colors(bqs->base_format[0], quadColor);
 
-      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-         if (quad->inout.mask & (1 << j)) {
-            int x = itx + (j & 1);
-            int y = ity + (j >> 1);
-            for (i = 0; i < 4; i++) { /* loop over color chans */
-               tile->data.color[y][x][i] = quadColor[i][j];
-            }
-         }
-      }
+      sp_tile_put_quad_rgba(tc, desc, tile, itx, ity, quad->inout.mask, quadColor);
    }
 }
 
@@ -1261,6 +1220,7 @@ choose_blend_quad(struct quad_stage *qs,
       /* assuming all or no color channels are normalized: */
       bqs->clamp[i] = desc->channel[0].normalized;
       bqs->format_type[i] = desc->channel[0].type;
+      bqs->format_desc[i] = desc;
 
       if (util_format_is_intensity(format))
          bqs->base_format[i] = INTENSITY;
@@ -822,7 +822,7 @@ depth_test_quads_fallback(struct quad_stage *qs,
 
    if (qs->softpipe->active_query_count) {
       for (i = 0; i < nr; i++) 
-         qs->softpipe->occlusion_count += mask_count[quads[i]->inout.mask];
+         *qs->thread->occlusion_count += mask_count[quads[i]->inout.mask];
    }
 
    if (nr)
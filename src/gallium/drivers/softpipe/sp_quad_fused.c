@@ -0,0 +1,426 @@
+/**************************************************************************
+ *
+ * Copyright 2013 The Mesa Project.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Fused quad processing.
+ *
+ * For the most common state combinations a single stage does the depth
+ * test, runs the fragment shader and blends, quad by quad, instead of
+ * passing batches through the generic depth_test, shade and blend stages
+ * which each switch on the state again.  The functions are generated from
+ * sp_quad_fused_tmp.h and chosen when the pipeline is linked.
+ *
+ * Fused paths are used when there's a single color buffer whose tiles are
+ * kept in the surface format (see sp_tile_cache.c), all channels are
+ * written, and:
+ * - there's no depth test, or an early depth test against a 24-bit depth
+ *   buffer without stencil,
+ * - no alpha test, stencil test or polygon stipple stage,
+ * - no blending, or src_alpha/inv_src_alpha or one/one blending.
+ */
+
+#include "pipe/p_defines.h"
+#include "util/u_debug.h"
+#include "util/u_format.h"
+#include "util/u_instr.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "sp_context.h"
+#include "sp_quad.h"
+#include "sp_quad_pipe.h"
+#include "sp_state.h"
+#include "sp_tile_cache.h"
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(no_fused, "SOFTPIPE_NO_FUSED", FALSE)
+
+
+/* Blend modes with a fused path; these are used in #if */
+#define FUSED_BLEND_REPLACE 0
+#define FUSED_BLEND_SRC_ALPHA 1  /**< src_alpha, inv_src_alpha */
+#define FUSED_BLEND_ADD 2        /**< one, one */
+#define FUSED_BLEND_COUNT 3
+
+
+/** Subclass of quad_stage */
+struct fused_quad_stage
+{
+   struct quad_stage base;
+   const struct util_format_description *format_desc; /**< of cbuf 0 */
+   unsigned zshift;  /**< position of the depth bits in the Z/stencil word */
+   unsigned zkeep;   /**< bits of the Z/stencil word which aren't depth */
+};
+
+
+/** cast wrapper */
+static INLINE struct fused_quad_stage *
+fused_quad_stage(struct quad_stage *stage)
+{
+   return (struct fused_quad_stage *) stage;
+}
+
+
+#define VEC4_ADD(R, A, B) \
+do { \
+   R[0] = A[0] + B[0]; \
+   R[1] = A[1] + B[1]; \
+   R[2] = A[2] + B[2]; \
+   R[3] = A[3] + B[3]; \
+} while (0)
+
+#define VEC4_SUB(R, A, B) \
+do { \
+   R[0] = A[0] - B[0]; \
+   R[1] = A[1] - B[1]; \
+   R[2] = A[2] - B[2]; \
+   R[3] = A[3] - B[3]; \
+} while (0)
+
+#define VEC4_MUL(R, A, B) \
+do { \
+   R[0] = A[0] * B[0]; \
+   R[1] = A[1] * B[1]; \
+   R[2] = A[2] * B[2]; \
+   R[3] = A[3] * B[3]; \
+} while (0)
+
+
+/**
+ * Clamp all colors in a quad to [0, 1]
+ */
+static INLINE void
+clamp_colors(float (*quadColor)[4])
+{
+   unsigned i, j;
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+      for (i = 0; i < 4; i++) {
+         quadColor[i][j] = CLAMP(quadColor[i][j], 0.0F, 1.0F);
+      }
+   }
+}
+
+
+#define NAME fused_replace
+#define BLEND FUSED_BLEND_REPLACE
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_src_alpha
+#define BLEND FUSED_BLEND_SRC_ALPHA
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_add
+#define BLEND FUSED_BLEND_ADD
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_less_replace
+#define DEPTH_OP <
+#define BLEND FUSED_BLEND_REPLACE
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_less_src_alpha
+#define DEPTH_OP <
+#define BLEND FUSED_BLEND_SRC_ALPHA
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_less_add
+#define DEPTH_OP <
+#define BLEND FUSED_BLEND_ADD
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_lequal_replace
+#define DEPTH_OP <=
+#define BLEND FUSED_BLEND_REPLACE
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_lequal_src_alpha
+#define DEPTH_OP <=
+#define BLEND FUSED_BLEND_SRC_ALPHA
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_lequal_add
+#define DEPTH_OP <=
+#define BLEND FUSED_BLEND_ADD
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_greater_replace
+#define DEPTH_OP >
+#define BLEND FUSED_BLEND_REPLACE
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_greater_src_alpha
+#define DEPTH_OP >
+#define BLEND FUSED_BLEND_SRC_ALPHA
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_greater_add
+#define DEPTH_OP >
+#define BLEND FUSED_BLEND_ADD
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_gequal_replace
+#define DEPTH_OP >=
+#define BLEND FUSED_BLEND_REPLACE
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_gequal_src_alpha
+#define DEPTH_OP >=
+#define BLEND FUSED_BLEND_SRC_ALPHA
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_gequal_add
+#define DEPTH_OP >=
+#define BLEND FUSED_BLEND_ADD
+#include "sp_quad_fused_tmp.h"
+
+
+typedef void (*fused_quad_func)(struct quad_stage *qs,
+                                struct quad_header *quads[],
+                                unsigned nr);
+
+/** Depth tests with a fused path: none, then less, lequal, greater, gequal */
+#define FUSED_DEPTH_COUNT 5
+
+static const fused_quad_func
+fused_funcs[FUSED_DEPTH_COUNT][FUSED_BLEND_COUNT] = {
+   { fused_replace, fused_src_alpha, fused_add },
+   { fused_z24_less_replace, fused_z24_less_src_alpha, fused_z24_less_add },
+   { fused_z24_lequal_replace, fused_z24_lequal_src_alpha,
+     fused_z24_lequal_add },
+   { fused_z24_greater_replace, fused_z24_greater_src_alpha,
+     fused_z24_greater_add },
+   { fused_z24_gequal_replace, fused_z24_gequal_src_alpha,
+     fused_z24_gequal_add },
+};
+
+/** Number of draws which used each path */
+static struct util_instr_counter
+fused_counters[FUSED_DEPTH_COUNT][FUSED_BLEND_COUNT] = {
+   { UTIL_INSTR_COUNTER_INIT("softpipe:draws fused replace"),
+     UTIL_INSTR_COUNTER_INIT("softpipe:draws fused src_alpha"),
+     UTIL_INSTR_COUNTER_INIT("softpipe:draws fused add") },
+   { UTIL_INSTR_COUNTER_INIT("softpipe:draws fused z24_less replace"),
+     UTIL_INSTR_COUNTER_INIT("softpipe:draws fused z24_less src_alpha"),
+     UTIL_INSTR_COUNTER_INIT("softpipe:draws fused z24_less add") },
+   { UTIL_INSTR_COUNTER_INIT("softpipe:draws fused z24_lequal replace"),
+     UTIL_INSTR_COUNTER_INIT("softpipe:draws fused z24_lequal src_alpha"),
+     UTIL_INSTR_COUNTER_INIT("softpipe:draws fused z24_lequal add") },
+   { UTIL_INSTR_COUNTER_INIT("softpipe:draws fused z24_greater replace"),
+     UTIL_INSTR_COUNTER_INIT("softpipe:draws fused z24_greater src_alpha"),
+     UTIL_INSTR_COUNTER_INIT("softpipe:draws fused z24_greater add") },
+   { UTIL_INSTR_COUNTER_INIT("softpipe:draws fused z24_gequal replace"),
+     UTIL_INSTR_COUNTER_INIT("softpipe:draws fused z24_gequal src_alpha"),
+     UTIL_INSTR_COUNTER_INIT("softpipe:draws fused z24_gequal add") },
+};
+
+
+/**
+ * Return the fused blend mode for the current blend state, or
+ * FUSED_BLEND_COUNT if there's none.
+ */
+static unsigned
+choose_blend(const struct pipe_blend_state *blend)
+{
+   const struct pipe_rt_blend_state *rt = &blend->rt[0];
+
+   if (blend->logicop_enable || rt->colormask != PIPE_MASK_RGBA)
+      return FUSED_BLEND_COUNT;
+
+   if (!rt->blend_enable)
+      return FUSED_BLEND_REPLACE;
+
+   if (rt->rgb_func != PIPE_BLEND_ADD ||
+       rt->alpha_func != PIPE_BLEND_ADD ||
+       rt->rgb_src_factor != rt->alpha_src_factor ||
+       rt->rgb_dst_factor != rt->alpha_dst_factor)
+      return FUSED_BLEND_COUNT;
+
+   if (rt->rgb_src_factor == PIPE_BLENDFACTOR_SRC_ALPHA &&
+       rt->rgb_dst_factor == PIPE_BLENDFACTOR_INV_SRC_ALPHA)
+      return FUSED_BLEND_SRC_ALPHA;
+
+   if (rt->rgb_src_factor == PIPE_BLENDFACTOR_ONE &&
+       rt->rgb_dst_factor == PIPE_BLENDFACTOR_ONE)
+      return FUSED_BLEND_ADD;
+
+   return FUSED_BLEND_COUNT;
+}
+
+
+/**
+ * Return the fused depth test for the current state (0 for none), or
+ * FUSED_DEPTH_COUNT if there's none.
+ */
+static unsigned
+choose_depth(struct fused_quad_stage *fqs)
+{
+   const struct softpipe_context *sp = fqs->base.softpipe;
+   const struct pipe_depth_stencil_alpha_state *dsa = sp->depth_stencil;
+   const struct tgsi_shader_info *info = &sp->fs_variant->info;
+   const struct pipe_surface *zsbuf = sp->framebuffer.zsbuf;
+
+   if (dsa->alpha.enabled)
+      return FUSED_DEPTH_COUNT;
+
+   if (!zsbuf)
+      return 0;
+
+   if (dsa->stencil[0].enabled)
+      return FUSED_DEPTH_COUNT;
+
+   if (!dsa->depth.enabled)
+      return 0;
+
+   /* the depth test must happen before shading */
+   if (info->uses_kill || info->writes_z || info->writes_stencil)
+      return FUSED_DEPTH_COUNT;
+
+   switch (zsbuf->format) {
+   case PIPE_FORMAT_Z24X8_UNORM:
+      fqs->zshift = 0;
+      fqs->zkeep = 0;
+      break;
+   case PIPE_FORMAT_Z24_UNORM_S8_UINT:
+      fqs->zshift = 0;
+      fqs->zkeep = 0xff000000;
+      break;
+   case PIPE_FORMAT_X8Z24_UNORM:
+      fqs->zshift = 8;
+      fqs->zkeep = 0;
+      break;
+   case PIPE_FORMAT_S8_UINT_Z24_UNORM:
+      fqs->zshift = 8;
+      fqs->zkeep = 0xff;
+      break;
+   default:
+      return FUSED_DEPTH_COUNT;
+   }
+
+   switch (dsa->depth.func) {
+   case PIPE_FUNC_LESS:
+      return 1;
+   case PIPE_FUNC_LEQUAL:
+      return 2;
+   case PIPE_FUNC_GREATER:
+      return 3;
+   case PIPE_FUNC_GEQUAL:
+      return 4;
+   default:
+      return FUSED_DEPTH_COUNT;
+   }
+}
+
+
+/**
+ * Choose the fused function for the current state.
+ * \return the counter of the chosen path, or NULL if the state has no
+ *         fused path and the generic stages must be used
+ */
+struct util_instr_counter *
+sp_choose_fused_quad_stage(struct quad_stage *qs)
+{
+   struct fused_quad_stage *fqs = fused_quad_stage(qs);
+   struct softpipe_context *sp = qs->softpipe;
+   const struct util_format_description *desc;
+   unsigned depth, blend;
+
+   if (debug_get_option_no_fused())
+      return NULL;
+
+   if (sp->framebuffer.nr_cbufs != 1 ||
+       !sp->framebuffer.cbufs[0] ||
+       !sp->cbuf_cache[0]->native)
+      return NULL;
+
+#if !DO_PSTIPPLE_IN_DRAW_MODULE && !DO_PSTIPPLE_IN_HELPER_MODULE
+   if (sp->rasterizer->poly_stipple_enable)
+      return NULL;
+#endif
+
+   /* the colors are always clamped, and written as RGBA */
+   desc = util_format_description(sp->framebuffer.cbufs[0]->format);
+   if (!desc->channel[0].normalized ||
+       util_format_is_intensity(desc->format) ||
+       util_format_is_luminance(desc->format) ||
+       util_format_is_luminance_alpha(desc->format) ||
+       util_format_is_rgb_no_alpha(desc->format))
+      return NULL;
+
+   blend = choose_blend(sp->blend);
+   if (blend == FUSED_BLEND_COUNT)
+      return NULL;
+
+   depth = choose_depth(fqs);
+   if (depth == FUSED_DEPTH_COUNT)
+      return NULL;
+
+   fqs->format_desc = desc;
+   qs->run = fused_funcs[depth][blend];
+
+   return &fused_counters[depth][blend];
+}
+
+
+static void
+fused_begin(struct quad_stage *qs)
+{
+   struct softpipe_context *softpipe = qs->softpipe;
+
+   softpipe->fs_variant->prepare( softpipe->fs_variant,
+                                  qs->thread->machine,
+                                  qs->thread->samplers );
+}
+
+
+static void
+fused_destroy(struct quad_stage *qs)
+{
+   FREE( qs );
+}
+
+
+struct quad_stage *
+sp_quad_fused_stage( struct softpipe_context *softpipe )
+{
+   struct fused_quad_stage *stage = CALLOC_STRUCT(fused_quad_stage);
+   unsigned i, j;
+
+   if (!stage)
+      return NULL;
+
+   for (i = 0; i < FUSED_DEPTH_COUNT; i++) {
+      for (j = 0; j < FUSED_BLEND_COUNT; j++) {
+         util_instr_register(&fused_counters[i][j]);
+      }
+   }
+
+   stage->base.softpipe = softpipe;
+   stage->base.begin = fused_begin;
+   stage->base.run = fused_replace;
+   stage->base.destroy = fused_destroy;
+
+   return &stage->base;
+}
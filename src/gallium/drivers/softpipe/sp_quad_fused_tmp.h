@@ -0,0 +1,202 @@
+/**************************************************************************
+ *
+ * Copyright 2013 The Mesa Project.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Template for generating fused depth test + shade + blend functions.
+ *
+ * NAME is the function name.  DEPTH_OP is the depth comparison operator;
+ * if it's not defined the depth test is disabled.  BLEND is one of the
+ * FUSED_BLEND_x modes.
+ *
+ * Each step does exactly what the corresponding stage of the generic
+ * pipeline does for the same state, so the results are identical; see
+ * depth_test_quads_fallback(), shade_quads() and the single color buffer
+ * functions of sp_quad_blend.c.
+ */
+
+
+#ifndef NAME
+#error "NAME is not defined!"
+#endif
+
+#ifndef BLEND
+#error "BLEND is not defined!"
+#endif
+
+
+static void
+NAME(struct quad_stage *qs,
+     struct quad_header *quads[],
+     unsigned nr)
+{
+   const struct fused_quad_stage *fqs = fused_quad_stage(qs);
+   struct softpipe_context *softpipe = qs->softpipe;
+   const struct sp_fragment_shader_variant *fs = softpipe->fs_variant;
+   struct tgsi_exec_machine *machine = qs->thread->machine;
+   const struct util_format_description *desc = fqs->format_desc;
+   const boolean occlusion = softpipe->active_query_count != 0;
+#if BLEND == FUSED_BLEND_REPLACE
+   const boolean clamp = softpipe->rasterizer->clamp_fragment_color;
+#endif
+   struct softpipe_tile_cache *tc = softpipe->cbuf_cache[0];
+   struct softpipe_cached_tile *tile =
+      sp_get_cached_tile(tc, quads[0]->input.x0, quads[0]->input.y0);
+#ifdef DEPTH_OP
+   const float zscale = (float) ((1 << 24) - 1);
+   const boolean zwrite = softpipe->depth_stencil->depth.writemask;
+   const unsigned zshift = fqs->zshift;
+   const unsigned zkeep = fqs->zkeep;
+   struct softpipe_cached_tile *ztile =
+      sp_get_cached_tile(softpipe->zsbuf_cache,
+                         quads[0]->input.x0, quads[0]->input.y0);
+   unsigned j;
+#endif
+   unsigned i;
+
+   tgsi_exec_set_constant_buffers(machine, PIPE_MAX_CONSTANT_BUFFERS,
+                         softpipe->mapped_constants[PIPE_SHADER_FRAGMENT],
+                         softpipe->const_buffer_size[PIPE_SHADER_FRAGMENT]);
+
+   machine->InterpCoefs = quads[0]->coef;
+   machine->flatshade_color = softpipe->rasterizer->flatshade ? TRUE : FALSE;
+
+   for (i = 0; i < nr; i++) {
+      struct quad_header *quad = quads[i];
+      const int itx = quad->input.x0 & (TILE_SIZE-1);
+      const int ity = quad->input.y0 & (TILE_SIZE-1);
+      float (*quadColor)[4];
+#if BLEND != FUSED_BLEND_REPLACE
+      float dest[4][TGSI_QUAD_SIZE];
+#endif
+
+#ifdef DEPTH_OP
+      {
+         const float fx = (float) quad->input.x0;
+         const float fy = (float) quad->input.y0;
+         const float dzdx = quad->posCoef->dadx[2];
+         const float dzdy = quad->posCoef->dady[2];
+         const float z0 = quad->posCoef->a0[2] + dzdx * fx + dzdy * fy;
+         unsigned zmask = 0;
+
+         quad->output.depth[0] = z0;
+         quad->output.depth[1] = z0 + dzdx;
+         quad->output.depth[2] = z0 + dzdy;
+         quad->output.depth[3] = z0 + dzdx + dzdy;
+
+         for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+            const int x = itx + (j & 1);
+            const int y = ity + (j >> 1);
+            const unsigned qz = (unsigned) (quad->output.depth[j] * zscale);
+            const unsigned bz = (ztile->data.depth32[y][x] >> zshift) & 0xffffff;
+
+            if (qz DEPTH_OP bz)
+               zmask |= 1 << j;
+         }
+
+         quad->inout.mask &= zmask;
+         if (!quad->inout.mask)
+            continue;
+
+         if (zwrite) {
+            for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+               const int x = itx + (j & 1);
+               const int y = ity + (j >> 1);
+               const unsigned zs = ztile->data.depth32[y][x];
+               unsigned z = (zs >> zshift) & 0xffffff;
+
+               if (quad->inout.mask & (1 << j))
+                  z = (unsigned) (quad->output.depth[j] * zscale);
+
+               ztile->data.depth32[y][x] = (z << zshift) | (zs & zkeep);
+            }
+         }
+
+         if (occlusion)
+            *qs->thread->occlusion_count += util_bitcount(quad->inout.mask);
+      }
+#endif
+
+      if (!fs->run(fs, machine, quad))
+         continue;
+
+#ifndef DEPTH_OP
+      if (occlusion)
+         *qs->thread->occlusion_count += util_bitcount(quad->inout.mask);
+#endif
+
+      quadColor = quad->output.color[0];
+
+#if BLEND == FUSED_BLEND_REPLACE
+      if (clamp)
+         clamp_colors(quadColor);
+#else
+      sp_tile_get_quad_rgba(tc, desc, tile, itx, ity, dest);
+
+      clamp_colors(quadColor);
+
+#if BLEND == FUSED_BLEND_SRC_ALPHA
+      {
+         static const float one[4] = { 1, 1, 1, 1 };
+         const float *alpha = quadColor[3];
+         float one_minus_alpha[TGSI_QUAD_SIZE];
+         float source[4][TGSI_QUAD_SIZE];
+
+         VEC4_MUL(source[0], quadColor[0], alpha); /* R */
+         VEC4_MUL(source[1], quadColor[1], alpha); /* G */
+         VEC4_MUL(source[2], quadColor[2], alpha); /* B */
+         VEC4_MUL(source[3], quadColor[3], alpha); /* A */
+
+         VEC4_SUB(one_minus_alpha, one, alpha);
+         VEC4_MUL(dest[0], dest[0], one_minus_alpha); /* R */
+         VEC4_MUL(dest[1], dest[1], one_minus_alpha); /* G */
+         VEC4_MUL(dest[2], dest[2], one_minus_alpha); /* B */
+         VEC4_MUL(dest[3], dest[3], one_minus_alpha); /* A */
+
+         VEC4_ADD(quadColor[0], source[0], dest[0]); /* R */
+         VEC4_ADD(quadColor[1], source[1], dest[1]); /* G */
+         VEC4_ADD(quadColor[2], source[2], dest[2]); /* B */
+         VEC4_ADD(quadColor[3], source[3], dest[3]); /* A */
+      }
+#elif BLEND == FUSED_BLEND_ADD
+      VEC4_ADD(quadColor[0], quadColor[0], dest[0]); /* R */
+      VEC4_ADD(quadColor[1], quadColor[1], dest[1]); /* G */
+      VEC4_ADD(quadColor[2], quadColor[2], dest[2]); /* B */
+      VEC4_ADD(quadColor[3], quadColor[3], dest[3]); /* A */
+#else
+#error "unknown BLEND mode"
+#endif
+
+      clamp_colors(quadColor);
+#endif /* BLEND != FUSED_BLEND_REPLACE */
+
+      sp_tile_put_quad_rgba(tc, desc, tile, itx, ity, quad->inout.mask, quadColor);
+   }
+}
+
+
+#undef NAME
+#undef DEPTH_OP
+#undef BLEND
@@ -29,20 +29,94 @@
 #include "sp_context.h"
 #include "sp_state.h"
 #include "pipe/p_shader_tokens.h"
+#include "util/u_instr.h"
+
+
+static struct util_instr_counter generic_path =
+   UTIL_INSTR_COUNTER_INIT("softpipe:draws generic");
 
 
 static void
-insert_stage_at_head(struct softpipe_context *sp, struct quad_stage *quad)
+insert_stage_at_head(struct quad_pipeline *qp, struct quad_stage *quad)
 {
-   quad->next = sp->quad.first;
-   sp->quad.first = quad;
+   quad->next = qp->first;
+   qp->first = quad;
+}
+
+
+/**
+ * Create the stages of a quad pipeline.  The stages modify \p thread
+ * only, so pipelines with different thread states can run concurrently.
+ */
+boolean
+sp_create_quad_pipeline(struct softpipe_context *sp,
+                        struct quad_pipeline *qp,
+                        struct quad_thread_state *thread)
+{
+   qp->shade = sp_quad_shade_stage(sp);
+   qp->depth_test = sp_quad_depth_test_stage(sp);
+   qp->blend = sp_quad_blend_stage(sp);
+   qp->pstipple = sp_quad_polygon_stipple_stage(sp);
+   qp->fused = sp_quad_fused_stage(sp);
+   qp->first = NULL;
+   qp->path = &generic_path;
+
+   if (!qp->shade || !qp->depth_test || !qp->blend || !qp->pstipple ||
+       !qp->fused)
+      return FALSE;
+
+   qp->shade->thread = thread;
+   qp->depth_test->thread = thread;
+   qp->blend->thread = thread;
+   qp->pstipple->thread = thread;
+   qp->fused->thread = thread;
+
+   util_instr_register(&generic_path);
+
+   return TRUE;
 }
 
 
 void
-sp_build_quad_pipeline(struct softpipe_context *sp)
+sp_destroy_quad_pipeline(struct quad_pipeline *qp)
+{
+   if (qp->shade)
+      qp->shade->destroy( qp->shade );
+
+   if (qp->depth_test)
+      qp->depth_test->destroy( qp->depth_test );
+
+   if (qp->blend)
+      qp->blend->destroy( qp->blend );
+
+   if (qp->pstipple)
+      qp->pstipple->destroy( qp->pstipple );
+
+   if (qp->fused)
+      qp->fused->destroy( qp->fused );
+
+   memset(qp, 0, sizeof *qp);
+}
+
+
+/**
+ * Link the stages of \p qp for the current state.  Common states are
+ * handled by the fused stage alone.
+ */
+void
+sp_link_quad_pipeline(struct softpipe_context *sp, struct quad_pipeline *qp)
 {
-   boolean early_depth_test =
+   boolean early_depth_test;
+
+   qp->path = sp_choose_fused_quad_stage(qp->fused);
+   if (qp->path) {
+      qp->first = qp->fused;
+      return;
+   }
+
+   qp->path = &generic_path;
+
+   early_depth_test =
       sp->depth_stencil->depth.enabled &&
       sp->framebuffer.zsbuf &&
       !sp->depth_stencil->alpha.enabled &&
@@ -50,20 +124,26 @@ sp_build_quad_pipeline(struct softpipe_context *sp)
       !sp->fs_variant->info.writes_z &&
       !sp->fs_variant->info.writes_stencil;
 
-   sp->quad.first = sp->quad.blend;
+   qp->first = qp->blend;
 
    if (early_depth_test) {
-      insert_stage_at_head( sp, sp->quad.shade );
-      insert_stage_at_head( sp, sp->quad.depth_test );
+      insert_stage_at_head( qp, qp->shade );
+      insert_stage_at_head( qp, qp->depth_test );
    }
    else {
-      insert_stage_at_head( sp, sp->quad.depth_test );
-      insert_stage_at_head( sp, sp->quad.shade );
+      insert_stage_at_head( qp, qp->depth_test );
+      insert_stage_at_head( qp, qp->shade );
    }
 
 #if !DO_PSTIPPLE_IN_DRAW_MODULE && !DO_PSTIPPLE_IN_HELPER_MODULE
    if (sp->rasterizer->poly_stipple_enable)
-      insert_stage_at_head( sp, sp->quad.pstipple );
+      insert_stage_at_head( qp, qp->pstipple );
 #endif
 }
 
+
+void
+sp_build_quad_pipeline(struct softpipe_context *sp)
+{
+   sp_link_quad_pipeline(sp, &sp->quad);
+}
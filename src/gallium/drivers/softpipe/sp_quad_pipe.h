@@ -32,8 +32,27 @@
 #define SP_QUAD_PIPE_H
 
 
+#include "pipe/p_compiler.h"
+
+
 struct softpipe_context;
 struct quad_header;
+struct tgsi_exec_machine;
+struct tgsi_sampler;
+struct util_instr_counter;
+
+
+/**
+ * The things a quad pipeline modifies besides the render targets.  The
+ * context's own pipeline uses the context's fragment machine, samplers
+ * and occlusion counter; each rasterizer thread (see sp_rast.c) has its
+ * own.
+ */
+struct quad_thread_state {
+   struct tgsi_exec_machine *machine;
+   struct tgsi_sampler **samplers;   /**< fragment samplers */
+   uint64_t *occlusion_count;
+};
 
 
 /**
@@ -43,6 +62,7 @@ struct quad_header;
  */
 struct quad_stage {
    struct softpipe_context *softpipe;
+   struct quad_thread_state *thread;
 
    struct quad_stage *next;
 
@@ -66,6 +86,30 @@ struct quad_stage *sp_quad_coverage_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_colormask_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
+struct quad_stage *sp_quad_fused_stage( struct softpipe_context *softpipe );
+
+struct util_instr_counter *sp_choose_fused_quad_stage(struct quad_stage *qs);
+
+
+/**
+ * The stages which get linked into a pipeline.
+ */
+struct quad_pipeline {
+   struct quad_stage *shade;
+   struct quad_stage *depth_test;
+   struct quad_stage *blend;
+   struct quad_stage *pstipple;
+   struct quad_stage *fused;  /**< all of the above, for common states */
+   struct quad_stage *first; /**< points to one of the above stages */
+   struct util_instr_counter *path;  /**< counts the draws using 'first' */
+};
+
+boolean sp_create_quad_pipeline(struct softpipe_context *sp,
+                                struct quad_pipeline *qp,
+                                struct quad_thread_state *thread);
+void sp_destroy_quad_pipeline(struct quad_pipeline *qp);
+void sp_link_quad_pipeline(struct softpipe_context *sp,
+                           struct quad_pipeline *qp);
 
 void sp_build_quad_pipeline(struct softpipe_context *sp);
 
@@ -0,0 +1,593 @@
+/**************************************************************************
+ *
+ * Copyright 2013 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * Threaded quad processing.
+ *
+ * Setup bins each batch of quads by tile row: tile row y goes to thread
+ * y % num_threads, which also owns band y % num_threads of the surface
+ * tile caches (see softpipe_tile_band), so no two threads ever touch the
+ * same cached tile.  When the batch of primitives ends each thread runs
+ * the quads of its bin in the order setup produced them, through its own
+ * quad stages, shader machine and texture caches.  Blending, depth and
+ * stencil only depend on earlier quads at the same pixel, and cached
+ * tiles in the surface format are written back unchanged whenever they
+ * are evicted, so the result is the same as when the quads are run in
+ * place.  Color tiles held as floats are rounded when written back, so
+ * while such a color buffer is bound the quads are run in place.
+ *
+ * Thread 0 is the calling thread, the others are spawned.
+ */
+
+
+#include "os/os_thread.h"
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_exec.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "sp_context.h"
+#include "sp_quad.h"
+#include "sp_quad_pipe.h"
+#include "sp_rast.h"
+#include "sp_state.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_texture.h"
+#include "sp_tile_cache.h"
+
+
+/** Process the bins early when one of them gets this many quads */
+#define MAX_BINNED_QUADS (64 * 1024)
+
+
+/**
+ * A batch of quads of one primitive, all in the same tile.
+ */
+struct sp_rast_batch
+{
+   unsigned coefs;   /**< posCoef index in sp_rast::coefs, coef[] follows */
+   unsigned first;   /**< first quad in sp_rast_thread::quads */
+   unsigned nr;
+};
+
+
+/**
+ * The parts of a quad_header which setup fills in.
+ */
+struct sp_rast_quad
+{
+   struct quad_header_input input;
+   unsigned mask;
+};
+
+
+struct sp_rast_thread
+{
+   struct sp_rast *rast;
+
+   pipe_thread thread;
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+
+   struct quad_pipeline quad;
+   struct quad_thread_state state;
+   struct tgsi_exec_machine *machine;
+   uint64_t occlusion_count;
+
+   /** Copies of the context's fragment samplers, using our texture caches */
+   struct sp_sampler_variant samplers[PIPE_MAX_SAMPLERS];
+   struct tgsi_sampler *sampler_list[PIPE_MAX_SAMPLERS];
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SAMPLERS];
+
+   /** The bin */
+   struct sp_rast_batch *batches;
+   unsigned num_batches, max_batches;
+   struct sp_rast_quad *quads;
+   unsigned num_quads, max_quads;
+
+   /** Quads being passed to the pipeline */
+   struct quad_header quad_headers[MAX_QUADS];
+   struct quad_header *quad_ptrs[MAX_QUADS];
+};
+
+
+struct sp_rast
+{
+   struct softpipe_context *softpipe;
+
+   unsigned num_threads;
+   struct sp_rast_thread *threads[SP_MAX_THREADS];
+   boolean exit_flag;
+
+   /** Interpolation coefficients of the binned primitives */
+   struct tgsi_interp_coef *coefs;
+   unsigned num_coefs, max_coefs;
+   unsigned coefs_per_prim;   /**< posCoef plus one per shader input */
+   int cur_coefs;             /**< current primitive's coefs, or -1 */
+};
+
+
+/**
+ * Make room for \p needed elements.
+ */
+static boolean
+grow_array(void **array, unsigned *max, unsigned needed, size_t size)
+{
+   unsigned new_max = MAX2(*max, 64);
+   void *new_array;
+
+   if (needed <= *max)
+      return TRUE;
+
+   while (new_max < needed)
+      new_max *= 2;
+
+   new_array = REALLOC(*array, *max * size, new_max * size);
+   if (!new_array)
+      return FALSE;
+
+   *array = new_array;
+   *max = new_max;
+   return TRUE;
+}
+
+
+/**
+ * Run the quads of a thread's bin through its pipeline.
+ */
+static void
+rasterize_bin(struct sp_rast_thread *thread)
+{
+   const struct tgsi_interp_coef *coefs = thread->rast->coefs;
+   struct quad_stage *first = thread->quad.first;
+   unsigned b, i;
+
+   for (b = 0; b < thread->num_batches; b++) {
+      const struct sp_rast_batch *batch = &thread->batches[b];
+      const struct sp_rast_quad *quad = &thread->quads[batch->first];
+
+      for (i = 0; i < batch->nr; i++) {
+         struct quad_header *header = &thread->quad_headers[i];
+
+         header->input = quad[i].input;
+         header->inout.mask = quad[i].mask;
+         header->posCoef = &coefs[batch->coefs];
+         header->coef = &coefs[batch->coefs + 1];
+         thread->quad_ptrs[i] = header;
+      }
+
+      first->run(first, thread->quad_ptrs, batch->nr);
+   }
+}
+
+
+/**
+ * This is the thread's main entrypoint.
+ * It's a simple loop:
+ *   1. wait for work
+ *   2. do work
+ *   3. signal that we're done
+ */
+static PIPE_THREAD_ROUTINE( thread_function, init_data )
+{
+   struct sp_rast_thread *thread = (struct sp_rast_thread *) init_data;
+   struct sp_rast *rast = thread->rast;
+
+   while (1) {
+      pipe_semaphore_wait(&thread->work_ready);
+
+      if (rast->exit_flag)
+         break;
+
+      rasterize_bin(thread);
+
+      pipe_semaphore_signal(&thread->work_done);
+   }
+
+   return NULL;
+}
+
+
+/**
+ * Point a thread's copy of a fragment sampler at the thread's texture
+ * cache for the unit.
+ */
+static boolean
+bind_sampler(struct sp_rast_thread *thread, unsigned unit, boolean used)
+{
+   struct softpipe_context *softpipe = thread->rast->softpipe;
+   struct sp_sampler_variant *samp =
+      softpipe->tgsi.samplers_list[PIPE_SHADER_FRAGMENT][unit];
+   struct softpipe_tex_tile_cache *tc;
+
+   thread->sampler_list[unit] = NULL;
+
+   if (!used || !samp || !softpipe->samplers[PIPE_SHADER_FRAGMENT][unit])
+      return TRUE;
+
+   tc = thread->tex_cache[unit];
+   if (!tc) {
+      tc = sp_create_tex_tile_cache(&softpipe->pipe);
+      if (!tc)
+         return FALSE;
+      thread->tex_cache[unit] = tc;
+   }
+
+   sp_tex_tile_cache_set_sampler_view(tc,
+      softpipe->sampler_views[PIPE_SHADER_FRAGMENT][unit]);
+
+   if (tc->texture) {
+      struct softpipe_resource *spt = softpipe_resource(tc->texture);
+      if (spt->timestamp != tc->timestamp) {
+         sp_tex_tile_cache_validate_texture(tc);
+         tc->timestamp = spt->timestamp;
+      }
+   }
+
+   thread->samplers[unit] = *samp;
+   thread->samplers[unit].cache = tc;
+   thread->sampler_list[unit] = &thread->samplers[unit].base;
+
+   return TRUE;
+}
+
+
+/**
+ * Prepare the threads' pipelines for the current state.  Called by setup
+ * before a batch of primitives.
+ * \return FALSE if the quads should be run in place, because a color
+ *         buffer's tiles can't be shared by the threads or because we're
+ *         out of memory
+ */
+boolean
+sp_rast_begin(struct sp_rast *rast)
+{
+   struct softpipe_context *softpipe = rast->softpipe;
+   const struct tgsi_shader_info *info = &softpipe->fs_variant->info;
+   unsigned i, unit;
+
+   /* the binned quads were set up for the previous state */
+   sp_rast_flush(rast);
+
+   /* color tiles held as floats are cached in a single band, see
+    * sp_tile_cache_set_surface()
+    */
+   for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++) {
+      if (softpipe->framebuffer.cbufs[i] &&
+          softpipe->cbuf_cache[i]->num_bands < rast->num_threads)
+         return FALSE;
+   }
+
+   rast->coefs_per_prim = 1 + info->num_inputs;
+   rast->cur_coefs = -1;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct sp_rast_thread *thread = rast->threads[i];
+
+      for (unit = 0; unit < PIPE_MAX_SAMPLERS; unit++) {
+         boolean used = (int) unit <= info->file_max[TGSI_FILE_SAMPLER];
+
+         if (!bind_sampler(thread, unit, used))
+            return FALSE;
+      }
+
+      sp_link_quad_pipeline(softpipe, &thread->quad);
+      thread->quad.first->begin(thread->quad.first);
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Called by setup when the coefficients of the quads it emits change.
+ */
+void
+sp_rast_new_coefs(struct sp_rast *rast)
+{
+   rast->cur_coefs = -1;
+}
+
+
+static boolean
+bin_coefs(struct sp_rast *rast, const struct quad_header *quad)
+{
+   const unsigned n = rast->coefs_per_prim;
+   struct tgsi_interp_coef *coefs;
+
+   if (!grow_array((void **) &rast->coefs, &rast->max_coefs,
+                   rast->num_coefs + n, sizeof *rast->coefs))
+      return FALSE;
+
+   coefs = &rast->coefs[rast->num_coefs];
+   coefs[0] = *quad->posCoef;
+   memcpy(&coefs[1], quad->coef, (n - 1) * sizeof *coefs);
+
+   rast->cur_coefs = rast->num_coefs;
+   rast->num_coefs += n;
+   return TRUE;
+}
+
+
+static boolean
+bin_batch(struct sp_rast *rast, struct sp_rast_thread *thread,
+          struct quad_header *quads[], unsigned nr)
+{
+   struct sp_rast_batch *batch;
+   unsigned i;
+
+   if (rast->cur_coefs < 0 && !bin_coefs(rast, quads[0]))
+      return FALSE;
+
+   if (!grow_array((void **) &thread->batches, &thread->max_batches,
+                   thread->num_batches + 1, sizeof *thread->batches) ||
+       !grow_array((void **) &thread->quads, &thread->max_quads,
+                   thread->num_quads + nr, sizeof *thread->quads))
+      return FALSE;
+
+   batch = &thread->batches[thread->num_batches++];
+   batch->coefs = rast->cur_coefs;
+   batch->first = thread->num_quads;
+   batch->nr = nr;
+
+   for (i = 0; i < nr; i++) {
+      struct sp_rast_quad *quad = &thread->quads[thread->num_quads++];
+
+      quad->input = quads[i]->input;
+      quad->mask = quads[i]->inout.mask;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Bin a batch of quads.  All quads must be in the same tile, as setup's
+ * batches are.
+ */
+void
+sp_rast_bin_quads(struct sp_rast *rast,
+                  struct quad_header *quads[],
+                  unsigned nr)
+{
+   const unsigned row = (unsigned) quads[0]->input.y0 / TILE_SIZE;
+   struct sp_rast_thread *thread = rast->threads[row % rast->num_threads];
+
+   assert(nr <= MAX_QUADS);
+
+   if (thread->num_quads + nr > MAX_BINNED_QUADS)
+      sp_rast_flush(rast);
+
+   if (bin_batch(rast, thread, quads, nr))
+      return;
+
+   /* Out of memory.  Process what was binned so far and retry, and if
+    * that doesn't help either, run the batch here.  Any thread's pipeline
+    * may be used while the others are idle.
+    */
+   sp_rast_flush(rast);
+
+   if (!bin_batch(rast, thread, quads, nr)) {
+      struct sp_rast_thread *thread0 = rast->threads[0];
+
+      thread0->quad.first->run(thread0->quad.first, quads, nr);
+
+      rast->softpipe->occlusion_count += thread0->occlusion_count;
+      thread0->occlusion_count = 0;
+   }
+}
+
+
+/**
+ * Process all binned quads and wait for the threads to finish.
+ */
+void
+sp_rast_flush(struct sp_rast *rast)
+{
+   struct softpipe_context *softpipe = rast->softpipe;
+   unsigned i;
+
+   /* the first batch always bins coefficients */
+   if (rast->num_coefs == 0)
+      return;
+
+   for (i = 1; i < rast->num_threads; i++) {
+      if (rast->threads[i]->num_batches)
+         pipe_semaphore_signal(&rast->threads[i]->work_ready);
+   }
+
+   rasterize_bin(rast->threads[0]);
+
+   for (i = 1; i < rast->num_threads; i++) {
+      if (rast->threads[i]->num_batches)
+         pipe_semaphore_wait(&rast->threads[i]->work_done);
+   }
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct sp_rast_thread *thread = rast->threads[i];
+
+      softpipe->occlusion_count += thread->occlusion_count;
+      thread->occlusion_count = 0;
+      thread->num_batches = 0;
+      thread->num_quads = 0;
+   }
+
+   rast->num_coefs = 0;
+   rast->cur_coefs = -1;
+}
+
+
+/**
+ * Drop the threads' cached texture tiles, see SP_FLUSH_TEXTURE_CACHE.
+ */
+void
+sp_rast_flush_tex_caches(struct sp_rast *rast)
+{
+   unsigned i, unit;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      for (unit = 0; unit < PIPE_MAX_SAMPLERS; unit++) {
+         if (rast->threads[i]->tex_cache[unit])
+            sp_flush_tex_tile_cache(rast->threads[i]->tex_cache[unit]);
+      }
+   }
+}
+
+
+/**
+ * Called when a fragment shader is deleted, so that a new shader at the
+ * same address isn't mistaken for the bound one.
+ */
+void
+sp_rast_unbind_shader(struct sp_rast *rast, const struct tgsi_token *tokens)
+{
+   unsigned i;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct tgsi_exec_machine *machine = rast->threads[i]->machine;
+
+      if (machine->Tokens == tokens)
+         tgsi_exec_machine_bind_shader(machine, NULL, 0, NULL);
+   }
+}
+
+
+static void
+destroy_thread_data(struct sp_rast_thread *thread)
+{
+   unsigned unit;
+
+   sp_destroy_quad_pipeline(&thread->quad);
+
+   if (thread->machine)
+      tgsi_exec_machine_destroy(thread->machine);
+
+   for (unit = 0; unit < PIPE_MAX_SAMPLERS; unit++) {
+      if (thread->tex_cache[unit]) {
+         sp_tex_tile_cache_set_sampler_view(thread->tex_cache[unit], NULL);
+         sp_destroy_tex_tile_cache(thread->tex_cache[unit]);
+      }
+   }
+
+   FREE(thread->batches);
+   FREE(thread->quads);
+   FREE(thread);
+}
+
+
+/**
+ * Create the rasterizer threads.
+ * \param num_threads  number of threads including the calling one, at
+ *                     least two and at most SP_MAX_THREADS
+ */
+struct sp_rast *
+sp_rast_create(struct softpipe_context *softpipe, unsigned num_threads)
+{
+   struct sp_rast *rast;
+   unsigned i;
+
+   assert(num_threads >= 2 && num_threads <= SP_MAX_THREADS);
+
+   rast = CALLOC_STRUCT(sp_rast);
+   if (!rast)
+      return NULL;
+
+   rast->softpipe = softpipe;
+   rast->num_threads = num_threads;
+   rast->cur_coefs = -1;
+
+   for (i = 0; i < num_threads; i++) {
+      struct sp_rast_thread *thread = CALLOC_STRUCT(sp_rast_thread);
+      if (!thread)
+         goto fail;
+
+      rast->threads[i] = thread;
+      thread->rast = rast;
+
+      thread->machine = tgsi_exec_machine_create();
+      if (!thread->machine)
+         goto fail;
+
+      thread->state.machine = thread->machine;
+      thread->state.samplers = thread->sampler_list;
+      thread->state.occlusion_count = &thread->occlusion_count;
+
+      if (!sp_create_quad_pipeline(softpipe, &thread->quad, &thread->state))
+         goto fail;
+   }
+
+   /* thread 0 is the calling thread */
+   for (i = 1; i < num_threads; i++) {
+      struct sp_rast_thread *thread = rast->threads[i];
+
+      pipe_semaphore_init(&thread->work_ready, 0);
+      pipe_semaphore_init(&thread->work_done, 0);
+      thread->thread = pipe_thread_create(thread_function, (void *) thread);
+   }
+
+   return rast;
+
+fail:
+   for (i = 0; i < num_threads; i++) {
+      if (rast->threads[i])
+         destroy_thread_data(rast->threads[i]);
+   }
+   FREE(rast);
+   return NULL;
+}
+
+
+void
+sp_rast_destroy(struct sp_rast *rast)
+{
+   unsigned i;
+
+   /* Set exit_flag and signal each thread's work_ready semaphore.
+    * Each thread will be woken up, notice that the exit_flag is set and
+    * break out of its main loop.
+    */
+   rast->exit_flag = TRUE;
+   for (i = 1; i < rast->num_threads; i++) {
+      pipe_semaphore_signal(&rast->threads[i]->work_ready);
+   }
+
+   for (i = 1; i < rast->num_threads; i++) {
+      struct sp_rast_thread *thread = rast->threads[i];
+
+      pipe_thread_wait(thread->thread);
+      pipe_semaphore_destroy(&thread->work_ready);
+      pipe_semaphore_destroy(&thread->work_done);
+   }
+
+   for (i = 0; i < rast->num_threads; i++) {
+      destroy_thread_data(rast->threads[i]);
+   }
+
+   FREE(rast->coefs);
+   FREE(rast);
+}
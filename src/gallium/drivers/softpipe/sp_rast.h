@@ -0,0 +1,77 @@
+/**************************************************************************
+ *
+ * Copyright 2013 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * Threaded quad processing.
+ *
+ * Setup bins each batch of quads by the tile row it falls in and the
+ * bins are processed by the rasterizer threads when the batch of
+ * primitives ends.  See sp_rast.c.
+ */
+
+#ifndef SP_RAST_H
+#define SP_RAST_H
+
+
+#include "pipe/p_compiler.h"
+
+
+struct softpipe_context;
+struct quad_header;
+struct tgsi_token;
+struct sp_rast;
+
+
+struct sp_rast *
+sp_rast_create(struct softpipe_context *softpipe, unsigned num_threads);
+
+void
+sp_rast_destroy(struct sp_rast *rast);
+
+boolean
+sp_rast_begin(struct sp_rast *rast);
+
+void
+sp_rast_new_coefs(struct sp_rast *rast);
+
+void
+sp_rast_bin_quads(struct sp_rast *rast,
+                  struct quad_header *quads[],
+                  unsigned nr);
+
+void
+sp_rast_flush(struct sp_rast *rast);
+
+void
+sp_rast_flush_tex_caches(struct sp_rast *rast);
+
+void
+sp_rast_unbind_shader(struct sp_rast *rast, const struct tgsi_token *tokens);
+
+
+#endif /* SP_RAST_H */
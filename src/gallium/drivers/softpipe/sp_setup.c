@@ -35,6 +35,7 @@
 #include "sp_context.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
+#include "sp_rast.h"
 #include "sp_setup.h"
 #include "sp_state.h"
 #include "draw/draw_context.h"
@@ -60,20 +61,13 @@ struct edge {
 };
 
 
-/**
- * Max number of quads (2x2 pixel blocks) to process per batch.
- * This can't be arbitrarily increased since we depend on some 32-bit
- * bitmasks (two bits per quad).
- */
-#define MAX_QUADS 16
-
-
 /**
  * Triangle setup info.
  * Also used for line drawing (taking some liberties).
  */
 struct setup_context {
    struct softpipe_context *softpipe;
+   struct sp_rast *rast;  /**< bins quads, or NULL to run them in place */
 
    /* Vertices are just an array of floats making up each attribute in
     * turn.  Currently fixed at 4 floats, but should change in time.
@@ -152,6 +146,33 @@ quad_clip(struct setup_context *setup, struct quad_header *quad)
 }
 
 
+/**
+ * Pass a batch of quads to the quad pipeline, or bin it for the
+ * rasterizer threads.  All quads of a batch are in the same tile.
+ */
+static INLINE void
+run_quads(struct setup_context *setup, struct quad_header *quads[], unsigned nr)
+{
+   struct softpipe_context *sp = setup->softpipe;
+
+   if (setup->rast)
+      sp_rast_bin_quads( setup->rast, quads, nr );
+   else
+      sp->quad.first->run( sp->quad.first, quads, nr );
+}
+
+
+/**
+ * Tell the rasterizer threads that setup->coef[] and posCoef changed.
+ */
+static INLINE void
+coefs_changed(struct setup_context *setup)
+{
+   if (setup->rast)
+      sp_rast_new_coefs( setup->rast );
+}
+
+
 /**
  * Emit a quad (pass to next stage) with clipping.
  */
@@ -161,13 +182,11 @@ clip_emit_quad(struct setup_context *setup, struct quad_header *quad)
    quad_clip( setup, quad );
 
    if (quad->inout.mask) {
-      struct softpipe_context *sp = setup->softpipe;
-
 #if DEBUG_FRAGS
       setup->numFragsEmitted += util_bitcount(quad->inout.mask);
 #endif
 
-      sp->quad.first->run( sp->quad.first, &quad, 1 );
+      run_quads( setup, &quad, 1 );
    }
 }
 
@@ -202,7 +221,6 @@ flush_spans(struct setup_context *setup)
    const int xleft1 = setup->span.left[1];
    const int xright0 = setup->span.right[0];
    const int xright1 = setup->span.right[1];
-   struct quad_stage *pipe = setup->softpipe->quad.first;
 
    const int minleft = block_x(MIN2(xleft0, xleft1));
    const int maxright = MAX2(xright0, xright1);
@@ -247,7 +265,7 @@ flush_spans(struct setup_context *setup)
             lx += 2;
          } while (mask0 | mask1);
 
-         pipe->run( pipe, setup->quad_ptrs, q );
+         run_quads( setup, setup->quad_ptrs, q );
       }
    }
 
@@ -669,6 +687,8 @@ setup_tri_coefficients(struct setup_context *setup)
          setup->coef[fragSlot].dady[0] = 0.0;
       }
    }
+
+   coefs_changed(setup);
 }
 
 
@@ -1023,6 +1043,8 @@ setup_line_coefficients(struct setup_context *setup,
          setup->coef[fragSlot].dady[0] = 0.0;
       }
    }
+
+   coefs_changed(setup);
    return TRUE;
 }
 
@@ -1271,6 +1293,7 @@ sp_setup_point(struct setup_context *setup,
       }
    }
 
+   coefs_changed(setup);
 
    if (halfSize <= 0.5 && !round) {
       /* special case for 1-pixel points */
@@ -1410,7 +1433,16 @@ sp_setup_prepare(struct setup_context *setup)
    /* Note: nr_attrs is only used for debugging (vertex printing) */
    setup->nr_vertex_attrs = draw_num_shader_outputs(sp->draw);
 
-   sp->quad.first->begin( sp->quad.first );
+   /* Fall back to running quads in place if the rasterizer threads
+    * can't be set up for this state.
+    */
+   if (sp->rast && sp_rast_begin( sp->rast ))
+      setup->rast = sp->rast;
+   else
+      setup->rast = NULL;
+
+   if (!setup->rast)
+      sp->quad.first->begin( sp->quad.first );
 
    if (sp->reduced_api_prim == PIPE_PRIM_TRIANGLES &&
        sp->rasterizer->fill_front == PIPE_POLYGON_MODE_FILL &&
@@ -1425,6 +1457,18 @@ sp_setup_prepare(struct setup_context *setup)
 }
 
 
+/**
+ * Called by vbuf code after a batch of primitives.  Waits until the
+ * rasterizer threads, if any, have processed all quads.
+ */
+void
+sp_setup_flush(struct setup_context *setup)
+{
+   if (setup->rast)
+      sp_rast_flush( setup->rast );
+}
+
+
 void
 sp_setup_destroy_context(struct setup_context *setup)
 {
@@ -371,6 +371,7 @@ softpipe_update_derived(struct softpipe_context *softpipe, unsigned prim)
    if (softpipe->dirty & (SP_NEW_BLEND |
                           SP_NEW_DEPTH_STENCIL_ALPHA |
                           SP_NEW_FRAMEBUFFER |
+                          SP_NEW_RASTERIZER |
                           SP_NEW_FS))
       sp_build_quad_pipeline(softpipe);
 
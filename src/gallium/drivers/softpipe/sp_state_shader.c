@@ -28,6 +28,7 @@
 #include "sp_context.h"
 #include "sp_state.h"
 #include "sp_fs.h"
+#include "sp_rast.h"
 #include "sp_texture.h"
 
 #include "pipe/p_defines.h"
@@ -189,6 +190,9 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
       tgsi_exec_machine_bind_shader(softpipe->fs_machine, NULL, 0, NULL);
    }
 
+   if (softpipe->rast)
+      sp_rast_unbind_shader(softpipe->rast, state->shader.tokens);
+
    /* delete variants */
    for (var = state->variants; var; var = next_var) {
       next_var = var->next;
@@ -44,6 +44,10 @@
 #include "sp_tex_sample.h"
 #include "sp_tex_tile_cache.h"
 
+#if defined(PIPE_ARCH_SSE)
+#include <emmintrin.h>
+#endif
+
 
 /** Set to one to help debug texture sampling */
 #define DEBUG_TEX 0
@@ -1453,6 +1457,390 @@ img_filter_2d_linear(struct tgsi_sampler *tgsi_sampler,
 }
 
 
+#if defined(PIPE_ARCH_SSE)
+
+/*
+ * Quad versions of the 2D image filters.
+ *
+ * These compute the texel coordinates and weights of all four pixels of a
+ * quad at once with SSE2, and fetch all the texels from a single cached
+ * tile when the quad's footprint fits in one.  Otherwise they do exactly
+ * what the per-pixel filters do, so the results are identical.
+ *
+ * They only support the REPEAT and CLAMP_TO_EDGE wrap modes, whose texel
+ * coordinates are always inside the image.  They return FALSE, and leave
+ * it to the caller to sample the pixels one at a time, if the texcoords
+ * are outside the range in which their arithmetic matches the per-pixel
+ * filters.
+ */
+
+
+/**
+ * util_ifloor() of four floats.  This uses the same double precision
+ * trick, which isn't quite floor() for small negative values.
+ */
+static INLINE __m128i
+ifloor_4(__m128 f)
+{
+   const __m128d k = _mm_set1_pd((3 << 22) + 0.5);
+   const __m128d lo = _mm_cvtps_pd(f);
+   const __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+   const __m128 af = _mm_movelh_ps(_mm_cvtpd_ps(_mm_add_pd(k, lo)),
+                                   _mm_cvtpd_ps(_mm_add_pd(k, hi)));
+   const __m128 bf = _mm_movelh_ps(_mm_cvtpd_ps(_mm_sub_pd(k, lo)),
+                                   _mm_cvtpd_ps(_mm_sub_pd(k, hi)));
+   return _mm_srai_epi32(_mm_sub_epi32(_mm_castps_si128(af),
+                                       _mm_castps_si128(bf)), 1);
+}
+
+
+/**
+ * floorf() of four floats with |f| < 2^31.
+ */
+static INLINE __m128
+floor_4(__m128 f)
+{
+   const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(f));
+   const __m128 sign = _mm_and_ps(f, _mm_set1_ps(-0.0f));
+   /* truncation rounds negative values up, and loses the sign of -0.0 */
+   return _mm_or_ps(_mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, f),
+                                             _mm_set1_ps(1.0f))),
+                    sign);
+}
+
+
+/**
+ * Are all four values within +/- 2^22?  False for NaNs, too.
+ */
+static INLINE boolean
+in_range_4(__m128 f)
+{
+   const __m128 absf = _mm_andnot_ps(_mm_set1_ps(-0.0f), f);
+   return _mm_movemask_ps(_mm_cmplt_ps(absf,
+                                       _mm_set1_ps((float) (1 << 22)))) == 0xf;
+}
+
+
+/**
+ * repeat() of four integer texcoords, which must be within
+ * [-size * 1024, 2^22).
+ */
+static INLINE __m128i
+repeat_4(__m128i coord, unsigned size)
+{
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 fsize = _mm_set1_ps((float) size);
+   const __m128 c = _mm_cvtepi32_ps(coord);
+   const __m128 q = floor_4(_mm_mul_ps(c, _mm_set1_ps(1.0f / size)));
+   __m128 r = _mm_sub_ps(c, _mm_mul_ps(q, fsize));
+
+   /* the quotient may be off by one */
+   r = _mm_add_ps(r, _mm_and_ps(_mm_cmplt_ps(r, zero), fsize));
+   r = _mm_sub_ps(r, _mm_and_ps(_mm_cmpge_ps(r, fsize), fsize));
+
+   return _mm_cvttps_epi32(r);
+}
+
+
+/**
+ * Is any of the four integer texcoords outside of [min, max]?
+ */
+static INLINE boolean
+any_outside_4(__m128i coord, int min, int max)
+{
+   const __m128i below = _mm_cmplt_epi32(coord, _mm_set1_epi32(min));
+   const __m128i above = _mm_cmpgt_epi32(coord, _mm_set1_epi32(max));
+   return _mm_movemask_epi8(_mm_or_si128(below, above)) != 0;
+}
+
+
+/**
+ * Four-wide wrap_nearest_repeat() / wrap_nearest_clamp_to_edge().
+ */
+static INLINE boolean
+wrap_nearest_quad(unsigned wrap, __m128 s, unsigned size, __m128i *icoord)
+{
+   const __m128i i = ifloor_4(_mm_mul_ps(s, _mm_set1_ps((float) size)));
+
+   if (wrap == PIPE_TEX_WRAP_REPEAT) {
+      if (any_outside_4(i, -(int) (size * 1024), (1 << 22) - 1))
+         return FALSE;
+      *icoord = repeat_4(i, size);
+   }
+   else {
+      const float min = 1.0F / (2.0F * size);
+      const float max = 1.0F - min;
+      const __m128i below = _mm_castps_si128(_mm_cmplt_ps(s, _mm_set1_ps(min)));
+      const __m128i above = _mm_castps_si128(_mm_cmpgt_ps(s, _mm_set1_ps(max)));
+      const __m128i last = _mm_andnot_si128(below, above);
+
+      *icoord = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(below, last), i),
+                             _mm_and_si128(last, _mm_set1_epi32(size - 1)));
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Four-wide wrap_linear_repeat() / wrap_linear_clamp_to_edge().
+ * If 'pot' is set the weights are computed the way
+ * img_filter_2d_linear_repeat_POT() does.
+ */
+static INLINE boolean
+wrap_linear_quad(unsigned wrap, boolean pot, __m128 s, unsigned size,
+                 __m128i *icoord0, __m128i *icoord1, __m128 *w)
+{
+   const __m128i one = _mm_set1_epi32(1);
+   const __m128i isize = _mm_set1_epi32(size);
+   __m128 u;
+   __m128i i0, i1;
+
+   if (wrap == PIPE_TEX_WRAP_CLAMP_TO_EDGE) {
+      /* CLAMP(s, 0, 1), but NaNs are passed through to fail the range check */
+      s = _mm_min_ps(_mm_set1_ps(1.0f), _mm_max_ps(_mm_setzero_ps(), s));
+   }
+
+   u = _mm_sub_ps(_mm_mul_ps(s, _mm_set1_ps((float) size)),
+                  _mm_set1_ps(0.5f));
+   if (!in_range_4(u))
+      return FALSE;
+
+   i0 = ifloor_4(u);
+   if (pot)
+      *w = _mm_sub_ps(u, _mm_cvtepi32_ps(i0));
+   else
+      *w = _mm_sub_ps(u, floor_4(u));
+
+   if (wrap == PIPE_TEX_WRAP_REPEAT) {
+      if (any_outside_4(i0, -(int) (size * 1024), 1 << 22))
+         return FALSE;
+      i0 = repeat_4(i0, size);
+      i1 = _mm_add_epi32(i0, one);
+      i1 = _mm_andnot_si128(_mm_cmpeq_epi32(i1, isize), i1);
+   }
+   else {
+      const __m128i max = _mm_sub_epi32(isize, one);
+      __m128i over;
+
+      i1 = _mm_add_epi32(i0, one);
+      i0 = _mm_andnot_si128(_mm_cmplt_epi32(i0, _mm_setzero_si128()), i0);
+      over = _mm_cmpgt_epi32(i1, max);
+      i1 = _mm_or_si128(_mm_andnot_si128(over, i1), _mm_and_si128(over, max));
+   }
+
+   *icoord0 = i0;
+   *icoord1 = i1;
+   return TRUE;
+}
+
+
+/**
+ * Are the texels at all the given coordinates in the same tile as the
+ * first one?
+ */
+static INLINE boolean
+same_tile_4(__m128i x0, __m128i x1, __m128i y0, __m128i y1)
+{
+   const __m128i tx0 = _mm_srli_epi32(x0, TILE_SIZE_LOG2);
+   const __m128i ty0 = _mm_srli_epi32(y0, TILE_SIZE_LOG2);
+   const __m128i tx = _mm_shuffle_epi32(tx0, 0);
+   const __m128i ty = _mm_shuffle_epi32(ty0, 0);
+   __m128i same;
+
+   same = _mm_and_si128(_mm_cmpeq_epi32(tx0, tx), _mm_cmpeq_epi32(ty0, ty));
+   same = _mm_and_si128(same, _mm_cmpeq_epi32(_mm_srli_epi32(x1, TILE_SIZE_LOG2), tx));
+   same = _mm_and_si128(same, _mm_cmpeq_epi32(_mm_srli_epi32(y1, TILE_SIZE_LOG2), ty));
+
+   return _mm_movemask_epi8(same) == 0xffff;
+}
+
+
+/**
+ * Look up the tile holding texel (x, y).
+ */
+static INLINE const struct softpipe_tex_cached_tile *
+get_tile_2d(const struct sp_sampler_variant *samp,
+            union tex_tile_address addr, int x, int y)
+{
+   addr.bits.x = x / TILE_SIZE;
+   addr.bits.y = y / TILE_SIZE;
+
+   return sp_get_cached_tile_tex(samp->cache, addr);
+}
+
+
+/**
+ * Write four texels or filtered colors, one per pixel, in SoA order.
+ */
+static INLINE void
+store_rgba_quad(__m128 c0, __m128 c1, __m128 c2, __m128 c3,
+                float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+   _mm_storeu_ps(rgba[0], c0);
+   _mm_storeu_ps(rgba[1], c1);
+   _mm_storeu_ps(rgba[2], c2);
+   _mm_storeu_ps(rgba[3], c3);
+}
+
+
+static INLINE __m128
+lerp_4(__m128 a, __m128 v0, __m128 v1)
+{
+   return _mm_add_ps(v0, _mm_mul_ps(a, _mm_sub_ps(v1, v0)));
+}
+
+
+static boolean
+img_filter_2d_nearest_quad(const struct sp_sampler_variant *samp,
+                           const float s[TGSI_QUAD_SIZE],
+                           const float t[TGSI_QUAD_SIZE],
+                           unsigned level,
+                           float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   const struct pipe_resource *texture = samp->view->texture;
+   const unsigned width = u_minify(texture->width0, level);
+   const unsigned height = u_minify(texture->height0, level);
+   union tex_tile_address addr;
+   __m128i x, y;
+   int xi[TGSI_QUAD_SIZE], yi[TGSI_QUAD_SIZE];
+   const float *out[TGSI_QUAD_SIZE];
+   unsigned j;
+
+   if (!wrap_nearest_quad(samp->sampler->wrap_s, _mm_loadu_ps(s), width, &x) ||
+       !wrap_nearest_quad(samp->sampler->wrap_t, _mm_loadu_ps(t), height, &y))
+      return FALSE;
+
+   _mm_storeu_si128((__m128i *) xi, x);
+   _mm_storeu_si128((__m128i *) yi, y);
+
+   addr.value = 0;
+   addr.bits.level = level;
+
+   if (same_tile_4(x, x, y, y)) {
+      const struct softpipe_tex_cached_tile *tile =
+         get_tile_2d(samp, addr, xi[0], yi[0]);
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++)
+         out[j] = &tile->data.color[yi[j] % TILE_SIZE][xi[j] % TILE_SIZE][0];
+   }
+   else {
+      for (j = 0; j < TGSI_QUAD_SIZE; j++)
+         out[j] = get_texel_2d_no_border(samp, addr, xi[j], yi[j]);
+   }
+
+   store_rgba_quad(_mm_loadu_ps(out[0]), _mm_loadu_ps(out[1]),
+                   _mm_loadu_ps(out[2]), _mm_loadu_ps(out[3]), rgba);
+
+   if (DEBUG_TEX) {
+      print_sample_4(__FUNCTION__, rgba);
+   }
+
+   return TRUE;
+}
+
+
+static INLINE boolean
+img_filter_2d_linear_quad_common(const struct sp_sampler_variant *samp,
+                                 boolean pot,
+                                 const float s[TGSI_QUAD_SIZE],
+                                 const float t[TGSI_QUAD_SIZE],
+                                 unsigned level,
+                                 float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   const struct pipe_resource *texture = samp->view->texture;
+   const unsigned width = u_minify(texture->width0, level);
+   const unsigned height = u_minify(texture->height0, level);
+   union tex_tile_address addr;
+   __m128i x0, x1, y0, y1;
+   __m128 xw, yw;
+   int x0i[TGSI_QUAD_SIZE], x1i[TGSI_QUAD_SIZE];
+   int y0i[TGSI_QUAD_SIZE], y1i[TGSI_QUAD_SIZE];
+   float xwf[TGSI_QUAD_SIZE], ywf[TGSI_QUAD_SIZE];
+   const float *tx[TGSI_QUAD_SIZE][4];
+   __m128 c[TGSI_QUAD_SIZE];
+   unsigned j;
+
+   if (!wrap_linear_quad(samp->sampler->wrap_s, pot, _mm_loadu_ps(s), width,
+                         &x0, &x1, &xw) ||
+       !wrap_linear_quad(samp->sampler->wrap_t, pot, _mm_loadu_ps(t), height,
+                         &y0, &y1, &yw))
+      return FALSE;
+
+   _mm_storeu_si128((__m128i *) x0i, x0);
+   _mm_storeu_si128((__m128i *) x1i, x1);
+   _mm_storeu_si128((__m128i *) y0i, y0);
+   _mm_storeu_si128((__m128i *) y1i, y1);
+   _mm_storeu_ps(xwf, xw);
+   _mm_storeu_ps(ywf, yw);
+
+   addr.value = 0;
+   addr.bits.level = level;
+
+   if (same_tile_4(x0, x1, y0, y1)) {
+      const struct softpipe_tex_cached_tile *tile =
+         get_tile_2d(samp, addr, x0i[0], y0i[0]);
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         const unsigned tx0 = x0i[j] % TILE_SIZE, tx1 = x1i[j] % TILE_SIZE;
+         const unsigned ty0 = y0i[j] % TILE_SIZE, ty1 = y1i[j] % TILE_SIZE;
+
+         tx[j][0] = &tile->data.color[ty0][tx0][0];
+         tx[j][1] = &tile->data.color[ty0][tx1][0];
+         tx[j][2] = &tile->data.color[ty1][tx0][0];
+         tx[j][3] = &tile->data.color[ty1][tx1][0];
+      }
+   }
+   else {
+      for (j = 0; j < TGSI_QUAD_SIZE; j++)
+         get_texel_quad_2d_no_border(samp, addr, x0i[j], y0i[j],
+                                     x1i[j], y1i[j], tx[j]);
+   }
+
+   /* interpolate R, G, B, A of each pixel */
+   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+      const float **txj = tx[j];
+      const __m128 a = _mm_set1_ps(xwf[j]);
+      const __m128 temp0 = lerp_4(a, _mm_loadu_ps(txj[0]), _mm_loadu_ps(txj[1]));
+      const __m128 temp1 = lerp_4(a, _mm_loadu_ps(txj[2]), _mm_loadu_ps(txj[3]));
+      c[j] = lerp_4(_mm_set1_ps(ywf[j]), temp0, temp1);
+   }
+
+   store_rgba_quad(c[0], c[1], c[2], c[3], rgba);
+
+   if (DEBUG_TEX) {
+      print_sample_4(__FUNCTION__, rgba);
+   }
+
+   return TRUE;
+}
+
+
+static boolean
+img_filter_2d_linear_quad(const struct sp_sampler_variant *samp,
+                          const float s[TGSI_QUAD_SIZE],
+                          const float t[TGSI_QUAD_SIZE],
+                          unsigned level,
+                          float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   return img_filter_2d_linear_quad_common(samp, FALSE, s, t, level, rgba);
+}
+
+
+static boolean
+img_filter_2d_linear_repeat_POT_quad(const struct sp_sampler_variant *samp,
+                                     const float s[TGSI_QUAD_SIZE],
+                                     const float t[TGSI_QUAD_SIZE],
+                                     unsigned level,
+                                     float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   return img_filter_2d_linear_quad_common(samp, TRUE, s, t, level, rgba);
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+
 static void
 img_filter_2d_array_linear(struct tgsi_sampler *tgsi_sampler,
                            float s,
@@ -1677,6 +2065,31 @@ compute_lod(const struct pipe_sampler_state *sampler,
 }
 
 
+/**
+ * Filter all four pixels of a quad at the same level, with the quad
+ * version of the image filter when there is one.
+ */
+static INLINE void
+img_filter_quad(struct tgsi_sampler *tgsi_sampler,
+                img_filter_func filter,
+                img_filter_quad_func filter_quad,
+                const float s[TGSI_QUAD_SIZE],
+                const float t[TGSI_QUAD_SIZE],
+                const float p[TGSI_QUAD_SIZE],
+                unsigned level,
+                float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   const struct sp_sampler_variant *samp = sp_sampler_variant(tgsi_sampler);
+   int j;
+
+   if (filter_quad && filter_quad(samp, s, t, level, rgba))
+      return;
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++)
+      filter(tgsi_sampler, s[j], t[j], p[j], level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+}
+
+
 static void
 mip_filter_linear(struct tgsi_sampler *tgsi_sampler,
                   const float s[TGSI_QUAD_SIZE],
@@ -1689,7 +2102,7 @@ mip_filter_linear(struct tgsi_sampler *tgsi_sampler,
 {
    struct sp_sampler_variant *samp = sp_sampler_variant(tgsi_sampler);
    const struct pipe_resource *texture = samp->view->texture;
-   int j;
+   int j, level_all = 0;
    float lod[TGSI_QUAD_SIZE];
 
    if (control == tgsi_sampler_lod_bias) {
@@ -1708,25 +2121,65 @@ mip_filter_linear(struct tgsi_sampler *tgsi_sampler,
 
    }
 
+   /* The lod usually is the same for all pixels of the quad, which can
+    * then be filtered together:
+    */
    for (j = 0; j < TGSI_QUAD_SIZE; j++) {
       int level0 = samp->view->u.tex.first_level + (int)lod[j];
+      int level = lod[j] < 0.0 ? -1 :
+                  level0 >= texture->last_level ? -2 : level0;
 
-      if (lod[j] < 0.0)
-         samp->mag_img_filter(tgsi_sampler, s[j], t[j], p[j], samp->view->u.tex.first_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
-
-      else if (level0 >= texture->last_level)
-         samp->min_img_filter(tgsi_sampler, s[j], t[j], p[j], texture->last_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+      if (j == 0)
+         level_all = level;
+      else if (level != level_all)
+         break;
+   }
 
+   if (j == TGSI_QUAD_SIZE) {
+      if (level_all == -1) {
+         img_filter_quad(tgsi_sampler, samp->mag_img_filter, samp->mag_img_filter_quad, s, t, p, samp->view->u.tex.first_level, rgba);
+      }
+      else if (level_all == -2) {
+         img_filter_quad(tgsi_sampler, samp->min_img_filter, samp->min_img_filter_quad, s, t, p, texture->last_level, rgba);
+      }
       else {
-         float levelBlend = frac(lod[j]);
-         float rgbax[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+         float rgbax[2][TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
          int c;
 
-         samp->min_img_filter(tgsi_sampler, s[j], t[j], p[j], level0,   samp->faces[j], tgsi_sampler_lod_bias, &rgbax[0][0]);
-         samp->min_img_filter(tgsi_sampler, s[j], t[j], p[j], level0+1, samp->faces[j], tgsi_sampler_lod_bias, &rgbax[0][1]);
+         img_filter_quad(tgsi_sampler, samp->min_img_filter, samp->min_img_filter_quad, s, t, p, level_all,   rgbax[0]);
+         img_filter_quad(tgsi_sampler, samp->min_img_filter, samp->min_img_filter_quad, s, t, p, level_all+1, rgbax[1]);
+
+         for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+            float levelBlend = frac(lod[j]);
+            for (c = 0; c < 4; c++) {
+               rgba[c][j] = lerp(levelBlend, rgbax[0][c][j], rgbax[1][c][j]);
+            }
+         }
+      }
+   }
+   else {
+      /* Different levels, filter the pixels one at a time:
+       */
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         int level0 = samp->view->u.tex.first_level + (int)lod[j];
 
-         for (c = 0; c < 4; c++) {
-            rgba[c][j] = lerp(levelBlend, rgbax[c][0], rgbax[c][1]);
+         if (lod[j] < 0.0)
+            samp->mag_img_filter(tgsi_sampler, s[j], t[j], p[j], samp->view->u.tex.first_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+
+         else if (level0 >= texture->last_level)
+            samp->min_img_filter(tgsi_sampler, s[j], t[j], p[j], texture->last_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+
+         else {
+            float levelBlend = frac(lod[j]);
+            float rgbax[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+            int c;
+
+            samp->min_img_filter(tgsi_sampler, s[j], t[j], p[j], level0,   samp->faces[j], tgsi_sampler_lod_bias, &rgbax[0][0]);
+            samp->min_img_filter(tgsi_sampler, s[j], t[j], p[j], level0+1, samp->faces[j], tgsi_sampler_lod_bias, &rgbax[0][1]);
+
+            for (c = 0; c < 4; c++) {
+               rgba[c][j] = lerp(levelBlend, rgbax[c][0], rgbax[c][1]);
+            }
          }
       }
    }
@@ -1755,6 +2208,8 @@ mip_filter_nearest(struct tgsi_sampler *tgsi_sampler,
    struct sp_sampler_variant *samp = sp_sampler_variant(tgsi_sampler);
    const struct pipe_resource *texture = samp->view->texture;
    float lod[TGSI_QUAD_SIZE];
+   float level[TGSI_QUAD_SIZE];
+   unsigned mag = 0;
    int j;
 
    if (control == tgsi_sampler_lod_bias) {
@@ -1774,11 +2229,28 @@ mip_filter_nearest(struct tgsi_sampler *tgsi_sampler,
 
    for (j = 0; j < TGSI_QUAD_SIZE; j++) {
       if (lod[j] < 0.0)
-         samp->mag_img_filter(tgsi_sampler, s[j], t[j], p[j], samp->view->u.tex.first_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+         mag |= 1 << j;
       else {
-         float level = samp->view->u.tex.first_level + (int)(lod[j] + 0.5F) ;
-         level = MIN2(level, (int)texture->last_level);
-         samp->min_img_filter(tgsi_sampler, s[j], t[j], p[j], level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+         level[j] = samp->view->u.tex.first_level + (int)(lod[j] + 0.5F) ;
+         level[j] = MIN2(level[j], (int)texture->last_level);
+      }
+   }
+
+   /* Filter the whole quad at once if all pixels use the same level:
+    */
+   if (mag == 0xf) {
+      img_filter_quad(tgsi_sampler, samp->mag_img_filter, samp->mag_img_filter_quad, s, t, p, samp->view->u.tex.first_level, rgba);
+   }
+   else if (mag == 0 &&
+            level[1] == level[0] && level[2] == level[0] && level[3] == level[0]) {
+      img_filter_quad(tgsi_sampler, samp->min_img_filter, samp->min_img_filter_quad, s, t, p, level[0], rgba);
+   }
+   else {
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         if (mag & (1 << j))
+            samp->mag_img_filter(tgsi_sampler, s[j], t[j], p[j], samp->view->u.tex.first_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+         else
+            samp->min_img_filter(tgsi_sampler, s[j], t[j], p[j], level[j], samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
       }
    }
 
@@ -1800,6 +2272,7 @@ mip_filter_none(struct tgsi_sampler *tgsi_sampler,
 {
    struct sp_sampler_variant *samp = sp_sampler_variant(tgsi_sampler);
    float lod[TGSI_QUAD_SIZE];
+   unsigned mag = 0;
    int j;
 
    if (control == tgsi_sampler_lod_bias) {
@@ -1818,11 +2291,24 @@ mip_filter_none(struct tgsi_sampler *tgsi_sampler,
    }
 
    for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-      if (lod[j] < 0.0) { 
-         samp->mag_img_filter(tgsi_sampler, s[j], t[j], p[j], samp->view->u.tex.first_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
-      }
-      else {
-         samp->min_img_filter(tgsi_sampler, s[j], t[j], p[j], samp->view->u.tex.first_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+      if (lod[j] < 0.0)
+         mag |= 1 << j;
+   }
+
+   if (mag == 0xf) {
+      img_filter_quad(tgsi_sampler, samp->mag_img_filter, samp->mag_img_filter_quad, s, t, p, samp->view->u.tex.first_level, rgba);
+   }
+   else if (mag == 0) {
+      img_filter_quad(tgsi_sampler, samp->min_img_filter, samp->min_img_filter_quad, s, t, p, samp->view->u.tex.first_level, rgba);
+   }
+   else {
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         if (mag & (1 << j)) { 
+            samp->mag_img_filter(tgsi_sampler, s[j], t[j], p[j], samp->view->u.tex.first_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+         }
+         else {
+            samp->min_img_filter(tgsi_sampler, s[j], t[j], p[j], samp->view->u.tex.first_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+         }
       }
    }
 }
@@ -1839,10 +2325,8 @@ mip_filter_none_no_filter_select(struct tgsi_sampler *tgsi_sampler,
                                      float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
 {
    struct sp_sampler_variant *samp = sp_sampler_variant(tgsi_sampler);
-   int j;
 
-   for (j = 0; j < TGSI_QUAD_SIZE; j++)
-      samp->mag_img_filter(tgsi_sampler, s[j], t[j], p[j], samp->view->u.tex.first_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+   img_filter_quad(tgsi_sampler, samp->mag_img_filter, samp->mag_img_filter_quad, s, t, p, samp->view->u.tex.first_level, rgba);
 }
 
 
@@ -2175,7 +2659,7 @@ mip_filter_linear_2d_linear_repeat_POT(
 {
    struct sp_sampler_variant *samp = sp_sampler_variant(tgsi_sampler);
    const struct pipe_resource *texture = samp->view->texture;
-   int j;
+   int j, level_all = 0;
    float lambda;
    float lod[TGSI_QUAD_SIZE];
 
@@ -2188,28 +2672,68 @@ mip_filter_linear_2d_linear_repeat_POT(
       memcpy(lod, c0, sizeof(lod));
    }
 
+   /* Filter the whole quad at once if all pixels use the same levels:
+    */
    for (j = 0; j < TGSI_QUAD_SIZE; j++) {
       int level0 = samp->view->u.tex.first_level + (int)lod[j];
+      int level;
 
-      /* Catches both negative and large values of level0:
-       */
-      if ((unsigned)level0 >= texture->last_level) { 
-         if (level0 < 0)
-            img_filter_2d_linear_repeat_POT(tgsi_sampler, s[j], t[j], p[j], samp->view->u.tex.first_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
-         else
-            img_filter_2d_linear_repeat_POT(tgsi_sampler, s[j], t[j], p[j], samp->view->texture->last_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+      if ((unsigned)level0 >= texture->last_level)
+         level = level0 < 0 ? -1 : -2;
+      else
+         level = level0;
 
+      if (j == 0)
+         level_all = level;
+      else if (level != level_all)
+         break;
+   }
+
+   if (j == TGSI_QUAD_SIZE) {
+      if (level_all == -1) {
+         img_filter_quad(tgsi_sampler, img_filter_2d_linear_repeat_POT, samp->min_img_filter_quad, s, t, p, samp->view->u.tex.first_level, rgba);
+      }
+      else if (level_all == -2) {
+         img_filter_quad(tgsi_sampler, img_filter_2d_linear_repeat_POT, samp->min_img_filter_quad, s, t, p, samp->view->texture->last_level, rgba);
       }
       else {
-         float levelBlend = frac(lod[j]);
-         float rgbax[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+         float rgbax[2][TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
          int c;
 
-         img_filter_2d_linear_repeat_POT(tgsi_sampler, s[j], t[j], p[j], level0,   samp->faces[j], tgsi_sampler_lod_bias, &rgbax[0][0]);
-         img_filter_2d_linear_repeat_POT(tgsi_sampler, s[j], t[j], p[j], level0+1, samp->faces[j], tgsi_sampler_lod_bias, &rgbax[0][1]);
+         img_filter_quad(tgsi_sampler, img_filter_2d_linear_repeat_POT, samp->min_img_filter_quad, s, t, p, level_all,   rgbax[0]);
+         img_filter_quad(tgsi_sampler, img_filter_2d_linear_repeat_POT, samp->min_img_filter_quad, s, t, p, level_all+1, rgbax[1]);
+
+         for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+            float levelBlend = frac(lod[j]);
+            for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+               rgba[c][j] = lerp(levelBlend, rgbax[0][c][j], rgbax[1][c][j]);
+         }
+      }
+   }
+   else {
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         int level0 = samp->view->u.tex.first_level + (int)lod[j];
+
+         /* Catches both negative and large values of level0:
+          */
+         if ((unsigned)level0 >= texture->last_level) { 
+            if (level0 < 0)
+               img_filter_2d_linear_repeat_POT(tgsi_sampler, s[j], t[j], p[j], samp->view->u.tex.first_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+            else
+               img_filter_2d_linear_repeat_POT(tgsi_sampler, s[j], t[j], p[j], samp->view->texture->last_level, samp->faces[j], tgsi_sampler_lod_bias, &rgba[0][j]);
+
+         }
+         else {
+            float levelBlend = frac(lod[j]);
+            float rgbax[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+            int c;
+
+            img_filter_2d_linear_repeat_POT(tgsi_sampler, s[j], t[j], p[j], level0,   samp->faces[j], tgsi_sampler_lod_bias, &rgbax[0][0]);
+            img_filter_2d_linear_repeat_POT(tgsi_sampler, s[j], t[j], p[j], level0+1, samp->faces[j], tgsi_sampler_lod_bias, &rgbax[0][1]);
 
-         for (c = 0; c < TGSI_NUM_CHANNELS; c++)
-            rgba[c][j] = lerp(levelBlend, rgbax[c][0], rgbax[c][1]);
+            for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+               rgba[c][j] = lerp(levelBlend, rgbax[c][0], rgbax[c][1]);
+         }
       }
    }
 
@@ -2736,6 +3260,38 @@ get_img_filter(const union sp_sampler_key key,
 }
 
 
+/**
+ * Get the quad version of the image filter, if there is one.
+ */
+static img_filter_quad_func
+get_img_filter_quad(const union sp_sampler_key key,
+                    unsigned filter,
+                    const struct pipe_sampler_state *sampler)
+{
+#if defined(PIPE_ARCH_SSE)
+   if ((key.bits.target == PIPE_TEXTURE_2D ||
+        key.bits.target == PIPE_TEXTURE_RECT) &&
+       sampler->normalized_coords &&
+       (sampler->wrap_s == PIPE_TEX_WRAP_REPEAT ||
+        sampler->wrap_s == PIPE_TEX_WRAP_CLAMP_TO_EDGE) &&
+       (sampler->wrap_t == PIPE_TEX_WRAP_REPEAT ||
+        sampler->wrap_t == PIPE_TEX_WRAP_CLAMP_TO_EDGE)) {
+      if (filter == PIPE_TEX_FILTER_NEAREST)
+         return img_filter_2d_nearest_quad;
+      /* Same weights as the per-pixel fast path, see get_img_filter():
+       */
+      else if (key.bits.is_pot &&
+               sampler->wrap_s == PIPE_TEX_WRAP_REPEAT &&
+               sampler->wrap_t == PIPE_TEX_WRAP_REPEAT)
+         return img_filter_2d_linear_repeat_POT_quad;
+      else
+         return img_filter_2d_linear_quad;
+   }
+#endif
+   return NULL;
+}
+
+
 /**
  * Bind the given texture object and texture cache to the sampler variant.
  */
@@ -2948,6 +3504,8 @@ sp_create_sampler_variant( const struct pipe_sampler_state *sampler,
 
    samp->min_img_filter = get_img_filter(key, sampler->min_img_filter, sampler);
    samp->mag_img_filter = get_img_filter(key, sampler->mag_img_filter, sampler);
+   samp->min_img_filter_quad = get_img_filter_quad(key, sampler->min_img_filter, sampler);
+   samp->mag_img_filter_quad = get_img_filter_quad(key, sampler->mag_img_filter, sampler);
 
    switch (sampler->min_mip_filter) {
    case PIPE_TEX_MIPFILTER_NONE:
@@ -2987,6 +3545,7 @@ sp_create_sampler_variant( const struct pipe_sampler_state *sampler,
       	 * making it possible to use one of the accelerated implementations 
       	 */
       	samp->min_img_filter = get_img_filter(key, PIPE_TEX_FILTER_NEAREST, sampler);
+      	samp->min_img_filter_quad = get_img_filter_quad(key, PIPE_TEX_FILTER_NEAREST, sampler);
       	
       	/* on first access create the lookup table containing the filter weights. */
         if (!weightLut) {
@@ -58,6 +58,17 @@ typedef void (*img_filter_func)(struct tgsi_sampler *tgsi_sampler,
                                 enum tgsi_sampler_control control,
                                 float *rgba);
 
+/**
+ * Filter all four pixels of a quad at the given level.  Returns FALSE if
+ * the texcoords can't be handled, in which case the pixels must be
+ * filtered one at a time with the img_filter_func.
+ */
+typedef boolean (*img_filter_quad_func)(const struct sp_sampler_variant *samp,
+                                        const float s[TGSI_QUAD_SIZE],
+                                        const float t[TGSI_QUAD_SIZE],
+                                        unsigned level,
+                                        float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE]);
+
 typedef void (*filter_func)(struct tgsi_sampler *tgsi_sampler,
                             const float s[TGSI_QUAD_SIZE],
                             const float t[TGSI_QUAD_SIZE],
@@ -122,6 +133,11 @@ struct sp_sampler_variant
    img_filter_func min_img_filter;
    img_filter_func mag_img_filter;
 
+   /* Quad versions of the above, NULL if there are none:
+    */
+   img_filter_quad_func min_img_filter_quad;
+   img_filter_quad_func mag_img_filter_quad;
+
    compute_lambda_func compute_lambda;
 
    filter_func mip_filter;
@@ -41,24 +41,95 @@
 #include "sp_texture.h"
 #include "sp_tex_tile_cache.h"
 
-   
+
+
+/**
+ * Mark all entries as invalid/empty.
+ */
+static void
+invalidate_tiles(struct softpipe_tex_tile_cache *tc)
+{
+   uint pos;
+
+   for (pos = 0; pos < tc->num_entries; pos++) {
+      if (tc->entries[pos])
+         tc->entries[pos]->addr.bits.invalid = 1;
+   }
+   tc->last_tile_addr.bits.invalid = 1;
+}
+
+
+/**
+ * Change the number of entries.  The entries must be invalid.
+ */
+static void
+resize_cache(struct softpipe_tex_tile_cache *tc, unsigned num_entries)
+{
+   uint pos;
+
+   for (pos = num_entries; pos < tc->num_entries; pos++) {
+      /* keep one as the spare tile if that was taken */
+      if (!tc->tile)
+         tc->tile = tc->entries[pos];
+      else
+         FREE(tc->entries[pos]);
+      tc->entries[pos] = NULL;
+   }
+
+   tc->num_entries = num_entries;
+}
+
+
+/**
+ * Number of entries for the given texture: enough to hold all the tiles
+ * of its first level, its mipmaps and layers, within the cache size
+ * limits.
+ */
+static unsigned
+entries_for_texture(const struct pipe_resource *texture)
+{
+   unsigned tiles, entries;
+
+   if (!texture)
+      return TEX_CACHE_MIN_ENTRIES;
+
+   tiles = ((texture->width0 + TILE_SIZE - 1) / TILE_SIZE) *
+           ((texture->height0 + TILE_SIZE - 1) / TILE_SIZE);
+   if (texture->last_level > 0)
+      tiles += tiles / 3;
+   tiles *= texture->array_size;
+
+   entries = align(MIN2(tiles, TEX_CACHE_MAX_ENTRIES), TEX_CACHE_WAYS);
+
+   return CLAMP(entries, TEX_CACHE_MIN_ENTRIES, TEX_CACHE_MAX_ENTRIES);
+}
+
 
 struct softpipe_tex_tile_cache *
 sp_create_tex_tile_cache( struct pipe_context *pipe )
 {
    struct softpipe_tex_tile_cache *tc;
-   uint pos;
 
    /* make sure max texture size works */
    assert((TILE_SIZE << TEX_ADDR_BITS) >= (1 << (SP_MAX_TEXTURE_2D_LEVELS-1)));
 
+   assert(TEX_CACHE_MIN_ENTRIES % TEX_CACHE_WAYS == 0);
+   assert(TEX_CACHE_MAX_ENTRIES % TEX_CACHE_WAYS == 0);
+
    tc = CALLOC_STRUCT( softpipe_tex_tile_cache );
    if (tc) {
       tc->pipe = pipe;
-      for (pos = 0; pos < NUM_ENTRIES; pos++) {
-         tc->entries[pos].addr.bits.invalid = 1;
+      tc->num_entries = TEX_CACHE_MIN_ENTRIES;
+      tc->last_tile_addr.bits.invalid = 1;
+
+      /* this allocation allows us to guarantee that allocation
+       * failures are never fatal later
+       */
+      tc->tile = MALLOC_STRUCT( softpipe_tex_cached_tile );
+      if (!tc->tile) {
+         FREE(tc);
+         return NULL;
       }
-      tc->last_tile = &tc->entries[0]; /* any tile */
    }
    return tc;
 }
@@ -70,9 +141,11 @@ sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
    if (tc) {
       uint pos;
 
-      for (pos = 0; pos < NUM_ENTRIES; pos++) {
-         /*assert(tc->entries[pos].x < 0);*/
+      for (pos = 0; pos < tc->num_entries; pos++) {
+         FREE( tc->entries[pos] );
       }
+      FREE( tc->tile );
+
       if (tc->transfer) {
          tc->pipe->transfer_unmap(tc->pipe, tc->transfer);
       }
@@ -92,14 +165,10 @@ sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 void
 sp_tex_tile_cache_validate_texture(struct softpipe_tex_tile_cache *tc)
 {
-   unsigned i;
-
    assert(tc);
    assert(tc->texture);
 
-   for (i = 0; i < NUM_ENTRIES; i++) {
-      tc->entries[i].addr.bits.invalid = 1;
-   }
+   invalidate_tiles(tc);
 }
 
 static boolean
@@ -124,7 +193,6 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
                                    struct pipe_sampler_view *view)
 {
    struct pipe_resource *texture = view ? view->texture : NULL;
-   uint i;
 
    assert(!tc->transfer);
 
@@ -147,9 +215,8 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
 
       /* mark as entries as invalid/empty */
       /* XXX we should try to avoid this when the teximage hasn't changed */
-      for (i = 0; i < NUM_ENTRIES; i++) {
-         tc->entries[i].addr.bits.invalid = 1;
-      }
+      invalidate_tiles(tc);
+      resize_cache(tc, entries_for_texture(texture));
 
       tc->tex_face = -1; /* any invalid value here */
    }
@@ -165,36 +232,94 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
 void
 sp_flush_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 {
-   int pos;
-
    if (tc->texture) {
       /* caching a texture, mark all entries as empty */
-      for (pos = 0; pos < NUM_ENTRIES; pos++) {
-         tc->entries[pos].addr.bits.invalid = 1;
-      }
+      invalidate_tiles(tc);
       tc->tex_face = -1;
    }
 
 }
 
 
+/**
+ * Return the counters of the cache.
+ */
+void
+sp_tex_tile_cache_get_stats(const struct softpipe_tex_tile_cache *tc,
+                            struct sp_tex_tile_cache_stats *stats)
+{
+   *stats = tc->stats;
+}
+
+
 /**
  * Given the texture face, level, zslice, x and y values, compute
- * the cache entry position/index where we'd hope to find the
- * cached texture tile.
- * This is basically a direct-map cache.
- * XXX There's probably lots of ways in which we can improve this.
+ * the position of the first entry of the set where we'd hope to find
+ * the cached texture tile.
  */
 static INLINE uint
-tex_cache_pos( union tex_tile_address addr )
+tex_cache_pos( const struct softpipe_tex_tile_cache *tc,
+               union tex_tile_address addr )
+{
+   uint set = (addr.bits.x + 
+               addr.bits.y * 9 + 
+               addr.bits.z * 3 + 
+               addr.bits.face + 
+               addr.bits.level * 7);
+
+   return (set % (tc->num_entries / TEX_CACHE_WAYS)) * TEX_CACHE_WAYS;
+}
+
+
+/**
+ * Return the entry of the set starting at 'first' to replace: an empty
+ * one if there is, else the least recently used one.
+ */
+static INLINE uint
+tex_replace_pos( const struct softpipe_tex_tile_cache *tc, uint first )
+{
+   uint pos, lru = first;
+
+   for (pos = first; pos < first + TEX_CACHE_WAYS; pos++) {
+      if (!tc->entries[pos] || tc->entries[pos]->addr.bits.invalid)
+         return pos;
+      /* wrap safe comparison of the clock values */
+      if ((int) (tc->last_used[pos] - tc->last_used[lru]) < 0)
+         lru = pos;
+   }
+
+   return lru;
+}
+
+
+/**
+ * Allocate a tile for an entry.  If that fails, take the spare tile or
+ * steal the tile of another entry.
+ */
+static struct softpipe_tex_cached_tile *
+alloc_tex_tile( struct softpipe_tex_tile_cache *tc )
 {
-   uint entry = (addr.bits.x + 
-                 addr.bits.y * 9 + 
-                 addr.bits.z * 3 + 
-                 addr.bits.face + 
-                 addr.bits.level * 7);
+   struct softpipe_tex_cached_tile *tile =
+      MALLOC_STRUCT( softpipe_tex_cached_tile );
+   uint pos;
+
+   if (!tile) {
+      tile = tc->tile;
+      tc->tile = NULL;
+   }
+
+   for (pos = 0; !tile && pos < tc->num_entries; pos++) {
+      tile = tc->entries[pos];
+      tc->entries[pos] = NULL;
+   }
 
-   return entry % NUM_ENTRIES;
+   /* this should never happen */
+   if (!tile)
+      abort();
+
+   tile->addr.bits.invalid = 1;
+   tc->last_tile_addr.bits.invalid = 1;
+   return tile;
 }
 
 /**
@@ -205,12 +330,31 @@ const struct softpipe_tex_cached_tile *
 sp_find_cached_tile_tex(struct softpipe_tex_tile_cache *tc, 
                         union tex_tile_address addr )
 {
-   struct softpipe_tex_cached_tile *tile;
+   struct softpipe_tex_cached_tile *tile = NULL;
    boolean zs = util_format_is_depth_or_stencil(tc->format);
+   const uint first = tex_cache_pos( tc, addr );
+   uint pos;
 
-   tile = tc->entries + tex_cache_pos( addr );
+   for (pos = first; pos < first + TEX_CACHE_WAYS; pos++) {
+      if (tc->entries[pos] && tc->entries[pos]->addr.value == addr.value) {
+         tile = tc->entries[pos];
+         break;
+      }
+   }
 
-   if (addr.value != tile->addr.value) {
+   if (tile) {
+      tc->stats.hits++;
+   }
+   else {
+      pos = tex_replace_pos( tc, first );
+
+      if (!tc->entries[pos])
+         tc->entries[pos] = alloc_tex_tile( tc );
+      tile = tc->entries[pos];
+
+      tc->stats.misses++;
+      if (!tile->addr.bits.invalid)
+         tc->stats.evictions++;
 
       /* cache miss.  Most misses are because we've invaldiated the
        * texture cache previously -- most commonly on binding a new
@@ -291,6 +435,10 @@ sp_find_cached_tile_tex(struct softpipe_tex_tile_cache *tc,
       tile->addr = addr;
    }
 
+   tc->last_used[pos] = ++tc->clock;
+
    tc->last_tile = tile;
+   tc->last_tile_addr = addr;
+   tc->last_pos = pos;
    return tile;
 }
@@ -73,7 +73,28 @@ struct softpipe_tex_cached_tile
    } data;
 };
 
-#define NUM_ENTRIES 50
+/**
+ * The cache is set associative, like the render target tile cache: a
+ * tile can be held by any of the TEX_CACHE_WAYS entries of its set, and on
+ * a miss the least recently used entry of the set is replaced.  The number
+ * of sets depends on the size of the texture, within these limits.  Tiles
+ * are only allocated when an entry is first used.
+ */
+#define TEX_CACHE_WAYS 4
+#define TEX_CACHE_MIN_ENTRIES 32
+#define TEX_CACHE_MAX_ENTRIES 256
+
+
+/**
+ * Counters accumulated over the life of a texture tile cache.
+ */
+struct sp_tex_tile_cache_stats
+{
+   uint64_t hits;       /**< lookups which found the tile in the cache */
+   uint64_t misses;     /**< lookups which loaded the tile */
+   uint64_t evictions;  /**< loaded tiles replaced by another */
+};
+
 
 struct softpipe_tex_tile_cache
 {
@@ -84,7 +105,11 @@ struct softpipe_tex_tile_cache
    struct pipe_resource *texture;  /**< if caching a texture */
    unsigned timestamp;
 
-   struct softpipe_tex_cached_tile entries[NUM_ENTRIES];
+   struct softpipe_tex_cached_tile *entries[TEX_CACHE_MAX_ENTRIES];
+   unsigned last_used[TEX_CACHE_MAX_ENTRIES];  /**< clock at last use */
+   unsigned num_entries;           /**< entries used for the texture */
+   unsigned clock;                 /**< LRU time */
+   struct softpipe_tex_cached_tile *tile;  /**< spare, for out of memory */
 
    struct pipe_transfer *tex_trans;
    void *tex_trans_map;
@@ -96,7 +121,11 @@ struct softpipe_tex_tile_cache
    unsigned swizzle_a;
    enum pipe_format format;
 
+   union tex_tile_address last_tile_addr;
    struct softpipe_tex_cached_tile *last_tile;  /**< most recently retrieved tile */
+   unsigned last_pos;                           /**< entry of last_tile */
+
+   struct sp_tex_tile_cache_stats stats;
 };
 
 
@@ -116,6 +145,10 @@ sp_tex_tile_cache_validate_texture(struct softpipe_tex_tile_cache *tc);
 extern void
 sp_flush_tex_tile_cache(struct softpipe_tex_tile_cache *tc);
 
+extern void
+sp_tex_tile_cache_get_stats(const struct softpipe_tex_tile_cache *tc,
+                            struct sp_tex_tile_cache_stats *stats);
+
 
 
 extern const struct softpipe_tex_cached_tile *
@@ -147,8 +180,11 @@ static INLINE const struct softpipe_tex_cached_tile *
 sp_get_cached_tile_tex(struct softpipe_tex_tile_cache *tc, 
                          union tex_tile_address addr )
 {
-   if (tc->last_tile->addr.value == addr.value)
+   if (tc->last_tile_addr.value == addr.value) {
+      tc->last_used[tc->last_pos] = ++tc->clock;
+      tc->stats.hits++;
       return tc->last_tile;
+   }
 
    return sp_find_cached_tile_tex( tc, addr );
 }
@@ -39,17 +39,74 @@
 #include "sp_tile_cache.h"
 
 static struct softpipe_cached_tile *
-sp_alloc_tile(struct softpipe_tile_cache *tc);
+sp_alloc_tile(struct softpipe_tile_cache *tc, unsigned band);
 
 
 /**
- * Return the position in the cache for the tile that contains win pos (x,y).
- * We currently use a direct mapped cache so this is like a hack key.
- * At some point we should investige something more sophisticated, like
- * a LRU replacement policy.
+ * Return the position in the cache of the first entry of the set which
+ * holds the tile at the given address.
+ * Each band maps to its own range of sets.
  */
-#define CACHE_POS(x, y) \
-   (((x) + (y) * 5) % NUM_ENTRIES)
+static INLINE unsigned
+set_pos(const struct softpipe_tile_cache *tc, union tile_address addr)
+{
+   const unsigned band = addr.bits.y % tc->num_bands;
+   const unsigned y = addr.bits.y / tc->num_bands;
+   const unsigned set = (addr.bits.x + y * 5) % tc->band_sets;
+
+   return (band * tc->band_sets + set) * TILE_CACHE_WAYS;
+}
+
+
+/**
+ * Return the entry of the set starting at 'first' to replace: an empty
+ * one if there is, else the least recently used one.
+ */
+static INLINE unsigned
+replace_pos(const struct softpipe_tile_cache *tc, unsigned first)
+{
+   unsigned pos, lru = first;
+
+   for (pos = first; pos < first + TILE_CACHE_WAYS; pos++) {
+      if (tc->tile_addrs[pos].bits.invalid)
+         return pos;
+      /* wrap safe comparison of the band clock values */
+      if ((int) (tc->last_used[pos] - tc->last_used[lru]) < 0)
+         lru = pos;
+   }
+
+   return lru;
+}
+
+
+/**
+ * Number of sets per band for a surface of the given width: enough for
+ * each band to hold two rows of tiles, which is what rasterizing a wide
+ * triangle touches at once, within the cache size limits.
+ */
+static unsigned
+band_sets_for_width(const struct softpipe_tile_cache *tc, unsigned width)
+{
+   const unsigned band_ways = tc->num_bands * TILE_CACHE_WAYS;
+   const unsigned row_tiles = (width + TILE_SIZE - 1) / TILE_SIZE;
+   unsigned sets = (2 * row_tiles + TILE_CACHE_WAYS - 1) / TILE_CACHE_WAYS;
+
+   sets = MAX2(sets, (TILE_CACHE_MIN_ENTRIES + band_ways - 1) / band_ways);
+   sets = MIN2(sets, TILE_CACHE_MAX_ENTRIES / band_ways);
+
+   return sets;
+}
+
+
+static INLINE void
+invalidate_last_tiles(struct softpipe_tile_cache *tc)
+{
+   unsigned i;
+
+   for (i = 0; i < tc->max_bands; i++) {
+      tc->band[i].last_tile_addr.bits.invalid = 1;
+   }
+}
 
 
 
@@ -80,8 +137,12 @@ clear_clear_flag(uint *bitvec, union tile_address addr)
 }
    
 
+/**
+ * \param num_bands  number of bands which may be accessed concurrently,
+ *                   at most SP_MAX_THREADS
+ */
 struct softpipe_tile_cache *
-sp_create_tile_cache( struct pipe_context *pipe )
+sp_create_tile_cache( struct pipe_context *pipe, unsigned num_bands )
 {
    struct softpipe_tile_cache *tc;
    uint pos;
@@ -96,18 +157,29 @@ sp_create_tile_cache( struct pipe_context *pipe )
 
    assert((TILE_SIZE << TILE_ADDR_BITS) >= MAX_WIDTH);
 
+   /* bands own whole rows of clear flags */
+   assert((MAX_WIDTH / TILE_SIZE) % 32 == 0);
+
+   assert(num_bands >= 1 && num_bands <= SP_MAX_THREADS);
+
    tc = CALLOC_STRUCT( softpipe_tile_cache );
    if (tc) {
       tc->pipe = pipe;
-      for (pos = 0; pos < NUM_ENTRIES; pos++) {
+      for (pos = 0; pos < TILE_CACHE_MAX_ENTRIES; pos++) {
          tc->tile_addrs[pos].bits.invalid = 1;
       }
-      tc->last_tile_addr.bits.invalid = 1;
+      tc->max_bands = num_bands;
+      tc->num_bands = num_bands;
+      tc->band_sets = band_sets_for_width(tc, 0);
+      tc->num_entries = num_bands * tc->band_sets * TILE_CACHE_WAYS;
+      invalidate_last_tiles(tc);
+      pipe_mutex_init(tc->tile_mutex);
 
       /* this allocation allows us to guarantee that allocation
        * failures are never fatal later
        */
-      tc->tile = MALLOC_STRUCT( softpipe_cached_tile );
+      tc->tile_bytes = sizeof(struct softpipe_cached_tile);
+      tc->tile = MALLOC( tc->tile_bytes );
       if (!tc->tile)
       {
          FREE(tc);
@@ -134,7 +206,7 @@ sp_destroy_tile_cache(struct softpipe_tile_cache *tc)
    if (tc) {
       uint pos;
 
-      for (pos = 0; pos < NUM_ENTRIES; pos++) {
+      for (pos = 0; pos < tc->num_entries; pos++) {
          /*assert(tc->entries[pos].x < 0);*/
          FREE( tc->entries[pos] );
       }
@@ -144,11 +216,86 @@ sp_destroy_tile_cache(struct softpipe_tile_cache *tc)
          tc->pipe->transfer_unmap(tc->pipe, tc->transfer);
       }
 
+      pipe_mutex_destroy(tc->tile_mutex);
+
       FREE( tc );
    }
 }
 
 
+/**
+ * Can color tiles of the given format be cached in the format itself?
+ * We do this for plain 32-bit formats, which covers the usual 8-bit RGBA
+ * render targets: loading and flushing a tile is then a copy, and only
+ * the pixels which are actually blended or written get converted.
+ */
+static boolean
+is_native_color_format(enum pipe_format format)
+{
+   const struct util_format_description *desc = util_format_description(format);
+
+   return desc->layout == UTIL_FORMAT_LAYOUT_PLAIN &&
+          desc->block.width == 1 &&
+          desc->block.height == 1 &&
+          desc->block.bits == 32 &&
+          !util_format_is_depth_or_stencil(format) &&
+          !util_format_is_pure_integer(format);
+}
+
+
+/**
+ * Make the cache's tiles the right size and number for the current
+ * surface.  This is only called while the cache is flushed, so the tile
+ * contents can be dropped.
+ */
+static void
+resize_cache(struct softpipe_tile_cache *tc, unsigned tile_bytes,
+             unsigned band_sets)
+{
+   const unsigned num_entries =
+      tc->num_bands * band_sets * TILE_CACHE_WAYS;
+   uint pos;
+
+   if (tile_bytes == tc->tile_bytes && num_entries == tc->num_entries) {
+      tc->band_sets = band_sets;
+      return;
+   }
+
+   invalidate_last_tiles(tc);
+
+   if (tile_bytes != tc->tile_bytes) {
+      for (pos = 0; pos < tc->num_entries; pos++) {
+         assert(tc->tile_addrs[pos].bits.invalid);
+         FREE( tc->entries[pos] );
+         tc->entries[pos] = NULL;
+      }
+
+      /* if this fails, sp_alloc_tile() provides the scratch tile when
+       * needed
+       */
+      FREE( tc->tile );
+      tc->tile_bytes = tile_bytes;
+      tc->tile = MALLOC( tile_bytes );
+   }
+   else {
+      /* the tiles are the right size, only free the ones of the entries
+       * which go away, keeping one as the scratch tile if that was taken
+       */
+      for (pos = num_entries; pos < tc->num_entries; pos++) {
+         assert(tc->tile_addrs[pos].bits.invalid);
+         if (!tc->tile)
+            tc->tile = tc->entries[pos];
+         else
+            FREE( tc->entries[pos] );
+         tc->entries[pos] = NULL;
+      }
+   }
+
+   tc->num_entries = num_entries;
+   tc->band_sets = band_sets;
+}
+
+
 /**
  * Specify the surface to cache.
  */
@@ -178,6 +325,26 @@ sp_tile_cache_set_surface(struct softpipe_tile_cache *tc,
                                            &tc->transfer);
 
       tc->depth_stencil = util_format_is_depth_or_stencil(ps->format);
+      tc->native = is_native_color_format(ps->format);
+
+      /* Color tiles held as floats are rounded each time they are written
+       * back, so results depend on when tiles get evicted.  Use a single
+       * band for them, which evicts at the same points as without
+       * rasterizer threads; sp_rast_begin() then runs the quads in place.
+       */
+      if (tc->depth_stencil || tc->native)
+         tc->num_bands = tc->max_bands;
+      else
+         tc->num_bands = 1;
+      invalidate_last_tiles(tc);
+
+      if (tc->depth_stencil || tc->native)
+         resize_cache(tc, util_format_get_blocksize(ps->format) *
+                          TILE_SIZE * TILE_SIZE,
+                      band_sets_for_width(tc, ps->width));
+      else
+         resize_cache(tc, sizeof(struct softpipe_cached_tile),
+                      band_sets_for_width(tc, ps->width));
    }
 }
 
@@ -198,9 +365,21 @@ sp_tile_cache_get_surface(struct softpipe_tile_cache *tc)
 static void
 clear_tile_rgba(struct softpipe_cached_tile *tile,
                 enum pipe_format format,
+                boolean native,
                 const union pipe_color_union *clear_value)
 {
-   if (clear_value->f[0] == 0.0 &&
+   if (native) {
+      uint packed, i, j;
+
+      util_format_write_4f(format, clear_value->f, 0, &packed, 0, 0, 0, 1, 1);
+
+      for (i = 0; i < TILE_SIZE; i++) {
+         for (j = 0; j < TILE_SIZE; j++) {
+            tile->data.color32[i][j] = packed;
+         }
+      }
+   }
+   else if (clear_value->f[0] == 0.0 &&
        clear_value->f[1] == 0.0 &&
        clear_value->f[2] == 0.0 &&
        clear_value->f[3] == 0.0) {
@@ -297,6 +476,82 @@ clear_tile(struct softpipe_cached_tile *tile,
 }
 
 
+/**
+ * Write a cached tile to the surface.
+ * \param x, y  position of the tile, in pixels
+ */
+static void
+put_tile(struct softpipe_tile_cache *tc,
+         const struct softpipe_cached_tile *tile,
+         uint x, uint y)
+{
+   struct pipe_transfer *pt = tc->transfer;
+   const enum pipe_format format = tc->surface->format;
+
+   if (tc->depth_stencil || tc->native) {
+      pipe_put_tile_raw(pt, tc->transfer_map,
+                        x, y, TILE_SIZE, TILE_SIZE,
+                        tile->data.any, 0/*STRIDE*/);
+   }
+   else if (util_format_is_pure_uint(format)) {
+      pipe_put_tile_ui_format(pt, tc->transfer_map,
+                              x, y, TILE_SIZE, TILE_SIZE,
+                              format,
+                              (unsigned *) tile->data.colorui128);
+   }
+   else if (util_format_is_pure_sint(format)) {
+      pipe_put_tile_i_format(pt, tc->transfer_map,
+                             x, y, TILE_SIZE, TILE_SIZE,
+                             format,
+                             (int *) tile->data.colori128);
+   }
+   else {
+      pipe_put_tile_rgba_format(pt, tc->transfer_map,
+                                x, y, TILE_SIZE, TILE_SIZE,
+                                format,
+                                (float *) tile->data.color);
+   }
+}
+
+
+/**
+ * Read a tile from the surface into the cache.
+ * \param x, y  position of the tile, in pixels
+ */
+static void
+get_tile(struct softpipe_tile_cache *tc,
+         struct softpipe_cached_tile *tile,
+         uint x, uint y)
+{
+   struct pipe_transfer *pt = tc->transfer;
+   const enum pipe_format format = tc->surface->format;
+
+   if (tc->depth_stencil || tc->native) {
+      pipe_get_tile_raw(pt, tc->transfer_map,
+                        x, y, TILE_SIZE, TILE_SIZE,
+                        tile->data.any, 0/*STRIDE*/);
+   }
+   else if (util_format_is_pure_uint(format)) {
+      pipe_get_tile_ui_format(pt, tc->transfer_map,
+                              x, y, TILE_SIZE, TILE_SIZE,
+                              format,
+                              (unsigned *) tile->data.colorui128);
+   }
+   else if (util_format_is_pure_sint(format)) {
+      pipe_get_tile_i_format(pt, tc->transfer_map,
+                             x, y, TILE_SIZE, TILE_SIZE,
+                             format,
+                             (int *) tile->data.colori128);
+   }
+   else {
+      pipe_get_tile_rgba_format(pt, tc->transfer_map,
+                                x, y, TILE_SIZE, TILE_SIZE,
+                                format,
+                                (float *) tile->data.color);
+   }
+}
+
+
 /**
  * Actually clear the tiles which were flagged as being in a clear state.
  */
@@ -311,13 +566,14 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
 
    assert(pt->resource);
    if (!tc->tile)
-      tc->tile = sp_alloc_tile(tc);
+      tc->tile = sp_alloc_tile(tc, 0);
 
    /* clear the scratch tile to the clear value */
    if (tc->depth_stencil) {
       clear_tile(tc->tile, pt->resource->format, tc->clear_val);
    } else {
-      clear_tile_rgba(tc->tile, pt->resource->format, &tc->clear_color);
+      clear_tile_rgba(tc->tile, tc->surface->format, tc->native,
+                      &tc->clear_color);
    }
 
    /* push the tile to all positions marked as clear */
@@ -327,28 +583,7 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
 
          if (is_clear_flag_set(tc->clear_flags, addr)) {
             /* write the scratch tile to the surface */
-            if (tc->depth_stencil) {
-               pipe_put_tile_raw(pt, tc->transfer_map,
-                                 x, y, TILE_SIZE, TILE_SIZE,
-                                 tc->tile->data.any, 0/*STRIDE*/);
-            }
-            else {
-               if (util_format_is_pure_uint(tc->surface->format)) {
-                  pipe_put_tile_ui_format(pt, tc->transfer_map,
-                                          x, y, TILE_SIZE, TILE_SIZE,
-                                          pt->resource->format,
-                                          (unsigned *) tc->tile->data.colorui128);
-               } else if (util_format_is_pure_sint(tc->surface->format)) {
-                  pipe_put_tile_i_format(pt, tc->transfer_map,
-                                         x, y, TILE_SIZE, TILE_SIZE,
-                                         pt->resource->format,
-                                         (int *) tc->tile->data.colori128);
-               } else {
-                  pipe_put_tile_rgba(pt, tc->transfer_map,
-                                     x, y, TILE_SIZE, TILE_SIZE,
-                                     (float *) tc->tile->data.color);
-               }
-            }
+            put_tile(tc, tc->tile, x, y);
             numCleared++;
          }
       }
@@ -366,37 +601,9 @@ static void
 sp_flush_tile(struct softpipe_tile_cache* tc, unsigned pos)
 {
    if (!tc->tile_addrs[pos].bits.invalid) {
-      if (tc->depth_stencil) {
-         pipe_put_tile_raw(tc->transfer, tc->transfer_map,
-                           tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                           tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                           TILE_SIZE, TILE_SIZE,
-                           tc->entries[pos]->data.depth32, 0/*STRIDE*/);
-      }
-      else {
-         if (util_format_is_pure_uint(tc->surface->format)) {
-            pipe_put_tile_ui_format(tc->transfer, tc->transfer_map,
-                                    tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                    tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                    TILE_SIZE, TILE_SIZE,
-                                    tc->surface->format,
-                                    (unsigned *) tc->entries[pos]->data.colorui128);
-         } else if (util_format_is_pure_sint(tc->surface->format)) {
-            pipe_put_tile_i_format(tc->transfer, tc->transfer_map,
-                                   tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                   tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                   TILE_SIZE, TILE_SIZE,
-                                   tc->surface->format,
-                                   (int *) tc->entries[pos]->data.colori128);
-         } else {
-            pipe_put_tile_rgba_format(tc->transfer, tc->transfer_map,
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (float *) tc->entries[pos]->data.color);
-         }
-      }
+      put_tile(tc, tc->entries[pos],
+               tc->tile_addrs[pos].bits.x * TILE_SIZE,
+               tc->tile_addrs[pos].bits.y * TILE_SIZE);
       tc->tile_addrs[pos].bits.invalid = 1;  /* mark as empty */
    }
 }
@@ -413,7 +620,7 @@ sp_flush_tile_cache(struct softpipe_tile_cache *tc)
 
    if (pt) {
       /* caching a drawing transfer */
-      for (pos = 0; pos < NUM_ENTRIES; pos++) {
+      for (pos = 0; pos < tc->num_entries; pos++) {
          struct softpipe_cached_tile *tile = tc->entries[pos];
          if (!tile)
          {
@@ -428,7 +635,7 @@ sp_flush_tile_cache(struct softpipe_tile_cache *tc)
       sp_tile_cache_flush_clear(tc);
 
 
-      tc->last_tile_addr.bits.invalid = 1;
+      invalidate_last_tiles(tc);
    }
 
 #if 0
@@ -436,35 +643,45 @@ sp_flush_tile_cache(struct softpipe_tile_cache *tc)
 #endif
 }
 
+/**
+ * Allocate a tile for an entry of the given band.  Only entries of that
+ * band are touched, see softpipe_tile_band.
+ */
 static struct softpipe_cached_tile *
-sp_alloc_tile(struct softpipe_tile_cache *tc)
+sp_alloc_tile(struct softpipe_tile_cache *tc, unsigned band)
 {
-   struct softpipe_cached_tile * tile = MALLOC_STRUCT(softpipe_cached_tile);
+   struct softpipe_cached_tile * tile = MALLOC(tc->tile_bytes);
    if (!tile)
    {
-      /* in this case, steal an existing tile */
-      if (!tc->tile)
-      {
-         unsigned pos;
-         for (pos = 0; pos < NUM_ENTRIES; ++pos) {
-            if (!tc->entries[pos])
-               continue;
+      const unsigned band_entries = tc->band_sets * TILE_CACHE_WAYS;
+      const unsigned first = band * band_entries;
+      unsigned pos;
 
-            sp_flush_tile(tc, pos);
-            tc->tile = tc->entries[pos];
-            tc->entries[pos] = NULL;
-            break;
-         }
+      /* in this case, steal an existing tile of the band */
+      for (pos = first; pos < first + band_entries; ++pos) {
+         if (!tc->entries[pos])
+            continue;
+
+         sp_flush_tile(tc, pos);
+         tile = tc->entries[pos];
+         tc->entries[pos] = NULL;
+         break;
+      }
+
+      if (!tile)
+      {
+         /* the band has no tiles yet, fall back to the scratch tile */
+         pipe_mutex_lock(tc->tile_mutex);
+         tile = tc->tile;
+         tc->tile = NULL;
+         pipe_mutex_unlock(tc->tile_mutex);
 
          /* this should never happen */
-         if (!tc->tile)
+         if (!tile)
             abort();
       }
 
-      tile = tc->tile;
-      tc->tile = NULL;
-
-      tc->last_tile_addr.bits.invalid = 1;
+      tc->band[band].last_tile_addr.bits.invalid = 1;
    }
    return tile;
 }
@@ -478,52 +695,38 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
                     union tile_address addr )
 {
    struct pipe_transfer *pt = tc->transfer;
-   /* cache pos/entry: */
-   const int pos = CACHE_POS(addr.bits.x,
-                             addr.bits.y);
-   struct softpipe_cached_tile *tile = tc->entries[pos];
-
-   if (!tile) {
-      tile = sp_alloc_tile(tc);
-      tc->entries[pos] = tile;
+   struct softpipe_tile_band *band = &tc->band[addr.bits.y % tc->num_bands];
+   const unsigned first = set_pos(tc, addr);
+   struct softpipe_cached_tile *tile;
+   unsigned pos;
+
+   for (pos = first; pos < first + TILE_CACHE_WAYS; pos++) {
+      if (tc->tile_addrs[pos].value == addr.value)
+         break;
    }
 
-   if (addr.value != tc->tile_addrs[pos].value) {
+   if (pos < first + TILE_CACHE_WAYS) {
+      tile = tc->entries[pos];
+      band->stats.hits++;
+   }
+   else {
+      pos = replace_pos(tc, first);
+
+      tile = tc->entries[pos];
+      if (!tile) {
+         tile = sp_alloc_tile(tc, band - tc->band);
+         tc->entries[pos] = tile;
+      }
+
+      band->stats.misses++;
 
       assert(pt->resource);
       if (tc->tile_addrs[pos].bits.invalid == 0) {
          /* put dirty tile back in framebuffer */
-         if (tc->depth_stencil) {
-            pipe_put_tile_raw(pt, tc->transfer_map,
-                              tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                              tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                              TILE_SIZE, TILE_SIZE,
-                              tile->data.depth32, 0/*STRIDE*/);
-         }
-         else {
-            if (util_format_is_pure_uint(tc->surface->format)) {
-               pipe_put_tile_ui_format(pt, tc->transfer_map,
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (unsigned *) tile->data.colorui128);
-            } else if (util_format_is_pure_sint(tc->surface->format)) {
-               pipe_put_tile_i_format(pt, tc->transfer_map,
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (int *) tile->data.colori128);
-            } else {
-               pipe_put_tile_rgba_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (float *) tile->data.color);
-            }
-         }
+         put_tile(tc, tile,
+                  tc->tile_addrs[pos].bits.x * TILE_SIZE,
+                  tc->tile_addrs[pos].bits.y * TILE_SIZE);
+         band->stats.evictions++;
       }
 
       tc->tile_addrs[pos] = addr;
@@ -534,52 +737,45 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
             clear_tile(tile, pt->resource->format, tc->clear_val);
          }
          else {
-            clear_tile_rgba(tile, pt->resource->format, &tc->clear_color);
+            clear_tile_rgba(tile, tc->surface->format, tc->native,
+                            &tc->clear_color);
          }
          clear_clear_flag(tc->clear_flags, addr);
       }
       else {
          /* get new tile data from transfer */
-         if (tc->depth_stencil) {
-            pipe_get_tile_raw(pt, tc->transfer_map,
-                              tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                              tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                              TILE_SIZE, TILE_SIZE,
-                              tile->data.depth32, 0/*STRIDE*/);
-         }
-         else {
-            if (util_format_is_pure_uint(tc->surface->format)) {
-               pipe_get_tile_ui_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (unsigned *) tile->data.colorui128);
-            } else if (util_format_is_pure_sint(tc->surface->format)) {
-               pipe_get_tile_i_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (int *) tile->data.colori128);
-            } else {
-               pipe_get_tile_rgba_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (float *) tile->data.color);
-            }
-         }
+         get_tile(tc, tile, addr.bits.x * TILE_SIZE, addr.bits.y * TILE_SIZE);
       }
    }
 
-   tc->last_tile = tile;
-   tc->last_tile_addr = addr;
+   tc->last_used[pos] = ++band->clock;
+
+   band->last_tile = tile;
+   band->last_tile_addr = addr;
+   band->last_pos = pos;
    return tile;
 }
 
 
+/**
+ * Return the counters of all bands of the cache.
+ */
+void
+sp_tile_cache_get_stats(const struct softpipe_tile_cache *tc,
+                        struct sp_tile_cache_stats *stats)
+{
+   unsigned i;
+
+   memset(stats, 0, sizeof *stats);
+
+   for (i = 0; i < tc->max_bands; i++) {
+      stats->hits += tc->band[i].stats.hits;
+      stats->misses += tc->band[i].stats.misses;
+      stats->evictions += tc->band[i].stats.evictions;
+   }
+}
+
+
 
 
 
@@ -602,8 +798,8 @@ sp_tile_cache_clear(struct softpipe_tile_cache *tc,
    /* set flags to indicate all the tiles are cleared */
    memset(tc->clear_flags, 255, sizeof(tc->clear_flags));
 
-   for (pos = 0; pos < NUM_ENTRIES; pos++) {
+   for (pos = 0; pos < tc->num_entries; pos++) {
       tc->tile_addrs[pos].bits.invalid = 1;
    }
-   tc->last_tile_addr.bits.invalid = 1;
+   invalidate_last_tiles(tc);
 }
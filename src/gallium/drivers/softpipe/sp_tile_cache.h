@@ -30,6 +30,9 @@
 
 
 #include "pipe/p_compiler.h"
+#include "os/os_thread.h"
+#include "tgsi/tgsi_exec.h"
+#include "util/u_format.h"
 #include "sp_texture.h"
 
 
@@ -60,6 +63,12 @@ union tile_address {
 };
 
 
+/**
+ * Color tiles of plain 32-bit formats hold the pixels in the surface's
+ * own format (color32), other color tiles hold them unpacked to float or
+ * integer RGBA.  Tiles are only allocated as large as the surface format
+ * needs, see softpipe_tile_cache::tile_bytes.
+ */
 struct softpipe_cached_tile
 {
    union {
@@ -75,7 +84,45 @@ struct softpipe_cached_tile
    } data;
 };
 
-#define NUM_ENTRIES 50
+/**
+ * The cache is set associative: a tile can be held by any of the
+ * TILE_CACHE_WAYS entries of its set, and on a miss the least recently
+ * used entry of the set is replaced.  The number of sets depends on the
+ * surface width, so that the cache holds two full rows of tiles, within
+ * these limits.
+ */
+#define TILE_CACHE_WAYS 4
+#define TILE_CACHE_MIN_ENTRIES 64
+#define TILE_CACHE_MAX_ENTRIES 1024
+
+
+/**
+ * Counters accumulated over the life of a tile cache.
+ */
+struct sp_tile_cache_stats
+{
+   uint64_t hits;       /**< lookups which found the tile in the cache */
+   uint64_t misses;     /**< lookups which loaded or cleared the tile */
+   uint64_t evictions;  /**< tiles written back to make room for another */
+};
+
+
+/**
+ * The cache entries are split into bands, with tile rows assigned to
+ * bands round-robin.  Each band has its own sets of entries, most
+ * recently used tile and counters, and the clear flags of a tile row all
+ * live in words of that row, so different bands can be accessed
+ * concurrently.  This is what lets the rasterizer threads (see sp_rast.c)
+ * share one cache.  Color tiles held as floats always use one band.
+ */
+struct softpipe_tile_band
+{
+   union tile_address last_tile_addr;
+   struct softpipe_cached_tile *last_tile;  /**< most recently retrieved tile */
+   unsigned last_pos;                       /**< entry of last_tile */
+   unsigned clock;                          /**< LRU time of the band */
+   struct sp_tile_cache_stats stats;
+};
 
 
 struct softpipe_tile_cache
@@ -85,22 +132,29 @@ struct softpipe_tile_cache
    struct pipe_transfer *transfer;
    void *transfer_map;
 
-   union tile_address tile_addrs[NUM_ENTRIES];
-   struct softpipe_cached_tile *entries[NUM_ENTRIES];
+   union tile_address tile_addrs[TILE_CACHE_MAX_ENTRIES];
+   struct softpipe_cached_tile *entries[TILE_CACHE_MAX_ENTRIES];
+   unsigned last_used[TILE_CACHE_MAX_ENTRIES];  /**< band clock at last use */
    uint clear_flags[(MAX_WIDTH / TILE_SIZE) * (MAX_HEIGHT / TILE_SIZE) / 32];
    union pipe_color_union clear_color; /**< for color bufs */
    uint64_t clear_val;        /**< for z+stencil */
    boolean depth_stencil; /**< Is the surface a depth/stencil format? */
+   boolean native;        /**< Are color tiles kept in the surface format? */
+   unsigned tile_bytes;   /**< size of the tiles allocated for the surface */
 
    struct softpipe_cached_tile *tile;  /**< scratch tile for clears */
+   pipe_mutex tile_mutex;              /**< guards 'tile' when out of memory */
 
-   union tile_address last_tile_addr;
-   struct softpipe_cached_tile *last_tile;  /**< most recently retrieved tile */
+   unsigned num_entries;               /**< entries used for the surface */
+   unsigned band_sets;                 /**< sets of each band */
+   unsigned num_bands;                 /**< bands used for the surface */
+   unsigned max_bands;                 /**< bands the cache was created with */
+   struct softpipe_tile_band band[SP_MAX_THREADS];
 };
 
 
 extern struct softpipe_tile_cache *
-sp_create_tile_cache( struct pipe_context *pipe );
+sp_create_tile_cache( struct pipe_context *pipe, unsigned num_bands );
 
 extern void
 sp_destroy_tile_cache(struct softpipe_tile_cache *tc);
@@ -124,6 +178,10 @@ extern struct softpipe_cached_tile *
 sp_find_cached_tile(struct softpipe_tile_cache *tc, 
                     union tile_address addr );
 
+extern void
+sp_tile_cache_get_stats(const struct softpipe_tile_cache *tc,
+                        struct sp_tile_cache_stats *stats);
+
 
 static INLINE union tile_address
 tile_address( unsigned x,
@@ -138,22 +196,109 @@ tile_address( unsigned x,
    return addr;
 }
 
-/* Quickly retrieve tile if it matches last lookup.
+/* Quickly retrieve tile if it matches last lookup in its band.
  */
 static INLINE struct softpipe_cached_tile *
 sp_get_cached_tile(struct softpipe_tile_cache *tc, 
                    int x, int y )
 {
    union tile_address addr = tile_address( x, y );
+   struct softpipe_tile_band *band = &tc->band[addr.bits.y % tc->num_bands];
 
-   if (tc->last_tile_addr.value == addr.value)
-      return tc->last_tile;
+   if (band->last_tile_addr.value == addr.value) {
+      tc->last_used[band->last_pos] = ++band->clock;
+      band->stats.hits++;
+      return band->last_tile;
+   }
 
    return sp_find_cached_tile( tc, addr );
 }
 
 
 
+/**
+ * Get the current colors of the quad's pixels from a color tile, as
+ * dest[chan][pixel].  Tiles in the surface format are only unpacked for
+ * the quad's four pixels.
+ */
+static INLINE void
+sp_tile_get_quad_rgba(const struct softpipe_tile_cache *tc,
+                      const struct util_format_description *desc,
+                      const struct softpipe_cached_tile *tile,
+                      int itx, int ity,
+                      float (*dest)[TGSI_QUAD_SIZE])
+{
+   unsigned i, j;
+
+   if (tc->native) {
+      float rgba[TGSI_QUAD_SIZE][4];
+
+      desc->unpack_rgba_float(&rgba[0][0], 2 * sizeof rgba[0],
+                              (const uint8_t *) &tile->data.color32[ity][itx],
+                              sizeof tile->data.color32[0], 2, 2);
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         for (i = 0; i < 4; i++) {
+            dest[i][j] = rgba[j][i];
+         }
+      }
+   }
+   else {
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         int x = itx + (j & 1);
+         int y = ity + (j >> 1);
+         for (i = 0; i < 4; i++) {
+            dest[i][j] = tile->data.color[y][x][i];
+         }
+      }
+   }
+}
+
+
+/**
+ * Write the colors of the quad's pixels enabled in 'mask' to a color tile.
+ */
+static INLINE void
+sp_tile_put_quad_rgba(const struct softpipe_tile_cache *tc,
+                      const struct util_format_description *desc,
+                      struct softpipe_cached_tile *tile,
+                      int itx, int ity, unsigned mask,
+                      float (*quadColor)[4])
+{
+   unsigned i, j;
+
+   if (tc->native) {
+      float rgba[TGSI_QUAD_SIZE][4];
+      uint packed[TGSI_QUAD_SIZE];
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         for (i = 0; i < 4; i++) {
+            rgba[j][i] = quadColor[i][j];
+         }
+      }
+
+      desc->pack_rgba_float((uint8_t *) packed, 2 * sizeof packed[0],
+                            &rgba[0][0], 2 * sizeof rgba[0], 2, 2);
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         if (mask & (1 << j)) {
+            tile->data.color32[ity + (j >> 1)][itx + (j & 1)] = packed[j];
+         }
+      }
+   }
+   else {
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         if (mask & (1 << j)) {
+            int x = itx + (j & 1);
+            int y = ity + (j >> 1);
+            for (i = 0; i < 4; i++) { /* loop over color chans */
+               tile->data.color[y][x][i] = quadColor[i][j];
+            }
+         }
+      }
+   }
+}
+
 
 #endif /* SP_TILE_CACHE_H */
 
@@ -26,6 +26,7 @@
  **************************************************************************/
 
 #include "util/u_inlines.h"
+#include "util/u_instr.h"
 #include "util/u_memory.h"
 #include "util/u_simple_list.h"
 
@@ -1282,6 +1283,21 @@ trace_context_clear_depth_stencil(struct pipe_context *_pipe,
    trace_dump_call_end();
 }
 
+static void
+trace_dump_instr_total(const struct util_instr_total *total, void *data)
+{
+   (void)data;
+
+   if (!total->calls)
+      return;
+
+   trace_dump_comment("util_instr %s: %llu calls, %llu%s",
+                      total->name, (unsigned long long)total->calls,
+                      (unsigned long long)total->value,
+                      total->timer ? " ns" : "");
+}
+
+
 static INLINE void
 trace_context_flush(struct pipe_context *_pipe,
                     struct pipe_fence_handle **fence)
@@ -1299,6 +1315,13 @@ trace_context_flush(struct pipe_context *_pipe,
       trace_dump_ret(ptr, *fence);
 
    trace_dump_call_end();
+
+   /* Record the instrumentation totals at each flush as comments, so the
+    * trace shows where the time went between them without adding calls
+    * that replay tools would not know.
+    */
+   if (util_instr_enabled)
+      util_instr_foreach(trace_dump_instr_total, NULL);
 }
 
 
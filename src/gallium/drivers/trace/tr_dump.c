@@ -376,6 +376,26 @@ void trace_dump_call_end(void)
    pipe_mutex_unlock(call_mutex);
 }
 
+void trace_dump_comment(const char *format, ...)
+{
+   char buf[1024];
+   va_list ap;
+
+   pipe_mutex_lock(call_mutex);
+   if (dumping) {
+      va_start(ap, format);
+      util_vsnprintf(buf, sizeof(buf), format, ap);
+      va_end(ap);
+
+      trace_dump_indent(1);
+      trace_dump_writes("<!-- ");
+      trace_dump_writes(buf);
+      trace_dump_writes(" -->");
+      trace_dump_newline();
+   }
+   pipe_mutex_unlock(call_mutex);
+}
+
 void trace_dump_arg_begin(const char *name)
 {
    if (!dumping)
@@ -79,6 +79,10 @@ void trace_dump_call_end_locked(void);
 void trace_dump_call_begin(const char *klass, const char *method);
 void trace_dump_call_end(void);
 
+/* Writes an XML comment between calls, for annotations which are not
+ * calls themselves. */
+void trace_dump_comment(const char *format, ...);
+
 void trace_dump_arg_begin(const char *name);
 void trace_dump_arg_end(void);
 void trace_dump_ret_begin(void);
@@ -71,6 +71,13 @@ vdp_imp_device_create_x11(Display *display, int screen, VdpDevice *device,
       goto no_context;
    }
 
+   /* Recycles the temporary textures of the PutBits paths. */
+   dev->staging = util_staging_pool_create(dev->context, 4);
+   if (!dev->staging) {
+      ret = VDP_STATUS_RESOURCES;
+      goto no_staging;
+   }
+
    *device = vlAddDataHTAB(dev);
    if (*device == 0) {
       ret = VDP_STATUS_ERROR;
@@ -85,6 +92,8 @@ vdp_imp_device_create_x11(Display *display, int screen, VdpDevice *device,
    return VDP_STATUS_OK;
 
 no_handle:
+   util_staging_pool_destroy(dev->staging);
+no_staging:
    /* Destroy vscreen */
 no_context:
    vl_screen_destroy(dev->vscreen);
@@ -162,6 +171,7 @@ vlVdpDeviceDestroy(VdpDevice device)
       return VDP_STATUS_INVALID_HANDLE;
 
    pipe_mutex_destroy(dev->mutex);
+   util_staging_pool_destroy(dev->staging);
    vl_compositor_cleanup(&dev->compositor);
    dev->context->destroy(dev->context);
    vl_screen_destroy(dev->vscreen);
@@ -276,7 +276,7 @@ vlVdpOutputSurfacePutBitsIndexed(VdpOutputSurface surface,
    enum pipe_format index_format;
    enum pipe_format colortbl_format;
 
-   struct pipe_resource *res, res_tmpl;
+   struct pipe_resource *res_idx = NULL, *res_tbl = NULL, res_tmpl;
    struct pipe_sampler_view sv_tmpl;
    struct pipe_sampler_view *sv_idx = NULL, *sv_tbl = NULL;
 
@@ -324,24 +324,24 @@ vlVdpOutputSurfacePutBitsIndexed(VdpOutputSurface surface,
    pipe_mutex_lock(vlsurface->device->mutex);
    vlVdpResolveDelayedRendering(vlsurface->device, NULL, NULL);
 
-   res = context->screen->resource_create(context->screen, &res_tmpl);
-   if (!res)
+   res_idx = util_staging_pool_get(vlsurface->device->staging, &res_tmpl);
+   if (!res_idx)
       goto error_resource;
 
    box.x = box.y = box.z = 0;
-   box.width = res->width0;
-   box.height = res->height0;
-   box.depth = res->depth0;
+   box.width = res_idx->width0;
+   box.height = res_idx->height0;
+   box.depth = res_idx->depth0;
 
-   context->transfer_inline_write(context, res, 0, PIPE_TRANSFER_WRITE, &box,
-                                  source_data[0], source_pitch[0],
-                                  source_pitch[0] * res->height0);
+   context->transfer_inline_write(context, res_idx, 0,
+                                  PIPE_TRANSFER_WRITE | PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+                                  &box, source_data[0], source_pitch[0],
+                                  source_pitch[0] * res_idx->height0);
 
    memset(&sv_tmpl, 0, sizeof(sv_tmpl));
-   u_sampler_view_default_template(&sv_tmpl, res, res->format);
+   u_sampler_view_default_template(&sv_tmpl, res_idx, res_idx->format);
 
-   sv_idx = context->create_sampler_view(context, res, &sv_tmpl);
-   pipe_resource_reference(&res, NULL);
+   sv_idx = context->create_sampler_view(context, res_idx, &sv_tmpl);
 
    if (!sv_idx)
       goto error_resource;
@@ -357,23 +357,24 @@ vlVdpOutputSurfacePutBitsIndexed(VdpOutputSurface surface,
    res_tmpl.usage = PIPE_USAGE_STAGING;
    res_tmpl.bind = PIPE_BIND_SAMPLER_VIEW;
 
-   res = context->screen->resource_create(context->screen, &res_tmpl);
-   if (!res)
+   res_tbl = util_staging_pool_get(vlsurface->device->staging, &res_tmpl);
+   if (!res_tbl)
       goto error_resource;
 
    box.x = box.y = box.z = 0;
-   box.width = res->width0;
-   box.height = res->height0;
-   box.depth = res->depth0;
+   box.width = res_tbl->width0;
+   box.height = res_tbl->height0;
+   box.depth = res_tbl->depth0;
 
-   context->transfer_inline_write(context, res, 0, PIPE_TRANSFER_WRITE, &box, color_table,
-                                  util_format_get_stride(colortbl_format, res->width0), 0);
+   context->transfer_inline_write(context, res_tbl, 0,
+                                  PIPE_TRANSFER_WRITE | PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+                                  &box, color_table,
+                                  util_format_get_stride(colortbl_format, res_tbl->width0), 0);
 
    memset(&sv_tmpl, 0, sizeof(sv_tmpl));
-   u_sampler_view_default_template(&sv_tmpl, res, res->format);
+   u_sampler_view_default_template(&sv_tmpl, res_tbl, res_tbl->format);
 
-   sv_tbl = context->create_sampler_view(context, res, &sv_tmpl);
-   pipe_resource_reference(&res, NULL);
+   sv_tbl = context->create_sampler_view(context, res_tbl, &sv_tmpl);
 
    if (!sv_tbl)
       goto error_resource;
@@ -383,8 +384,13 @@ vlVdpOutputSurfacePutBitsIndexed(VdpOutputSurface surface,
    vl_compositor_set_layer_dst_area(cstate, 0, RectToPipe(destination_rect, &dst_rect));
    vl_compositor_render(cstate, compositor, vlsurface->surface, NULL);
 
+   /* The render is not flushed yet, the pool fences the textures with
+    * the next flush before handing them out again.
+    */
    pipe_sampler_view_reference(&sv_idx, NULL);
    pipe_sampler_view_reference(&sv_tbl, NULL);
+   util_staging_pool_put(vlsurface->device->staging, &res_idx, NULL);
+   util_staging_pool_put(vlsurface->device->staging, &res_tbl, NULL);
    pipe_mutex_unlock(vlsurface->device->mutex);
 
    return VDP_STATUS_OK;
@@ -392,6 +398,8 @@ vlVdpOutputSurfacePutBitsIndexed(VdpOutputSurface surface,
 error_resource:
    pipe_sampler_view_reference(&sv_idx, NULL);
    pipe_sampler_view_reference(&sv_tbl, NULL);
+   pipe_resource_reference(&res_idx, NULL);
+   pipe_resource_reference(&res_tbl, NULL);
    pipe_mutex_unlock(vlsurface->device->mutex);
    return VDP_STATUS_RESOURCES;
 }
@@ -0,0 +1,286 @@
+/*
+ * Test case and microbenchmark for cso_hash.
+ *
+ * Run with "bench" as the first argument to time insertion, lookup,
+ * iteration and removal for a range of table sizes.
+ */
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cso_cache/cso_hash.h"
+#include "os/os_time.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+
+/* Simple deterministic generator, so runs are reproducible. */
+static unsigned
+next_random(unsigned *state)
+{
+   *state = *state * 1103515245 + 12345;
+   return (*state >> 16) | (*state << 16);
+}
+
+
+static void *
+value_for(unsigned i)
+{
+   return (void *)(uintptr_t)(i * 2 + 1);
+}
+
+
+static unsigned
+count_key(struct cso_hash *hash, unsigned key)
+{
+   struct cso_hash_iter iter = cso_hash_find(hash, key);
+   unsigned count = 0;
+
+   while (!cso_hash_iter_is_null(iter) && cso_hash_iter_key(iter) == key) {
+      ++count;
+      iter = cso_hash_iter_next(iter);
+   }
+
+   return count;
+}
+
+
+static void
+test_basic(unsigned n, unsigned key_step)
+{
+   struct cso_hash *hash = cso_hash_create();
+   struct cso_hash_iter iter;
+   unsigned i, count;
+
+   for (i = 0; i < n; i++) {
+      iter = cso_hash_insert(hash, i * key_step, value_for(i));
+      assert(!cso_hash_iter_is_null(iter));
+      assert(cso_hash_iter_data(iter) == value_for(i));
+   }
+   assert(cso_hash_size(hash) == (int)n);
+
+   for (i = 0; i < n; i++) {
+      iter = cso_hash_find(hash, i * key_step);
+      assert(cso_hash_iter_data(iter) == value_for(i));
+      assert(cso_hash_contains(hash, i * key_step));
+   }
+
+   if (key_step > 1)
+      assert(!cso_hash_contains(hash, 1));
+
+   /* Every entry is visited exactly once. */
+   count = 0;
+   for (iter = cso_hash_first_node(hash); !cso_hash_iter_is_null(iter);
+        iter = cso_hash_iter_next(iter)) {
+      unsigned key = cso_hash_iter_key(iter);
+      assert(key % key_step == 0);
+      assert(cso_hash_iter_data(iter) == value_for(key / key_step));
+      ++count;
+   }
+   assert(count == n);
+
+   /* Remove every other entry while iterating. */
+   iter = cso_hash_first_node(hash);
+   while (!cso_hash_iter_is_null(iter)) {
+      if ((cso_hash_iter_key(iter) / key_step) & 1)
+         iter = cso_hash_erase(hash, iter);
+      else
+         iter = cso_hash_iter_next(iter);
+   }
+   assert(cso_hash_size(hash) == (int)(n + 1) / 2);
+
+   for (i = 0; i < n; i++)
+      assert(cso_hash_contains(hash, i * key_step) == !(i & 1));
+
+   /* Reinsert after removal. */
+   for (i = 1; i < n; i += 2)
+      cso_hash_insert(hash, i * key_step, value_for(i));
+   assert(cso_hash_size(hash) == (int)n);
+
+   for (i = 0; i < n; i++) {
+      void *data = cso_hash_take(hash, i * key_step);
+      assert(data == value_for(i));
+   }
+   assert(cso_hash_size(hash) == 0);
+   assert(cso_hash_iter_is_null(cso_hash_first_node(hash)));
+
+   cso_hash_delete(hash);
+}
+
+
+static void
+test_collisions(void)
+{
+   struct cso_hash *hash = cso_hash_create();
+   struct cso_hash_iter iter;
+   unsigned i, seen;
+
+   /* Many values under few keys, like cso_cache with a poor key. */
+   for (i = 0; i < 300; i++)
+      cso_hash_insert(hash, i % 3, value_for(i));
+
+   assert(count_key(hash, 0) == 100);
+   assert(count_key(hash, 1) == 100);
+   assert(count_key(hash, 2) == 100);
+   assert(count_key(hash, 3) == 0);
+
+   /* Erase everything under key 1 through key iterators. */
+   iter = cso_hash_find(hash, 1);
+   seen = 0;
+   while (!cso_hash_iter_is_null(iter) && cso_hash_iter_key(iter) == 1) {
+      iter = cso_hash_erase(hash, iter);
+      ++seen;
+   }
+   assert(seen == 100);
+   assert(count_key(hash, 1) == 0);
+   assert(count_key(hash, 2) == 100);
+   assert(cso_hash_size(hash) == 200);
+
+   cso_hash_delete(hash);
+}
+
+
+static void
+test_churn(void)
+{
+   struct cso_hash *hash = cso_hash_create();
+   unsigned state = 1;
+   unsigned keys[64];
+   unsigned i, j;
+
+   /* Constant size with lots of insert/erase turnover, which is what
+    * cso_cache eviction looks like. */
+   for (i = 0; i < Elements(keys); i++) {
+      keys[i] = next_random(&state);
+      cso_hash_insert(hash, keys[i], value_for(i));
+   }
+
+   for (j = 0; j < 100000; j++) {
+      void *data;
+
+      i = next_random(&state) % Elements(keys);
+      data = cso_hash_take(hash, keys[i]);
+      assert(data == value_for(i));
+      keys[i] = next_random(&state);
+      cso_hash_insert(hash, keys[i], value_for(i));
+   }
+
+   assert(cso_hash_size(hash) == Elements(keys));
+   for (i = 0; i < Elements(keys); i++)
+      assert(cso_hash_iter_data(cso_hash_find(hash, keys[i])) == value_for(i));
+
+   cso_hash_delete(hash);
+}
+
+
+static double
+elapsed_ns(int64_t start, unsigned ops)
+{
+   return (double)(os_time_get() - start) * 1000.0 / ops;
+}
+
+
+static void
+bench(unsigned n)
+{
+   struct cso_hash *hash = cso_hash_create();
+   unsigned *keys = malloc(n * sizeof *keys);
+   unsigned rounds = MAX2(1, (1 << 20) / n);
+   struct cso_hash **tables = malloc(rounds * sizeof *tables);
+   unsigned state = n;
+   unsigned i, r, found = 0;
+   double insert_ns, hit_ns, miss_ns, iter_ns, erase_ns;
+   int64_t start;
+
+   for (i = 0; i < n; i++)
+      keys[i] = next_random(&state);
+
+   /* Insertion and removal are timed on throwaway tables, so that small
+    * sizes can be repeated enough to be measurable. */
+   start = os_time_get();
+   for (r = 0; r < rounds; r++) {
+      tables[r] = cso_hash_create();
+      for (i = 0; i < n; i++)
+         cso_hash_insert(tables[r], keys[i], value_for(i));
+   }
+   insert_ns = elapsed_ns(start, n * rounds);
+
+   start = os_time_get();
+   for (r = 0; r < rounds; r++) {
+      for (i = 0; i < n; i++)
+         cso_hash_take(tables[r], keys[i]);
+   }
+   erase_ns = elapsed_ns(start, n * rounds);
+
+   for (r = 0; r < rounds; r++)
+      cso_hash_delete(tables[r]);
+
+   for (i = 0; i < n; i++)
+      cso_hash_insert(hash, keys[i], value_for(i));
+
+   start = os_time_get();
+   for (r = 0; r < rounds; r++) {
+      for (i = 0; i < n; i++)
+         found += cso_hash_iter_data(cso_hash_find(hash, keys[i])) != NULL;
+   }
+   hit_ns = elapsed_ns(start, n * rounds);
+
+   start = os_time_get();
+   for (r = 0; r < rounds; r++) {
+      for (i = 0; i < n; i++)
+         found += cso_hash_contains(hash, keys[i] ^ 0x5bd1e995);
+   }
+   miss_ns = elapsed_ns(start, n * rounds);
+
+   start = os_time_get();
+   for (r = 0; r < rounds; r++) {
+      struct cso_hash_iter iter;
+      for (iter = cso_hash_first_node(hash); !cso_hash_iter_is_null(iter);
+           iter = cso_hash_iter_next(iter))
+         found += cso_hash_iter_data(iter) != NULL;
+   }
+   iter_ns = elapsed_ns(start, n * rounds);
+
+   printf("%8u %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+          n, insert_ns, hit_ns, miss_ns, iter_ns, erase_ns);
+
+   if (found == 0)
+      printf("unexpected\n");
+
+   free(tables);
+   free(keys);
+   cso_hash_delete(hash);
+}
+
+
+int main(int argc, char **argv)
+{
+   if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+      unsigned n;
+
+      printf("ns per operation\n");
+      printf("%8s %10s %10s %10s %10s %10s\n",
+             "entries", "insert", "hit", "miss", "iterate", "erase");
+      for (n = 16; n <= (1 << 20); n *= 4)
+         bench(n);
+      return 0;
+   }
+
+   printf("Testing insertion, lookup and removal\n");
+   test_basic(1, 1);
+   test_basic(1000, 1);
+   test_basic(1000, 16);
+   test_basic(5000, 1 << 12);
+
+   printf("Testing colliding keys\n");
+   test_collisions();
+
+   printf("Testing insert/erase turnover\n");
+   test_churn();
+
+   printf("Success!\n");
+   return 0;
+}
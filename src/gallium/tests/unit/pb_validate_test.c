@@ -0,0 +1,226 @@
+/*
+ * Test case and benchmark for pb_validate.
+ *
+ * Run with "bench" as the first argument to time submissions of synthetic
+ * buffer lists, where each buffer is referenced several times in random
+ * order.
+ */
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pipebuffer/pb_buffer.h"
+#include "pipebuffer/pb_validate.h"
+#include "os/os_time.h"
+#include "util/u_memory.h"
+
+
+struct test_buffer
+{
+   struct pb_buffer base;
+   unsigned validated;
+   unsigned validate_flags;
+   unsigned fenced;
+};
+
+
+static void
+test_buffer_destroy(struct pb_buffer *buf)
+{
+   (void)buf;
+}
+
+
+static enum pipe_error
+test_buffer_validate(struct pb_buffer *buf, struct pb_validate *vl,
+                     unsigned flags)
+{
+   struct test_buffer *tbuf = (struct test_buffer *)buf;
+   if (vl) {
+      ++tbuf->validated;
+      tbuf->validate_flags = flags;
+   }
+   return PIPE_OK;
+}
+
+
+static void
+test_buffer_fence(struct pb_buffer *buf, struct pipe_fence_handle *fence)
+{
+   struct test_buffer *tbuf = (struct test_buffer *)buf;
+   (void)fence;
+   ++tbuf->fenced;
+}
+
+
+static const struct pb_vtbl test_buffer_vtbl = {
+   test_buffer_destroy,
+   NULL,
+   NULL,
+   test_buffer_validate,
+   test_buffer_fence,
+   NULL
+};
+
+
+static struct test_buffer *
+create_buffers(unsigned count)
+{
+   struct test_buffer *bufs = CALLOC(count, sizeof *bufs);
+   unsigned i;
+
+   for (i = 0; i < count; i++) {
+      /* Keep a reference of our own so the list never destroys them. */
+      pipe_reference_init(&bufs[i].base.reference, 1);
+      bufs[i].base.vtbl = &test_buffer_vtbl;
+   }
+
+   return bufs;
+}
+
+
+static unsigned
+next_random(unsigned *state)
+{
+   *state = *state * 1103515245 + 12345;
+   return *state >> 16;
+}
+
+
+static void
+test_dedup(void)
+{
+   struct pb_validate *vl = pb_validate_create();
+   struct test_buffer *bufs = create_buffers(3);
+   struct pb_validate_stats stats;
+   enum pipe_error ret;
+   unsigned i, round;
+
+   for (round = 0; round < 3; round++) {
+      /* Interleaved references, which the list used to store repeatedly. */
+      pb_validate_add_buffer(vl, &bufs[0].base, PB_USAGE_GPU_READ);
+      pb_validate_add_buffer(vl, &bufs[1].base, PB_USAGE_GPU_READ);
+      pb_validate_add_buffer(vl, &bufs[0].base, PB_USAGE_GPU_WRITE);
+      pb_validate_add_buffer(vl, &bufs[2].base, PB_USAGE_GPU_READ);
+      pb_validate_add_buffer(vl, &bufs[1].base, PB_USAGE_GPU_READ);
+      pb_validate_add_buffer(vl, &bufs[1].base, PB_USAGE_GPU_READ);
+
+      ret = pb_validate_validate(vl);
+      assert(ret == PIPE_OK);
+      pb_validate_fence(vl, NULL);
+
+      for (i = 0; i < 3; i++) {
+         assert(bufs[i].validated == round + 1);
+         assert(bufs[i].fenced == round + 1);
+         assert(pipe_is_referenced(&bufs[i].base.reference));
+      }
+      assert(bufs[0].validate_flags == PB_USAGE_GPU_READ_WRITE);
+      assert(bufs[1].validate_flags == PB_USAGE_GPU_READ);
+   }
+
+   pb_validate_get_stats(vl, &stats);
+   assert(stats.num_submissions == 3);
+   assert(stats.num_buffers == 9);
+   assert(stats.num_duplicates == 9);
+
+   pb_validate_destroy(vl);
+   FREE(bufs);
+}
+
+
+static void
+test_large(void)
+{
+   const unsigned count = 5000;
+   struct pb_validate *vl = pb_validate_create();
+   struct test_buffer *bufs = create_buffers(count);
+   enum pipe_error ret;
+   unsigned state = 1;
+   unsigned i;
+
+   /* Enough buffers to grow the list several times in one submission. */
+   for (i = 0; i < count * 4; i++) {
+      unsigned j = next_random(&state) % count;
+      pb_validate_add_buffer(vl, &bufs[j].base, PB_USAGE_GPU_READ);
+   }
+   for (i = 0; i < count; i++)
+      pb_validate_add_buffer(vl, &bufs[i].base, PB_USAGE_GPU_READ);
+
+   ret = pb_validate_validate(vl);
+   assert(ret == PIPE_OK);
+   pb_validate_fence(vl, NULL);
+
+   for (i = 0; i < count; i++) {
+      assert(bufs[i].validated == 1);
+      assert(bufs[i].fenced == 1);
+   }
+
+   pb_validate_destroy(vl);
+   FREE(bufs);
+}
+
+
+static void
+bench(unsigned count, unsigned refs)
+{
+   const unsigned submissions = MAX2(1, (1 << 22) / (count * refs));
+   struct pb_validate *vl = pb_validate_create();
+   struct test_buffer *bufs = create_buffers(count);
+   unsigned *order = MALLOC(count * refs * sizeof *order);
+   struct pb_validate_stats stats;
+   unsigned state = count;
+   unsigned i, s;
+   int64_t start, total;
+
+   for (i = 0; i < count * refs; i++)
+      order[i] = next_random(&state) % count;
+
+   start = os_time_get_nano();
+   for (s = 0; s < submissions; s++) {
+      for (i = 0; i < count * refs; i++)
+         pb_validate_add_buffer(vl, &bufs[order[i]].base, PB_USAGE_GPU_READ);
+      pb_validate_validate(vl);
+      pb_validate_fence(vl, NULL);
+   }
+   total = os_time_get_nano() - start;
+
+   pb_validate_get_stats(vl, &stats);
+   printf("%8u %6u %10.1f %10.1f %10.1f %10.2f\n",
+          count, refs,
+          (double)total / 1000.0 / submissions,
+          (double)stats.validate_ns / 1000.0 / submissions,
+          (double)stats.fence_ns / 1000.0 / submissions,
+          (double)stats.num_buffers / submissions);
+
+   FREE(order);
+   pb_validate_destroy(vl);
+   FREE(bufs);
+}
+
+
+int main(int argc, char **argv)
+{
+   if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+      unsigned count;
+
+      printf("usec per submission\n");
+      printf("%8s %6s %10s %10s %10s %10s\n",
+             "buffers", "refs", "total", "validate", "fence", "entries");
+      for (count = 64; count <= 16384; count *= 4) {
+         bench(count, 1);
+         bench(count, 4);
+      }
+      return 0;
+   }
+
+   printf("Testing repeated references\n");
+   test_dedup();
+
+   printf("Testing list growth\n");
+   test_large();
+
+   printf("Success!\n");
+   return 0;
+}
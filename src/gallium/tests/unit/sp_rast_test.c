@@ -0,0 +1,282 @@
+/*
+ * Test case for the softpipe rasterizer threads.
+ *
+ * Renders the same blended scene with SOFTPIPE_NUM_THREADS set to one and
+ * to several threads, and checks that the images are identical.  The
+ * surface is large enough for tiles to be evicted from the tile caches in
+ * the middle of each draw.
+ */
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "util/u_draw_quad.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "softpipe/sp_public.h"
+#include "sw/null/null_sw_winsys.h"
+
+
+#define WIDTH 1024
+#define HEIGHT 1024
+#define NUM_LAYERS 4
+
+
+static const unsigned thread_counts[] = { 3, 8 };
+
+static const enum pipe_format formats[] = {
+   PIPE_FORMAT_B8G8R8A8_UNORM,
+   PIPE_FORMAT_R16G16B16A16_UNORM,
+   PIPE_FORMAT_R32G32B32A32_FLOAT,
+};
+
+
+/**
+ * Fill in a layer of two screen-covering triangles and a small one, with
+ * position and color for each vertex.
+ */
+static void
+make_layer(float (*v)[2][4], unsigned layer)
+{
+   static const float corners[6][2] = {
+      { -1, -1 }, { 1, -1 }, { -1, 1 },
+      { 1, -1 }, { 1, 1 }, { -1, 1 },
+   };
+   unsigned i;
+
+   for (i = 0; i < 9; i++) {
+      if (i < 6) {
+         v[i][0][0] = corners[i][0];
+         v[i][0][1] = corners[i][1];
+      }
+      else {
+         v[i][0][0] = -0.7f + 0.13f * layer + (i == 7 ? 0.9f : 0.0f);
+         v[i][0][1] = -0.8f + 0.21f * layer + (i == 8 ? 1.1f : 0.0f);
+      }
+      v[i][0][2] = 0.0f;
+      v[i][0][3] = 1.0f;
+
+      v[i][1][0] = (float) ((i * 7 + layer * 3) % 11) / 11.0f;
+      v[i][1][1] = (float) ((i * 5 + layer * 2) % 13) / 13.0f;
+      v[i][1][2] = (float) ((i * 3 + layer) % 7) / 7.0f;
+      v[i][1][3] = 0.3f + 0.05f * layer;
+   }
+}
+
+
+/**
+ * Render the scene on a new context and return a copy of the image.
+ */
+static void *
+render(struct pipe_screen *screen, enum pipe_format format,
+       unsigned num_threads)
+{
+   struct pipe_context *pipe;
+   struct pipe_resource templ, *tex, *vbuf;
+   struct pipe_surface surf_templ, *surf;
+   struct pipe_framebuffer_state fb;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_viewport_state viewport;
+   struct pipe_vertex_element velem[2];
+   struct pipe_transfer *transfer;
+   union pipe_color_union clear_color;
+   void *blend_cso, *dsa_cso, *rast_cso, *velem_cso, *vs, *fs;
+   float vertices[NUM_LAYERS][9][2][4];
+   const unsigned semantic_names[] = { TGSI_SEMANTIC_POSITION,
+                                       TGSI_SEMANTIC_COLOR };
+   const unsigned semantic_indexes[] = { 0, 0 };
+   unsigned stride, y, layer;
+   const ubyte *map;
+   ubyte *image;
+   char value[16];
+
+   /* softpipe reads it at context creation */
+   snprintf(value, sizeof value, "%u", num_threads);
+   setenv("SOFTPIPE_NUM_THREADS", value, 1);
+
+   pipe = screen->context_create(screen, NULL);
+   if (!pipe)
+      return NULL;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = format;
+   templ.width0 = WIDTH;
+   templ.height0 = HEIGHT;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_RENDER_TARGET;
+   tex = screen->resource_create(screen, &templ);
+
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = format;
+   surf = pipe->create_surface(pipe, tex, &surf_templ);
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = WIDTH;
+   fb.height = HEIGHT;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = surf;
+   pipe->set_framebuffer_state(pipe, &fb);
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].blend_enable = 1;
+   blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+   blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+   blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+   blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+   blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   blend_cso = pipe->create_blend_state(pipe, &blend);
+   pipe->bind_blend_state(pipe, blend_cso);
+
+   memset(&dsa, 0, sizeof dsa);
+   dsa_cso = pipe->create_depth_stencil_alpha_state(pipe, &dsa);
+   pipe->bind_depth_stencil_alpha_state(pipe, dsa_cso);
+
+   memset(&rast, 0, sizeof rast);
+   rast.cull_face = PIPE_FACE_NONE;
+   rast.gl_rasterization_rules = 1;
+   rast.depth_clip = 1;
+   rast_cso = pipe->create_rasterizer_state(pipe, &rast);
+   pipe->bind_rasterizer_state(pipe, rast_cso);
+
+   memset(&viewport, 0, sizeof viewport);
+   viewport.scale[0] = WIDTH / 2.0f;
+   viewport.scale[1] = HEIGHT / 2.0f;
+   viewport.scale[2] = 0.5f;
+   viewport.scale[3] = 1.0f;
+   viewport.translate[0] = WIDTH / 2.0f;
+   viewport.translate[1] = HEIGHT / 2.0f;
+   viewport.translate[2] = 0.5f;
+   pipe->set_viewport_state(pipe, &viewport);
+
+   memset(velem, 0, sizeof velem);
+   velem[0].src_offset = 0;
+   velem[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   velem[1].src_offset = 4 * sizeof(float);
+   velem[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   velem_cso = pipe->create_vertex_elements_state(pipe, 2, velem);
+   pipe->bind_vertex_elements_state(pipe, velem_cso);
+
+   vs = util_make_vertex_passthrough_shader(pipe, 2, semantic_names,
+                                            semantic_indexes);
+   pipe->bind_vs_state(pipe, vs);
+   fs = util_make_fragment_passthrough_shader(pipe);
+   pipe->bind_fs_state(pipe, fs);
+
+   for (layer = 0; layer < NUM_LAYERS; layer++)
+      make_layer(vertices[layer], layer);
+   vbuf = pipe_buffer_create(screen, PIPE_BIND_VERTEX_BUFFER,
+                             PIPE_USAGE_STATIC, sizeof vertices);
+   pipe_buffer_write(pipe, vbuf, 0, sizeof vertices, vertices);
+
+   clear_color.f[0] = 0.2f;
+   clear_color.f[1] = 0.4f;
+   clear_color.f[2] = 0.6f;
+   clear_color.f[3] = 1.0f;
+   pipe->clear(pipe, PIPE_CLEAR_COLOR, &clear_color, 0.0, 0);
+
+   /* one draw per layer, so tiles are reloaded between draws */
+   for (layer = 0; layer < NUM_LAYERS; layer++)
+      util_draw_vertex_buffer(pipe, NULL, vbuf, 0,
+                              layer * sizeof vertices[0],
+                              PIPE_PRIM_TRIANGLES, 9, 2);
+
+   pipe->flush(pipe, NULL);
+
+   stride = util_format_get_stride(format, WIDTH);
+   image = MALLOC(stride * HEIGHT);
+   map = pipe_transfer_map(pipe, tex, 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, WIDTH, HEIGHT, &transfer);
+   for (y = 0; y < HEIGHT; y++)
+      memcpy(image + y * stride, map + y * transfer->stride, stride);
+   pipe->transfer_unmap(pipe, transfer);
+
+   pipe->bind_vs_state(pipe, NULL);
+   pipe->bind_fs_state(pipe, NULL);
+   pipe->delete_vs_state(pipe, vs);
+   pipe->delete_fs_state(pipe, fs);
+   pipe->bind_blend_state(pipe, NULL);
+   pipe->delete_blend_state(pipe, blend_cso);
+   pipe->bind_depth_stencil_alpha_state(pipe, NULL);
+   pipe->delete_depth_stencil_alpha_state(pipe, dsa_cso);
+   pipe->bind_rasterizer_state(pipe, NULL);
+   pipe->delete_rasterizer_state(pipe, rast_cso);
+   pipe->bind_vertex_elements_state(pipe, NULL);
+   pipe->delete_vertex_elements_state(pipe, velem_cso);
+
+   memset(&fb, 0, sizeof fb);
+   pipe->set_framebuffer_state(pipe, &fb);
+   pipe_surface_reference(&surf, NULL);
+   pipe_resource_reference(&tex, NULL);
+   pipe_resource_reference(&vbuf, NULL);
+   pipe->destroy(pipe);
+
+   return image;
+}
+
+
+int
+main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   unsigned i, j, fails = 0;
+
+   screen = softpipe_create_screen(null_sw_create());
+   if (!screen) {
+      printf("Failure! Could not create the screen.\n");
+      return 1;
+   }
+
+   for (i = 0; i < Elements(formats); i++) {
+      const unsigned stride = util_format_get_stride(formats[i], WIDTH);
+      void *reference;
+
+      if (!screen->is_format_supported(screen, formats[i], PIPE_TEXTURE_2D,
+                                       0, PIPE_BIND_RENDER_TARGET))
+         continue;
+
+      reference = render(screen, formats[i], 1);
+      assert(reference);
+
+      for (j = 0; j < Elements(thread_counts); j++) {
+         void *image = render(screen, formats[i], thread_counts[j]);
+
+         printf("%s, %u threads\n", util_format_name(formats[i]),
+                thread_counts[j]);
+
+         if (memcmp(image, reference, stride * HEIGHT) != 0) {
+            printf("Test failed: %s differs with %u threads.\n",
+                   util_format_name(formats[i]), thread_counts[j]);
+            ++fails;
+         }
+
+         FREE(image);
+      }
+
+      FREE(reference);
+   }
+
+   screen->destroy(screen);
+
+   if (fails)
+      printf("Failure! %u tests failed.\n", fails);
+   else
+      printf("Success!\n");
+
+   return fails != 0;
+}
@@ -0,0 +1,247 @@
+/*
+ * Test case for the softpipe quad image filters.
+ *
+ * Filters random quads of texcoords with the quad version of the 2D image
+ * filters and with the per-pixel filters they stand in for, and checks
+ * that the results match.  Covers nearest and linear filtering with the
+ * REPEAT and CLAMP_TO_EDGE wrap modes on POT and NPOT textures.
+ */
+
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "softpipe/sp_public.h"
+#include "softpipe/sp_tex_sample.h"
+#include "softpipe/sp_tex_tile_cache.h"
+#include "sw/null/null_sw_winsys.h"
+
+
+#define NUM_QUADS 4096
+#define TOLERANCE 1e-5f
+
+
+static const struct {
+   unsigned width, height;
+} sizes[] = {
+   { 64, 64 },
+   { 128, 32 },
+   { 61, 37 },
+   { 100, 3 },
+};
+
+static const unsigned wraps[] = {
+   PIPE_TEX_WRAP_REPEAT,
+   PIPE_TEX_WRAP_CLAMP_TO_EDGE,
+};
+
+static const unsigned filters[] = {
+   PIPE_TEX_FILTER_NEAREST,
+   PIPE_TEX_FILTER_LINEAR,
+};
+
+
+static float
+rand_float(float min, float max)
+{
+   return min + (max - min) * ((float) rand() / (float) RAND_MAX);
+}
+
+
+static struct pipe_resource *
+create_texture(struct pipe_context *pipe, unsigned width, unsigned height)
+{
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_resource templ, *tex;
+   struct pipe_transfer *transfer;
+   ubyte *map;
+   unsigned x, y;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   templ.width0 = width;
+   templ.height0 = height;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_SAMPLER_VIEW;
+
+   tex = screen->resource_create(screen, &templ);
+   assert(tex);
+
+   map = pipe_transfer_map(pipe, tex, 0, 0, PIPE_TRANSFER_WRITE,
+                           0, 0, width, height, &transfer);
+   for (y = 0; y < height; y++) {
+      ubyte *row = map + y * transfer->stride;
+      for (x = 0; x < width * 4; x++)
+         row[x] = rand() & 0xff;
+   }
+   pipe->transfer_unmap(pipe, transfer);
+
+   return tex;
+}
+
+
+/**
+ * Filter random quads with both versions of the image filter selected for
+ * the given state.  Returns 1 if the results differ, 0 otherwise.
+ */
+static unsigned
+test_filter(struct pipe_sampler_view *view, struct softpipe_tex_tile_cache *tc,
+            unsigned wrap, unsigned filter)
+{
+   const struct pipe_resource *tex = view->texture;
+   struct pipe_sampler_state sampler;
+   struct sp_sampler_variant *samp;
+   union sp_sampler_key key;
+   unsigned i, j, c, quads = 0, wrong = 0;
+
+   memset(&sampler, 0, sizeof sampler);
+   sampler.wrap_s = wrap;
+   sampler.wrap_t = wrap;
+   sampler.wrap_r = wrap;
+   sampler.min_img_filter = filter;
+   sampler.mag_img_filter = filter;
+   sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+   sampler.normalized_coords = 1;
+
+   key.value = 0;
+   key.bits.target = PIPE_TEXTURE_2D;
+   key.bits.is_pot = util_is_power_of_two(tex->width0) &&
+                     util_is_power_of_two(tex->height0);
+   key.bits.swizzle_r = PIPE_SWIZZLE_RED;
+   key.bits.swizzle_g = PIPE_SWIZZLE_GREEN;
+   key.bits.swizzle_b = PIPE_SWIZZLE_BLUE;
+   key.bits.swizzle_a = PIPE_SWIZZLE_ALPHA;
+
+   samp = sp_create_sampler_variant(&sampler, key);
+   assert(samp);
+   sp_sampler_variant_bind_view(samp, tc, view);
+
+   printf("Testing %ux%u, %s, %s: ",
+          tex->width0, tex->height0,
+          wrap == PIPE_TEX_WRAP_REPEAT ? "REPEAT" : "CLAMP_TO_EDGE",
+          filter == PIPE_TEX_FILTER_NEAREST ? "NEAREST" : "LINEAR");
+
+   if (!samp->min_img_filter_quad) {
+      printf("no quad filter, skipped\n");
+      sp_sampler_variant_destroy(samp);
+      return 0;
+   }
+
+   for (i = 0; i < NUM_QUADS; i++) {
+      float s[TGSI_QUAD_SIZE], t[TGSI_QUAD_SIZE], p[TGSI_QUAD_SIZE];
+      float rgba_quad[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+      float rgba_pixel[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+      const float s0 = rand_float(-2.0f, 3.0f);
+      const float t0 = rand_float(-2.0f, 3.0f);
+      const float ds = rand_float(-2.0f, 2.0f) / tex->width0;
+      const float dt = rand_float(-2.0f, 2.0f) / tex->height0;
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         s[j] = s0 + (j & 1) * ds;
+         t[j] = t0 + (j >> 1) * dt;
+         p[j] = 0.0f;
+         samp->faces[j] = 0;
+      }
+
+      if (!samp->min_img_filter_quad(samp, s, t, 0, rgba_quad))
+         continue;
+      quads++;
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++)
+         samp->min_img_filter(&samp->base, s[j], t[j], p[j], 0, 0,
+                              tgsi_sampler_lod_bias, &rgba_pixel[0][j]);
+
+      for (c = 0; c < TGSI_NUM_CHANNELS; c++) {
+         for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+            if (fabsf(rgba_quad[c][j] - rgba_pixel[c][j]) > TOLERANCE)
+               break;
+         }
+         if (j < TGSI_QUAD_SIZE)
+            break;
+      }
+      if (c < TGSI_NUM_CHANNELS) {
+         if (!wrong)
+            printf("\n  s = %f, t = %f: channel %u, pixel %u: %f != %f\n  ",
+                   s[j], t[j], c, j, rgba_quad[c][j], rgba_pixel[c][j]);
+         wrong++;
+      }
+   }
+
+   printf("%u quads, %u wrong\n", quads, wrong);
+
+   sp_sampler_variant_destroy(samp);
+
+   /* A quad filter that never handles anything tests nothing. */
+   if (quads == 0)
+      return 1;
+   return wrong != 0;
+}
+
+
+int main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   unsigned i, w, f, fails = 0;
+
+   screen = softpipe_create_screen(null_sw_create());
+   if (!screen) {
+      printf("Failure! Could not create the screen.\n");
+      return 1;
+   }
+
+   pipe = screen->context_create(screen, NULL);
+   if (!pipe) {
+      printf("Failure! Could not create the context.\n");
+      return 1;
+   }
+
+   srand(0);
+
+   for (i = 0; i < Elements(sizes); i++) {
+      struct pipe_resource *tex;
+      struct pipe_sampler_view templ, *view;
+      struct softpipe_tex_tile_cache *tc;
+
+      tex = create_texture(pipe, sizes[i].width, sizes[i].height);
+      u_sampler_view_default_template(&templ, tex, tex->format);
+      view = pipe->create_sampler_view(pipe, tex, &templ);
+
+      tc = sp_create_tex_tile_cache(pipe);
+      sp_tex_tile_cache_set_sampler_view(tc, view);
+
+      for (w = 0; w < Elements(wraps); w++) {
+         for (f = 0; f < Elements(filters); f++)
+            fails += test_filter(view, tc, wraps[w], filters[f]);
+      }
+
+      sp_tex_tile_cache_set_sampler_view(tc, NULL);
+      sp_destroy_tex_tile_cache(tc);
+
+      pipe_sampler_view_reference(&view, NULL);
+      pipe_resource_reference(&tex, NULL);
+   }
+
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+
+   if (fails)
+      printf("Failure! %u tests failed.\n", fails);
+   else
+      printf("Success!\n");
+
+   return fails != 0;
+}
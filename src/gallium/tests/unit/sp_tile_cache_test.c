@@ -0,0 +1,218 @@
+/*
+ * Test case for the softpipe render target and texture tile caches.
+ *
+ * The surfaces are walked quad by quad in scanline order, the way the
+ * rasterizer walks a triangle covering them.  On a 4K surface a row of
+ * tiles is wider than the old direct mapped caches, which then reloaded
+ * every tile once per quad row; each tile must now be loaded only once.
+ */
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "softpipe/sp_public.h"
+#include "softpipe/sp_tile_cache.h"
+#include "softpipe/sp_tex_tile_cache.h"
+#include "sw/null/null_sw_winsys.h"
+
+
+static struct pipe_resource *
+create_texture(struct pipe_screen *screen, enum pipe_format format,
+               unsigned width, unsigned height, unsigned bind)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = format;
+   templ.width0 = width;
+   templ.height0 = height;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = bind;
+
+   return screen->resource_create(screen, &templ);
+}
+
+
+static unsigned
+pattern(unsigned x, unsigned y)
+{
+   return (y << 16) ^ x ^ 0xa5000000;
+}
+
+
+static unsigned
+num_tiles(unsigned width, unsigned height)
+{
+   return ((width + TILE_SIZE - 1) / TILE_SIZE) *
+          ((height + TILE_SIZE - 1) / TILE_SIZE);
+}
+
+
+/**
+ * Write every pixel of a 32-bit color surface through a render target tile
+ * cache with the given number of bands, and check the cache statistics and
+ * the surface contents.
+ */
+static void
+test_render(struct pipe_context *pipe, unsigned width, unsigned height,
+            unsigned num_bands)
+{
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_resource *tex;
+   struct pipe_surface templ, *surf;
+   struct pipe_transfer *transfer;
+   struct softpipe_tile_cache *tc;
+   struct sp_tile_cache_stats stats;
+   union pipe_color_union color;
+   const ubyte *map;
+   unsigned x, y, j, wrong = 0;
+
+   tex = create_texture(screen, PIPE_FORMAT_B8G8R8A8_UNORM, width, height,
+                        PIPE_BIND_RENDER_TARGET);
+   assert(tex);
+
+   memset(&templ, 0, sizeof templ);
+   templ.format = tex->format;
+   surf = pipe->create_surface(pipe, tex, &templ);
+
+   tc = sp_create_tile_cache(pipe, num_bands);
+   sp_tile_cache_set_surface(tc, surf);
+
+   memset(&color, 0, sizeof color);
+   sp_tile_cache_clear(tc, &color, 0);
+
+   for (y = 0; y < height; y += 2) {
+      for (x = 0; x < width; x += 2) {
+         struct softpipe_cached_tile *tile = sp_get_cached_tile(tc, x, y);
+
+         for (j = 0; j < 4; j++) {
+            const unsigned px = x + (j & 1);
+            const unsigned py = y + (j >> 1);
+            tile->data.color32[py % TILE_SIZE][px % TILE_SIZE] =
+               pattern(px, py);
+         }
+      }
+   }
+
+   sp_flush_tile_cache(tc);
+
+   sp_tile_cache_get_stats(tc, &stats);
+   printf("render %ux%u, %u bands: %llu hits, %llu misses, %llu evictions\n",
+          width, height, num_bands,
+          (unsigned long long) stats.hits,
+          (unsigned long long) stats.misses,
+          (unsigned long long) stats.evictions);
+   assert(stats.misses == num_tiles(width, height));
+   assert(stats.evictions <= stats.misses);
+   assert(stats.hits + stats.misses == (width / 2) * (height / 2));
+
+   sp_tile_cache_set_surface(tc, NULL);
+   sp_destroy_tile_cache(tc);
+
+   map = pipe_transfer_map(pipe, tex, 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, width, height, &transfer);
+   for (y = 0; y < height; y++) {
+      const unsigned *row = (const unsigned *) (map + y * transfer->stride);
+      for (x = 0; x < width; x++) {
+         if (row[x] != pattern(x, y))
+            wrong++;
+      }
+   }
+   pipe->transfer_unmap(pipe, transfer);
+   assert(wrong == 0);
+
+   pipe_surface_reference(&surf, NULL);
+   pipe_resource_reference(&tex, NULL);
+}
+
+
+/**
+ * Read every texel of a texture through a texture tile cache and check the
+ * cache statistics.
+ */
+static void
+test_texture(struct pipe_context *pipe, unsigned width, unsigned height)
+{
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_resource *tex;
+   struct pipe_sampler_view templ, *view;
+   struct softpipe_tex_tile_cache *tc;
+   struct sp_tex_tile_cache_stats stats;
+   unsigned x, y;
+
+   tex = create_texture(screen, PIPE_FORMAT_B8G8R8A8_UNORM, width, height,
+                        PIPE_BIND_SAMPLER_VIEW);
+   assert(tex);
+
+   u_sampler_view_default_template(&templ, tex, tex->format);
+   view = pipe->create_sampler_view(pipe, tex, &templ);
+
+   tc = sp_create_tex_tile_cache(pipe);
+   sp_tex_tile_cache_set_sampler_view(tc, view);
+
+   for (y = 0; y < height; y += 2) {
+      for (x = 0; x < width; x += 2) {
+         union tex_tile_address addr = tex_tile_address(x, y, 0, 0, 0);
+         const struct softpipe_tex_cached_tile *tile =
+            sp_get_cached_tile_tex(tc, addr);
+         assert(tile->addr.value == addr.value);
+      }
+   }
+
+   sp_tex_tile_cache_get_stats(tc, &stats);
+   printf("texture %ux%u: %llu hits, %llu misses, %llu evictions\n",
+          width, height,
+          (unsigned long long) stats.hits,
+          (unsigned long long) stats.misses,
+          (unsigned long long) stats.evictions);
+   assert(stats.misses == num_tiles(width, height));
+   assert(stats.hits + stats.misses == (width / 2) * (height / 2));
+
+   sp_tex_tile_cache_set_sampler_view(tc, NULL);
+   sp_destroy_tex_tile_cache(tc);
+
+   pipe_sampler_view_reference(&view, NULL);
+   pipe_resource_reference(&tex, NULL);
+}
+
+
+int main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+
+   screen = softpipe_create_screen(null_sw_create());
+   if (!screen) {
+      printf("failed to create screen\n");
+      return 1;
+   }
+
+   pipe = screen->context_create(screen, NULL);
+   if (!pipe) {
+      printf("failed to create context\n");
+      return 1;
+   }
+
+   test_render(pipe, 256, 256, 1);
+   test_render(pipe, 3840, 2160, 1);
+   test_render(pipe, 3840, 2160, 3);
+   test_render(pipe, 3840, 2160, 8);
+   test_texture(pipe, 256, 256);
+   test_texture(pipe, 3840, 2160);
+
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+
+   printf("Success!\n");
+   return 0;
+}
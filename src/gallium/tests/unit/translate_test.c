@@ -29,6 +29,7 @@
 #include "util/u_format.h"
 #include "util/u_half.h"
 #include "util/u_cpu_detect.h"
+#include "os/os_time.h"
 #include "rtasm/rtasm_cpu.h"
 
 /* don't use this for serious use */
@@ -46,6 +47,84 @@ static double rand_double()
    return v;
 }
 
+/**
+ * Measure throughput of run_elts() for some common vertex conversions.
+ */
+static void
+benchmark(struct translate *(*create_fn)(const struct translate_key *key),
+          const char *name)
+{
+   static const struct {
+      enum pipe_format input_format;
+      enum pipe_format output_format;
+   } conversions[] = {
+      { PIPE_FORMAT_R32G32B32_FLOAT,    PIPE_FORMAT_R32G32B32_FLOAT },
+      { PIPE_FORMAT_R32G32B32_FLOAT,    PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R8G8B8A8_UNORM,     PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R16G16B16A16_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R16G16_SNORM,       PIPE_FORMAT_R32G32_FLOAT },
+      { PIPE_FORMAT_R64G64B64_FLOAT,    PIPE_FORMAT_R32G32B32_FLOAT },
+   };
+   const unsigned nr_vertices = 64 * 1024;
+   const unsigned nr_iterations = 64;
+   unsigned char *input, *output;
+   unsigned *elts;
+   unsigned i, j;
+
+   input = align_malloc(nr_vertices * 32, 4096);
+   output = align_malloc(nr_vertices * 32, 4096);
+   elts = align_malloc(nr_vertices * sizeof *elts, 4096);
+
+   memset(input, 0, nr_vertices * 32);
+
+   /* pseudo-random, but cache friendly, access pattern */
+   for (i = 0; i < nr_vertices; ++i)
+      elts[i] = (i & ~7) | ((i * 5) & 7);
+
+   for (i = 0; i < Elements(conversions); ++i) {
+      struct translate_key key;
+      struct translate *translate;
+      unsigned input_size = util_format_get_stride(conversions[i].input_format, 1);
+      unsigned output_size = util_format_get_stride(conversions[i].output_format, 1);
+      int64_t start, end;
+
+      memset(&key, 0, sizeof key);
+      key.output_stride = output_size;
+      key.nr_elements = 1;
+      key.element[0].type = TRANSLATE_ELEMENT_NORMAL;
+      key.element[0].input_format = conversions[i].input_format;
+      key.element[0].output_format = conversions[i].output_format;
+
+      translate = create_fn(&key);
+      if (!translate) {
+         printf("SKIP: %s -> %s\n",
+                util_format_name(conversions[i].input_format),
+                util_format_name(conversions[i].output_format));
+         continue;
+      }
+
+      translate->set_buffer(translate, 0, input, input_size, nr_vertices - 1);
+
+      start = os_time_get();
+      for (j = 0; j < nr_iterations; ++j)
+         translate->run_elts(translate, elts, nr_vertices, 0, output);
+      end = os_time_get();
+
+      printf("BENCH: %s -> %s: %.1f Mvertices/s, %.1f MB/s read (translate_%s)\n",
+             util_format_name(conversions[i].input_format),
+             util_format_name(conversions[i].output_format),
+             (double)nr_vertices * nr_iterations / MAX2(end - start, 1),
+             (double)nr_vertices * nr_iterations * input_size / MAX2(end - start, 1),
+             name);
+
+      translate->release(translate);
+   }
+
+   align_free(elts);
+   align_free(output);
+   align_free(input);
+}
+
 int main(int argc, char** argv)
 {
    struct translate *(*create_fn)(const struct translate_key *key) = 0;
@@ -74,6 +153,8 @@ int main(int argc, char** argv)
    {}
    else if (!strcmp(argv[1], "generic"))
       create_fn = translate_generic_create;
+   else if (!strcmp(argv[1], "llvm"))
+      create_fn = translate_llvm_create;
    else if (!strcmp(argv[1], "x86"))
       create_fn = translate_sse2_create;
    else if (!strcmp(argv[1], "nosse"))
@@ -129,7 +210,7 @@ int main(int argc, char** argv)
 
    if (!create_fn)
    {
-      printf("Usage: ./translate_test [generic|x86|nosse|sse|sse2|sse3|sse4.1]\n");
+      printf("Usage: ./translate_test [generic|llvm|x86|nosse|sse|sse2|sse3|sse4.1] [bench]\n");
       return 2;
    }
 
@@ -320,5 +401,9 @@ int main(int argc, char** argv)
    }
 
    printf("%u/%u tests passed for translate_%s\n", passed, total, argv[1]);
+
+   if (argc > 2 && !strcmp(argv[2], "bench"))
+      benchmark(create_fn, argv[1]);
+
    return passed != total;
 }
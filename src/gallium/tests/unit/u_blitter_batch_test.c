@@ -0,0 +1,358 @@
+/*
+ * Test case for the u_blitter batches.
+ *
+ * Blits and clears many rectangles once with the single rectangle
+ * functions and once with a batch, on softpipe, and checks that the images
+ * are identical.  There are more rectangles than a batch draws at once.
+ */
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "util/u_blitter.h"
+#include "util/u_box.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "softpipe/sp_public.h"
+#include "sw/null/null_sw_winsys.h"
+
+
+#define SIZE 128
+#define NUM_RECTS 150
+#define FORMAT PIPE_FORMAT_B8G8R8A8_UNORM
+
+
+struct rect {
+   int dstx, dsty;
+   unsigned width, height;
+   struct pipe_box src;
+};
+
+
+/**
+ * Make rectangles of various sizes, some of them scaled or flipped.
+ */
+static void
+make_rects(struct rect *rects, unsigned src_layer)
+{
+   unsigned i;
+
+   for (i = 0; i < NUM_RECTS; i++) {
+      struct rect *r = &rects[i];
+
+      r->width = 1 + (i * 7) % 13;
+      r->height = 1 + (i * 5) % 11;
+      r->dstx = (i * 37) % (SIZE - r->width);
+      r->dsty = (i * 53) % (SIZE - r->height);
+
+      u_box_2d_zslice((i * 29) % (SIZE - 32), (i * 31) % (SIZE - 32),
+                      src_layer, r->width, r->height, &r->src);
+      if (i % 3 == 1)
+         r->src.width = 2 * r->width;
+      if (i % 5 == 2) {
+         r->src.x += r->src.width;
+         r->src.width = -r->src.width;
+      }
+   }
+}
+
+
+/**
+ * Save the states the blitter restores.  Nothing is bound in the test, so
+ * they are all empty.
+ */
+static void
+save_states(struct blitter_context *blitter)
+{
+   struct pipe_vertex_buffer vertex_buffers[PIPE_MAX_ATTRIBS];
+   struct pipe_framebuffer_state fb;
+   struct pipe_viewport_state viewport;
+   struct pipe_scissor_state scissor;
+   struct pipe_stencil_ref stencil_ref;
+
+   memset(vertex_buffers, 0, sizeof vertex_buffers);
+   memset(&fb, 0, sizeof fb);
+   memset(&viewport, 0, sizeof viewport);
+   memset(&scissor, 0, sizeof scissor);
+   memset(&stencil_ref, 0, sizeof stencil_ref);
+
+   util_blitter_save_vertex_buffer_slot(blitter, vertex_buffers);
+   util_blitter_save_vertex_elements(blitter, NULL);
+   util_blitter_save_vertex_shader(blitter, NULL);
+   util_blitter_save_geometry_shader(blitter, NULL);
+   util_blitter_save_so_targets(blitter, 0, NULL);
+   util_blitter_save_rasterizer(blitter, NULL);
+   util_blitter_save_viewport(blitter, &viewport);
+   util_blitter_save_scissor(blitter, &scissor);
+   util_blitter_save_fragment_shader(blitter, NULL);
+   util_blitter_save_blend(blitter, NULL);
+   util_blitter_save_depth_stencil_alpha(blitter, NULL);
+   util_blitter_save_stencil_ref(blitter, &stencil_ref);
+   util_blitter_save_framebuffer(blitter, &fb);
+   util_blitter_save_fragment_sampler_states(blitter, 0, NULL);
+   util_blitter_save_fragment_sampler_views(blitter, 0, NULL);
+   util_blitter_save_render_condition(blitter, NULL, 0);
+}
+
+
+static struct pipe_resource *
+create_texture(struct pipe_screen *screen, enum pipe_texture_target target,
+               unsigned array_size, unsigned bind)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = target;
+   templ.format = FORMAT;
+   templ.width0 = SIZE;
+   templ.height0 = SIZE;
+   templ.depth0 = 1;
+   templ.array_size = array_size;
+   templ.bind = bind;
+
+   return screen->resource_create(screen, &templ);
+}
+
+
+/**
+ * Fill each layer of the texture with a different pattern.
+ */
+static void
+fill_texture(struct pipe_context *pipe, struct pipe_resource *tex)
+{
+   uint32_t *data = MALLOC(SIZE * SIZE * 4);
+   struct pipe_box box;
+   unsigned layer, i;
+
+   for (layer = 0; layer < tex->array_size; layer++) {
+      for (i = 0; i < SIZE * SIZE; i++)
+         data[i] = (i * 2654435761u) ^ (layer * 0x01010101u);
+
+      u_box_2d_zslice(0, 0, layer, SIZE, SIZE, &box);
+      pipe->transfer_inline_write(pipe, tex, 0, PIPE_TRANSFER_WRITE, &box,
+                                  data, SIZE * 4, SIZE * SIZE * 4);
+   }
+
+   FREE(data);
+}
+
+
+static struct pipe_surface *
+create_surface(struct pipe_context *pipe, struct pipe_resource *tex)
+{
+   struct pipe_surface templ;
+   union pipe_color_union color;
+   struct pipe_surface *surf;
+
+   memset(&templ, 0, sizeof templ);
+   templ.format = FORMAT;
+   surf = pipe->create_surface(pipe, tex, &templ);
+
+   color.f[0] = 0.25f;
+   color.f[1] = 0.5f;
+   color.f[2] = 0.75f;
+   color.f[3] = 1.0f;
+   pipe->clear_render_target(pipe, surf, &color, 0, 0, SIZE, SIZE);
+
+   return surf;
+}
+
+
+/**
+ * Return whether the two textures have the same contents.
+ */
+static boolean
+compare_textures(struct pipe_context *pipe, struct pipe_resource *a,
+                 struct pipe_resource *b)
+{
+   struct pipe_transfer *ta, *tb;
+   const ubyte *ma, *mb;
+   boolean equal = TRUE;
+   unsigned y;
+
+   ma = pipe_transfer_map(pipe, a, 0, 0, PIPE_TRANSFER_READ,
+                          0, 0, SIZE, SIZE, &ta);
+   mb = pipe_transfer_map(pipe, b, 0, 0, PIPE_TRANSFER_READ,
+                          0, 0, SIZE, SIZE, &tb);
+
+   for (y = 0; y < SIZE; y++) {
+      if (memcmp(ma + y * ta->stride, mb + y * tb->stride, SIZE * 4) != 0)
+         equal = FALSE;
+   }
+
+   pipe->transfer_unmap(pipe, ta);
+   pipe->transfer_unmap(pipe, tb);
+
+   return equal;
+}
+
+
+/**
+ * Blit the rectangles from a texture of the given target, rectangle by
+ * rectangle and as a batch.
+ */
+static boolean
+test_blit(struct pipe_context *pipe, struct blitter_context *blitter,
+          enum pipe_texture_target target)
+{
+   struct pipe_screen *screen = pipe->screen;
+   unsigned array_size = target == PIPE_TEXTURE_2D_ARRAY ? 2 : 1;
+   struct pipe_resource *src, *dst[2];
+   struct pipe_surface *surf[2];
+   struct pipe_sampler_view templ, *view;
+   struct rect rects[NUM_RECTS];
+   boolean equal;
+   unsigned i;
+
+   src = create_texture(screen, target, array_size, PIPE_BIND_SAMPLER_VIEW);
+   fill_texture(pipe, src);
+   util_blitter_default_src_texture(&templ, src, 0);
+   view = pipe->create_sampler_view(pipe, src, &templ);
+
+   for (i = 0; i < 2; i++) {
+      dst[i] = create_texture(screen, PIPE_TEXTURE_2D, 1,
+                              PIPE_BIND_RENDER_TARGET);
+      surf[i] = create_surface(pipe, dst[i]);
+   }
+
+   make_rects(rects, array_size - 1);
+
+   for (i = 0; i < NUM_RECTS; i++) {
+      save_states(blitter);
+      util_blitter_blit_generic(blitter, surf[0],
+                                rects[i].dstx, rects[i].dsty,
+                                rects[i].width, rects[i].height,
+                                view, &rects[i].src, SIZE, SIZE,
+                                PIPE_MASK_RGBA, PIPE_TEX_FILTER_NEAREST,
+                                NULL, FALSE);
+   }
+
+   save_states(blitter);
+   util_blitter_begin_blit_batch(blitter, surf[1], view, SIZE, SIZE,
+                                 PIPE_MASK_RGBA, PIPE_TEX_FILTER_NEAREST,
+                                 NULL);
+   for (i = 0; i < NUM_RECTS; i++) {
+      util_blitter_batch_blit(blitter, rects[i].dstx, rects[i].dsty,
+                              rects[i].width, rects[i].height,
+                              &rects[i].src);
+   }
+   util_blitter_end_batch(blitter);
+
+   equal = compare_textures(pipe, dst[0], dst[1]);
+
+   for (i = 0; i < 2; i++) {
+      pipe_surface_reference(&surf[i], NULL);
+      pipe_resource_reference(&dst[i], NULL);
+   }
+   pipe_sampler_view_reference(&view, NULL);
+   pipe_resource_reference(&src, NULL);
+
+   return equal;
+}
+
+
+/**
+ * Clear the rectangles, rectangle by rectangle and as a batch.
+ */
+static boolean
+test_clear(struct pipe_context *pipe, struct blitter_context *blitter)
+{
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_resource *dst[2];
+   struct pipe_surface *surf[2];
+   struct rect rects[NUM_RECTS];
+   union pipe_color_union color;
+   boolean equal;
+   unsigned i;
+
+   for (i = 0; i < 2; i++) {
+      dst[i] = create_texture(screen, PIPE_TEXTURE_2D, 1,
+                              PIPE_BIND_RENDER_TARGET);
+      surf[i] = create_surface(pipe, dst[i]);
+   }
+
+   make_rects(rects, 0);
+
+   color.f[0] = 1.0f;
+   color.f[1] = 0.2f;
+   color.f[2] = 0.0f;
+   color.f[3] = 0.6f;
+
+   for (i = 0; i < NUM_RECTS; i++) {
+      save_states(blitter);
+      util_blitter_clear_render_target(blitter, surf[0], &color,
+                                       rects[i].dstx, rects[i].dsty,
+                                       rects[i].width, rects[i].height);
+   }
+
+   save_states(blitter);
+   util_blitter_begin_clear_batch(blitter, surf[1], &color);
+   for (i = 0; i < NUM_RECTS; i++) {
+      util_blitter_batch_clear(blitter, rects[i].dstx, rects[i].dsty,
+                               rects[i].width, rects[i].height);
+   }
+   util_blitter_end_batch(blitter);
+
+   equal = compare_textures(pipe, dst[0], dst[1]);
+
+   for (i = 0; i < 2; i++) {
+      pipe_surface_reference(&surf[i], NULL);
+      pipe_resource_reference(&dst[i], NULL);
+   }
+
+   return equal;
+}
+
+
+int
+main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct blitter_context *blitter;
+   unsigned fails = 0;
+
+   screen = softpipe_create_screen(null_sw_create());
+   if (!screen) {
+      printf("Failure! Could not create the screen.\n");
+      return 1;
+   }
+   pipe = screen->context_create(screen, NULL);
+   blitter = util_blitter_create(pipe);
+
+   printf("Testing blits from a 2D texture...\n");
+   if (!test_blit(pipe, blitter, PIPE_TEXTURE_2D)) {
+      printf("Test failed: the batched blits from a 2D texture differ.\n");
+      ++fails;
+   }
+
+   printf("Testing blits from a 2D array texture...\n");
+   if (!test_blit(pipe, blitter, PIPE_TEXTURE_2D_ARRAY)) {
+      printf("Test failed: the batched blits from a 2D array differ.\n");
+      ++fails;
+   }
+
+   printf("Testing clears...\n");
+   if (!test_clear(pipe, blitter)) {
+      printf("Test failed: the batched clears differ.\n");
+      ++fails;
+   }
+
+   util_blitter_destroy(blitter);
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+
+   if (fails)
+      printf("Failure! %u tests failed.\n", fails);
+   else
+      printf("Success!\n");
+
+   return fails != 0;
+}
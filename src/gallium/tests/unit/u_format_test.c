@@ -28,9 +28,13 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <float.h>
 
+#include "os/os_time.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_half.h"
+#include "util/u_memory.h"
 #include "util/u_format.h"
 #include "util/u_format_tests.h"
 #include "util/u_format_s3tc.h"
@@ -725,12 +729,82 @@ test_all(void)
 }
 
 
+/**
+ * Measure the throughput of the pack/unpack functions of the formats which
+ * are most often converted.
+ */
+static void
+benchmark(void)
+{
+   static const enum pipe_format formats[] = {
+      PIPE_FORMAT_B8G8R8A8_UNORM,
+      PIPE_FORMAT_B8G8R8X8_UNORM,
+      PIPE_FORMAT_R8G8B8A8_UNORM,
+      PIPE_FORMAT_A8R8G8B8_UNORM,
+      PIPE_FORMAT_B5G6R5_UNORM,
+      PIPE_FORMAT_R16G16B16A16_FLOAT,
+      PIPE_FORMAT_R32G32B32A32_FLOAT,
+      PIPE_FORMAT_B8G8R8A8_SRGB,
+   };
+   const unsigned width = 1024, height = 256;
+   const unsigned nr_iterations = 16;
+   const unsigned float_stride = width * 4 * sizeof(float);
+   uint8_t *packed, *unpacked;
+   unsigned i, j;
+
+   packed = align_malloc(width * height * 16, 16);
+   unpacked = align_malloc(height * float_stride, 16);
+
+   for (i = 0; i < width * height * 16; ++i)
+      packed[i] = (uint8_t)(i * 7 + (i >> 8));
+   for (i = 0; i < width * height * 4; ++i)
+      ((float *)unpacked)[i] = (float)(i % 256) / 255.0f;
+
+   for (i = 0; i < Elements(formats); ++i) {
+      const struct util_format_description *format_desc;
+      unsigned stride;
+      int64_t start, end;
+
+      format_desc = util_format_description(formats[i]);
+      stride = util_format_get_stride(formats[i], width);
+
+#     define BENCH_ONE_FUNC(name, dst, dst_stride, src, src_stride) \
+      if (format_desc->name) { \
+         start = os_time_get(); \
+         for (j = 0; j < nr_iterations; ++j) \
+            format_desc->name(dst, dst_stride, src, src_stride, width, height); \
+         end = os_time_get(); \
+         printf("BENCH: util_format_%s_%s: %.1f Mpixels/s, %.1f MB/s\n", \
+                format_desc->short_name, #name, \
+                (double)width * height * nr_iterations / MAX2(end - start, 1), \
+                (double)stride * height * nr_iterations / MAX2(end - start, 1)); \
+      }
+
+      BENCH_ONE_FUNC(unpack_rgba_8unorm, unpacked, width * 4, packed, stride);
+      BENCH_ONE_FUNC(pack_rgba_8unorm, packed, stride, unpacked, width * 4);
+      BENCH_ONE_FUNC(unpack_rgba_float, (float *)unpacked, float_stride, packed, stride);
+      BENCH_ONE_FUNC(pack_rgba_float, packed, stride, (const float *)unpacked, float_stride);
+
+#     undef BENCH_ONE_FUNC
+   }
+
+   align_free(unpacked);
+   align_free(packed);
+}
+
+
 int main(int argc, char **argv)
 {
    boolean success;
 
+   util_cpu_detect();
    util_format_s3tc_init();
 
+   if (argc > 1 && !strcmp(argv[1], "bench")) {
+      benchmark();
+      return 0;
+   }
+
    success = test_all();
 
    return success ? 0 : 1;
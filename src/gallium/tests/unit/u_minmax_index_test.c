@@ -0,0 +1,87 @@
+#include <stdio.h>
+
+#include "pipe/p_compiler.h"
+#include "util/u_minmax_index.h"
+
+
+struct minmax_test {
+   unsigned index_size;
+   int primitive_restart;
+   unsigned restart_index;
+   unsigned min_index;
+   unsigned max_index;
+};
+
+
+static const struct minmax_test tests[] = {
+   /* Restart indices wider than the index type must not match. */
+   { 1, 1, 0xffff, 0, 0xff },
+   { 2, 1, 0xffffffff, 0, 0xffff },
+   { 1, 1, 0x1ff, 0, 0xff },
+   /* Restart indices which fit are skipped. */
+   { 1, 1, 0xff, 0, 7 },
+   { 2, 1, 0xffff, 0, 7 },
+   { 4, 1, 0xffffffff, 0, 7 },
+   { 1, 0, 0xff, 0, 0xff },
+};
+
+
+static unsigned
+fill_indices(void *indices, unsigned index_size, unsigned count)
+{
+   unsigned i;
+
+   /* Long enough for the vector paths, with the largest value first. */
+   for (i = 0; i < count; i++) {
+      unsigned value = i % 8;
+
+      if (i == 0)
+         value = index_size == 4 ? 0xffffffff : (1u << (index_size * 8)) - 1;
+
+      switch (index_size) {
+      case 1:
+         ((uint8_t *)indices)[i] = value;
+         break;
+      case 2:
+         ((uint16_t *)indices)[i] = value;
+         break;
+      default:
+         ((uint32_t *)indices)[i] = value;
+         break;
+      }
+   }
+   return count;
+}
+
+
+int
+main(int argc, char **argv)
+{
+   uint32_t indices[64];
+   unsigned i, fails = 0;
+
+   for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+      const struct minmax_test *t = &tests[i];
+      unsigned count, min_index, max_index;
+
+      count = fill_indices(indices, t->index_size, 33);
+      util_get_minmax_index(indices, t->index_size, count,
+                            t->primitive_restart, t->restart_index,
+                            &min_index, &max_index);
+
+      if (min_index != t->min_index || max_index != t->max_index) {
+         printf("Test %u failed: index size %u, restart %d 0x%x: "
+                "got [%u, %u], expected [%u, %u]\n",
+                i, t->index_size, t->primitive_restart, t->restart_index,
+                min_index, max_index, t->min_index, t->max_index);
+         ++fails;
+      }
+   }
+
+   if (fails)
+      printf("Failure! %u tests failed.\n", fails);
+   else
+      printf("Success!\n");
+
+   return fails != 0;
+}
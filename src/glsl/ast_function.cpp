@@ -347,6 +347,8 @@ match_function_by_name(const char *name,
 
    /* Local shader has no exact candidates; check the built-ins. */
    _mesa_glsl_initialize_functions(state);
+   _mesa_glsl_read_builtin_function(state->builtins_to_link,
+				    state->num_builtins_to_link, name);
    for (unsigned i = 0; i < state->num_builtins_to_link; i++) {
       ir_function *builtin =
 	 state->builtins_to_link[i]->symbols->get_function(name);
@@ -0,0 +1,190 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "blob.h"
+#include "ralloc.h"
+
+#define BLOB_INITIAL_SIZE 4096
+
+/**
+ * Make sure at least \c additional more bytes can be written to the blob.
+ */
+static bool
+grow_to_fit(struct blob *blob, size_t additional)
+{
+   size_t to_allocate;
+   uint8_t *new_data;
+
+   if (blob->out_of_memory)
+      return false;
+
+   if (blob->size + additional <= blob->allocated)
+      return true;
+
+   if (blob->allocated == 0)
+      to_allocate = BLOB_INITIAL_SIZE;
+   else
+      to_allocate = blob->allocated * 2;
+
+   if (to_allocate < blob->size + additional)
+      to_allocate = blob->size + additional;
+
+   new_data = reralloc_size(blob, blob->data, to_allocate);
+   if (new_data == NULL) {
+      blob->out_of_memory = true;
+      return false;
+   }
+
+   blob->data = new_data;
+   blob->allocated = to_allocate;
+
+   return true;
+}
+
+struct blob *
+blob_create(void *mem_ctx)
+{
+   return rzalloc(mem_ctx, struct blob);
+}
+
+bool
+blob_write_bytes(struct blob *blob, const void *bytes, size_t to_write)
+{
+   if (!grow_to_fit(blob, to_write))
+      return false;
+
+   if (to_write > 0) {
+      memcpy(blob->data + blob->size, bytes, to_write);
+      blob->size += to_write;
+   }
+
+   return true;
+}
+
+bool
+blob_write_uint32(struct blob *blob, uint32_t value)
+{
+   return blob_write_bytes(blob, &value, sizeof(value));
+}
+
+bool
+blob_write_uint64(struct blob *blob, uint64_t value)
+{
+   return blob_write_bytes(blob, &value, sizeof(value));
+}
+
+bool
+blob_write_string(struct blob *blob, const char *str)
+{
+   /* The length includes the terminator, so that zero can mean NULL. */
+   const uint32_t length = str == NULL ? 0 : strlen(str) + 1;
+
+   if (!blob_write_uint32(blob, length))
+      return false;
+
+   return length == 0 || blob_write_bytes(blob, str, length);
+}
+
+bool
+blob_overwrite_bytes(struct blob *blob, size_t offset,
+                     const void *bytes, size_t size)
+{
+   if (offset + size > blob->size)
+      return false;
+
+   memcpy(blob->data + offset, bytes, size);
+   return true;
+}
+
+void
+blob_reader_init(struct blob_reader *blob, const void *data, size_t size)
+{
+   blob->data = (const uint8_t *) data;
+   blob->end = blob->data + size;
+   blob->current = blob->data;
+   blob->overrun = false;
+}
+
+const void *
+blob_read_bytes(struct blob_reader *blob, size_t size)
+{
+   const void *ret;
+
+   if (blob->overrun || size > (size_t) (blob->end - blob->current)) {
+      blob->overrun = true;
+      return NULL;
+   }
+
+   ret = blob->current;
+   blob->current += size;
+
+   return ret;
+}
+
+uint32_t
+blob_read_uint32(struct blob_reader *blob)
+{
+   const void *bytes = blob_read_bytes(blob, sizeof(uint32_t));
+   uint32_t value = 0;
+
+   if (bytes != NULL)
+      memcpy(&value, bytes, sizeof(value));
+
+   return value;
+}
+
+uint64_t
+blob_read_uint64(struct blob_reader *blob)
+{
+   const void *bytes = blob_read_bytes(blob, sizeof(uint64_t));
+   uint64_t value = 0;
+
+   if (bytes != NULL)
+      memcpy(&value, bytes, sizeof(value));
+
+   return value;
+}
+
+const char *
+blob_read_string(struct blob_reader *blob)
+{
+   const uint32_t length = blob_read_uint32(blob);
+   const char *str;
+
+   if (length == 0)
+      return NULL;
+
+   str = (const char *) blob_read_bytes(blob, length);
+
+   /* A string that isn't terminated where its length says it is can only
+    * come from corrupt data.
+    */
+   if (str != NULL && str[length - 1] != '\0') {
+      blob->overrun = true;
+      return NULL;
+   }
+
+   return str;
+}
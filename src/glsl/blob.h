@@ -0,0 +1,121 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file blob.h
+ *
+ * A growable byte buffer for serializing data, and a matching reader.
+ *
+ * Values are written in host byte order and without any alignment, so a
+ * blob can only be read back on the machine (and build) that wrote it.
+ * Reads past the end of the data do not crash; they return zeros and set
+ * \c blob_reader::overrun, which callers check once at the end.
+ */
+
+#pragma once
+#ifndef BLOB_H
+#define BLOB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct blob {
+   uint8_t *data;       /**< ralloc'd as a child of the blob */
+   size_t size;         /**< Number of bytes written */
+   size_t allocated;    /**< Number of bytes allocated for \c data */
+   bool out_of_memory;  /**< Set if any write failed to grow \c data */
+};
+
+struct blob_reader {
+   const uint8_t *data;
+   const uint8_t *end;
+   const uint8_t *current;
+   bool overrun;        /**< Set if any read ran past \c end */
+};
+
+/**
+ * Create an empty blob, allocated as a ralloc child of \c mem_ctx.
+ */
+struct blob *
+blob_create(void *mem_ctx);
+
+bool
+blob_write_bytes(struct blob *blob, const void *bytes, size_t to_write);
+
+bool
+blob_write_uint32(struct blob *blob, uint32_t value);
+
+bool
+blob_write_uint64(struct blob *blob, uint64_t value);
+
+/**
+ * Write a string, which may be \c NULL, including its terminator.
+ */
+bool
+blob_write_string(struct blob *blob, const char *str);
+
+/**
+ * Overwrite \c size bytes previously written at \c offset.
+ *
+ * \return
+ * \c false if the bytes to overwrite have not been written yet.
+ */
+bool
+blob_overwrite_bytes(struct blob *blob, size_t offset,
+                     const void *bytes, size_t size);
+
+void
+blob_reader_init(struct blob_reader *blob, const void *data, size_t size);
+
+/**
+ * Return a pointer to the next \c size bytes of the blob, or \c NULL if
+ * there are fewer than \c size bytes left.
+ */
+const void *
+blob_read_bytes(struct blob_reader *blob, size_t size);
+
+uint32_t
+blob_read_uint32(struct blob_reader *blob);
+
+uint64_t
+blob_read_uint64(struct blob_reader *blob);
+
+/**
+ * Read a string written by \c blob_write_string.
+ *
+ * The returned pointer points into the blob's data, so the caller must copy
+ * the string if it needs to outlive the data.
+ */
+const char *
+blob_read_string(struct blob_reader *blob);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLOB_H */
@@ -37,3 +37,12 @@ _mesa_glsl_initialize_functions(_mesa_glsl_parse_state *state)
 {
    (void) state;
 }
+
+void
+_mesa_glsl_read_builtin_function(gl_shader **shader_list,
+				 unsigned num_shaders, const char *name)
+{
+   (void) shader_list;
+   (void) num_shaders;
+   (void) name;
+}
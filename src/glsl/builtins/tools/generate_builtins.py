@@ -106,16 +106,16 @@ def write_profile(filename, profile):
     print 'static const char prototypes_for_' + profile + '[] ='
     print stringify(proto_ir), ';'
 
-    # Print a table of all the functions (not signatures) referenced.
-    # This is done so we can avoid bothering with a hash table in the C++ code.
+    # Print a table of all the functions (not signatures) referenced, sorted
+    # by name so that the C++ code can find a function with bsearch().
 
     function_names = set()
     for func in re.finditer(r'\(function (.+)\n', proto_ir):
         function_names.add(func.group(1))
 
-    print 'static const char *functions_for_' + profile + ' [] = {'
+    print 'static const builtin_function functions_for_' + profile + ' [] = {'
     for func in sorted(function_names):
-        print '   builtin_' + func + ','
+        print '   { "' + func + '", builtin_' + func + ' },'
     print '};'
 
 def write_profiles():
@@ -169,10 +169,103 @@ if __name__ == "__main__":
 extern "C" struct gl_shader *
 _mesa_new_shader(struct gl_context *ctx, GLuint name, GLenum type);
 
-gl_shader *
-read_builtins(GLenum target, const char *protos, const char **functions, unsigned count)
+/**
+ * The IR of all the signatures of a built-in function
+ */
+struct builtin_function {
+   const char *name;
+   const char *ir;
+};
+
+/**
+ * A built-in profile
+ *
+ * Only the prototypes are read when the profile is first used.  The body of
+ * a function is read the first time a shader calls it, so the IR of the
+ * many functions that are never called is never built.
+ */
+struct builtin_profile {
+   gl_shader *sh;
+
+   /**
+    * Parse state used to read the function bodies
+    *
+    * Reading a body adds its parameters and temporaries to the parse state's
+    * symbol table, so \c sh has a separate table holding just the functions.
+    */
+   _mesa_glsl_parse_state *st;
+
+   const builtin_function *functions;  /**< sorted by name */
+   unsigned count;
+   bool *is_read;                      /**< has functions[i] been read? */
+};
+
+static void
+read_builtin_function(builtin_profile *p, const char *name);
+
+/**
+ * Reads the bodies of the built-in functions called by a built-in function.
+ */
+class builtin_call_visitor : public ir_hierarchical_visitor {
+public:
+   builtin_call_visitor(builtin_profile *p) : p(p)
+   {
+   }
+
+   virtual ir_visitor_status visit_enter(ir_call *ir)
+   {
+      read_builtin_function(p, ir->callee_name());
+      return visit_continue;
+   }
+
+private:
+   builtin_profile *p;
+};
+
+static int
+compare_builtin_function(const void *name, const void *f)
+{
+   return strcmp((const char *) name, ((const builtin_function *) f)->name);
+}
+
+static void
+read_builtin_function(builtin_profile *p, const char *name)
 {
-   struct gl_context fakeCtx;
+   const builtin_function *f = (const builtin_function *)
+      bsearch(name, p->functions, p->count, sizeof(p->functions[0]),
+              compare_builtin_function);
+
+   if (f == NULL || p->is_read[f - p->functions])
+      return;
+
+   p->is_read[f - p->functions] = true;
+
+   /* Read the function bodies, telling the IR reader not to scan for
+    * prototypes (we've already created them).  The IR reader will skip any
+    * signature that does not already exist as a prototype.  Nothing is added
+    * to the instruction list, the bodies go to the existing signatures.
+    */
+   exec_list instructions;
+   _mesa_glsl_read_ir(p->st, &instructions, f->ir, false);
+
+   if (p->st->error) {
+      printf("error reading builtin: %.35s ...\\n", f->ir);
+      printf("Info log:\\n%s\\n", p->st->info_log);
+      return;
+   }
+
+   builtin_call_visitor v(p);
+   p->sh->symbols->get_function(name)->accept(&v);
+}
+
+static bool
+read_builtins(builtin_profile *p, GLenum target, const char *protos,
+              const builtin_function *functions, unsigned count)
+{
+   /* The parse state keeps a pointer to the context, so it can't be on the
+    * stack.
+    */
+   static struct gl_context fakeCtx;
    fakeCtx.API = API_OPENGL_COMPAT;
    fakeCtx.Const.GLSLVersion = 140;
    fakeCtx.Extensions.ARB_ES2_compatibility = true;
@@ -192,30 +285,32 @@ read_builtins(GLenum target, const char *protos, const char **functions, unsigne
    _mesa_glsl_initialize_types(st);
 
    sh->ir = new(sh) exec_list;
-   sh->symbols = st->symbols;
 
    /* Read the IR containing the prototypes */
    _mesa_glsl_read_ir(st, sh->ir, protos, true);
 
-   /* Read ALL the function bodies, telling the IR reader not to scan for
-    * prototypes (we've already created them).  The IR reader will skip any
-    * signature that does not already exist as a prototype.
-    */
-   for (unsigned i = 0; i < count; i++) {
-      _mesa_glsl_read_ir(st, sh->ir, functions[i], false);
-
-      if (st->error) {
-         printf("error reading builtin: %.35s ...\\n", functions[i]);
-         printf("Info log:\\n%s\\n", st->info_log);
-         ralloc_free(sh);
-         return NULL;
-      }
+   if (st->error) {
+      printf("error reading builtin prototypes\\n");
+      printf("Info log:\\n%s\\n", st->info_log);
+      ralloc_free(sh);
+      return false;
+   }
+
+   sh->symbols = new(sh) glsl_symbol_table;
+   foreach_list(node, sh->ir) {
+      ir_function *f = ((ir_instruction *) node)->as_function();
+
+      if (f != NULL)
+         sh->symbols->add_function(f);
    }
 
-   reparent_ir(sh->ir, sh);
-   delete st;
+   p->sh = sh;
+   p->st = st;
+   p->functions = functions;
+   p->count = count;
+   p->is_read = rzalloc_array(sh, bool, count);
 
-   return sh;
+   return true;
 }
 """
 
@@ -224,38 +319,66 @@ read_builtins(GLenum target, const char *protos, const char **functions, unsigne
 
     profiles = get_profile_list()
 
-    print 'static gl_shader *builtin_profiles[%d];' % len(profiles)
+    print 'static builtin_profile builtin_profiles[%d];' % len(profiles)
 
     print """
 static void *builtin_mem_ctx = NULL;
 
+/**
+ * Protects builtin_mem_ctx and builtin_profiles, which are shared by all
+ * threads compiling shaders.  A profile's shader is only modified when
+ * reading the body of a function, which happens before any shader can use
+ * the function, so it may be linked by several threads at once.
+ */
+_glthread_DECLARE_STATIC_MUTEX(builtins_mutex);
+
 void
 _mesa_glsl_release_functions(void)
 {
+   _glthread_LOCK_MUTEX(builtins_mutex);
    ralloc_free(builtin_mem_ctx);
    builtin_mem_ctx = NULL;
    memset(builtin_profiles, 0, sizeof(builtin_profiles));
+   _glthread_UNLOCK_MUTEX(builtins_mutex);
 }
 
 static void
 _mesa_read_profile(struct _mesa_glsl_parse_state *state,
                    int profile_index,
 		   const char *prototypes,
-		   const char **functions,
+		   const builtin_function *functions,
                    int count)
 {
-   gl_shader *sh = builtin_profiles[profile_index];
+   builtin_profile *p = &builtin_profiles[profile_index];
 
-   if (sh == NULL) {
-      sh = read_builtins(GL_VERTEX_SHADER, prototypes, functions, count);
-      ralloc_steal(builtin_mem_ctx, sh);
-      builtin_profiles[profile_index] = sh;
+   if (p->sh == NULL) {
+      if (!read_builtins(p, GL_VERTEX_SHADER, prototypes, functions, count))
+         return;
+      ralloc_steal(builtin_mem_ctx, p->sh);
    }
 
-   state->builtins_to_link[state->num_builtins_to_link] = sh;
+   state->builtins_to_link[state->num_builtins_to_link] = p->sh;
    state->num_builtins_to_link++;
 }
 
+void
+_mesa_glsl_read_builtin_function(gl_shader **shader_list,
+                                 unsigned num_shaders, const char *name)
+{
+   _glthread_LOCK_MUTEX(builtins_mutex);
+
+   for (unsigned i = 0; i < num_shaders; i++) {
+      for (unsigned j = 0; j < Elements(builtin_profiles); j++) {
+         if (builtin_profiles[j].sh == shader_list[i]) {
+            read_builtin_function(&builtin_profiles[j], name);
+            break;
+         }
+      }
+   }
+
+   _glthread_UNLOCK_MUTEX(builtins_mutex);
+}
+
 void
 _mesa_glsl_initialize_functions(struct _mesa_glsl_parse_state *state)
 {
@@ -263,6 +386,8 @@ _mesa_glsl_initialize_functions(struct _mesa_glsl_parse_state *state)
    if (state->num_builtins_to_link > 0)
       return;
 
+   _glthread_LOCK_MUTEX(builtins_mutex);
+
    if (builtin_mem_ctx == NULL) {
       builtin_mem_ctx = ralloc_context(NULL); // "GLSL built-in functions"
       memset(&builtin_profiles, 0, sizeof(builtin_profiles));
@@ -296,5 +421,6 @@ _mesa_glsl_initialize_functions(struct _mesa_glsl_parse_state *state)
         print '   }'
         print
         i = i + 1
+    print '   _glthread_UNLOCK_MUTEX(builtins_mutex);'
     print '}'
 
@@ -24,6 +24,8 @@
 #include <stdarg.h>
 #include <string.h>
 #include <assert.h>
+#include <stdlib.h>
+#include <time.h>
 
 extern "C" {
 #include "main/core.h" /* for struct gl_context */
@@ -1168,21 +1170,256 @@ ast_struct_specifier::print(void) const
 }
 
 
+/* Shaders may be compiled by several threads at once. */
+_glthread_DECLARE_STATIC_MUTEX(anon_struct_mutex);
+
 ast_struct_specifier::ast_struct_specifier(const char *identifier,
 					   ast_declarator_list *declarator_list)
 {
    if (identifier == NULL) {
       static unsigned anon_count = 1;
-      identifier = ralloc_asprintf(this, "#anon_struct_%04x", anon_count);
-      anon_count++;
+      unsigned id;
+
+      _glthread_LOCK_MUTEX(anon_struct_mutex);
+      id = anon_count++;
+      _glthread_UNLOCK_MUTEX(anon_struct_mutex);
+
+      identifier = ralloc_asprintf(this, "#anon_struct_%04x", id);
    }
    name = identifier;
    this->declarations.push_degenerate_list_at_head(&declarator_list->link);
 }
 
+namespace {
+
+/**
+ * Arguments of \c do_common_optimization that some of the passes depend on
+ */
+struct common_optimization_options {
+   bool linked;
+   bool uniform_locations_assigned;
+   unsigned max_unroll_iterations;
+};
+
+struct common_optimization_pass {
+   const char *name;
+
+   /** Only run the pass on linked shaders */
+   bool linked_only;
+
+   bool (*run)(exec_list *ir, const common_optimization_options *options);
+};
+
+} /* anonymous namespace */
+
+static bool
+run_lower_sub_to_add_neg(exec_list *ir, const common_optimization_options *)
+{
+   return lower_instructions(ir, SUB_TO_ADD_NEG);
+}
+
+static bool
+run_function_inlining(exec_list *ir, const common_optimization_options *)
+{
+   return do_function_inlining(ir);
+}
+
+static bool
+run_dead_functions(exec_list *ir, const common_optimization_options *)
+{
+   return do_dead_functions(ir);
+}
+
+static bool
+run_structure_splitting(exec_list *ir, const common_optimization_options *)
+{
+   return do_structure_splitting(ir);
+}
+
+static bool
+run_if_simplification(exec_list *ir, const common_optimization_options *)
+{
+   return do_if_simplification(ir);
+}
+
+static bool
+run_copy_propagation(exec_list *ir, const common_optimization_options *)
+{
+   return do_copy_propagation(ir);
+}
+
+static bool
+run_copy_propagation_elements(exec_list *ir,
+                              const common_optimization_options *)
+{
+   return do_copy_propagation_elements(ir);
+}
+
+static bool
+run_dead_code(exec_list *ir, const common_optimization_options *options)
+{
+   if (options->linked)
+      return do_dead_code(ir, options->uniform_locations_assigned);
+   else
+      return do_dead_code_unlinked(ir);
+}
+
+static bool
+run_dead_code_local(exec_list *ir, const common_optimization_options *)
+{
+   return do_dead_code_local(ir);
+}
+
+static bool
+run_tree_grafting(exec_list *ir, const common_optimization_options *)
+{
+   return do_tree_grafting(ir);
+}
+
+static bool
+run_constant_propagation(exec_list *ir, const common_optimization_options *)
+{
+   return do_constant_propagation(ir);
+}
+
+static bool
+run_constant_variable(exec_list *ir,
+                      const common_optimization_options *options)
+{
+   if (options->linked)
+      return do_constant_variable(ir);
+   else
+      return do_constant_variable_unlinked(ir);
+}
+
+static bool
+run_constant_folding(exec_list *ir, const common_optimization_options *)
+{
+   return do_constant_folding(ir);
+}
+
+static bool
+run_algebraic(exec_list *ir, const common_optimization_options *)
+{
+   return do_algebraic(ir);
+}
+
+static bool
+run_lower_jumps(exec_list *ir, const common_optimization_options *)
+{
+   return do_lower_jumps(ir);
+}
+
+static bool
+run_vec_index_to_swizzle(exec_list *ir, const common_optimization_options *)
+{
+   return do_vec_index_to_swizzle(ir);
+}
+
+static bool
+run_swizzle_swizzle(exec_list *ir, const common_optimization_options *)
+{
+   return do_swizzle_swizzle(ir);
+}
+
+static bool
+run_noop_swizzle(exec_list *ir, const common_optimization_options *)
+{
+   return do_noop_swizzle(ir);
+}
+
+static bool
+run_split_arrays(exec_list *ir, const common_optimization_options *options)
+{
+   return optimize_split_arrays(ir, options->linked);
+}
+
+static bool
+run_redundant_jumps(exec_list *ir, const common_optimization_options *)
+{
+   return optimize_redundant_jumps(ir);
+}
+
+static bool
+run_loop_unrolling(exec_list *ir, const common_optimization_options *options)
+{
+   bool progress = false;
+
+   loop_state *ls = analyze_loop_variables(ir);
+   if (ls->loop_found) {
+      progress = set_loop_controls(ir, ls) || progress;
+      progress = unroll_loops(ir, ls, options->max_unroll_iterations)
+         || progress;
+   }
+   delete ls;
+
+   return progress;
+}
+
+/**
+ * The passes run by \c do_common_optimization, in order
+ */
+static const common_optimization_pass common_optimization_passes[] = {
+   { "lower_sub_to_add_neg",       false, run_lower_sub_to_add_neg },
+   { "function_inlining",          true,  run_function_inlining },
+   { "dead_functions",             true,  run_dead_functions },
+   { "structure_splitting",        true,  run_structure_splitting },
+   { "if_simplification",          false, run_if_simplification },
+   { "copy_propagation",           false, run_copy_propagation },
+   { "copy_propagation_elements",  false, run_copy_propagation_elements },
+   { "dead_code",                  false, run_dead_code },
+   { "dead_code_local",            false, run_dead_code_local },
+   { "tree_grafting",              false, run_tree_grafting },
+   { "constant_propagation",       false, run_constant_propagation },
+   { "constant_variable",          false, run_constant_variable },
+   { "constant_folding",           false, run_constant_folding },
+   { "algebraic",                  false, run_algebraic },
+   { "lower_jumps",                false, run_lower_jumps },
+   { "vec_index_to_swizzle",       false, run_vec_index_to_swizzle },
+   { "swizzle_swizzle",            false, run_swizzle_swizzle },
+   { "noop_swizzle",               false, run_noop_swizzle },
+   { "split_arrays",               false, run_split_arrays },
+   { "redundant_jumps",            false, run_redundant_jumps },
+   { "loop_unrolling",             false, run_loop_unrolling },
+};
+
+_glthread_DECLARE_STATIC_MUTEX(optimization_stats_mutex);
+
+/**
+ * Whether MESA_GLSL_OPT_STATS is set.  It is only read once.
+ */
+static bool
+print_optimization_stats(void)
+{
+   static bool initialized = false;
+   static bool print_stats;
+   bool result;
+
+   _glthread_LOCK_MUTEX(optimization_stats_mutex);
+   if (!initialized) {
+      const char *const env = getenv("MESA_GLSL_OPT_STATS");
+      print_stats = env != NULL && env[0] != '\0';
+      initialized = true;
+   }
+   result = print_stats;
+   _glthread_UNLOCK_MUTEX(optimization_stats_mutex);
+
+   return result;
+}
+
 /**
  * Do the set of common optimizations passes
  *
+ * The passes are run in a cycle, which stops once every pass has run
+ * without progress since the last change.  Compared to repeating the whole
+ * list until a round makes no progress, this only saves the passes of that
+ * last round which already ran after the last change.  Any change still
+ * re-runs every other pass.
+ *
+ * Setting the environment variable \c MESA_GLSL_OPT_STATS prints the number
+ * of rounds and, for each pass, how often it ran, how often it made
+ * progress and the processor time it took.
+ *
  * \param ir                          List of instructions to be optimized
  * \param linked                      Is the shader linked?  This enables
  *                                    optimizations passes that remove code at
@@ -1196,53 +1433,79 @@ ast_struct_specifier::ast_struct_specifier(const char *identifier,
  * \param max_unroll_iterations       Maximum number of loop iterations to be
  *                                    unrolled.  Setting to 0 forces all loops
  *                                    to be unrolled.
+ *
+ * \return
+ * \c true if any of the passes made progress.
  */
 bool
 do_common_optimization(exec_list *ir, bool linked,
 		       bool uniform_locations_assigned,
 		       unsigned max_unroll_iterations)
 {
-   GLboolean progress = GL_FALSE;
+   const unsigned num_passes = Elements(common_optimization_passes);
+   const common_optimization_options options = {
+      linked, uniform_locations_assigned, max_unroll_iterations
+   };
+   const bool print_stats = print_optimization_stats();
+
+   struct {
+      unsigned runs;
+      unsigned progress;
+      clock_t time;
+   } stats[num_passes];
+
+   memset(stats, 0, sizeof(stats));
+
+   /* Number of passes in a row that could not change the IR. */
+   unsigned clean_passes = 0;
+   unsigned changes = 0;
+   unsigned rounds = 0;
+
+   for (unsigned i = 0; clean_passes < num_passes; i = (i + 1) % num_passes) {
+      const common_optimization_pass *const pass =
+         &common_optimization_passes[i];
+
+      if (i == 0)
+         rounds++;
+
+      if (pass->linked_only && !linked) {
+         clean_passes++;
+         continue;
+      }
 
-   progress = lower_instructions(ir, SUB_TO_ADD_NEG) || progress;
+      const clock_t start = print_stats ? clock() : 0;
+      const bool progress = pass->run(ir, &options);
 
-   if (linked) {
-      progress = do_function_inlining(ir) || progress;
-      progress = do_dead_functions(ir) || progress;
-      progress = do_structure_splitting(ir) || progress;
-   }
-   progress = do_if_simplification(ir) || progress;
-   progress = do_copy_propagation(ir) || progress;
-   progress = do_copy_propagation_elements(ir) || progress;
-   if (linked)
-      progress = do_dead_code(ir, uniform_locations_assigned) || progress;
-   else
-      progress = do_dead_code_unlinked(ir) || progress;
-   progress = do_dead_code_local(ir) || progress;
-   progress = do_tree_grafting(ir) || progress;
-   progress = do_constant_propagation(ir) || progress;
-   if (linked)
-      progress = do_constant_variable(ir) || progress;
-   else
-      progress = do_constant_variable_unlinked(ir) || progress;
-   progress = do_constant_folding(ir) || progress;
-   progress = do_algebraic(ir) || progress;
-   progress = do_lower_jumps(ir) || progress;
-   progress = do_vec_index_to_swizzle(ir) || progress;
-   progress = do_swizzle_swizzle(ir) || progress;
-   progress = do_noop_swizzle(ir) || progress;
+      if (print_stats)
+         stats[i].time += clock() - start;
+      stats[i].runs++;
 
-   progress = optimize_split_arrays(ir, linked) || progress;
-   progress = optimize_redundant_jumps(ir) || progress;
+      if (progress) {
+         stats[i].progress++;
+         changes++;
+         clean_passes = 0;
+      } else {
+         clean_passes++;
+      }
+   }
 
-   loop_state *ls = analyze_loop_variables(ir);
-   if (ls->loop_found) {
-      progress = set_loop_controls(ir, ls) || progress;
-      progress = unroll_loops(ir, ls, max_unroll_iterations) || progress;
+   if (print_stats) {
+      fprintf(stderr, "GLSL IR optimization (%s): %u rounds, %u changes\n",
+              linked ? "linked" : "unlinked", rounds, changes);
+      fprintf(stderr, "  %-28s %6s %9s %9s\n",
+              "pass", "runs", "progress", "time (ms)");
+      for (unsigned i = 0; i < num_passes; i++) {
+         if (stats[i].runs == 0)
+            continue;
+
+         fprintf(stderr, "  %-28s %6u %9u %9.3f\n",
+                 common_optimization_passes[i].name,
+                 stats[i].runs, stats[i].progress,
+                 1000.0 * stats[i].time / CLOCKS_PER_SEC);
+      }
    }
-   delete ls;
 
-   return progress;
+   return changes != 0;
 }
 
 extern "C" {
@@ -36,6 +36,16 @@ hash_table *glsl_type::array_types = NULL;
 hash_table *glsl_type::record_types = NULL;
 void *glsl_type::mem_ctx = NULL;
 
+/**
+ * Protects mem_ctx and the array and record type tables, which are shared
+ * by all contexts and threads compiling shaders.
+ *
+ * The private constructors and operator new allocate from mem_ctx, so
+ * apart from the built-in types, which are constructed during static
+ * initialization, glsl_types must only be created with the mutex held.
+ */
+_glthread_DECLARE_STATIC_MUTEX(glsl_type_mutex);
+
 void
 glsl_type::init_ralloc_type_ctx(void)
 {
@@ -414,6 +424,8 @@ const glsl_type *glsl_type::get_scalar_type() const
 void
 _mesa_glsl_release_types(void)
 {
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
+
    if (glsl_type::array_types != NULL) {
       hash_table_dtor(glsl_type::array_types);
       glsl_type::array_types = NULL;
@@ -423,6 +435,8 @@ _mesa_glsl_release_types(void)
       hash_table_dtor(glsl_type::record_types);
       glsl_type::record_types = NULL;
    }
+
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
 }
 
 
@@ -517,6 +531,7 @@ glsl_type::get_instance(unsigned base_type, unsigned rows, unsigned columns)
 const glsl_type *
 glsl_type::get_array_instance(const glsl_type *base, unsigned array_size)
 {
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
 
    if (array_types == NULL) {
       array_types = hash_table_ctor(64, hash_table_string_hash,
@@ -538,6 +553,8 @@ glsl_type::get_array_instance(const glsl_type *base, unsigned array_size)
       hash_table_insert(array_types, (void *) t, ralloc_strdup(mem_ctx, key));
    }
 
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
+
    assert(t->base_type == GLSL_TYPE_ARRAY);
    assert(t->length == array_size);
    assert(t->fields.array == base);
@@ -599,6 +616,8 @@ glsl_type::get_record_instance(const glsl_struct_field *fields,
 			       unsigned num_fields,
 			       const char *name)
 {
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
+
    const glsl_type key(fields, num_fields, name);
 
    if (record_types == NULL) {
@@ -612,6 +631,8 @@ glsl_type::get_record_instance(const glsl_struct_field *fields,
       hash_table_insert(record_types, (void *) t, t);
    }
 
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
+
    assert(t->base_type == GLSL_TYPE_STRUCT);
    assert(t->length == num_fields);
    assert(strcmp(t->name, name) == 0);
@@ -620,6 +641,47 @@ glsl_type::get_record_instance(const glsl_struct_field *fields,
 }
 
 
+const glsl_type *
+glsl_type::get_builtin_instance(const char *name)
+{
+   static const struct {
+      const glsl_type *types;
+      unsigned count;
+   } lists[] = {
+      { builtin_core_types, Elements(builtin_core_types) },
+      { builtin_structure_types, Elements(builtin_structure_types) },
+      { builtin_110_deprecated_structure_types,
+	Elements(builtin_110_deprecated_structure_types) },
+      { builtin_110_types, Elements(builtin_110_types) },
+      { builtin_120_types, Elements(builtin_120_types) },
+      { builtin_130_types, Elements(builtin_130_types) },
+      { builtin_140_types, Elements(builtin_140_types) },
+      { builtin_ARB_texture_rectangle_types,
+	Elements(builtin_ARB_texture_rectangle_types) },
+      { builtin_EXT_texture_array_types,
+	Elements(builtin_EXT_texture_array_types) },
+      { builtin_EXT_texture_buffer_object_types,
+	Elements(builtin_EXT_texture_buffer_object_types) },
+      { builtin_OES_EGL_image_external_types,
+	Elements(builtin_OES_EGL_image_external_types) },
+      { builtin_ARB_texture_cube_map_array_types,
+	Elements(builtin_ARB_texture_cube_map_array_types) },
+      { &_sampler3D_type, 1 },
+      { &_samplerCubeShadow_type, 1 },
+      { &_void_type, 1 },
+   };
+
+   for (unsigned i = 0; i < Elements(lists); i++) {
+      for (unsigned j = 0; j < lists[i].count; j++) {
+	 if (strcmp(lists[i].types[j].name, name) == 0)
+	    return &lists[i].types[j];
+      }
+   }
+
+   return NULL;
+}
+
+
 const glsl_type *
 glsl_type::field_type(const char *name) const
 {
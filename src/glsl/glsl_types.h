@@ -86,7 +86,9 @@ struct glsl_type {
 				*/
 
    /* Callers of this ralloc-based new need not call delete. It's
-    * easier to just ralloc_free 'mem_ctx' (or any of its ancestors). */
+    * easier to just ralloc_free 'mem_ctx' (or any of its ancestors).
+    * The caller must hold the mutex protecting 'mem_ctx', see
+    * glsl_types.cpp. */
    static void* operator new(size_t size)
    {
       if (glsl_type::mem_ctx == NULL) {
@@ -231,6 +233,15 @@ struct glsl_type {
 					       unsigned num_fields,
 					       const char *name);
 
+   /**
+    * Get the instance of a built-in type, such as a sampler or one of the
+    * \c gl_ structure types, by name
+    *
+    * \return
+    * The type, or \c NULL if there is no built-in type called \c name.
+    */
+   static const glsl_type *get_builtin_instance(const char *name);
+
    /**
     * Query the total number of scalars that make up a scalar, vector or matrix
     */
@@ -471,7 +482,8 @@ private:
    /**
     * ralloc context for all glsl_type allocations
     *
-    * Set on the first call to \c glsl_type::new.
+    * Set on the first call to \c glsl_type::new.  Like the hash tables
+    * below, this is shared by all threads and protected by a mutex.
     */
    static void *mem_ctx;
 
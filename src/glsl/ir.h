@@ -1863,6 +1863,18 @@ _mesa_glsl_initialize_variables(exec_list *instructions,
 extern void
 _mesa_glsl_initialize_functions(_mesa_glsl_parse_state *state);
 
+/**
+ * Read the body of the built-in function \c name
+ *
+ * Built-in function bodies are only read when a shader calls them.  This
+ * reads the body of \c name, and of the built-in functions it calls, in
+ * each of the built-in shaders in \c shader_list.  Other shaders in the
+ * list are ignored.
+ */
+extern void
+_mesa_glsl_read_builtin_function(gl_shader **shader_list,
+				 unsigned num_shaders, const char *name);
+
 extern void
 _mesa_glsl_release_functions(void);
 
@@ -0,0 +1,115 @@
+/*
+ * Copyright © 2010 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file ir_acp.h
+ *
+ * Tables of per-variable data for the copy and constant propagation
+ * passes, which keep their available copies (ACP) and kills indexed by
+ * variable.
+ */
+
+#pragma once
+#ifndef IR_ACP_H
+#define IR_ACP_H
+
+#include "ir.h"
+#include "main/hash_table.h"
+
+/**
+ * Creates a table indexed by ir_variable.  It is freed along with
+ * \c mem_ctx.
+ */
+static inline hash_table *
+acp_table_create(void *mem_ctx)
+{
+   return _mesa_hash_table_create(mem_ctx, _mesa_key_pointer_equal);
+}
+
+/** Returns the data stored in \c ht for \c var, or NULL. */
+static inline void *
+acp_table_find(hash_table *ht, ir_variable *var)
+{
+   hash_entry *entry = _mesa_hash_table_search(ht, _mesa_hash_pointer(var),
+                                               var);
+
+   return entry ? entry->data : NULL;
+}
+
+/** Removes all entries of \c ht, without freeing their data. */
+static inline void
+acp_table_clear(hash_table *ht)
+{
+   hash_entry *entry;
+
+   hash_table_foreach(ht, entry) {
+      _mesa_hash_table_remove(ht, entry);
+   }
+}
+
+/**
+ * Base of the per-variable data of a table, which is allocated out of the
+ * table itself.
+ */
+class acp_var_base
+{
+public:
+   /* Callers of this ralloc-based new need not call delete. It's
+    * easier to just ralloc_free 'ctx' (or any of its ancestors). */
+   static void* operator new(size_t size, void *ctx)
+   {
+      void *node;
+
+      node = ralloc_size(ctx, size);
+      assert(node != NULL);
+
+      return node;
+   }
+
+   /* If the user *does* call delete, that's OK, we will just
+    * ralloc_free in that case. */
+   static void operator delete(void *node)
+   {
+      ralloc_free(node);
+   }
+};
+
+/**
+ * Returns the T stored in \c ht for \c var, adding one if there is none.
+ * T derives from acp_var_base.
+ */
+template<class T>
+static inline T *
+acp_table_get(hash_table *ht, ir_variable *var)
+{
+   T *v = (T *) acp_table_find(ht, var);
+
+   if (!v) {
+      v = new(ht) T;
+      _mesa_hash_table_insert(ht, _mesa_hash_pointer(var), var, v);
+   }
+
+   return v;
+}
+
+#endif /* IR_ACP_H */
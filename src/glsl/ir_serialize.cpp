@@ -0,0 +1,1205 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file ir_serialize.cpp
+ *
+ * The serialized form of an instruction stream is:
+ *
+ *  - a table of every variable declared anywhere in the stream, including
+ *    function parameters, with all of the variable's fields,
+ *  - a table of every function, with the prototype of each signature,
+ *  - the instruction stream itself, in which variable declarations,
+ *    dereferences, loop counters and calls refer to the tables by index.
+ *
+ * Creating all of the variables and signatures up front lets the reader
+ * resolve references to variables that are declared later in the stream
+ * (the linker may place a function that uses a global ahead of the global's
+ * declaration) and calls to functions that are defined later, the same
+ * problem \c clone_ir_list solves with a fix-up pass.
+ */
+
+#include <string.h>
+#include "main/core.h" /* for Elements */
+#include "ir.h"
+#include "ir_hierarchical_visitor.h"
+#include "ir_serialize.h"
+#include "blob.h"
+#include "glsl_types.h"
+#include "program/hash_table.h"
+
+/** Marks a NULL rvalue or a missing loop counter in the stream. */
+#define NO_INDEX (~0u)
+
+void
+serialize_glsl_type(struct blob *blob, const glsl_type *type)
+{
+   blob_write_uint32(blob, type->base_type);
+
+   switch (type->base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_BOOL:
+      blob_write_uint32(blob, type->vector_elements);
+      blob_write_uint32(blob, type->matrix_columns);
+      break;
+
+   case GLSL_TYPE_SAMPLER:
+      blob_write_string(blob, type->name);
+      break;
+
+   case GLSL_TYPE_STRUCT:
+      blob_write_string(blob, type->name);
+
+      /* The gl_ structures are built-in types that are not in the record
+       * type table, so they are looked up by name instead.
+       */
+      if (strncmp(type->name, "gl_", 3) == 0)
+	 break;
+
+      blob_write_uint32(blob, type->length);
+      for (unsigned i = 0; i < type->length; i++) {
+	 serialize_glsl_type(blob, type->fields.structure[i].type);
+	 blob_write_string(blob, type->fields.structure[i].name);
+      }
+      break;
+
+   case GLSL_TYPE_ARRAY:
+      serialize_glsl_type(blob, type->fields.array);
+      blob_write_uint32(blob, type->length);
+      break;
+
+   case GLSL_TYPE_VOID:
+   case GLSL_TYPE_ERROR:
+      break;
+   }
+}
+
+const glsl_type *
+deserialize_glsl_type(struct blob_reader *blob)
+{
+   const unsigned base_type = blob_read_uint32(blob);
+
+   switch (base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_BOOL: {
+      const unsigned rows = blob_read_uint32(blob);
+      const unsigned columns = blob_read_uint32(blob);
+      const glsl_type *type = glsl_type::get_instance(base_type, rows, columns);
+
+      return type->is_error() ? NULL : type;
+   }
+
+   case GLSL_TYPE_SAMPLER: {
+      const char *name = blob_read_string(blob);
+      const glsl_type *type =
+	 name != NULL ? glsl_type::get_builtin_instance(name) : NULL;
+
+      return (type != NULL && type->is_sampler()) ? type : NULL;
+   }
+
+   case GLSL_TYPE_STRUCT: {
+      const char *name = blob_read_string(blob);
+      if (name == NULL)
+	 return NULL;
+
+      if (strncmp(name, "gl_", 3) == 0) {
+	 const glsl_type *type = glsl_type::get_builtin_instance(name);
+	 return (type != NULL && type->is_record()) ? type : NULL;
+      }
+
+      const unsigned length = blob_read_uint32(blob);
+      if (blob->overrun || length == 0 || length > (unsigned) (blob->end - blob->current))
+	 return NULL;
+
+      glsl_struct_field *const fields = new glsl_struct_field[length];
+      bool valid = true;
+      for (unsigned i = 0; i < length; i++) {
+	 fields[i].type = deserialize_glsl_type(blob);
+	 fields[i].name = blob_read_string(blob);
+	 valid = valid && fields[i].type != NULL && fields[i].name != NULL;
+      }
+
+      const glsl_type *type = valid
+	 ? glsl_type::get_record_instance(fields, length, name) : NULL;
+
+      delete [] fields;
+      return type;
+   }
+
+   case GLSL_TYPE_ARRAY: {
+      const glsl_type *element_type = deserialize_glsl_type(blob);
+      const unsigned length = blob_read_uint32(blob);
+
+      if (element_type == NULL || element_type->is_array())
+	 return NULL;
+
+      return glsl_type::get_array_instance(element_type, length);
+   }
+
+   case GLSL_TYPE_VOID:
+      return glsl_type::void_type;
+
+   case GLSL_TYPE_ERROR:
+      return glsl_type::error_type;
+   }
+
+   return NULL;
+}
+
+
+namespace {
+
+/**
+ * Number the variables and function signatures of an instruction stream
+ */
+class ir_serialize_index_visitor : public ir_hierarchical_visitor {
+public:
+   ir_serialize_index_visitor()
+   {
+      this->mem_ctx = ralloc_context(NULL);
+      this->indices = hash_table_ctor(0, hash_table_pointer_hash,
+				      hash_table_pointer_compare);
+      this->variables = NULL;
+      this->num_variables = 0;
+      this->functions = NULL;
+      this->num_functions = 0;
+      this->num_signatures = 0;
+   }
+
+   ~ir_serialize_index_visitor()
+   {
+      hash_table_dtor(this->indices);
+      ralloc_free(this->mem_ctx);
+   }
+
+   virtual ir_visitor_status visit(ir_variable *var)
+   {
+      if ((this->num_variables & (this->num_variables - 1)) == 0) {
+	 this->variables = reralloc(this->mem_ctx, this->variables,
+				    ir_variable *,
+				    MAX2(this->num_variables * 2, 16));
+      }
+
+      this->variables[this->num_variables] = var;
+      this->num_variables++;
+      hash_table_insert(this->indices, (void *) (intptr_t) this->num_variables,
+			var);
+
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_function *f)
+   {
+      if ((this->num_functions & (this->num_functions - 1)) == 0) {
+	 this->functions = reralloc(this->mem_ctx, this->functions,
+				    ir_function *,
+				    MAX2(this->num_functions * 2, 16));
+      }
+
+      this->functions[this->num_functions] = f;
+      this->num_functions++;
+      hash_table_insert(this->indices, (void *) (intptr_t) this->num_functions,
+			f);
+
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_function_signature *sig)
+   {
+      this->num_signatures++;
+      hash_table_insert(this->indices,
+			(void *) (intptr_t) this->num_signatures, sig);
+
+      return visit_continue;
+   }
+
+   /**
+    * Get the index of a variable, function or signature, or \c NO_INDEX if
+    * it is not part of the instruction stream.
+    */
+   unsigned index(const void *p)
+   {
+      const intptr_t i = (intptr_t) hash_table_find(this->indices, p);
+      return i == 0 ? NO_INDEX : unsigned(i - 1);
+   }
+
+   void *mem_ctx;
+   struct hash_table *indices;
+
+   ir_variable **variables;
+   unsigned num_variables;
+
+   ir_function **functions;
+   unsigned num_functions;
+   unsigned num_signatures;
+};
+
+
+class ir_serializer {
+public:
+   ir_serializer(struct blob *blob)
+      : blob(blob), failed(false)
+   {
+   }
+
+   bool run(exec_list *instructions);
+
+private:
+   void write_variable(ir_variable *var);
+   void write_constant(ir_constant *c);
+   void write_index(const void *p);
+   void write_list(exec_list *list);
+   void write_instruction(ir_instruction *ir);
+   void write_rvalue(ir_rvalue *ir);
+
+   struct blob *blob;
+   ir_serialize_index_visitor index;
+   bool failed;
+};
+
+
+void
+ir_serializer::write_index(const void *p)
+{
+   const unsigned i = this->index.index(p);
+
+   /* A reference to something outside of the instruction stream. */
+   if (i == NO_INDEX)
+      this->failed = true;
+
+   blob_write_uint32(this->blob, i);
+}
+
+
+void
+ir_serializer::write_constant(ir_constant *c)
+{
+   serialize_glsl_type(this->blob, c->type);
+
+   switch (c->type->base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_BOOL:
+      blob_write_bytes(this->blob, &c->value, sizeof(c->value));
+      break;
+
+   case GLSL_TYPE_STRUCT:
+      foreach_list(node, &c->components) {
+	 write_constant((ir_constant *) node);
+      }
+      break;
+
+   case GLSL_TYPE_ARRAY:
+      for (unsigned i = 0; i < c->type->length; i++)
+	 write_constant(c->array_elements[i]);
+      break;
+
+   default:
+      this->failed = true;
+      break;
+   }
+}
+
+
+void
+ir_serializer::write_variable(ir_variable *var)
+{
+   serialize_glsl_type(this->blob, var->type);
+   blob_write_string(this->blob, var->name);
+   blob_write_uint32(this->blob, var->mode);
+   blob_write_uint32(this->blob,
+		     (var->read_only << 0) |
+		     (var->centroid << 1) |
+		     (var->invariant << 2) |
+		     (var->used << 3) |
+		     (var->assigned << 4) |
+		     (var->origin_upper_left << 5) |
+		     (var->pixel_center_integer << 6) |
+		     (var->explicit_location << 7) |
+		     (var->explicit_index << 8) |
+		     (var->has_initializer << 9));
+   blob_write_uint32(this->blob, var->interpolation);
+   blob_write_uint32(this->blob, var->depth_layout);
+   blob_write_uint32(this->blob, var->max_array_access);
+   blob_write_uint32(this->blob, var->location);
+   blob_write_uint32(this->blob, var->uniform_block);
+   blob_write_uint32(this->blob, var->index);
+
+   blob_write_uint32(this->blob, var->state_slots ? var->num_state_slots : 0);
+   for (unsigned i = 0; var->state_slots && i < var->num_state_slots; i++) {
+      blob_write_bytes(this->blob, var->state_slots[i].tokens,
+		       sizeof(var->state_slots[i].tokens));
+      blob_write_uint32(this->blob, var->state_slots[i].swizzle);
+   }
+
+   /* warn_extension is only used while compiling, so it is not stored. */
+
+   blob_write_uint32(this->blob, var->constant_value != NULL);
+   if (var->constant_value)
+      write_constant(var->constant_value);
+
+   blob_write_uint32(this->blob, var->constant_initializer != NULL);
+   if (var->constant_initializer)
+      write_constant(var->constant_initializer);
+}
+
+
+void
+ir_serializer::write_list(exec_list *list)
+{
+   unsigned count = 0;
+
+   foreach_list(node, list) {
+      count++;
+   }
+
+   blob_write_uint32(this->blob, count);
+
+   foreach_list(node, list) {
+      write_instruction((ir_instruction *) node);
+   }
+}
+
+
+void
+ir_serializer::write_rvalue(ir_rvalue *ir)
+{
+   if (ir == NULL)
+      blob_write_uint32(this->blob, ir_type_unset);
+   else
+      write_instruction(ir);
+}
+
+
+void
+ir_serializer::write_instruction(ir_instruction *ir)
+{
+   blob_write_uint32(this->blob, ir->ir_type);
+
+   switch (ir->ir_type) {
+   case ir_type_variable:
+      write_index(ir);
+      break;
+
+   case ir_type_assignment: {
+      ir_assignment *const a = (ir_assignment *) ir;
+
+      write_rvalue(a->lhs);
+      write_rvalue(a->rhs);
+      write_rvalue(a->condition);
+      blob_write_uint32(this->blob, a->write_mask);
+      break;
+   }
+
+   case ir_type_call: {
+      ir_call *const call = (ir_call *) ir;
+
+      write_index(call->callee);
+      write_rvalue(call->return_deref);
+      write_list(&call->actual_parameters);
+      blob_write_uint32(this->blob, call->use_builtin);
+      break;
+   }
+
+   case ir_type_constant:
+      write_constant((ir_constant *) ir);
+      break;
+
+   case ir_type_dereference_array: {
+      ir_dereference_array *const deref = (ir_dereference_array *) ir;
+
+      write_rvalue(deref->array);
+      write_rvalue(deref->array_index);
+      break;
+   }
+
+   case ir_type_dereference_record: {
+      ir_dereference_record *const deref = (ir_dereference_record *) ir;
+
+      write_rvalue(deref->record);
+      blob_write_string(this->blob, deref->field);
+      break;
+   }
+
+   case ir_type_dereference_variable:
+      write_index(((ir_dereference_variable *) ir)->var);
+      break;
+
+   case ir_type_discard:
+      write_rvalue(((ir_discard *) ir)->condition);
+      break;
+
+   case ir_type_expression: {
+      ir_expression *const expr = (ir_expression *) ir;
+
+      blob_write_uint32(this->blob, expr->operation);
+      serialize_glsl_type(this->blob, expr->type);
+      for (unsigned i = 0; i < expr->get_num_operands(); i++)
+	 write_rvalue(expr->operands[i]);
+      break;
+   }
+
+   case ir_type_function: {
+      ir_function *const f = (ir_function *) ir;
+
+      /* The prototypes are in the function table, only the bodies are left.
+       */
+      write_index(f);
+      foreach_list(node, &f->signatures) {
+	 write_list(&((ir_function_signature *) node)->body);
+      }
+      break;
+   }
+
+   case ir_type_if: {
+      ir_if *const if_stmt = (ir_if *) ir;
+
+      write_rvalue(if_stmt->condition);
+      write_list(&if_stmt->then_instructions);
+      write_list(&if_stmt->else_instructions);
+      break;
+   }
+
+   case ir_type_loop: {
+      ir_loop *const loop = (ir_loop *) ir;
+
+      write_rvalue(loop->from);
+      write_rvalue(loop->to);
+      write_rvalue(loop->increment);
+      if (loop->counter != NULL)
+	 write_index(loop->counter);
+      else
+	 blob_write_uint32(this->blob, NO_INDEX);
+      blob_write_uint32(this->blob, loop->cmp);
+      write_list(&loop->body_instructions);
+      break;
+   }
+
+   case ir_type_loop_jump:
+      blob_write_uint32(this->blob, ((ir_loop_jump *) ir)->mode);
+      break;
+
+   case ir_type_return:
+      write_rvalue(((ir_return *) ir)->value);
+      break;
+
+   case ir_type_swizzle: {
+      ir_swizzle *const swiz = (ir_swizzle *) ir;
+
+      write_rvalue(swiz->val);
+      blob_write_uint32(this->blob,
+			(swiz->mask.x << 0) |
+			(swiz->mask.y << 2) |
+			(swiz->mask.z << 4) |
+			(swiz->mask.w << 6) |
+			(swiz->mask.num_components << 8));
+      break;
+   }
+
+   case ir_type_texture: {
+      ir_texture *const tex = (ir_texture *) ir;
+
+      blob_write_uint32(this->blob, tex->op);
+      serialize_glsl_type(this->blob, tex->type);
+      write_rvalue(tex->sampler);
+      write_rvalue(tex->coordinate);
+      write_rvalue(tex->projector);
+      write_rvalue(tex->shadow_comparitor);
+      write_rvalue(tex->offset);
+
+      switch (tex->op) {
+      case ir_tex:
+	 break;
+      case ir_txb:
+	 write_rvalue(tex->lod_info.bias);
+	 break;
+      case ir_txl:
+      case ir_txf:
+      case ir_txs:
+	 write_rvalue(tex->lod_info.lod);
+	 break;
+      case ir_txd:
+	 write_rvalue(tex->lod_info.grad.dPdx);
+	 write_rvalue(tex->lod_info.grad.dPdy);
+	 break;
+      }
+      break;
+   }
+
+   default:
+      this->failed = true;
+      break;
+   }
+}
+
+
+bool
+ir_serializer::run(exec_list *instructions)
+{
+   this->index.run(instructions);
+
+   blob_write_uint32(this->blob, this->index.num_variables);
+   for (unsigned i = 0; i < this->index.num_variables; i++)
+      write_variable(this->index.variables[i]);
+
+   blob_write_uint32(this->blob, this->index.num_functions);
+   blob_write_uint32(this->blob, this->index.num_signatures);
+   for (unsigned i = 0; i < this->index.num_functions; i++) {
+      ir_function *const f = this->index.functions[i];
+      unsigned num_signatures = 0;
+
+      foreach_list(node, &f->signatures) {
+	 num_signatures++;
+      }
+
+      blob_write_string(this->blob, f->name);
+      blob_write_uint32(this->blob, num_signatures);
+
+      foreach_list(node, &f->signatures) {
+	 ir_function_signature *const sig = (ir_function_signature *) node;
+	 unsigned num_parameters = 0;
+
+	 foreach_list(param, &sig->parameters) {
+	    num_parameters++;
+	 }
+
+	 serialize_glsl_type(this->blob, sig->return_type);
+	 blob_write_uint32(this->blob,
+			   (sig->is_defined << 0) | (sig->is_builtin << 1));
+	 blob_write_uint32(this->blob, num_parameters);
+	 foreach_list(param, &sig->parameters) {
+	    write_index((ir_variable *) param);
+	 }
+      }
+   }
+
+   write_list(instructions);
+
+   return !this->failed && !this->blob->out_of_memory;
+}
+
+
+class ir_deserializer {
+public:
+   ir_deserializer(void *mem_ctx, struct blob_reader *blob)
+      : mem_ctx(mem_ctx), blob(blob), failed(false),
+	variables(NULL), num_variables(0),
+	functions(NULL), num_functions(0),
+	signatures(NULL), num_signatures(0)
+   {
+   }
+
+   ~ir_deserializer()
+   {
+      delete [] this->variables;
+      delete [] this->functions;
+      delete [] this->signatures;
+   }
+
+   bool run(exec_list *instructions);
+
+private:
+   const glsl_type *read_type();
+   unsigned read_count();
+   ir_variable *read_variable();
+   ir_constant *read_constant();
+   ir_variable *read_variable_index();
+   void read_list(exec_list *list);
+   ir_instruction *read_instruction();
+   ir_rvalue *read_rvalue(bool nullable);
+   ir_dereference *read_dereference(bool nullable);
+
+   void *mem_ctx;
+   struct blob_reader *blob;
+   bool failed;
+
+   ir_variable **variables;
+   unsigned num_variables;
+
+   ir_function **functions;
+   unsigned num_functions;
+
+   ir_function_signature **signatures;
+   unsigned num_signatures;
+};
+
+
+const glsl_type *
+ir_deserializer::read_type()
+{
+   const glsl_type *type = deserialize_glsl_type(this->blob);
+
+   if (type == NULL)
+      this->failed = true;
+
+   return type;
+}
+
+
+/**
+ * Read an element count
+ *
+ * Every element takes at least four bytes, so a count larger than that
+ * can only come from corrupt data.  Checking it here keeps a corrupt count
+ * from causing a huge allocation.
+ */
+unsigned
+ir_deserializer::read_count()
+{
+   const unsigned count = blob_read_uint32(this->blob);
+
+   if (count > (unsigned) (this->blob->end - this->blob->current) / 4) {
+      this->failed = true;
+      return 0;
+   }
+
+   return count;
+}
+
+
+ir_constant *
+ir_deserializer::read_constant()
+{
+   const glsl_type *type = read_type();
+   if (type == NULL)
+      return NULL;
+
+   switch (type->base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_BOOL: {
+      const ir_constant_data *data = (const ir_constant_data *)
+	 blob_read_bytes(this->blob, sizeof(ir_constant_data));
+
+      if (data == NULL) {
+	 this->failed = true;
+	 return NULL;
+      }
+
+      /* The data may not be suitably aligned for a direct read. */
+      ir_constant_data value;
+      memcpy(&value, data, sizeof(value));
+      return new(this->mem_ctx) ir_constant(type, &value);
+   }
+
+   case GLSL_TYPE_STRUCT:
+   case GLSL_TYPE_ARRAY: {
+      exec_list values;
+
+      for (unsigned i = 0; i < type->length; i++) {
+	 ir_constant *const c = read_constant();
+	 if (c == NULL)
+	    return NULL;
+
+	 values.push_tail(c);
+      }
+
+      return new(this->mem_ctx) ir_constant(type, &values);
+   }
+
+   default:
+      this->failed = true;
+      return NULL;
+   }
+}
+
+
+ir_variable *
+ir_deserializer::read_variable()
+{
+   const glsl_type *type = read_type();
+   const char *name = blob_read_string(this->blob);
+   const unsigned mode = blob_read_uint32(this->blob);
+
+   if (type == NULL || mode > ir_var_temporary) {
+      this->failed = true;
+      return NULL;
+   }
+
+   ir_variable *const var =
+      new(this->mem_ctx) ir_variable(type, name, (ir_variable_mode) mode);
+
+   const unsigned flags = blob_read_uint32(this->blob);
+   var->read_only = (flags >> 0) & 1;
+   var->centroid = (flags >> 1) & 1;
+   var->invariant = (flags >> 2) & 1;
+   var->used = (flags >> 3) & 1;
+   var->assigned = (flags >> 4) & 1;
+   var->origin_upper_left = (flags >> 5) & 1;
+   var->pixel_center_integer = (flags >> 6) & 1;
+   var->explicit_location = (flags >> 7) & 1;
+   var->explicit_index = (flags >> 8) & 1;
+   var->has_initializer = (flags >> 9) & 1;
+   var->interpolation = blob_read_uint32(this->blob);
+   var->depth_layout = (ir_depth_layout) blob_read_uint32(this->blob);
+   var->max_array_access = blob_read_uint32(this->blob);
+   var->location = blob_read_uint32(this->blob);
+   var->uniform_block = blob_read_uint32(this->blob);
+   var->index = blob_read_uint32(this->blob);
+
+   var->num_state_slots = read_count();
+   if (var->num_state_slots != 0) {
+      var->state_slots = ralloc_array(var, ir_state_slot,
+				      var->num_state_slots);
+
+      for (unsigned i = 0; i < var->num_state_slots; i++) {
+	 const void *tokens =
+	    blob_read_bytes(this->blob, sizeof(var->state_slots[i].tokens));
+
+	 if (tokens != NULL) {
+	    memcpy(var->state_slots[i].tokens, tokens,
+		   sizeof(var->state_slots[i].tokens));
+	 }
+	 var->state_slots[i].swizzle = blob_read_uint32(this->blob);
+      }
+   }
+
+   if (blob_read_uint32(this->blob))
+      var->constant_value = read_constant();
+
+   if (blob_read_uint32(this->blob))
+      var->constant_initializer = read_constant();
+
+   return var;
+}
+
+
+ir_variable *
+ir_deserializer::read_variable_index()
+{
+   const unsigned i = blob_read_uint32(this->blob);
+
+   if (i >= this->num_variables) {
+      this->failed = true;
+      return NULL;
+   }
+
+   return this->variables[i];
+}
+
+
+void
+ir_deserializer::read_list(exec_list *list)
+{
+   const unsigned count = read_count();
+
+   for (unsigned i = 0; i < count && !this->failed; i++) {
+      ir_instruction *const ir = read_instruction();
+
+      if (ir == NULL)
+	 this->failed = true;
+      else
+	 list->push_tail(ir);
+   }
+}
+
+
+ir_rvalue *
+ir_deserializer::read_rvalue(bool nullable)
+{
+   ir_instruction *const ir = read_instruction();
+   ir_rvalue *const rvalue = ir != NULL ? ir->as_rvalue() : NULL;
+
+   if (rvalue == NULL && (ir != NULL || !nullable))
+      this->failed = true;
+
+   return rvalue;
+}
+
+
+ir_dereference *
+ir_deserializer::read_dereference(bool nullable)
+{
+   ir_rvalue *const rvalue = read_rvalue(nullable);
+   ir_dereference *const deref =
+      rvalue != NULL ? rvalue->as_dereference() : NULL;
+
+   if (rvalue != NULL && deref == NULL)
+      this->failed = true;
+
+   return deref;
+}
+
+
+ir_instruction *
+ir_deserializer::read_instruction()
+{
+   const unsigned type = blob_read_uint32(this->blob);
+
+   if (this->failed || this->blob->overrun)
+      goto fail;
+
+   switch (type) {
+   case ir_type_unset:
+      return NULL;
+
+   case ir_type_variable: {
+      ir_variable *const var = read_variable_index();
+
+      /* Each variable is declared exactly once, and parameters are already
+       * in their signature's parameter list.
+       */
+      if (var == NULL || var->next != NULL)
+	 goto fail;
+
+      return var;
+   }
+
+   case ir_type_assignment: {
+      ir_dereference *const lhs = read_dereference(false);
+      ir_rvalue *const rhs = read_rvalue(false);
+      ir_rvalue *const condition = read_rvalue(true);
+      const unsigned write_mask = blob_read_uint32(this->blob);
+
+      if (this->failed)
+	 goto fail;
+
+      return new(this->mem_ctx) ir_assignment(lhs, rhs, condition,
+					      write_mask);
+   }
+
+   case ir_type_call: {
+      const unsigned i = blob_read_uint32(this->blob);
+      if (i >= this->num_signatures)
+	 goto fail;
+
+      ir_dereference *const ret = read_dereference(true);
+      if (ret != NULL && ret->as_dereference_variable() == NULL)
+	 goto fail;
+
+      exec_list parameters;
+      read_list(&parameters);
+      const bool use_builtin = blob_read_uint32(this->blob) != 0;
+
+      if (this->failed)
+	 goto fail;
+
+      ir_call *const call =
+	 new(this->mem_ctx) ir_call(this->signatures[i],
+				    (ir_dereference_variable *) ret,
+				    &parameters);
+      call->use_builtin = use_builtin;
+      return call;
+   }
+
+   case ir_type_constant:
+      return read_constant();
+
+   case ir_type_dereference_array: {
+      ir_rvalue *const array = read_rvalue(false);
+      ir_rvalue *const index = read_rvalue(false);
+
+      if (this->failed)
+	 goto fail;
+
+      if (!array->type->is_array() && !array->type->is_matrix()
+	  && !array->type->is_vector())
+	 goto fail;
+
+      return new(this->mem_ctx) ir_dereference_array(array, index);
+   }
+
+   case ir_type_dereference_record: {
+      ir_rvalue *const record = read_rvalue(false);
+      const char *field = blob_read_string(this->blob);
+
+      if (this->failed || field == NULL || !record->type->is_record())
+	 goto fail;
+
+      ir_dereference_record *const deref =
+	 new(this->mem_ctx) ir_dereference_record(record, field);
+      if (deref->type->is_error())
+	 goto fail;
+
+      return deref;
+   }
+
+   case ir_type_dereference_variable: {
+      ir_variable *const var = read_variable_index();
+
+      if (var == NULL)
+	 goto fail;
+
+      return new(this->mem_ctx) ir_dereference_variable(var);
+   }
+
+   case ir_type_discard: {
+      ir_rvalue *const condition = read_rvalue(true);
+
+      if (this->failed)
+	 goto fail;
+
+      return new(this->mem_ctx) ir_discard(condition);
+   }
+
+   case ir_type_expression: {
+      const unsigned operation = blob_read_uint32(this->blob);
+      const glsl_type *const expr_type = read_type();
+
+      if (this->failed || operation > ir_last_opcode)
+	 goto fail;
+
+      const unsigned num_operands =
+	 ir_expression::get_num_operands((ir_expression_operation) operation);
+      ir_rvalue *op[4] = { NULL, NULL, NULL, NULL };
+
+      for (unsigned i = 0; i < num_operands; i++)
+	 op[i] = read_rvalue(false);
+
+      if (this->failed)
+	 goto fail;
+
+      return new(this->mem_ctx) ir_expression(operation, expr_type,
+					      op[0], op[1], op[2], op[3]);
+   }
+
+   case ir_type_function: {
+      const unsigned i = blob_read_uint32(this->blob);
+      if (i >= this->num_functions)
+	 goto fail;
+
+      ir_function *const f = this->functions[i];
+      if (f->next != NULL)
+	 goto fail;
+
+      foreach_list(node, &f->signatures) {
+	 read_list(&((ir_function_signature *) node)->body);
+      }
+
+      if (this->failed)
+	 goto fail;
+
+      return f;
+   }
+
+   case ir_type_if: {
+      ir_rvalue *const condition = read_rvalue(false);
+
+      if (this->failed)
+	 goto fail;
+
+      ir_if *const if_stmt = new(this->mem_ctx) ir_if(condition);
+      read_list(&if_stmt->then_instructions);
+      read_list(&if_stmt->else_instructions);
+
+      if (this->failed)
+	 goto fail;
+
+      return if_stmt;
+   }
+
+   case ir_type_loop: {
+      ir_loop *const loop = new(this->mem_ctx) ir_loop();
+
+      loop->from = read_rvalue(true);
+      loop->to = read_rvalue(true);
+      loop->increment = read_rvalue(true);
+
+      const unsigned counter = blob_read_uint32(this->blob);
+      if (counter != NO_INDEX) {
+	 if (counter >= this->num_variables)
+	    goto fail;
+
+	 loop->counter = this->variables[counter];
+      }
+
+      loop->cmp = blob_read_uint32(this->blob);
+      read_list(&loop->body_instructions);
+
+      if (this->failed)
+	 goto fail;
+
+      return loop;
+   }
+
+   case ir_type_loop_jump: {
+      const unsigned mode = blob_read_uint32(this->blob);
+
+      if (mode != ir_loop_jump::jump_break
+	  && mode != ir_loop_jump::jump_continue)
+	 goto fail;
+
+      return new(this->mem_ctx) ir_loop_jump((ir_loop_jump::jump_mode) mode);
+   }
+
+   case ir_type_return: {
+      ir_rvalue *const value = read_rvalue(true);
+
+      if (this->failed)
+	 goto fail;
+
+      return new(this->mem_ctx) ir_return(value);
+   }
+
+   case ir_type_swizzle: {
+      ir_rvalue *const val = read_rvalue(false);
+      const unsigned mask = blob_read_uint32(this->blob);
+      const unsigned count = (mask >> 8) & 7;
+
+      if (this->failed || count < 1 || count > 4
+	  || !(val->type->is_scalar() || val->type->is_vector()))
+	 goto fail;
+
+      return new(this->mem_ctx) ir_swizzle(val,
+					   (mask >> 0) & 3,
+					   (mask >> 2) & 3,
+					   (mask >> 4) & 3,
+					   (mask >> 6) & 3,
+					   count);
+   }
+
+   case ir_type_texture: {
+      const unsigned op = blob_read_uint32(this->blob);
+
+      if (op > ir_txs)
+	 goto fail;
+
+      ir_texture *const tex =
+	 new(this->mem_ctx) ir_texture((ir_texture_opcode) op);
+
+      tex->type = read_type();
+      tex->sampler = read_dereference(false);
+      tex->coordinate = read_rvalue(true);
+      tex->projector = read_rvalue(true);
+      tex->shadow_comparitor = read_rvalue(true);
+      tex->offset = read_rvalue(true);
+
+      switch (tex->op) {
+      case ir_tex:
+	 break;
+      case ir_txb:
+	 tex->lod_info.bias = read_rvalue(false);
+	 break;
+      case ir_txl:
+      case ir_txf:
+      case ir_txs:
+	 tex->lod_info.lod = read_rvalue(false);
+	 break;
+      case ir_txd:
+	 tex->lod_info.grad.dPdx = read_rvalue(false);
+	 tex->lod_info.grad.dPdy = read_rvalue(false);
+	 break;
+      }
+
+      if (this->failed)
+	 goto fail;
+
+      return tex;
+   }
+   }
+
+fail:
+   this->failed = true;
+   return NULL;
+}
+
+
+bool
+ir_deserializer::run(exec_list *instructions)
+{
+   this->num_variables = read_count();
+   this->variables = new ir_variable *[this->num_variables];
+   for (unsigned i = 0; i < this->num_variables; i++) {
+      this->variables[i] = read_variable();
+      if (this->variables[i] == NULL)
+	 return false;
+   }
+
+   this->num_functions = read_count();
+   this->functions = new ir_function *[this->num_functions];
+
+   const unsigned total_signatures = read_count();
+   this->signatures = new ir_function_signature *[total_signatures];
+
+   for (unsigned i = 0; i < this->num_functions; i++) {
+      const char *name = blob_read_string(this->blob);
+      const unsigned num_signatures = read_count();
+
+      if (name == NULL || num_signatures == 0
+	  || num_signatures > total_signatures - this->num_signatures)
+	 return false;
+
+      ir_function *const f = new(this->mem_ctx) ir_function(name);
+      this->functions[i] = f;
+
+      for (unsigned j = 0; j < num_signatures; j++) {
+	 const glsl_type *return_type = read_type();
+	 const unsigned flags = blob_read_uint32(this->blob);
+	 const unsigned num_parameters = read_count();
+
+	 if (this->failed)
+	    return false;
+
+	 ir_function_signature *const sig =
+	    new(this->mem_ctx) ir_function_signature(return_type);
+	 sig->is_defined = (flags >> 0) & 1;
+	 sig->is_builtin = (flags >> 1) & 1;
+
+	 for (unsigned k = 0; k < num_parameters; k++) {
+	    ir_variable *const param = read_variable_index();
+
+	    if (param == NULL || param->next != NULL)
+	       return false;
+
+	    sig->parameters.push_tail(param);
+	 }
+
+	 f->add_signature(sig);
+	 this->signatures[this->num_signatures++] = sig;
+      }
+   }
+
+   if (this->num_signatures != total_signatures)
+      return false;
+
+   read_list(instructions);
+
+   return !this->failed && !this->blob->overrun;
+}
+
+} /* anonymous namespace */
+
+
+bool
+serialize_ir(struct blob *blob, exec_list *instructions)
+{
+   ir_serializer s(blob);
+
+   return s.run(instructions);
+}
+
+
+bool
+deserialize_ir(void *mem_ctx, struct blob_reader *blob,
+               exec_list *instructions)
+{
+   ir_deserializer d(mem_ctx, blob);
+
+   return d.run(instructions);
+}
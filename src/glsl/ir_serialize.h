@@ -0,0 +1,78 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef IR_SERIALIZE_H
+#define IR_SERIALIZE_H
+
+/**
+ * \file ir_serialize.h
+ *
+ * Binary serialization of GLSL IR.
+ *
+ * Unlike the s-expressions produced by \c ir_print_visitor, the binary form
+ * preserves every field of the IR that the linker and the back-ends look
+ * at (locations, interpolation, state slots, uniform block indices, ...),
+ * so a deserialized instruction stream can be handed straight to a driver.
+ */
+
+struct blob;
+struct blob_reader;
+struct exec_list;
+struct glsl_type;
+
+void
+serialize_glsl_type(struct blob *blob, const glsl_type *type);
+
+/**
+ * \return
+ * The type, or \c NULL if the data does not describe a valid type.
+ */
+const glsl_type *
+deserialize_glsl_type(struct blob_reader *blob);
+
+/**
+ * Serialize a complete, self-contained instruction stream
+ *
+ * Every variable dereferenced in \c instructions must be declared in it,
+ * and every function called must be defined in it, as is the case for
+ * linked shaders.
+ *
+ * \return
+ * \c false if the IR could not be serialized.
+ */
+bool
+serialize_ir(struct blob *blob, exec_list *instructions);
+
+/**
+ * Append the IR stored by \c serialize_ir to \c instructions
+ *
+ * \return
+ * \c false if the data is malformed.  \c instructions may then contain a
+ * partially read instruction stream.
+ */
+bool
+deserialize_ir(void *mem_ctx, struct blob_reader *blob,
+               exec_list *instructions);
+
+#endif /* IR_SERIALIZE_H */
@@ -85,7 +85,13 @@ public:
 
       /* Try to find the signature in one of the other shaders that is being
        * linked.  If it's not found there, return an error.
+       *
+       * The bodies of built-in functions are read when a shader calls them,
+       * but maybe not in all of the built-in shaders being linked.
        */
+      if (ir->use_builtin)
+	 _mesa_glsl_read_builtin_function(shader_list, num_shaders, name);
+
       sig = find_matching_signature(name, &ir->actual_parameters, shader_list,
 				    num_shaders, ir->use_builtin);
       if (sig == NULL) {
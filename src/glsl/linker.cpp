@@ -2573,8 +2573,7 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
 
       unsigned max_unroll = ctx->ShaderCompilerOptions[i].MaxUnrollIterations;
 
-      while (do_common_optimization(prog->_LinkedShaders[i]->ir, true, false, max_unroll))
-	 ;
+      do_common_optimization(prog->_LinkedShaders[i]->ir, true, false, max_unroll);
    }
 
    /* FINISHME: The value of the max_attribute_index parameter is
@@ -174,10 +174,7 @@ compile_shader(struct gl_context *ctx, struct gl_shader *shader)
 
    /* Optimization passes */
    if (!state->error && !shader->ir->is_empty()) {
-      bool progress;
-      do {
-	 progress = do_common_optimization(shader->ir, false, false, 32);
-      } while (progress);
+      do_common_optimization(shader->ir, false, false, 32);
 
       validate_ir_tree(shader->ir);
    }
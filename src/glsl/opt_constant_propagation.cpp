@@ -40,6 +40,7 @@
 #include "ir_basic_block.h"
 #include "ir_optimization.h"
 #include "glsl_types.h"
+#include "ir_acp.h"
 
 namespace {
 
@@ -73,17 +74,24 @@ public:
 };
 
 
-class kill_entry : public exec_node
+/** The constants available for a variable */
+class acp_var : public acp_var_base
 {
 public:
-   kill_entry(ir_variable *var, unsigned write_mask)
+   /** List of acp_entry */
+   exec_list entries;
+};
+
+
+/** The channels of a variable killed in a block */
+class kill_entry : public acp_var_base
+{
+public:
+   kill_entry()
    {
-      assert(var);
-      this->var = var;
-      this->write_mask = write_mask;
+      this->write_mask = 0;
    }
 
-   ir_variable *var;
    unsigned write_mask;
 };
 
@@ -94,8 +102,8 @@ public:
       progress = false;
       killed_all = false;
       mem_ctx = ralloc_context(0);
-      this->acp = new(mem_ctx) exec_list;
-      this->kills = new(mem_ctx) exec_list;
+      this->acp = acp_table_create(mem_ctx);
+      this->kills = acp_table_create(mem_ctx);
    }
    ~ir_constant_propagation_visitor()
    {
@@ -110,18 +118,22 @@ public:
    virtual ir_visitor_status visit_enter(class ir_if *);
 
    void add_constant(ir_assignment *ir);
+   void add_entry(acp_entry *entry);
    void kill(ir_variable *ir, unsigned write_mask);
    void handle_if_block(exec_list *instructions);
    void handle_rvalue(ir_rvalue **rvalue);
 
-   /** List of acp_entry: The available constants to propagate */
-   exec_list *acp;
+   /**
+    * Hash table of acp_var, indexed by variable: The available constants
+    * to propagate.
+    */
+   hash_table *acp;
 
    /**
-    * List of kill_entry: The masks of variables whose values were
+    * Hash table of kill_entry: The masks of variables whose values were
     * killed in this block.
     */
-   exec_list *kills;
+   hash_table *kills;
 
    bool progress;
 
@@ -153,6 +165,10 @@ ir_constant_propagation_visitor::handle_rvalue(ir_rvalue **rvalue)
 	 return;
    }
 
+   acp_var *v = (acp_var *) acp_table_find(this->acp, deref->var);
+   if (!v)
+      return;
+
    ir_constant_data data;
    memset(&data, 0, sizeof(data));
 
@@ -172,9 +188,9 @@ ir_constant_propagation_visitor::handle_rvalue(ir_rvalue **rvalue)
 	 channel = i;
       }
 
-      foreach_iter(exec_list_iterator, iter, *this->acp) {
-	 acp_entry *entry = (acp_entry *)iter.get();
-	 if (entry->var == deref->var && entry->write_mask & (1 << channel)) {
+      foreach_list(node, &v->entries) {
+	 acp_entry *entry = (acp_entry *) node;
+	 if (entry->write_mask & (1 << channel)) {
 	    found = entry;
 	    break;
 	 }
@@ -221,16 +237,19 @@ ir_constant_propagation_visitor::visit_enter(ir_function_signature *ir)
     * block.  Any instructions at global scope will be shuffled into
     * main() at link time, so they're irrelevant to us.
     */
-   exec_list *orig_acp = this->acp;
-   exec_list *orig_kills = this->kills;
+   hash_table *orig_acp = this->acp;
+   hash_table *orig_kills = this->kills;
    bool orig_killed_all = this->killed_all;
 
-   this->acp = new(mem_ctx) exec_list;
-   this->kills = new(mem_ctx) exec_list;
+   this->acp = acp_table_create(mem_ctx);
+   this->kills = acp_table_create(mem_ctx);
    this->killed_all = false;
 
    visit_list_elements(this, &ir->body);
 
+   ralloc_free(this->acp);
+   ralloc_free(this->kills);
+
    this->kills = orig_kills;
    this->acp = orig_acp;
    this->killed_all = orig_killed_all;
@@ -299,7 +318,7 @@ ir_constant_propagation_visitor::visit_enter(ir_call *ir)
    /* Since we're unlinked, we don't (necssarily) know the side effects of
     * this call.  So kill all copies.
     */
-   acp->make_empty();
+   acp_table_clear(this->acp);
    this->killed_all = true;
 
    return visit_continue_with_parent;
@@ -308,35 +327,40 @@ ir_constant_propagation_visitor::visit_enter(ir_call *ir)
 void
 ir_constant_propagation_visitor::handle_if_block(exec_list *instructions)
 {
-   exec_list *orig_acp = this->acp;
-   exec_list *orig_kills = this->kills;
+   hash_table *orig_acp = this->acp;
+   hash_table *orig_kills = this->kills;
    bool orig_killed_all = this->killed_all;
 
-   this->acp = new(mem_ctx) exec_list;
-   this->kills = new(mem_ctx) exec_list;
+   this->acp = acp_table_create(mem_ctx);
+   this->kills = acp_table_create(mem_ctx);
    this->killed_all = false;
 
    /* Populate the initial acp with a constant of the original */
-   foreach_iter(exec_list_iterator, iter, *orig_acp) {
-      acp_entry *a = (acp_entry *)iter.get();
-      this->acp->push_tail(new(this->mem_ctx) acp_entry(a));
+   hash_entry *he;
+   hash_table_foreach(orig_acp, he) {
+      foreach_list(node, &((acp_var *) he->data)->entries) {
+	 acp_entry *a = (acp_entry *) node;
+	 add_entry(new(this->acp) acp_entry(a));
+      }
    }
 
    visit_list_elements(this, instructions);
 
    if (this->killed_all) {
-      orig_acp->make_empty();
+      acp_table_clear(orig_acp);
    }
 
-   exec_list *new_kills = this->kills;
+   hash_table *new_kills = this->kills;
+   ralloc_free(this->acp);
    this->kills = orig_kills;
    this->acp = orig_acp;
    this->killed_all = this->killed_all || orig_killed_all;
 
-   foreach_iter(exec_list_iterator, iter, *new_kills) {
-      kill_entry *k = (kill_entry *)iter.get();
-      kill(k->var, k->write_mask);
+   hash_table_foreach(new_kills, he) {
+      kill_entry *k = (kill_entry *) he->data;
+      kill((ir_variable *) he->key, k->write_mask);
    }
+   ralloc_free(new_kills);
 }
 
 ir_visitor_status
@@ -355,33 +379,36 @@ ir_constant_propagation_visitor::visit_enter(ir_if *ir)
 ir_visitor_status
 ir_constant_propagation_visitor::visit_enter(ir_loop *ir)
 {
-   exec_list *orig_acp = this->acp;
-   exec_list *orig_kills = this->kills;
+   hash_table *orig_acp = this->acp;
+   hash_table *orig_kills = this->kills;
    bool orig_killed_all = this->killed_all;
 
    /* FINISHME: For now, the initial acp for loops is totally empty.
     * We could go through once, then go through again with the acp
     * cloned minus the killed entries after the first run through.
     */
-   this->acp = new(mem_ctx) exec_list;
-   this->kills = new(mem_ctx) exec_list;
+   this->acp = acp_table_create(mem_ctx);
+   this->kills = acp_table_create(mem_ctx);
    this->killed_all = false;
 
    visit_list_elements(this, &ir->body_instructions);
 
    if (this->killed_all) {
-      orig_acp->make_empty();
+      acp_table_clear(orig_acp);
    }
 
-   exec_list *new_kills = this->kills;
+   hash_table *new_kills = this->kills;
+   ralloc_free(this->acp);
    this->kills = orig_kills;
    this->acp = orig_acp;
    this->killed_all = this->killed_all || orig_killed_all;
 
-   foreach_iter(exec_list_iterator, iter, *new_kills) {
-      kill_entry *k = (kill_entry *)iter.get();
-      kill(k->var, k->write_mask);
+   hash_entry *he;
+   hash_table_foreach(new_kills, he) {
+      kill_entry *k = (kill_entry *) he->data;
+      kill((ir_variable *) he->key, k->write_mask);
    }
+   ralloc_free(new_kills);
 
    /* already descended into the children. */
    return visit_continue_with_parent;
@@ -397,29 +424,27 @@ ir_constant_propagation_visitor::kill(ir_variable *var, unsigned write_mask)
       return;
 
    /* Remove any entries currently in the ACP for this kill. */
-   foreach_iter(exec_list_iterator, iter, *this->acp) {
-      acp_entry *entry = (acp_entry *)iter.get();
+   acp_var *v = (acp_var *) acp_table_find(this->acp, var);
+   if (v) {
+      foreach_list_safe(node, &v->entries) {
+	 acp_entry *entry = (acp_entry *) node;
 
-      if (entry->var == var) {
 	 entry->write_mask &= ~write_mask;
 	 if (entry->write_mask == 0)
 	    entry->remove();
       }
    }
 
-   /* Add this writemask of the variable to the list of killed
+   /* Add this writemask of the variable to the table of killed
     * variables in this block.
     */
-   foreach_iter(exec_list_iterator, iter, *this->kills) {
-      kill_entry *entry = (kill_entry *)iter.get();
+   acp_table_get<kill_entry>(this->kills, var)->write_mask |= write_mask;
+}
 
-      if (entry->var == var) {
-	 entry->write_mask |= write_mask;
-	 return;
-      }
-   }
-   /* Not already in the list.  Make new entry. */
-   this->kills->push_tail(new(this->mem_ctx) kill_entry(var, write_mask));
+void
+ir_constant_propagation_visitor::add_entry(acp_entry *entry)
+{
+   acp_table_get<acp_var>(this->acp, entry->var)->entries.push_tail(entry);
 }
 
 /**
@@ -449,8 +474,8 @@ ir_constant_propagation_visitor::add_constant(ir_assignment *ir)
    if (!deref->var->type->is_vector() && !deref->var->type->is_scalar())
       return;
 
-   entry = new(this->mem_ctx) acp_entry(deref->var, ir->write_mask, constant);
-   this->acp->push_tail(entry);
+   entry = new(this->acp) acp_entry(deref->var, ir->write_mask, constant);
+   add_entry(entry);
 }
 
 } /* unnamed namespace */
@@ -37,6 +37,7 @@
 #include "ir_basic_block.h"
 #include "ir_optimization.h"
 #include "glsl_types.h"
+#include "ir_acp.h"
 
 namespace {
 
@@ -68,13 +69,33 @@ public:
    ir_variable *var;
 };
 
+
+/** The ACP entries that copy to and from a variable */
+class acp_var : public acp_var_base
+{
+public:
+   acp_var()
+   {
+      this->lhs_entry = NULL;
+   }
+
+   /**
+    * The copy to the variable, if any.  Adding a copy kills its LHS first,
+    * so there is at most one.
+    */
+   acp_entry *lhs_entry;
+
+   /** List of acp_entry: The copies from the variable. */
+   exec_list rhs_entries;
+};
+
 class ir_copy_propagation_visitor : public ir_hierarchical_visitor {
 public:
    ir_copy_propagation_visitor()
    {
       progress = false;
       mem_ctx = ralloc_context(0);
-      this->acp = new(mem_ctx) exec_list;
+      this->acp = acp_table_create(mem_ctx);
       this->kills = new(mem_ctx) exec_list;
    }
    ~ir_copy_propagation_visitor()
@@ -91,11 +112,15 @@ public:
    virtual ir_visitor_status visit_enter(class ir_if *);
 
    void add_copy(ir_assignment *ir);
+   void add_entry(acp_entry *entry);
    void kill(ir_variable *ir);
    void handle_if_block(exec_list *instructions);
 
-   /** List of acp_entry: The available copies to propagate */
-   exec_list *acp;
+   /**
+    * Hash table of acp_var, indexed by variable: The available copies to
+    * propagate.
+    */
+   hash_table *acp;
    /**
     * List of kill_entry: The variables whose values were killed in this
     * block.
@@ -118,16 +143,18 @@ ir_copy_propagation_visitor::visit_enter(ir_function_signature *ir)
     * block.  Any instructions at global scope will be shuffled into
     * main() at link time, so they're irrelevant to us.
     */
-   exec_list *orig_acp = this->acp;
+   hash_table *orig_acp = this->acp;
    exec_list *orig_kills = this->kills;
    bool orig_killed_all = this->killed_all;
 
-   this->acp = new(mem_ctx) exec_list;
+   this->acp = acp_table_create(mem_ctx);
    this->kills = new(mem_ctx) exec_list;
    this->killed_all = false;
 
    visit_list_elements(this, &ir->body);
 
+   ralloc_free(this->acp);
+
    this->kills = orig_kills;
    this->acp = orig_acp;
    this->killed_all = orig_killed_all;
@@ -165,16 +192,10 @@ ir_copy_propagation_visitor::visit(ir_dereference_variable *ir)
    if (this->in_assignee)
       return visit_continue;
 
-   ir_variable *var = ir->var;
-
-   foreach_iter(exec_list_iterator, iter, *this->acp) {
-      acp_entry *entry = (acp_entry *)iter.get();
-
-      if (var == entry->lhs) {
-	 ir->var = entry->rhs;
-	 this->progress = true;
-	 break;
-      }
+   acp_var *v = (acp_var *) acp_table_find(this->acp, ir->var);
+   if (v && v->lhs_entry) {
+      ir->var = v->lhs_entry->rhs;
+      this->progress = true;
    }
 
    return visit_continue;
@@ -198,7 +219,7 @@ ir_copy_propagation_visitor::visit_enter(ir_call *ir)
    /* Since we're unlinked, we don't (necessarily) know the side effects of
     * this call.  So kill all copies.
     */
-   acp->make_empty();
+   acp_table_clear(this->acp);
    this->killed_all = true;
 
    return visit_continue_with_parent;
@@ -207,27 +228,31 @@ ir_copy_propagation_visitor::visit_enter(ir_call *ir)
 void
 ir_copy_propagation_visitor::handle_if_block(exec_list *instructions)
 {
-   exec_list *orig_acp = this->acp;
+   hash_table *orig_acp = this->acp;
    exec_list *orig_kills = this->kills;
    bool orig_killed_all = this->killed_all;
 
-   this->acp = new(mem_ctx) exec_list;
+   this->acp = acp_table_create(mem_ctx);
    this->kills = new(mem_ctx) exec_list;
    this->killed_all = false;
 
    /* Populate the initial acp with a copy of the original */
-   foreach_iter(exec_list_iterator, iter, *orig_acp) {
-      acp_entry *a = (acp_entry *)iter.get();
-      this->acp->push_tail(new(this->mem_ctx) acp_entry(a->lhs, a->rhs));
+   hash_entry *he;
+   hash_table_foreach(orig_acp, he) {
+      acp_entry *a = ((acp_var *) he->data)->lhs_entry;
+
+      if (a)
+	 add_entry(new(this->acp) acp_entry(a->lhs, a->rhs));
    }
 
    visit_list_elements(this, instructions);
 
    if (this->killed_all) {
-      orig_acp->make_empty();
+      acp_table_clear(orig_acp);
    }
 
    exec_list *new_kills = this->kills;
+   ralloc_free(this->acp);
    this->kills = orig_kills;
    this->acp = orig_acp;
    this->killed_all = this->killed_all || orig_killed_all;
@@ -253,7 +278,7 @@ ir_copy_propagation_visitor::visit_enter(ir_if *ir)
 ir_visitor_status
 ir_copy_propagation_visitor::visit_enter(ir_loop *ir)
 {
-   exec_list *orig_acp = this->acp;
+   hash_table *orig_acp = this->acp;
    exec_list *orig_kills = this->kills;
    bool orig_killed_all = this->killed_all;
 
@@ -261,17 +286,18 @@ ir_copy_propagation_visitor::visit_enter(ir_loop *ir)
     * We could go through once, then go through again with the acp
     * cloned minus the killed entries after the first run through.
     */
-   this->acp = new(mem_ctx) exec_list;
+   this->acp = acp_table_create(mem_ctx);
    this->kills = new(mem_ctx) exec_list;
    this->killed_all = false;
 
    visit_list_elements(this, &ir->body_instructions);
 
    if (this->killed_all) {
-      orig_acp->make_empty();
+      acp_table_clear(orig_acp);
    }
 
    exec_list *new_kills = this->kills;
+   ralloc_free(this->acp);
    this->kills = orig_kills;
    this->acp = orig_acp;
    this->killed_all = this->killed_all || orig_killed_all;
@@ -291,10 +317,17 @@ ir_copy_propagation_visitor::kill(ir_variable *var)
    assert(var != NULL);
 
    /* Remove any entries currently in the ACP for this kill. */
-   foreach_iter(exec_list_iterator, iter, *acp) {
-      acp_entry *entry = (acp_entry *)iter.get();
+   acp_var *v = (acp_var *) acp_table_find(this->acp, var);
+   if (v) {
+      if (v->lhs_entry) {
+	 v->lhs_entry->remove();
+	 v->lhs_entry = NULL;
+      }
+
+      foreach_list_safe(node, &v->rhs_entries) {
+	 acp_entry *entry = (acp_entry *) node;
 
-      if (entry->lhs == var || entry->rhs == var) {
+	 ((acp_var *) acp_table_find(this->acp, entry->lhs))->lhs_entry = NULL;
 	 entry->remove();
       }
    }
@@ -304,6 +337,13 @@ ir_copy_propagation_visitor::kill(ir_variable *var)
    this->kills->push_tail(new(this->mem_ctx) kill_entry(var));
 }
 
+void
+ir_copy_propagation_visitor::add_entry(acp_entry *entry)
+{
+   acp_table_get<acp_var>(this->acp, entry->lhs)->lhs_entry = entry;
+   acp_table_get<acp_var>(this->acp, entry->rhs)->rhs_entries.push_tail(entry);
+}
+
 /**
  * Adds an entry to the available copy list if it's a plain assignment
  * of a variable to a variable.
@@ -329,8 +369,8 @@ ir_copy_propagation_visitor::add_copy(ir_assignment *ir)
 	 ir->condition = new(ralloc_parent(ir)) ir_constant(false);
 	 this->progress = true;
       } else {
-	 entry = new(this->mem_ctx) acp_entry(lhs_var, rhs_var);
-	 this->acp->push_tail(entry);
+	 entry = new(this->acp) acp_entry(lhs_var, rhs_var);
+	 add_entry(entry);
       }
    }
 }
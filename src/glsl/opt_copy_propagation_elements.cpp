@@ -46,6 +46,7 @@
 #include "ir_basic_block.h"
 #include "ir_optimization.h"
 #include "glsl_types.h"
+#include "ir_acp.h"
 
 static bool debug = false;
 
@@ -74,6 +75,24 @@ public:
    ir_variable *rhs;
    unsigned int write_mask;
    int swizzle[4];
+
+   /** Link in acp_var::rhs_entries of \c rhs */
+   exec_node rhs_link;
+};
+
+
+/** The ACP entries that copy to and from a variable */
+class acp_var : public acp_var_base
+{
+public:
+   /**
+    * List of acp_entry: The copies to the variable, in the order they were
+    * added.
+    */
+   exec_list lhs_entries;
+
+   /** List of acp_entry::rhs_link: The copies from the variable. */
+   exec_list rhs_entries;
 };
 
 
@@ -98,7 +117,7 @@ public:
       this->killed_all = false;
       this->mem_ctx = ralloc_context(NULL);
       this->shader_mem_ctx = NULL;
-      this->acp = new(mem_ctx) exec_list;
+      this->acp = acp_table_create(mem_ctx);
       this->kills = new(mem_ctx) exec_list;
    }
    ~ir_copy_propagation_elements_visitor()
@@ -116,11 +135,16 @@ public:
    void handle_rvalue(ir_rvalue **rvalue);
 
    void add_copy(ir_assignment *ir);
+   void add_entry(acp_entry *entry);
+   void remove_entry(acp_entry *entry);
    void kill(kill_entry *k);
    void handle_if_block(exec_list *instructions);
 
-   /** List of acp_entry: The available copies to propagate */
-   exec_list *acp;
+   /**
+    * Hash table of acp_var, indexed by variable: The available copies to
+    * propagate.
+    */
+   hash_table *acp;
    /**
     * List of kill_entry: The variables whose values were killed in this
     * block.
@@ -146,16 +170,18 @@ ir_copy_propagation_elements_visitor::visit_enter(ir_function_signature *ir)
     * block.  Any instructions at global scope will be shuffled into
     * main() at link time, so they're irrelevant to us.
     */
-   exec_list *orig_acp = this->acp;
+   hash_table *orig_acp = this->acp;
    exec_list *orig_kills = this->kills;
    bool orig_killed_all = this->killed_all;
 
-   this->acp = new(mem_ctx) exec_list;
+   this->acp = acp_table_create(mem_ctx);
    this->kills = new(mem_ctx) exec_list;
    this->killed_all = false;
 
    visit_list_elements(this, &ir->body);
 
+   ralloc_free(this->acp);
+
    this->kills = orig_kills;
    this->acp = orig_acp;
    this->killed_all = orig_killed_all;
@@ -244,15 +270,17 @@ ir_copy_propagation_elements_visitor::handle_rvalue(ir_rvalue **ir)
    /* Try to find ACP entries covering swizzle_chan[], hoping they're
     * the same source variable.
     */
-   foreach_iter(exec_list_iterator, iter, *this->acp) {
-      acp_entry *entry = (acp_entry *)iter.get();
-
-      if (var == entry->lhs) {
-	 for (int c = 0; c < chans; c++) {
-	    if (entry->write_mask & (1 << swizzle_chan[c])) {
-	       source[c] = entry->rhs;
-	       source_chan[c] = entry->swizzle[swizzle_chan[c]];
-	    }
+   acp_var *v = (acp_var *) acp_table_find(this->acp, var);
+   if (!v)
+      return;
+
+   foreach_list(node, &v->lhs_entries) {
+      acp_entry *entry = (acp_entry *) node;
+
+      for (int c = 0; c < chans; c++) {
+	 if (entry->write_mask & (1 << swizzle_chan[c])) {
+	    source[c] = entry->rhs;
+	    source_chan[c] = entry->swizzle[swizzle_chan[c]];
 	 }
       }
    }
@@ -265,6 +293,20 @@ ir_copy_propagation_elements_visitor::handle_rvalue(ir_rvalue **ir)
 	 return;
    }
 
+   /* Copies of a variable to itself, like (assign (x) (var_ref a)
+    * (swiz x (var_ref a))), would rewrite the rvalue to the same channels
+    * of the same variable.  That is no progress.
+    */
+   if (source[0] == var) {
+      int c;
+      for (c = 0; c < chans; c++) {
+	 if (source_chan[c] != swizzle_chan[c])
+	    break;
+      }
+      if (c == chans)
+	 return;
+   }
+
    if (!shader_mem_ctx)
       shader_mem_ctx = ralloc_parent(deref_var);
 
@@ -280,6 +322,7 @@ ir_copy_propagation_elements_visitor::handle_rvalue(ir_rvalue **ir)
 					source_chan[2],
 					source_chan[3],
 					chans);
+   this->progress = true;
 
    if (debug) {
       printf("to:\n");
@@ -306,7 +349,7 @@ ir_copy_propagation_elements_visitor::visit_enter(ir_call *ir)
    /* Since we're unlinked, we don't (necessarily) know the side effects of
     * this call.  So kill all copies.
     */
-   acp->make_empty();
+   acp_table_clear(this->acp);
    this->killed_all = true;
 
    return visit_continue_with_parent;
@@ -315,33 +358,39 @@ ir_copy_propagation_elements_visitor::visit_enter(ir_call *ir)
 void
 ir_copy_propagation_elements_visitor::handle_if_block(exec_list *instructions)
 {
-   exec_list *orig_acp = this->acp;
+   hash_table *orig_acp = this->acp;
    exec_list *orig_kills = this->kills;
    bool orig_killed_all = this->killed_all;
 
-   this->acp = new(mem_ctx) exec_list;
+   this->acp = acp_table_create(mem_ctx);
    this->kills = new(mem_ctx) exec_list;
    this->killed_all = false;
 
    /* Populate the initial acp with a copy of the original */
-   foreach_iter(exec_list_iterator, iter, *orig_acp) {
-      acp_entry *a = (acp_entry *)iter.get();
-      this->acp->push_tail(new(this->mem_ctx) acp_entry(a));
+   hash_entry *he;
+   hash_table_foreach(orig_acp, he) {
+      acp_var *v = (acp_var *) he->data;
+
+      foreach_list(node, &v->lhs_entries) {
+	 acp_entry *a = (acp_entry *) node;
+	 add_entry(new(this->acp) acp_entry(a));
+      }
    }
 
    visit_list_elements(this, instructions);
 
    if (this->killed_all) {
-      orig_acp->make_empty();
+      acp_table_clear(orig_acp);
    }
 
    exec_list *new_kills = this->kills;
+   ralloc_free(this->acp);
    this->kills = orig_kills;
    this->acp = orig_acp;
    this->killed_all = this->killed_all || orig_killed_all;
 
    /* Move the new kills into the parent block's list, removing them
-    * from the parent's ACP list in the process.
+    * from the parent's ACP in the process.
     */
    foreach_list_safe(node, new_kills) {
       kill_entry *k = (kill_entry *)node;
@@ -364,7 +413,7 @@ ir_copy_propagation_elements_visitor::visit_enter(ir_if *ir)
 ir_visitor_status
 ir_copy_propagation_elements_visitor::visit_enter(ir_loop *ir)
 {
-   exec_list *orig_acp = this->acp;
+   hash_table *orig_acp = this->acp;
    exec_list *orig_kills = this->kills;
    bool orig_killed_all = this->killed_all;
 
@@ -372,17 +421,18 @@ ir_copy_propagation_elements_visitor::visit_enter(ir_loop *ir)
     * We could go through once, then go through again with the acp
     * cloned minus the killed entries after the first run through.
     */
-   this->acp = new(mem_ctx) exec_list;
+   this->acp = acp_table_create(mem_ctx);
    this->kills = new(mem_ctx) exec_list;
    this->killed_all = false;
 
    visit_list_elements(this, &ir->body_instructions);
 
    if (this->killed_all) {
-      orig_acp->make_empty();
+      acp_table_clear(orig_acp);
    }
 
    exec_list *new_kills = this->kills;
+   ralloc_free(this->acp);
    this->kills = orig_kills;
    this->acp = orig_acp;
    this->killed_all = this->killed_all || orig_killed_all;
@@ -400,18 +450,18 @@ ir_copy_propagation_elements_visitor::visit_enter(ir_loop *ir)
 void
 ir_copy_propagation_elements_visitor::kill(kill_entry *k)
 {
-   foreach_list_safe(node, acp) {
-      acp_entry *entry = (acp_entry *)node;
+   acp_var *v = (acp_var *) acp_table_find(this->acp, k->var);
+   if (v) {
+      foreach_list_safe(node, &v->lhs_entries) {
+	 acp_entry *entry = (acp_entry *) node;
 
-      if (entry->lhs == k->var) {
 	 entry->write_mask = entry->write_mask & ~k->write_mask;
-	 if (entry->write_mask == 0) {
-	    entry->remove();
-	    continue;
-	 }
+	 if (entry->write_mask == 0)
+	    remove_entry(entry);
       }
-      if (entry->rhs == k->var) {
-	 entry->remove();
+
+      foreach_list_safe(node, &v->rhs_entries) {
+	 remove_entry(exec_node_data(acp_entry, node, rhs_link));
       }
    }
 
@@ -422,6 +472,23 @@ ir_copy_propagation_elements_visitor::kill(kill_entry *k)
    this->kills->push_tail(k);
 }
 
+void
+ir_copy_propagation_elements_visitor::add_entry(acp_entry *entry)
+{
+   acp_var *lhs = acp_table_get<acp_var>(this->acp, entry->lhs);
+   acp_var *rhs = acp_table_get<acp_var>(this->acp, entry->rhs);
+
+   lhs->lhs_entries.push_tail(entry);
+   rhs->rhs_entries.push_tail(&entry->rhs_link);
+}
+
+void
+ir_copy_propagation_elements_visitor::remove_entry(acp_entry *entry)
+{
+   entry->remove();
+   entry->rhs_link.remove();
+}
+
 /**
  * Adds directly-copied channels between vector variables to the available
  * copy propagation list.
@@ -474,14 +541,13 @@ ir_copy_propagation_elements_visitor::add_copy(ir_assignment *ir)
        * copy-propagated from.
        */
       for (int i = 0; i < 4; i++) {
-	 if (ir->write_mask & (1 << orig_swizzle[i]))
+	 if ((write_mask & (1 << i)) && (ir->write_mask & (1 << swizzle[i])))
 	    write_mask &= ~(1 << i);
       }
    }
 
-   entry = new(this->mem_ctx) acp_entry(lhs->var, rhs->var, write_mask,
-					swizzle);
-   this->acp->push_tail(entry);
+   entry = new(this->acp) acp_entry(lhs->var, rhs->var, write_mask, swizzle);
+   add_entry(entry);
 }
 
 bool
@@ -327,7 +327,10 @@ try_tree_grafting(ir_assignment *start,
 	 return v.progress;
    }
 
-   return false;
+   /* A graft deep inside an expression does not always stop the walk, so
+    * the graft may have happened anyway.
+    */
+   return v.progress;
 }
 
 static void
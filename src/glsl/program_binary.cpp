@@ -0,0 +1,660 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file program_binary.cpp
+ *
+ * A program binary is a header followed by a payload:
+ *
+ *  - magic number and format version,
+ *  - a key identifying the Mesa build and the context limits,
+ *  - a checksum of the payload,
+ *  - the payload: everything \c link_shaders stores in the program, except
+ *    for the uniform storage, which \c link_assign_uniform_locations
+ *    rebuilds from the IR.
+ *
+ * The on-disk cache stores the same binaries, one file per program.  Each
+ * file starts with a key made of everything that affects the result of
+ * linking, and is named after a hash of that key.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main/core.h"
+#include "main/shaderobj.h"
+#include "main/version.h"
+#include "blob.h"
+#include "ir.h"
+#include "ir_serialize.h"
+#include "linker.h"
+#include "program.h"
+#include "program_binary.h"
+#include "program/hash_table.h"
+
+#define PROGRAM_BINARY_MAGIC   0x4153454d /* "MESA" */
+#define PROGRAM_BINARY_VERSION 1
+
+/** Size of the header: magic, version, context key and checksum */
+#define PROGRAM_BINARY_HEADER_SIZE (2 * sizeof(uint32_t) + 2 * sizeof(uint64_t))
+
+/** Offset of the checksum in the header */
+#define PROGRAM_BINARY_CHECKSUM_OFFSET (2 * sizeof(uint32_t) + sizeof(uint64_t))
+
+#define FNV1A_64_INIT  0xcbf29ce484222325ull
+#define FNV1A_64_PRIME 0x100000001b3ull
+
+static uint64_t
+hash_data(uint64_t hash, const void *data, size_t size)
+{
+   const uint8_t *bytes = (const uint8_t *) data;
+
+   for (size_t i = 0; i < size; i++) {
+      hash ^= bytes[i];
+      hash *= FNV1A_64_PRIME;
+   }
+
+   return hash;
+}
+
+static uint64_t
+hash_uint32(uint64_t hash, uint32_t value)
+{
+   return hash_data(hash, &value, sizeof(value));
+}
+
+/**
+ * Hash of everything a binary depends on besides the program itself
+ *
+ * The IR and the layout of the payload change between builds without any
+ * notice, so the build time is part of the key.  The context limits and
+ * enabled extensions are included because the compiler and linker look at
+ * them.
+ */
+static uint64_t
+context_key(const struct gl_context *ctx)
+{
+   static const char build[] = MESA_VERSION_STRING " " __DATE__ " " __TIME__;
+   uint64_t hash = FNV1A_64_INIT;
+
+   hash = hash_data(hash, build, sizeof(build));
+   hash = hash_uint32(hash, sizeof(void *));
+   hash = hash_uint32(hash, ctx->API);
+   hash = hash_data(hash, &ctx->Const, sizeof(ctx->Const));
+   hash = hash_data(hash, &ctx->Extensions,
+                    offsetof(struct gl_extensions, String));
+   hash = hash_data(hash, ctx->ShaderCompilerOptions,
+                    sizeof(ctx->ShaderCompilerOptions));
+
+   return hash;
+}
+
+static void
+write_uniform_blocks(struct blob *blob, const struct gl_uniform_block *blocks,
+                     unsigned num_blocks)
+{
+   blob_write_uint32(blob, num_blocks);
+
+   for (unsigned i = 0; i < num_blocks; i++) {
+      const struct gl_uniform_block *block = &blocks[i];
+
+      blob_write_string(blob, block->Name);
+      blob_write_uint32(blob, block->NumUniforms);
+
+      for (unsigned j = 0; j < block->NumUniforms; j++) {
+         const struct gl_uniform_buffer_variable *u = &block->Uniforms[j];
+
+         blob_write_string(blob, u->Name);
+         serialize_glsl_type(blob, u->Type);
+         blob_write_uint32(blob, u->Buffer);
+         blob_write_uint32(blob, u->Offset);
+         blob_write_uint32(blob, u->RowMajor);
+      }
+
+      blob_write_uint32(blob, block->Binding);
+      blob_write_uint32(blob, block->UniformBufferSize);
+   }
+}
+
+static bool
+read_uniform_blocks(struct blob_reader *blob, void *mem_ctx,
+                    struct gl_uniform_block **blocks, unsigned *num_blocks)
+{
+   const unsigned num = blob_read_uint32(blob);
+
+   *blocks = NULL;
+   *num_blocks = 0;
+
+   /* Each block takes up at least 16 bytes, which keeps corrupt data from
+    * making us allocate huge arrays.
+    */
+   if (num > (size_t) (blob->end - blob->current) / 16)
+      return false;
+
+   if (num == 0)
+      return !blob->overrun;
+
+   *blocks = rzalloc_array(mem_ctx, struct gl_uniform_block, num);
+   *num_blocks = num;
+
+   for (unsigned i = 0; i < num; i++) {
+      struct gl_uniform_block *block = &(*blocks)[i];
+      const char *name = blob_read_string(blob);
+      const unsigned num_uniforms = blob_read_uint32(blob);
+
+      if (name == NULL
+          || num_uniforms > (size_t) (blob->end - blob->current) / 16)
+         return false;
+
+      block->Name = ralloc_strdup(*blocks, name);
+      block->NumUniforms = num_uniforms;
+      block->Uniforms = rzalloc_array(*blocks,
+                                      struct gl_uniform_buffer_variable,
+                                      num_uniforms);
+
+      for (unsigned j = 0; j < num_uniforms; j++) {
+         struct gl_uniform_buffer_variable *u = &block->Uniforms[j];
+
+         name = blob_read_string(blob);
+         u->Type = deserialize_glsl_type(blob);
+         if (name == NULL || u->Type == NULL)
+            return false;
+
+         u->Name = ralloc_strdup(*blocks, name);
+         u->Buffer = blob_read_uint32(blob);
+         u->Offset = blob_read_uint32(blob);
+         u->RowMajor = blob_read_uint32(blob) != 0;
+      }
+
+      block->Binding = blob_read_uint32(blob);
+      block->UniformBufferSize = blob_read_uint32(blob);
+   }
+
+   return !blob->overrun;
+}
+
+static bool
+write_program(struct blob *blob, struct gl_shader_program *prog)
+{
+   const struct gl_transform_feedback_info *const xfb =
+      &prog->LinkedTransformFeedback;
+
+   blob_write_uint32(blob, prog->Version);
+   blob_write_uint32(blob, prog->IsES);
+   blob_write_string(blob, prog->InfoLog);
+   blob_write_uint32(blob, prog->Vert.UsesClipDistance);
+   blob_write_uint32(blob, prog->Vert.ClipDistanceArraySize);
+   blob_write_uint32(blob, prog->FragDepthLayout);
+
+   blob_write_uint32(blob, xfb->NumOutputs);
+   blob_write_bytes(blob, xfb->Outputs,
+                    xfb->NumOutputs * sizeof(xfb->Outputs[0]));
+   blob_write_uint32(blob, xfb->NumBuffers);
+   blob_write_bytes(blob, xfb->BufferStride, sizeof(xfb->BufferStride));
+   blob_write_uint32(blob, xfb->NumVarying);
+   for (int i = 0; i < xfb->NumVarying; i++) {
+      blob_write_string(blob, xfb->Varyings[i].Name);
+      blob_write_uint32(blob, xfb->Varyings[i].Type);
+      blob_write_uint32(blob, xfb->Varyings[i].Size);
+   }
+
+   write_uniform_blocks(blob, prog->UniformBlocks, prog->NumUniformBlocks);
+   for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
+      for (unsigned j = 0; j < prog->NumUniformBlocks; j++)
+         blob_write_uint32(blob, prog->UniformBlockStageIndex[i][j]);
+   }
+
+   for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
+      struct gl_shader *const sh = prog->_LinkedShaders[i];
+
+      blob_write_uint32(blob, sh != NULL);
+      if (sh == NULL)
+         continue;
+
+      blob_write_uint32(blob, sh->Type);
+      write_uniform_blocks(blob, sh->UniformBlocks, sh->NumUniformBlocks);
+
+      if (!serialize_ir(blob, sh->ir))
+         return false;
+   }
+
+   return !blob->out_of_memory;
+}
+
+static bool
+read_program(struct gl_context *ctx, struct blob_reader *blob,
+             struct gl_shader_program *prog)
+{
+   struct gl_transform_feedback_info *const xfb =
+      &prog->LinkedTransformFeedback;
+
+   prog->Version = blob_read_uint32(blob);
+   prog->IsES = blob_read_uint32(blob) != 0;
+
+   const char *const info_log = blob_read_string(blob);
+   if (info_log == NULL)
+      return false;
+
+   ralloc_free(prog->InfoLog);
+   prog->InfoLog = ralloc_strdup(NULL, info_log);
+
+   prog->Vert.UsesClipDistance = blob_read_uint32(blob) != 0;
+   prog->Vert.ClipDistanceArraySize = blob_read_uint32(blob);
+   prog->FragDepthLayout = (gl_frag_depth_layout) blob_read_uint32(blob);
+
+   xfb->NumOutputs = blob_read_uint32(blob);
+   const void *const outputs =
+      blob_read_bytes(blob, xfb->NumOutputs * sizeof(xfb->Outputs[0]));
+   if (outputs == NULL) {
+      xfb->NumOutputs = 0;
+      return false;
+   }
+
+   xfb->Outputs = ralloc_array(prog, struct gl_transform_feedback_output,
+                               xfb->NumOutputs);
+   memcpy(xfb->Outputs, outputs, xfb->NumOutputs * sizeof(xfb->Outputs[0]));
+
+   xfb->NumBuffers = blob_read_uint32(blob);
+   const void *const strides =
+      blob_read_bytes(blob, sizeof(xfb->BufferStride));
+   if (strides == NULL || xfb->NumBuffers > MAX_FEEDBACK_BUFFERS)
+      return false;
+
+   memcpy(xfb->BufferStride, strides, sizeof(xfb->BufferStride));
+
+   const unsigned num_varying = blob_read_uint32(blob);
+   if (num_varying > (size_t) (blob->end - blob->current) / 12)
+      return false;
+
+   xfb->Varyings = rzalloc_array(prog,
+                                 struct gl_transform_feedback_varying_info,
+                                 num_varying);
+   xfb->NumVarying = num_varying;
+   for (unsigned i = 0; i < num_varying; i++) {
+      const char *const name = blob_read_string(blob);
+      if (name == NULL)
+         return false;
+
+      xfb->Varyings[i].Name = ralloc_strdup(prog, name);
+      xfb->Varyings[i].Type = blob_read_uint32(blob);
+      xfb->Varyings[i].Size = blob_read_uint32(blob);
+   }
+
+   if (!read_uniform_blocks(blob, prog, &prog->UniformBlocks,
+                            &prog->NumUniformBlocks))
+      return false;
+
+   for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
+      prog->UniformBlockStageIndex[i] =
+         ralloc_array(prog, int, prog->NumUniformBlocks);
+
+      for (unsigned j = 0; j < prog->NumUniformBlocks; j++)
+         prog->UniformBlockStageIndex[i][j] = (int) blob_read_uint32(blob);
+   }
+
+   for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
+      if (!blob_read_uint32(blob))
+         continue;
+
+      const GLenum type = blob_read_uint32(blob);
+      if (type != _mesa_shader_index_to_type(i))
+         return false;
+
+      gl_shader *const sh = ctx->Driver.NewShader(NULL, 0, type);
+      _mesa_reference_shader(ctx, &prog->_LinkedShaders[i], sh);
+
+      if (!read_uniform_blocks(blob, sh, &sh->UniformBlocks,
+                               &sh->NumUniformBlocks))
+         return false;
+
+      sh->ir = new(sh) exec_list;
+      if (!deserialize_ir(sh, blob, sh->ir))
+         return false;
+   }
+
+   return !blob->overrun;
+}
+
+/**
+ * Reset the link results of \c prog, as \c link_shaders does
+ */
+static void
+reset_link_results(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   prog->LinkStatus = false;
+   prog->Validated = false;
+   prog->_Used = false;
+
+   ralloc_free(prog->InfoLog);
+   prog->InfoLog = ralloc_strdup(NULL, "");
+
+   ralloc_free(prog->UniformBlocks);
+   prog->UniformBlocks = NULL;
+   prog->NumUniformBlocks = 0;
+   for (int i = 0; i < MESA_SHADER_TYPES; i++) {
+      ralloc_free(prog->UniformBlockStageIndex[i]);
+      prog->UniformBlockStageIndex[i] = NULL;
+   }
+
+   ralloc_free(prog->LinkedTransformFeedback.Varyings);
+   ralloc_free(prog->LinkedTransformFeedback.Outputs);
+   memset(&prog->LinkedTransformFeedback, 0,
+          sizeof(prog->LinkedTransformFeedback));
+
+   for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
+      if (prog->_LinkedShaders[i] != NULL)
+         ctx->Driver.DeleteShader(ctx, prog->_LinkedShaders[i]);
+
+      prog->_LinkedShaders[i] = NULL;
+   }
+
+   ralloc_free(prog->Binary);
+   prog->Binary = NULL;
+   prog->BinarySize = 0;
+}
+
+extern "C" void
+_mesa_glsl_save_program_binary(struct gl_context *ctx,
+                               struct gl_shader_program *prog)
+{
+   struct blob *blob = blob_create(NULL);
+
+   ralloc_free(prog->Binary);
+   prog->Binary = NULL;
+   prog->BinarySize = 0;
+
+   /* The checksum is filled in once the payload has been written. */
+   blob_write_uint32(blob, PROGRAM_BINARY_MAGIC);
+   blob_write_uint32(blob, PROGRAM_BINARY_VERSION);
+   blob_write_uint64(blob, context_key(ctx));
+   blob_write_uint64(blob, 0);
+
+   if (write_program(blob, prog) && blob->size <= INT_MAX) {
+      const uint64_t checksum =
+         hash_data(FNV1A_64_INIT, blob->data + PROGRAM_BINARY_HEADER_SIZE,
+                   blob->size - PROGRAM_BINARY_HEADER_SIZE);
+
+      blob_overwrite_bytes(blob, PROGRAM_BINARY_CHECKSUM_OFFSET,
+                           &checksum, sizeof(checksum));
+
+      ralloc_steal(prog, blob->data);
+      prog->Binary = blob->data;
+      prog->BinarySize = blob->size;
+   }
+
+   ralloc_free(blob);
+}
+
+extern "C" GLboolean
+_mesa_glsl_load_program_binary(struct gl_context *ctx,
+                               struct gl_shader_program *prog,
+                               const GLvoid *binary, GLsizei length)
+{
+   struct blob_reader blob;
+
+   reset_link_results(ctx, prog);
+
+   if (length < (GLsizei) PROGRAM_BINARY_HEADER_SIZE) {
+      linker_error(prog, "program binary is too short\n");
+      return GL_FALSE;
+   }
+
+   blob_reader_init(&blob, binary, length);
+
+   if (blob_read_uint32(&blob) != PROGRAM_BINARY_MAGIC
+       || blob_read_uint32(&blob) != PROGRAM_BINARY_VERSION
+       || blob_read_uint64(&blob) != context_key(ctx)) {
+      linker_error(prog, "program binary was created by a different "
+                   "driver or context\n");
+      return GL_FALSE;
+   }
+
+   const uint64_t checksum = blob_read_uint64(&blob);
+   if (checksum != hash_data(FNV1A_64_INIT, blob.current,
+                             blob.end - blob.current)) {
+      linker_error(prog, "program binary is corrupt\n");
+      return GL_FALSE;
+   }
+
+   /* Even with a valid checksum, the data is only trusted as far as
+    * read_program and deserialize_ir validate it.
+    */
+   if (!read_program(ctx, &blob, prog) || blob.current != blob.end) {
+      reset_link_results(ctx, prog);
+      linker_error(prog, "program binary is corrupt\n");
+      return GL_FALSE;
+   }
+
+   link_assign_uniform_locations(prog);
+
+   prog->Binary = ralloc_size(prog, length);
+   memcpy(prog->Binary, binary, length);
+   prog->BinarySize = length;
+
+   prog->LinkStatus = true;
+   return GL_TRUE;
+}
+
+struct binding {
+   const char *name;
+   unsigned value;
+};
+
+static void
+count_binding(const char *name, unsigned value, void *closure)
+{
+   (void) name;
+   (void) value;
+   ++*(unsigned *) closure;
+}
+
+static void
+add_binding(const char *name, unsigned value, void *closure)
+{
+   struct binding **const next = (struct binding **) closure;
+
+   (*next)->name = name;
+   (*next)->value = value;
+   ++*next;
+}
+
+static int
+compare_bindings(const void *a, const void *b)
+{
+   return strcmp(((const struct binding *) a)->name,
+                 ((const struct binding *) b)->name);
+}
+
+static void
+write_bindings(struct blob *blob, struct string_to_uint_map *map)
+{
+   unsigned count = 0;
+
+   map->iterate(count_binding, &count);
+
+   struct binding *const bindings = ralloc_array(blob, struct binding, count);
+   struct binding *next = bindings;
+
+   /* The bindings are visited in no particular order, sort them so that
+    * equal maps give equal keys.
+    */
+   map->iterate(add_binding, &next);
+   qsort(bindings, count, sizeof(*bindings), compare_bindings);
+
+   blob_write_uint32(blob, count);
+   for (unsigned i = 0; i < count; i++) {
+      blob_write_string(blob, bindings[i].name);
+      blob_write_uint32(blob, bindings[i].value);
+   }
+
+   ralloc_free(bindings);
+}
+
+/**
+ * Everything that affects the result of linking \c prog
+ *
+ * The key is stored at the start of the cache file and compared on load, so
+ * programs whose keys hash to the same file name can't be mixed up.  The
+ * context is only represented by its hash, which the binary header repeats
+ * anyway.
+ */
+static struct blob *
+program_key(void *mem_ctx, const struct gl_context *ctx,
+            const struct gl_shader_program *prog)
+{
+   struct blob *const key = blob_create(mem_ctx);
+
+   blob_write_uint64(key, context_key(ctx));
+
+   /* MESA_GLSL=nopt and friends change the compiled IR. */
+   blob_write_uint32(key, ctx->Shader.Flags);
+
+   blob_write_uint32(key, prog->NumShaders);
+   for (unsigned i = 0; i < prog->NumShaders; i++) {
+      blob_write_uint32(key, prog->Shaders[i]->Type);
+      blob_write_string(key, prog->Shaders[i]->Source);
+   }
+
+   write_bindings(key, prog->AttributeBindings);
+   write_bindings(key, prog->FragDataBindings);
+   write_bindings(key, prog->FragDataIndexBindings);
+
+   blob_write_uint32(key, prog->TransformFeedback.BufferMode);
+   blob_write_uint32(key, prog->TransformFeedback.NumVarying);
+   for (unsigned i = 0; i < prog->TransformFeedback.NumVarying; i++)
+      blob_write_string(key, prog->TransformFeedback.VaryingNames[i]);
+
+   blob_write_uint32(key, prog->InternalSeparateShader);
+   blob_write_bytes(key, &prog->Geom, sizeof(prog->Geom));
+
+   return key;
+}
+
+static char *
+cache_file_name(void *mem_ctx, const struct blob *key)
+{
+   return ralloc_asprintf(mem_ctx, "%s/%016llx.bin",
+                          getenv("MESA_GLSL_CACHE_DIR"),
+                          (unsigned long long)
+                          hash_data(FNV1A_64_INIT, key->data, key->size));
+}
+
+extern "C" GLboolean
+_mesa_glsl_program_cache_enabled(void)
+{
+   const char *const dir = getenv("MESA_GLSL_CACHE_DIR");
+
+   return dir != NULL && dir[0] != '\0';
+}
+
+extern "C" GLboolean
+_mesa_glsl_program_cache_load(struct gl_context *ctx,
+                              struct gl_shader_program *prog)
+{
+   struct blob *const key = program_key(NULL, ctx, prog);
+   char *const name = cache_file_name(key, key);
+   FILE *const f = fopen(name, "rb");
+   struct blob_reader reader;
+   void *data = NULL;
+   long size = 0;
+   GLboolean ok = GL_FALSE;
+
+   if (f == NULL || key->out_of_memory)
+      goto done;
+
+   if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) <= 0
+       || size > INT_MAX || fseek(f, 0, SEEK_SET) != 0)
+      goto done;
+
+   data = ralloc_size(key, size);
+   if (fread(data, 1, size, f) != (size_t) size)
+      goto done;
+
+   /* The file name is only a hash of the key, check the key itself. */
+   blob_reader_init(&reader, data, size);
+   if (blob_read_uint64(&reader) != key->size)
+      goto done;
+
+   {
+      const void *const stored_key = blob_read_bytes(&reader, key->size);
+      if (stored_key == NULL || memcmp(stored_key, key->data, key->size) != 0)
+         goto done;
+   }
+
+   ok = _mesa_glsl_load_program_binary(ctx, prog, reader.current,
+                                       reader.end - reader.current);
+
+done:
+   if (f != NULL)
+      fclose(f);
+
+   ralloc_free(key);
+   return ok;
+}
+
+extern "C" void
+_mesa_glsl_program_cache_store(struct gl_context *ctx,
+                               struct gl_shader_program *prog)
+{
+   if (prog->Binary == NULL)
+      return;
+
+   struct blob *const key = program_key(NULL, ctx, prog);
+   if (key->out_of_memory) {
+      ralloc_free(key);
+      return;
+   }
+
+   char *const name = cache_file_name(key, key);
+   char *const tmp_name = ralloc_asprintf(key, "%s.%p.tmp", name,
+                                          (void *) prog);
+
+   /* Another process storing the same program may pick the same temporary
+    * file.  That can only leave a bad binary in the cache, which fails the
+    * checksum when it is loaded.
+    */
+   FILE *const f = fopen(tmp_name, "wb");
+
+   if (f != NULL) {
+      const uint64_t key_size = key->size;
+      const bool written =
+         fwrite(&key_size, sizeof(key_size), 1, f) == 1 &&
+         fwrite(key->data, 1, key->size, f) == key->size &&
+         fwrite(prog->Binary, 1, prog->BinarySize, f) ==
+         (size_t) prog->BinarySize;
+
+      /* Write to a temporary file and rename it, so that other processes
+       * sharing the cache never see a partially written binary.
+       */
+      if (fclose(f) == 0 && written && rename(tmp_name, name) == 0) {
+         ralloc_free(key);
+         return;
+      }
+
+      remove(tmp_name);
+   }
+
+   ralloc_free(key);
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef PROGRAM_BINARY_H
+#define PROGRAM_BINARY_H
+
+/**
+ * \file program_binary.h
+ *
+ * Saving and restoring the results of \c link_shaders, for
+ * GL_ARB_get_program_binary and the on-disk program cache.
+ *
+ * A binary holds the linked IR of each stage (before the driver's own
+ * lowering), the uniform blocks, the transform feedback outputs and the
+ * other link results stored in \c gl_shader_program.  Uniform storage is
+ * rebuilt from the IR when the binary is loaded.  Binaries are only valid
+ * for the Mesa build and context limits they were created with.
+ */
+
+#include "main/glheader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct gl_context;
+struct gl_shader_program;
+
+/**
+ * Store the results of a successful \c link_shaders in \c prog->Binary
+ *
+ * This must be called before \c dd_function_table::LinkShader, which
+ * lowers the linked IR for the driver.
+ */
+void
+_mesa_glsl_save_program_binary(struct gl_context *ctx,
+                               struct gl_shader_program *prog);
+
+/**
+ * Replace the link results of \c prog with those stored in \c binary
+ *
+ * On success \c prog is left as \c link_shaders would have left it, and
+ * \c prog->LinkStatus is set.
+ *
+ * \return
+ * \c GL_FALSE if \c binary was not created by this build of Mesa with the
+ * same context limits, or is corrupt.
+ */
+GLboolean
+_mesa_glsl_load_program_binary(struct gl_context *ctx,
+                               struct gl_shader_program *prog,
+                               const GLvoid *binary, GLsizei length);
+
+/**
+ * Is the on-disk program cache enabled (by setting MESA_GLSL_CACHE_DIR)?
+ */
+GLboolean
+_mesa_glsl_program_cache_enabled(void);
+
+/**
+ * Load the link results of \c prog from the on-disk cache
+ *
+ * The cache is keyed by the sources of the attached shaders, the state set
+ * by the application that affects linking, and the context limits.
+ *
+ * \return
+ * \c GL_TRUE if the program was found in the cache and loaded.
+ */
+GLboolean
+_mesa_glsl_program_cache_load(struct gl_context *ctx,
+                              struct gl_shader_program *prog);
+
+/**
+ * Write \c prog->Binary to the on-disk cache
+ */
+void
+_mesa_glsl_program_cache_store(struct gl_context *ctx,
+                               struct gl_shader_program *prog);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROGRAM_BINARY_H */
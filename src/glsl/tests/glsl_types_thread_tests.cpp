@@ -0,0 +1,100 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include "main/compiler.h"
+#include "main/mtypes.h"
+#include "main/macros.h"
+#include "glsl_types.h"
+
+/**
+ * \file glsl_types_thread_tests.cpp
+ *
+ * Shaders may be compiled by several threads at once, so the array and
+ * record types they create must still be unique: every thread asking for
+ * the same type has to get the same glsl_type pointer.
+ */
+
+#define NUM_THREADS 8
+#define NUM_SIZES 64
+
+struct thread_data {
+   const glsl_type *arrays[NUM_SIZES];
+   const glsl_type *records[NUM_SIZES];
+};
+
+static void *
+create_types(void *data)
+{
+   thread_data *const d = (thread_data *) data;
+
+   for (unsigned i = 0; i < NUM_SIZES; i++) {
+      const glsl_type *const base = (i & 1) ? glsl_type::vec4_type
+                                            : glsl_type::float_type;
+      d->arrays[i] = glsl_type::get_array_instance(base, i + 1);
+
+      glsl_struct_field field;
+      field.type = d->arrays[i];
+      field.name = "a";
+
+      char name[32];
+      snprintf(name, sizeof(name), "s%u", i);
+      d->records[i] = glsl_type::get_record_instance(&field, 1, name);
+   }
+
+   return NULL;
+}
+
+class glsl_types_thread : public ::testing::Test {
+public:
+   virtual void TearDown();
+};
+
+void
+glsl_types_thread::TearDown()
+{
+   _mesa_glsl_release_types();
+}
+
+TEST_F(glsl_types_thread, types_are_unique)
+{
+   pthread_t threads[NUM_THREADS];
+   thread_data data[NUM_THREADS];
+
+   for (unsigned i = 0; i < NUM_THREADS; i++)
+      ASSERT_EQ(0, pthread_create(&threads[i], NULL, create_types, &data[i]));
+
+   for (unsigned i = 0; i < NUM_THREADS; i++)
+      ASSERT_EQ(0, pthread_join(threads[i], NULL));
+
+   for (unsigned j = 0; j < NUM_SIZES; j++) {
+      EXPECT_TRUE(data[0].arrays[j]->is_array());
+      EXPECT_EQ(j + 1, data[0].arrays[j]->length);
+      EXPECT_TRUE(data[0].records[j]->is_record());
+
+      for (unsigned i = 1; i < NUM_THREADS; i++) {
+	 EXPECT_EQ(data[0].arrays[j], data[i].arrays[j]);
+	 EXPECT_EQ(data[0].records[j], data[i].records[j]);
+      }
+   }
+}
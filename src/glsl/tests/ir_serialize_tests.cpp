@@ -0,0 +1,239 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "main/compiler.h"
+#include "main/mtypes.h"
+#include "main/macros.h"
+#include "ralloc.h"
+#include "blob.h"
+#include "ir.h"
+#include "ir_reader.h"
+#include "ir_print_visitor.h"
+#include "ir_serialize.h"
+#include "glsl_parser_extras.h"
+#include "glsl_symbol_table.h"
+
+/**
+ * \file ir_serialize_tests.cpp
+ *
+ * The IR is read from s-expressions, serialized and deserialized.  Since
+ * the serialized form covers every field of the IR, serializing the
+ * deserialized IR again has to produce exactly the same bytes.  The
+ * deserialized IR also has to print the same as the original, which
+ * catches fields that are serialized but not restored.
+ */
+
+static const char vertex_shader_ir[] =
+   "((declare (uniform) vec4 color)\n"
+   " (declare (uniform) (array mat4 2) mvp)\n"
+   " (declare (in) vec4 position)\n"
+   " (declare (out) vec4 gl_Position)\n"
+   " (declare (out) vec4 v_color)\n"
+   " (function scale\n"
+   "   (signature vec4\n"
+   "     (parameters (declare (in) vec4 p) (declare (out) float f))\n"
+   "     ((assign (x) (var_ref f) (constant float (3.5)))\n"
+   "      (return (expression vec4 * (var_ref p) (constant float (2.0)))))))\n"
+   " (function main\n"
+   "   (signature void (parameters)\n"
+   "     ((declare () int i)\n"
+   "      (declare () float f)\n"
+   "      (declare () (array float 3) a)\n"
+   "      (declare () vec4 tmp)\n"
+   "      (assign (x) (var_ref i) (constant int (0)))\n"
+   "      (assign () (var_ref a)\n"
+   "              (constant (array float 3) ((constant float (1.0))\n"
+   "                                         (constant float (2.0))\n"
+   "                                         (constant float (3.0)))))\n"
+   "      (loop () () () ()\n"
+   "        ((if (expression bool >= (var_ref i) (constant int (2)))\n"
+   "             (break) ())\n"
+   "         (assign (x) (var_ref i)\n"
+   "                 (expression int + (var_ref i) (constant int (1))))))\n"
+   "      (call scale (var_ref tmp) ((var_ref position) (var_ref f)))\n"
+   "      (assign (xyzw) (var_ref gl_Position)\n"
+   "              (expression vec4 *\n"
+   "                 (array_ref (var_ref mvp) (constant int (1)))\n"
+   "                 (var_ref tmp)))\n"
+   "      (assign (xyzw) (var_ref v_color) (swiz wzyx (var_ref color)))))))\n";
+
+static const char fragment_shader_ir[] =
+   "((declare (uniform) sampler2D tex)\n"
+   " (declare (uniform) float bias)\n"
+   " (declare (in) vec4 v_color)\n"
+   " (declare (out) vec4 gl_FragColor)\n"
+   " (function main\n"
+   "   (signature void (parameters)\n"
+   "     ((assign (xyzw) (var_ref gl_FragColor)\n"
+   "              (expression vec4 * (var_ref v_color)\n"
+   "                 (txb vec4 (var_ref tex) (swiz xy (var_ref v_color)) 0 1 ()\n"
+   "                      (var_ref bias))))))))\n";
+
+class ir_serialize_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void read_ir(const char *src);
+   struct blob *serialize(exec_list *ir);
+   std::string print(exec_list *ir);
+
+   struct gl_context ctx;
+   void *mem_ctx;
+   _mesa_glsl_parse_state *state;
+   exec_list *ir;
+};
+
+void
+ir_serialize_test::SetUp()
+{
+   memset(&ctx, 0, sizeof(ctx));
+   ctx.API = API_OPENGL_COMPAT;
+   ctx.Const.GLSLVersion = 130;
+
+   this->mem_ctx = ralloc_context(NULL);
+   this->state = new(mem_ctx) _mesa_glsl_parse_state(&ctx, GL_VERTEX_SHADER,
+                                                     mem_ctx);
+   this->state->language_version = 130;
+   _mesa_glsl_initialize_types(this->state);
+
+   this->ir = new(mem_ctx) exec_list;
+}
+
+void
+ir_serialize_test::TearDown()
+{
+   ralloc_free(this->mem_ctx);
+   this->mem_ctx = NULL;
+
+   _mesa_glsl_release_types();
+}
+
+void
+ir_serialize_test::read_ir(const char *src)
+{
+   _mesa_glsl_read_ir(this->state, this->ir, src, true);
+   ASSERT_FALSE(this->state->error) << this->state->info_log;
+}
+
+struct blob *
+ir_serialize_test::serialize(exec_list *ir)
+{
+   struct blob *blob = blob_create(this->mem_ctx);
+
+   EXPECT_TRUE(serialize_ir(blob, ir));
+   return blob;
+}
+
+std::string
+ir_serialize_test::print(exec_list *ir)
+{
+   testing::internal::CaptureStdout();
+   _mesa_print_ir(ir, NULL);
+   fflush(stdout);
+   return testing::internal::GetCapturedStdout();
+}
+
+TEST_F(ir_serialize_test, types)
+{
+   glsl_struct_field fields[2];
+   fields[0].type = glsl_type::vec4_type;
+   fields[0].name = "v";
+   fields[1].type = glsl_type::get_array_instance(glsl_type::mat3_type, 4);
+   fields[1].name = "m";
+
+   const glsl_type *const types[] = {
+      glsl_type::void_type,
+      glsl_type::error_type,
+      glsl_type::bool_type,
+      glsl_type::uvec3_type,
+      glsl_type::mat2x4_type,
+      this->state->symbols->get_type("sampler2DShadow"),
+      glsl_type::get_array_instance(glsl_type::ivec2_type, 7),
+      glsl_type::get_record_instance(fields, 2, "S"),
+   };
+
+   struct blob *blob = blob_create(this->mem_ctx);
+   for (unsigned i = 0; i < Elements(types); i++)
+      serialize_glsl_type(blob, types[i]);
+
+   struct blob_reader reader;
+   blob_reader_init(&reader, blob->data, blob->size);
+   for (unsigned i = 0; i < Elements(types); i++)
+      EXPECT_EQ(types[i], deserialize_glsl_type(&reader));
+
+   EXPECT_EQ(reader.end, reader.current);
+   EXPECT_FALSE(reader.overrun);
+}
+
+TEST_F(ir_serialize_test, vertex_shader_round_trip)
+{
+   read_ir(vertex_shader_ir);
+
+   struct blob *blob = serialize(this->ir);
+   struct blob_reader reader;
+   exec_list copy;
+
+   blob_reader_init(&reader, blob->data, blob->size);
+   ASSERT_TRUE(deserialize_ir(this->mem_ctx, &reader, &copy));
+
+   struct blob *again = serialize(&copy);
+   ASSERT_EQ(blob->size, again->size);
+   EXPECT_EQ(0, memcmp(blob->data, again->data, blob->size));
+
+   EXPECT_EQ(print(this->ir), print(&copy));
+}
+
+TEST_F(ir_serialize_test, fragment_shader_round_trip)
+{
+   read_ir(fragment_shader_ir);
+
+   struct blob *blob = serialize(this->ir);
+   struct blob_reader reader;
+   exec_list copy;
+
+   blob_reader_init(&reader, blob->data, blob->size);
+   ASSERT_TRUE(deserialize_ir(this->mem_ctx, &reader, &copy));
+
+   struct blob *again = serialize(&copy);
+   ASSERT_EQ(blob->size, again->size);
+   EXPECT_EQ(0, memcmp(blob->data, again->data, blob->size));
+
+   EXPECT_EQ(print(this->ir), print(&copy));
+}
+
+TEST_F(ir_serialize_test, truncated_data_is_rejected)
+{
+   read_ir(vertex_shader_ir);
+
+   struct blob *blob = serialize(this->ir);
+
+   for (size_t size = 0; size < blob->size; size++) {
+      struct blob_reader reader;
+      exec_list copy;
+
+      blob_reader_init(&reader, blob->data, size);
+      EXPECT_FALSE(deserialize_ir(this->mem_ctx, &reader, &copy))
+         << "accepted the first " << size << " bytes";
+   }
+}
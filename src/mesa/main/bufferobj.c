@@ -309,6 +309,9 @@ _mesa_reference_buffer_object_(struct gl_context *ctx,
 	 ASSERT(ctx->Array.ArrayObj->Vertex.BufferObj != bufObj);
 #endif
 
+         free(oldObj->MinMaxCache);
+         oldObj->MinMaxCache = NULL;
+
 	 ASSERT(ctx->Driver.DeleteBuffer);
          ctx->Driver.DeleteBuffer(ctx, oldObj);
       }
@@ -572,9 +575,9 @@ _mesa_copy_buffer_subdata(struct gl_context *ctx,
    assert(!_mesa_bufferobj_mapped(dst));
 
    if (src == dst) {
-      srcPtr = dstPtr = ctx->Driver.MapBufferRange(ctx, 0, src->Size,
-						   GL_MAP_READ_BIT |
-						   GL_MAP_WRITE_BIT, src);
+      srcPtr = dstPtr = _mesa_bufferobj_map_range(ctx, 0, src->Size,
+						  GL_MAP_READ_BIT |
+						  GL_MAP_WRITE_BIT, src);
 
       if (!srcPtr)
 	 return;
@@ -584,9 +587,9 @@ _mesa_copy_buffer_subdata(struct gl_context *ctx,
    } else {
       srcPtr = ctx->Driver.MapBufferRange(ctx, readOffset, size,
 					  GL_MAP_READ_BIT, src);
-      dstPtr = ctx->Driver.MapBufferRange(ctx, writeOffset, size,
-					  (GL_MAP_WRITE_BIT |
-					   GL_MAP_INVALIDATE_RANGE_BIT), dst);
+      dstPtr = _mesa_bufferobj_map_range(ctx, writeOffset, size,
+					 (GL_MAP_WRITE_BIT |
+					  GL_MAP_INVALIDATE_RANGE_BIT), dst);
    }
 
    /* Note: the src and dst regions will never overlap.  Trying to do so
@@ -1071,6 +1074,7 @@ _mesa_BufferData(GLenum target, GLsizeiptrARB size,
    FLUSH_VERTICES(ctx, _NEW_BUFFER_OBJECT);
 
    bufObj->Written = GL_TRUE;
+   _mesa_bufferobj_changed(bufObj);
 
 #ifdef VBO_DEBUG
    printf("glBufferDataARB(%u, sz %ld, from %p, usage 0x%x)\n",
@@ -1107,6 +1111,7 @@ _mesa_BufferSubData(GLenum target, GLintptrARB offset,
       return;
 
    bufObj->Written = GL_TRUE;
+   _mesa_bufferobj_changed(bufObj);
 
    ASSERT(ctx->Driver.BufferSubData);
    ctx->Driver.BufferSubData( ctx, offset, size, data, bufObj );
@@ -1183,7 +1188,7 @@ _mesa_MapBuffer(GLenum target, GLenum access)
    }
 
    ASSERT(ctx->Driver.MapBufferRange);
-   map = ctx->Driver.MapBufferRange(ctx, 0, bufObj->Size, accessFlags, bufObj);
+   map = _mesa_bufferobj_map_range(ctx, 0, bufObj->Size, accessFlags, bufObj);
    if (!map) {
       _mesa_error(ctx, GL_OUT_OF_MEMORY, "glMapBufferARB(map failed)");
       return NULL;
@@ -1490,6 +1495,8 @@ _mesa_CopyBufferSubData(GLenum readTarget, GLenum writeTarget,
       }
    }
 
+   _mesa_bufferobj_changed(dst);
+
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset, size);
 }
 
@@ -1604,7 +1611,7 @@ _mesa_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length,
    }
 
    ASSERT(ctx->Driver.MapBufferRange);
-   map = ctx->Driver.MapBufferRange(ctx, offset, length, access, bufObj);
+   map = _mesa_bufferobj_map_range(ctx, offset, length, access, bufObj);
    if (!map) {
       _mesa_error(ctx, GL_OUT_OF_MEMORY, "glMapBufferARB(map failed)");
    }
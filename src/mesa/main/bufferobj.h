@@ -56,6 +56,35 @@ _mesa_is_bufferobj(const struct gl_buffer_object *obj)
    return obj != NULL && obj->Name != 0;
 }
 
+/**
+ * Note that the contents of the buffer object changed, which invalidates
+ * everything cached about them (like vbo's min/max indices).
+ */
+static inline void
+_mesa_bufferobj_changed(struct gl_buffer_object *obj)
+{
+   obj->Stamp++;
+}
+
+/**
+ * Map a buffer object through the driver.  Write mappings are noted with
+ * _mesa_bufferobj_changed, so Mesa's own writes into buffer objects (like
+ * packing pixels into a PBO) should use this rather than calling
+ * ctx->Driver.MapBufferRange directly.
+ */
+static inline void *
+_mesa_bufferobj_map_range(struct gl_context *ctx,
+                          GLintptr offset, GLsizeiptr length,
+                          GLbitfield access, struct gl_buffer_object *obj)
+{
+   void *map = ctx->Driver.MapBufferRange(ctx, offset, length, access, obj);
+
+   if (map && (access & GL_MAP_WRITE_BIT))
+      _mesa_bufferobj_changed(obj);
+
+   return map;
+}
+
 
 extern void
 _mesa_init_buffer_objects( struct gl_context *ctx );
@@ -298,6 +298,10 @@ descriptor=[
 # close enough for now.
   [ "CURRENT_PROGRAM", "LOC_CUSTOM, TYPE_INT, 0, extra_ARB_shader_objects" ],
 
+# GL_ARB_get_program_binary / GL_OES_get_program_binary
+  [ "NUM_PROGRAM_BINARY_FORMATS", "CONST(1), NO_EXTRA" ],
+  [ "PROGRAM_BINARY_FORMATS", "CONST(GL_PROGRAM_BINARY_FORMAT_MESA), NO_EXTRA" ],
+
 # OpenGL 2.0
   [ "STENCIL_BACK_FUNC", "CONTEXT_ENUM(Stencil.Function[1]), NO_EXTRA" ],
   [ "STENCIL_BACK_VALUE_MASK", "CONTEXT_INT(Stencil.ValueMask[1]), NO_EXTRA" ],
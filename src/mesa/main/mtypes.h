@@ -77,6 +77,7 @@ struct gl_texture_object;
 struct gl_context;
 struct st_context;
 struct gl_uniform_storage;
+struct util_minmax_cache;
 struct prog_instruction;
 struct gl_program_parameter_list;
 struct set;
@@ -1521,6 +1522,8 @@ struct gl_buffer_object
    GLboolean DeletePending;   /**< true if buffer object is removed from the hash */
    GLboolean Written;   /**< Ever written to? (for debugging) */
    GLboolean Purgeable; /**< Is the buffer purgeable under memory pressure? */
+   GLuint Stamp;        /**< Incremented whenever the contents change */
+   struct util_minmax_cache *MinMaxCache; /**< vbo's cached index ranges */
 };
 
 
@@ -2391,6 +2394,20 @@ struct gl_shader_program
    unsigned Version;       /**< GLSL version used for linking */
    GLboolean IsES;         /**< True if this program uses GLSL ES */
 
+   /**
+    * \name GL_ARB_get_program_binary state
+    */
+   /*@{*/
+   GLboolean BinaryRetrievableHint; /**< GL_PROGRAM_BINARY_RETRIEVABLE_HINT */
+
+   /**
+    * The result of the last successful link in GL_PROGRAM_BINARY_FORMAT_MESA
+    * form, or NULL if it was not saved.
+    */
+   GLvoid *Binary;
+   GLsizei BinarySize;
+   /*@}*/
+
    /**
     * Per-stage shaders resulting from the first stage of linking.
     *
@@ -242,10 +242,10 @@ _mesa_map_pbo_dest(struct gl_context *ctx,
 
    if (_mesa_is_bufferobj(pack->BufferObj)) {
       /* pack into PBO */
-      buf = (GLubyte *) ctx->Driver.MapBufferRange(ctx, 0,
-						   pack->BufferObj->Size,
-						   GL_MAP_WRITE_BIT,
-						   pack->BufferObj);
+      buf = (GLubyte *) _mesa_bufferobj_map_range(ctx, 0,
+						  pack->BufferObj->Size,
+						  GL_MAP_WRITE_BIT,
+						  pack->BufferObj);
       if (!buf)
          return NULL;
 
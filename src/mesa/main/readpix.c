@@ -793,6 +793,10 @@ _mesa_ReadnPixelsARB( GLint x, GLint y, GLsizei width, GLsizei height,
 
    ctx->Driver.ReadPixels(ctx, x, y, width, height,
 			  format, type, &ctx->Pack, pixels);
+
+   /* The driver may have written the PBO without mapping it. */
+   if (_mesa_is_bufferobj(ctx->Pack.BufferObj))
+      _mesa_bufferobj_changed(ctx->Pack.BufferObj);
 }
 
 void GLAPIENTRY
@@ -468,6 +468,12 @@ get_programiv(struct gl_context *ctx, GLuint program, GLenum pname, GLint *param
       || ctx->API == API_OPENGL_CORE
       || _mesa_is_gles3(ctx);
 
+   /* Is glProgramParameteri(GL_PROGRAM_BINARY_RETRIEVABLE_HINT) available in
+    * this context?  GL_OES_get_program_binary lacks it.
+    */
+   const bool has_program_binary_hint =
+      _mesa_is_desktop_gl(ctx) || _mesa_is_gles3(ctx);
+
    if (!shProg) {
       _mesa_error(ctx, GL_INVALID_VALUE, "glGetProgramiv(program)");
       return;
@@ -582,6 +588,18 @@ get_programiv(struct gl_context *ctx, GLuint program, GLenum pname, GLint *param
 
       *params = shProg->NumUniformBlocks;
       return;
+   case GL_PROGRAM_BINARY_RETRIEVABLE_HINT:
+      if (!has_program_binary_hint)
+         break;
+
+      *params = shProg->BinaryRetrievableHint;
+      return;
+   case GL_PROGRAM_BINARY_LENGTH:
+      if (ctx->API == API_OPENGLES)
+         break;
+
+      *params = shProg->LinkStatus ? shProg->BinarySize : 0;
+      return;
    default:
       break;
    }
@@ -1517,6 +1535,8 @@ _mesa_ProgramParameteriARB(GLuint program, GLenum pname, GLint value)
 
    switch (pname) {
    case GL_GEOMETRY_VERTICES_OUT_ARB:
+      if (!_mesa_is_desktop_gl(ctx))
+         break;
       if (value < 1 ||
           (unsigned) value > ctx->Const.MaxGeometryOutputVertices) {
          _mesa_error(ctx, GL_INVALID_VALUE,
@@ -1525,8 +1545,10 @@ _mesa_ProgramParameteriARB(GLuint program, GLenum pname, GLint value)
          return;
       }
       shProg->Geom.VerticesOut = value;
-      break;
+      return;
    case GL_GEOMETRY_INPUT_TYPE_ARB:
+      if (!_mesa_is_desktop_gl(ctx))
+         break;
       switch (value) {
       case GL_POINTS:
       case GL_LINES:
@@ -1534,33 +1556,128 @@ _mesa_ProgramParameteriARB(GLuint program, GLenum pname, GLint value)
       case GL_TRIANGLES:
       case GL_TRIANGLES_ADJACENCY_ARB:
          shProg->Geom.InputType = value;
-         break;
+         return;
       default:
          _mesa_error(ctx, GL_INVALID_VALUE,
                      "glProgramParameteri(geometry input type = %s",
                      _mesa_lookup_enum_by_nr(value));
          return;
       }
-      break;
    case GL_GEOMETRY_OUTPUT_TYPE_ARB:
+      if (!_mesa_is_desktop_gl(ctx))
+         break;
       switch (value) {
       case GL_POINTS:
       case GL_LINE_STRIP:
       case GL_TRIANGLE_STRIP:
          shProg->Geom.OutputType = value;
-         break;
+         return;
       default:
          _mesa_error(ctx, GL_INVALID_VALUE,
                      "glProgramParameteri(geometry output type = %s",
                      _mesa_lookup_enum_by_nr(value));
          return;
       }
-      break;
+   case GL_PROGRAM_BINARY_RETRIEVABLE_HINT:
+      /* The hint only takes effect the next time the program is linked.
+       */
+      if (value != GL_FALSE && value != GL_TRUE) {
+         _mesa_error(ctx, GL_INVALID_VALUE,
+                     "glProgramParameteri(GL_PROGRAM_BINARY_RETRIEVABLE_HINT"
+                     "=%d)", value);
+         return;
+      }
+      shProg->BinaryRetrievableHint = value;
+      return;
    default:
-      _mesa_error(ctx, GL_INVALID_ENUM, "glProgramParameteriARB(pname=%s)",
-                  _mesa_lookup_enum_by_nr(pname));
       break;
    }
+
+   _mesa_error(ctx, GL_INVALID_ENUM, "glProgramParameteriARB(pname=%s)",
+               _mesa_lookup_enum_by_nr(pname));
+}
+
+
+/**
+ * Called via glGetProgramBinary()
+ */
+void GLAPIENTRY
+_mesa_GetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
+                       GLenum *binaryFormat, GLvoid *binary)
+{
+   struct gl_shader_program *shProg;
+   GET_CURRENT_CONTEXT(ctx);
+
+   ASSERT_OUTSIDE_BEGIN_END(ctx);
+
+   shProg = _mesa_lookup_shader_program_err(ctx, program,
+                                            "glGetProgramBinary");
+   if (!shProg)
+      return;
+
+   if (!shProg->LinkStatus) {
+      _mesa_error(ctx, GL_INVALID_OPERATION,
+                  "glGetProgramBinary(program not linked)");
+      return;
+   }
+
+   if (bufSize < shProg->BinarySize) {
+      _mesa_error(ctx, GL_INVALID_OPERATION, "glGetProgramBinary(bufSize)");
+      return;
+   }
+
+   /* The linker only saves the binary when the program was linked with the
+    * retrievable hint set, on GLES, or with the program cache enabled.
+    * Otherwise this returns an empty binary, which glProgramBinary rejects.
+    */
+   if (shProg->BinarySize > 0)
+      memcpy(binary, shProg->Binary, shProg->BinarySize);
+   *binaryFormat = GL_PROGRAM_BINARY_FORMAT_MESA;
+   if (length)
+      *length = shProg->BinarySize;
+}
+
+
+/**
+ * Called via glProgramBinary()
+ */
+void GLAPIENTRY
+_mesa_ProgramBinary(GLuint program, GLenum binaryFormat,
+                    const GLvoid *binary, GLint length)
+{
+   struct gl_shader_program *shProg;
+   struct gl_transform_feedback_object *obj;
+   GET_CURRENT_CONTEXT(ctx);
+
+   ASSERT_OUTSIDE_BEGIN_END(ctx);
+
+   obj = ctx->TransformFeedback.CurrentObject;
+   shProg = _mesa_lookup_shader_program_err(ctx, program, "glProgramBinary");
+   if (!shProg)
+      return;
+
+   if (binaryFormat != GL_PROGRAM_BINARY_FORMAT_MESA) {
+      _mesa_error(ctx, GL_INVALID_ENUM, "glProgramBinary(binaryFormat=0x%x)",
+                  binaryFormat);
+      return;
+   }
+
+   if (obj->Active
+       && (shProg == ctx->Shader.CurrentVertexProgram
+	   || shProg == ctx->Shader.CurrentGeometryProgram
+	   || shProg == ctx->Shader.CurrentFragmentProgram)) {
+      _mesa_error(ctx, GL_INVALID_OPERATION,
+                  "glProgramBinary(transform feedback active)");
+      return;
+   }
+
+   FLUSH_VERTICES(ctx, _NEW_PROGRAM);
+
+   /* A binary that can't be loaded (for example, one created by another
+    * version of Mesa) isn't an error; it just leaves the program unlinked,
+    * and the application is expected to recompile it from source.
+    */
+   _mesa_glsl_program_binary(ctx, shProg, binary, length);
 }
 
 void
@@ -1749,6 +1866,15 @@ _mesa_init_shader_dispatch(const struct gl_context *ctx,
       SET_ShaderBinary(exec, _mesa_ShaderBinary);
    }
 
+   /* GL_ARB_get_program_binary / GL_OES_get_program_binary */
+   if (ctx->API != API_OPENGLES) {
+      SET_GetProgramBinary(exec, _mesa_GetProgramBinary);
+      SET_ProgramBinary(exec, _mesa_ProgramBinary);
+   }
+   if (_mesa_is_desktop_gl(ctx) || _mesa_is_gles3(ctx)) {
+      SET_ProgramParameteri(exec, _mesa_ProgramParameteriARB);
+   }
+
    /* GL_ARB_blend_func_extended */
    if (_mesa_is_desktop_gl(ctx)) {
       SET_BindFragDataLocationIndexed(exec, _mesa_BindFragDataLocationIndexed);
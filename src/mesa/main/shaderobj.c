@@ -293,6 +293,10 @@ _mesa_clear_shader_program_data(struct gl_context *ctx,
    assert(shProg->InfoLog != NULL);
    ralloc_free(shProg->InfoLog);
    shProg->InfoLog = ralloc_strdup(shProg, "");
+
+   ralloc_free(shProg->Binary);
+   shProg->Binary = NULL;
+   shProg->BinarySize = 0;
 }
 
 
@@ -1164,6 +1164,7 @@ const struct function gles2_functions_possible[] = {
    { "glGetFloatv", 20, _gloffset_GetFloatv },
    { "glGetFramebufferAttachmentParameteriv", 20, -1 },
    { "glGetIntegerv", 20, _gloffset_GetIntegerv },
+   { "glGetProgramBinaryOES", 20, -1 },
    { "glGetProgramInfoLog", 20, -1 },
    { "glGetProgramiv", 20, -1 },
    { "glGetRenderbufferParameteriv", 20, -1 },
@@ -1197,6 +1198,7 @@ const struct function gles2_functions_possible[] = {
    { "glMultiDrawElementsEXT", 20, -1 },
    { "glPixelStorei", 20, _gloffset_PixelStorei },
    { "glPolygonOffset", 20, _gloffset_PolygonOffset },
+   { "glProgramBinaryOES", 20, -1 },
    { "glReadBufferNV", 20, _gloffset_ReadBuffer },
    { "glReadPixels", 20, _gloffset_ReadPixels },
    { "glReleaseShaderCompiler", 20, -1 },
@@ -1311,8 +1313,8 @@ const struct function gles3_functions_possible[] = {
    { "glGetIntegeri_v", 30, -1 },
    // XXX: Missing implementation of ARB_internalformat_query
    // { "glGetInternalformativ", 30, -1 },
-   // XXX: Missing implementation of ARB_get_program_binary
-   /// { "glGetProgramBinary", 30, -1 },
+   // We check for the aliased -OES version in GLES 2
+   // { "glGetProgramBinary", 30, -1 },
    { "glGetQueryiv", 30, -1 },
    { "glGetQueryObjectuiv", 30, -1 },
    { "glGetSamplerParameterfv", 30, -1 },
@@ -1336,10 +1338,9 @@ const struct function gles3_functions_possible[] = {
    // We check for the aliased -EXT version in GLES 2
    // { "glMapBufferRange", 30, -1 },
    { "glPauseTransformFeedback", 30, -1 },
-   // XXX: Missing implementation of ARB_get_program_binary
+   // We check for the aliased -OES version in GLES 2
    // { "glProgramBinary", 30, -1 },
-   // XXX: Missing implementation of ARB_get_program_binary
-   // { "glProgramParameteri", 30, -1 },
+   { "glProgramParameteri", 30, -1 },
    // We check for the aliased -NV version in GLES 2
    // { "glReadBuffer", 30, -1 },
    { "glRenderbufferStorageMultisample", 30, -1 },
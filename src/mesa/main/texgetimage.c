@@ -556,8 +556,8 @@ _mesa_get_teximage(struct gl_context *ctx,
        * texture data to the PBO if the PBO is in VRAM along with the texture.
        */
       GLubyte *buf = (GLubyte *)
-         ctx->Driver.MapBufferRange(ctx, 0, ctx->Pack.BufferObj->Size,
-				    GL_MAP_WRITE_BIT, ctx->Pack.BufferObj);
+         _mesa_bufferobj_map_range(ctx, 0, ctx->Pack.BufferObj->Size,
+				   GL_MAP_WRITE_BIT, ctx->Pack.BufferObj);
       if (!buf) {
          /* out of memory or other unexpected error */
          _mesa_error(ctx, GL_OUT_OF_MEMORY, "glGetTexImage(map PBO failed)");
@@ -610,8 +610,8 @@ _mesa_get_compressed_teximage(struct gl_context *ctx,
    if (_mesa_is_bufferobj(ctx->Pack.BufferObj)) {
       /* pack texture image into a PBO */
       GLubyte *buf = (GLubyte *)
-         ctx->Driver.MapBufferRange(ctx, 0, ctx->Pack.BufferObj->Size,
-				    GL_MAP_WRITE_BIT, ctx->Pack.BufferObj);
+         _mesa_bufferobj_map_range(ctx, 0, ctx->Pack.BufferObj->Size,
+				   GL_MAP_WRITE_BIT, ctx->Pack.BufferObj);
       if (!buf) {
          /* out of memory or other unexpected error */
          _mesa_error(ctx, GL_OUT_OF_MEMORY,
@@ -843,6 +843,10 @@ _mesa_GetnTexImageARB( GLenum target, GLint level, GLenum format,
       ctx->Driver.GetTexImage(ctx, format, type, pixels, texImage);
    }
    _mesa_unlock_texture(ctx, texObj);
+
+   /* The driver may have written the PBO without mapping it. */
+   if (_mesa_is_bufferobj(ctx->Pack.BufferObj))
+      _mesa_bufferobj_changed(ctx->Pack.BufferObj);
 }
 
 
@@ -972,6 +976,10 @@ _mesa_GetnCompressedTexImageARB(GLenum target, GLint level, GLsizei bufSize,
       ctx->Driver.GetCompressedTexImage(ctx, texImage, img);
    }
    _mesa_unlock_texture(ctx, texObj);
+
+   /* The driver may have written the PBO without mapping it. */
+   if (_mesa_is_bufferobj(ctx->Pack.BufferObj))
+      _mesa_bufferobj_changed(ctx->Pack.BufferObj);
 }
 
 void GLAPIENTRY
@@ -309,6 +309,22 @@ _mesa_BeginTransformFeedback(GLenum mode)
 }
 
 
+/**
+ * The buffers bound to a transform feedback object may have been written
+ * to by the vertices recorded since Begin/ResumeTransformFeedback.
+ */
+static void
+feedback_buffers_changed(struct gl_transform_feedback_object *obj)
+{
+   GLuint i;
+
+   for (i = 0; i < MAX_FEEDBACK_BUFFERS; i++) {
+      if (obj->Buffers[i])
+         _mesa_bufferobj_changed(obj->Buffers[i]);
+   }
+}
+
+
 void GLAPIENTRY
 _mesa_EndTransformFeedback(void)
 {
@@ -330,6 +346,8 @@ _mesa_EndTransformFeedback(void)
 
    assert(ctx->Driver.EndTransformFeedback);
    ctx->Driver.EndTransformFeedback(ctx, obj);
+
+   feedback_buffers_changed(obj);
 }
 
 
@@ -816,6 +834,8 @@ _mesa_PauseTransformFeedback(void)
 
    assert(ctx->Driver.PauseTransformFeedback);
    ctx->Driver.PauseTransformFeedback(ctx, obj);
+
+   feedback_buffers_changed(obj);
 }
 
 
@@ -272,6 +272,30 @@ public:
 	 free(dup_key);
    }
 
+   /**
+    * Call \c func for every mapping in the map, in no particular order
+    */
+   void iterate(void (*func)(const char *, unsigned, void *), void *closure)
+   {
+      struct iterate_closure c = { func, closure };
+
+      hash_table_call_foreach(this->ht, iterate_wrapper, &c);
+   }
+
+private:
+   struct iterate_closure {
+      void (*func)(const char *, unsigned, void *);
+      void *closure;
+   };
+
+   static void iterate_wrapper(const void *key, void *data, void *closure)
+   {
+      struct iterate_closure *c = (struct iterate_closure *) closure;
+
+      c->func((const char *) key, (unsigned) ((intptr_t) data - 1),
+	      c->closure);
+   }
+
 private:
    static void delete_key(const void *key, void *data, void *closure)
    {
@@ -42,6 +42,7 @@
 #include "ir_optimization.h"
 #include "ast.h"
 #include "linker.h"
+#include "program_binary.h"
 
 #include "main/mtypes.h"
 #include "main/shaderobj.h"
@@ -3086,8 +3087,7 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader)
       /* Do some optimization at compile time to reduce shader IR size
        * and reduce later work if the same shader is linked multiple times
        */
-      while (do_common_optimization(shader->ir, false, false, 32))
-	 ;
+      do_common_optimization(shader->ir, false, false, 32);
 
       validate_ir_tree(shader->ir);
    }
@@ -3132,6 +3132,30 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader)
 }
 
 
+/**
+ * Hand the results of linking, or of loading a program binary, to the driver
+ */
+static void
+link_shader_finish(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   if (prog->LinkStatus) {
+      if (!ctx->Driver.LinkShader(ctx, prog)) {
+	 prog->LinkStatus = GL_FALSE;
+      }
+   }
+
+   if (ctx->Shader.Flags & GLSL_DUMP) {
+      if (!prog->LinkStatus) {
+	 printf("GLSL shader program %d failed to link\n", prog->Name);
+      }
+
+      if (prog->InfoLog && prog->InfoLog[0] != 0) {
+	 printf("GLSL shader program %d info log:\n", prog->Name);
+	 printf("%s\n", prog->InfoLog);
+      }
+   }
+}
+
 /**
  * Link a GLSL shader program.  Called via glLinkProgram().
  */
@@ -3152,25 +3176,42 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
    }
 
    if (prog->LinkStatus) {
-      link_shaders(ctx, prog);
-   }
+      const bool use_cache = _mesa_glsl_program_cache_enabled();
 
-   if (prog->LinkStatus) {
-      if (!ctx->Driver.LinkShader(ctx, prog)) {
-	 prog->LinkStatus = GL_FALSE;
-      }
-   }
+      if (!use_cache || !_mesa_glsl_program_cache_load(ctx, prog)) {
+	 link_shaders(ctx, prog);
 
-   if (ctx->Shader.Flags & GLSL_DUMP) {
-      if (!prog->LinkStatus) {
-	 printf("GLSL shader program %d failed to link\n", prog->Name);
-      }
+	 /* The binary has to be saved before the driver lowers the IR.
+	  * GL_OES_get_program_binary has no retrievable hint, so always save
+	  * it on GLES.
+	  */
+	 if (prog->LinkStatus &&
+	     (use_cache || prog->BinaryRetrievableHint ||
+	      ctx->API == API_OPENGLES2)) {
+	    _mesa_glsl_save_program_binary(ctx, prog);
 
-      if (prog->InfoLog && prog->InfoLog[0] != 0) {
-	 printf("GLSL shader program %d info log:\n", prog->Name);
-	 printf("%s\n", prog->InfoLog);
+	    if (use_cache)
+	       _mesa_glsl_program_cache_store(ctx, prog);
+	 }
       }
    }
+
+   link_shader_finish(ctx, prog);
+}
+
+/**
+ * Load a program binary.  Called via glProgramBinary().
+ */
+void
+_mesa_glsl_program_binary(struct gl_context *ctx,
+			  struct gl_shader_program *prog,
+			  const GLvoid *binary, GLsizei length)
+{
+   _mesa_clear_shader_program_data(ctx, prog);
+
+   _mesa_glsl_load_program_binary(ctx, prog, binary, length);
+
+   link_shader_finish(ctx, prog);
 }
 
 } /* extern "C" */
@@ -42,6 +42,7 @@
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
+#include "util/u_vbuf.h"
 
 
 /**
@@ -77,8 +78,11 @@ st_bufferobj_free(struct gl_context *ctx, struct gl_buffer_object *obj)
    assert(obj->RefCount == 0);
    assert(st_obj->transfer == NULL);
 
-   if (st_obj->buffer) 
+   if (st_obj->buffer) {
+      /* u_vbuf keys its caches on the buffer address */
+      u_vbuf_invalidate_buffer(st_obj->buffer);
       pipe_resource_reference(&st_obj->buffer, NULL);
+   }
 
    free(st_obj);
 }
@@ -129,6 +133,8 @@ st_bufferobj_subdata(struct gl_context *ctx,
    pipe_buffer_write(st_context(ctx)->pipe,
 		     st_obj->buffer,
 		     offset, size, data);
+
+   u_vbuf_invalidate_buffer(st_obj->buffer);
 }
 
 
@@ -228,6 +234,7 @@ st_bufferobj_data(struct gl_context *ctx,
       pipe_usage = PIPE_USAGE_DEFAULT;
    }
 
+   u_vbuf_invalidate_buffer(st_obj->buffer);
    pipe_resource_reference( &st_obj->buffer, NULL );
 
    if (size != 0) {
@@ -261,8 +268,11 @@ st_bufferobj_map_range(struct gl_context *ctx,
    struct st_buffer_object *st_obj = st_buffer_object(obj);
    enum pipe_transfer_usage flags = 0x0;
 
-   if (access & GL_MAP_WRITE_BIT)
+   if (access & GL_MAP_WRITE_BIT) {
       flags |= PIPE_TRANSFER_WRITE;
+      /* drop vertex translations cached from the old contents */
+      u_vbuf_invalidate_buffer(st_obj->buffer);
+   }
 
    if (access & GL_MAP_READ_BIT)
       flags |= PIPE_TRANSFER_READ;
@@ -380,6 +390,8 @@ st_copy_buffer_subdata(struct gl_context *ctx,
 
    pipe->resource_copy_region(pipe, dstObj->buffer, 0, writeOffset, 0, 0,
                               srcObj->buffer, 0, &box);
+
+   u_vbuf_invalidate_buffer(dstObj->buffer);
 }
 
 
@@ -45,6 +45,7 @@
 #include "pipe/p_screen.h"
 #include "util/u_gen_mipmap.h"
 #include "util/u_blit.h"
+#include "util/u_upload_mgr.h"
 
 
 /** Check if we have a front color buffer and if it's been drawn to. */
@@ -79,12 +80,25 @@ display_front_buffer(struct st_context *st)
 void st_flush( struct st_context *st,
                struct pipe_fence_handle **fence )
 {
+   struct pipe_screen *screen = st->pipe->screen;
+   struct pipe_fence_handle *upload_fence = NULL;
+
    FLUSH_VERTICES(st->ctx, 0);
    FLUSH_CURRENT(st->ctx, 0);
 
    st_flush_bitmap_cache(st);
 
-   st->pipe->flush( st->pipe, fence );
+   /* The upload rings need a fence to reclaim the space used so far. */
+   st->pipe->flush( st->pipe, &upload_fence );
+
+   u_upload_fence(st->uploader, upload_fence);
+   if (st->indexbuf_uploader)
+      u_upload_fence(st->indexbuf_uploader, upload_fence);
+
+   if (fence)
+      *fence = upload_fence;
+   else
+      screen->fence_reference(screen, &upload_fence, NULL);
 }
 
 
@@ -46,6 +46,7 @@
 #include "pipe/p_context.h"
 #include "util/u_draw.h"
 #include "util/u_inlines.h"
+#include "util/u_vbuf.h"
 #include "cso_cache/cso_context.h"
 
 struct st_transform_feedback_object {
@@ -104,6 +105,22 @@ st_delete_transform_feedback(struct gl_context *ctx,
 }
 
 
+/**
+ * The targets have been written by the GPU, so vertex translations cached
+ * from their buffers are stale.
+ */
+static void
+st_invalidate_transform_feedback_buffers(struct st_transform_feedback_object *sobj)
+{
+   unsigned i;
+
+   for (i = 0; i < sobj->num_targets; i++) {
+      if (sobj->targets[i])
+         u_vbuf_invalidate_buffer(sobj->targets[i]->buffer);
+   }
+}
+
+
 /* XXX Do we really need the mode? */
 static void
 st_begin_transform_feedback(struct gl_context *ctx, GLenum mode,
@@ -157,6 +174,8 @@ st_pause_transform_feedback(struct gl_context *ctx,
 {
    struct st_context *st = st_context(ctx);
    cso_set_stream_outputs(st->cso_context, 0, NULL, 0);
+
+   st_invalidate_transform_feedback_buffers(st_transform_feedback_object(obj));
 }
 
 
@@ -201,6 +220,8 @@ st_end_transform_feedback(struct gl_context *ctx,
 
    cso_set_stream_outputs(st->cso_context, 0, NULL, 0);
 
+   st_invalidate_transform_feedback_buffers(sobj);
+
    pipe_so_target_reference(&sobj->draw_count,
                             st_transform_feedback_get_draw_target(obj));
 }
@@ -121,22 +121,28 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
    st->dirty.mesa = ~0;
    st->dirty.st = ~0;
 
-   st->uploader = u_upload_create(st->pipe, 65536, 4, PIPE_BIND_VERTEX_BUFFER);
+   st->uploader = u_upload_create_ring(st->pipe, 65536, 1024 * 1024, 4,
+                                       PIPE_BIND_VERTEX_BUFFER);
 
    if (!screen->get_param(screen, PIPE_CAP_USER_INDEX_BUFFERS)) {
-      st->indexbuf_uploader = u_upload_create(st->pipe, 128 * 1024, 4,
-                                              PIPE_BIND_INDEX_BUFFER);
+      st->indexbuf_uploader = u_upload_create_ring(st->pipe, 128 * 1024,
+                                                   4 * 1024 * 1024, 4,
+                                                   PIPE_BIND_INDEX_BUFFER);
    }
 
    if (!screen->get_param(screen, PIPE_CAP_USER_CONSTANT_BUFFERS)) {
       unsigned alignment =
          screen->get_param(screen, PIPE_CAP_CONSTANT_BUFFER_OFFSET_ALIGNMENT);
 
+      /* Not a ring, the constants stay bound across flushes. */
       st->constbuf_uploader = u_upload_create(pipe, 128 * 1024, alignment,
                                               PIPE_BIND_CONSTANT_BUFFER);
    }
 
    st->cso_context = cso_create_context(pipe);
+   /* Every buffer write goes through st_cb_bufferobjects.c and
+    * st_cb_xformfb.c, which invalidate the cached vertex translations. */
+   cso_enable_vbuf_cache(st->cso_context);
 
    st_init_atoms( st );
    st_init_bitmap(st);
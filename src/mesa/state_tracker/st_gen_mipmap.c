@@ -101,6 +101,32 @@ st_render_mipmap(struct st_context *st,
    return TRUE;
 }
 
+/**
+ * Generate mipmap levels with the CPU fallback of the util module.
+ * \return TRUE if successful, FALSE if not possible
+ */
+static boolean
+st_cpu_mipmap(struct st_context *st,
+              GLenum target,
+              struct pipe_resource *pt,
+              uint baseLevel, uint lastLevel)
+{
+   uint layer;
+
+   if (pt->target != PIPE_TEXTURE_2D_ARRAY) {
+      return util_gen_mipmap_cpu(st->pipe, pt,
+                                 _mesa_tex_target_to_face(target),
+                                 baseLevel, lastLevel);
+   }
+
+   for (layer = 0; layer < pt->array_size; layer++) {
+      if (!util_gen_mipmap_cpu(st->pipe, pt, layer, baseLevel, lastLevel))
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
 /**
  * Compute the expected number of mipmap levels in the texture given
  * the width/height/depth of the base image and the GL_TEXTURE_BASE_LEVEL/
@@ -195,11 +221,10 @@ st_generate_mipmap(struct gl_context *ctx, GLenum target,
    assert(pt->last_level >= lastLevel);
 
    /* Try to generate the mipmap by rendering/texturing.  If that fails,
-    * use the software fallback.
+    * use the multithreaded CPU path, and then the core Mesa fallback.
     */
-   if (!st_render_mipmap(st, target, stObj, baseLevel, lastLevel)) {
-      /* since the util code actually also has a fallback, should
-         probably make it never fail and kill this */
+   if (!st_render_mipmap(st, target, stObj, baseLevel, lastLevel) &&
+       !st_cpu_mipmap(st, target, pt, baseLevel, lastLevel)) {
       _mesa_generate_mipmap(ctx, target, texObj);
    }
 
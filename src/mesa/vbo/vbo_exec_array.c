@@ -35,6 +35,7 @@
 #include "main/enums.h"
 #include "main/macros.h"
 #include "main/transformfeedback.h"
+#include "util/u_minmax_index.h"
 
 #include "vbo_context.h"
 
@@ -77,11 +78,38 @@ vbo_check_buffers_are_unmapped(struct gl_context *ctx)
 
 
 
+/**
+ * Look up the min/max elements of an index range of a static buffer object
+ * in its cache, allocating the cache if needed.
+ * The buffer object's mutex must be held.
+ */
+static GLboolean
+vbo_minmax_cache_lookup(struct gl_buffer_object *obj, GLuint offset,
+                        GLuint count, GLuint index_size,
+                        GLboolean restart, GLuint restartIndex,
+                        GLuint *min_index, GLuint *max_index)
+{
+   if (!obj->MinMaxCache) {
+      obj->MinMaxCache = malloc(sizeof(*obj->MinMaxCache));
+      if (!obj->MinMaxCache)
+         return GL_FALSE;
+      util_minmax_cache_init(obj->MinMaxCache, obj->Stamp);
+   }
+
+   return util_minmax_cache_lookup(obj->MinMaxCache, obj->Stamp, offset,
+                                   count, index_size, restart, restartIndex,
+                                   min_index, max_index);
+}
+
+
 /**
  * Compute min and max elements by scanning the index buffer for
  * glDraw[Range]Elements() calls.
  * If primitive restart is enabled, we need to ignore restart
  * indexes when computing min/max.
+ *
+ * The results for static buffer objects are cached until the buffer
+ * contents change, since the same ranges tend to be drawn every frame.
  */
 static void
 vbo_get_minmax_index(struct gl_context *ctx,
@@ -93,8 +121,24 @@ vbo_get_minmax_index(struct gl_context *ctx,
    const GLboolean restart = ctx->Array.PrimitiveRestart;
    const GLuint restartIndex = ctx->Array.RestartIndex;
    const int index_size = vbo_sizeof_ib_type(ib->type);
+   const GLintptr offset = (GLintptr) ib->ptr + prim->start * index_size;
+   const GLboolean cached = _mesa_is_bufferobj(ib->obj) &&
+                            ib->obj->Usage == GL_STATIC_DRAW_ARB;
+   GLuint stamp = 0;
    const char *indices;
-   GLuint i;
+
+   if (cached) {
+      GLboolean hit;
+
+      _glthread_LOCK_MUTEX(ib->obj->Mutex);
+      stamp = ib->obj->Stamp;
+      hit = vbo_minmax_cache_lookup(ib->obj, offset, count, index_size,
+                                    restart, restartIndex,
+                                    min_index, max_index);
+      _glthread_UNLOCK_MUTEX(ib->obj->Mutex);
+      if (hit)
+         return;
+   }
 
    indices = (char *) ib->ptr + prim->start * index_size;
    if (_mesa_is_bufferobj(ib->obj)) {
@@ -103,81 +147,22 @@ vbo_get_minmax_index(struct gl_context *ctx,
                                            GL_MAP_READ_BIT, ib->obj);
    }
 
-   switch (ib->type) {
-   case GL_UNSIGNED_INT: {
-      const GLuint *ui_indices = (const GLuint *)indices;
-      GLuint max_ui = 0;
-      GLuint min_ui = ~0U;
-      if (restart) {
-         for (i = 0; i < count; i++) {
-            if (ui_indices[i] != restartIndex) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-            if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-         }
-      }
-      *min_index = min_ui;
-      *max_index = max_ui;
-      break;
-   }
-   case GL_UNSIGNED_SHORT: {
-      const GLushort *us_indices = (const GLushort *)indices;
-      GLuint max_us = 0;
-      GLuint min_us = ~0U;
-      if (restart) {
-         for (i = 0; i < count; i++) {
-            if (us_indices[i] != restartIndex) {
-               if (us_indices[i] > max_us) max_us = us_indices[i];
-               if (us_indices[i] < min_us) min_us = us_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (us_indices[i] > max_us) max_us = us_indices[i];
-            if (us_indices[i] < min_us) min_us = us_indices[i];
-         }
-      }
-      *min_index = min_us;
-      *max_index = max_us;
-      break;
-   }
-   case GL_UNSIGNED_BYTE: {
-      const GLubyte *ub_indices = (const GLubyte *)indices;
-      GLuint max_ub = 0;
-      GLuint min_ub = ~0U;
-      if (restart) {
-         for (i = 0; i < count; i++) {
-            if (ub_indices[i] != restartIndex) {
-               if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-               if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-            if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-         }
-      }
-      *min_index = min_ub;
-      *max_index = max_ub;
-      break;
-   }
-   default:
-      assert(0);
-      break;
-   }
+   util_get_minmax_index(indices, index_size, count, restart, restartIndex,
+                         min_index, max_index);
 
    if (_mesa_is_bufferobj(ib->obj)) {
       ctx->Driver.UnmapBuffer(ctx, ib->obj);
    }
+
+   if (cached) {
+      _glthread_LOCK_MUTEX(ib->obj->Mutex);
+      if (ib->obj->MinMaxCache) {
+         util_minmax_cache_add(ib->obj->MinMaxCache, stamp, offset, count,
+                               index_size, restart, restartIndex,
+                               *min_index, *max_index);
+      }
+      _glthread_UNLOCK_MUTEX(ib->obj->Mutex);
+   }
 }
 
 /**
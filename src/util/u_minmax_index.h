@@ -0,0 +1,364 @@
+/**************************************************************************
+ *
+ * Copyright 2012 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Min/max index scanning of index buffers, and a small cache of the
+ * results per index buffer.
+ *
+ * This header is shared by gallium's u_vbuf and Mesa's vbo module, so it
+ * must not depend on anything but the C library and the compiler. The includer is
+ * expected to have defined INLINE and the <stdint.h> types.
+ */
+
+#ifndef U_MINMAX_INDEX_H
+#define U_MINMAX_INDEX_H
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTIL_MINMAX_INDEX_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifdef UTIL_MINMAX_INDEX_SSE2
+
+/*
+ * Restart indices are replaced by the neutral element of each reduction
+ * (0 for max, all ones for min) before being folded into the accumulators,
+ * so the inner loops have no branches.
+ *
+ * The restart index must fit the index type, see util_get_minmax_index.
+ */
+
+static INLINE unsigned
+util_minmax_index_ubyte_sse2(const uint8_t *indices, unsigned count,
+                             int primitive_restart, unsigned restart_index,
+                             unsigned *min, unsigned *max)
+{
+   const __m128i restart = _mm_set1_epi8((char)restart_index);
+   __m128i vmin = _mm_set1_epi8((char)0xff);
+   __m128i vmax = _mm_setzero_si128();
+   uint8_t lmin[16], lmax[16];
+   unsigned i, n = count & ~15;
+
+   for (i = 0; i < n; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(indices + i));
+      if (primitive_restart) {
+         __m128i mask = _mm_cmpeq_epi8(v, restart);
+         vmin = _mm_min_epu8(vmin, _mm_or_si128(v, mask));
+         vmax = _mm_max_epu8(vmax, _mm_andnot_si128(mask, v));
+      } else {
+         vmin = _mm_min_epu8(vmin, v);
+         vmax = _mm_max_epu8(vmax, v);
+      }
+   }
+
+   _mm_storeu_si128((__m128i *)lmin, vmin);
+   _mm_storeu_si128((__m128i *)lmax, vmax);
+   for (i = 0; i < 16; i++) {
+      if (lmin[i] < *min) *min = lmin[i];
+      if (lmax[i] > *max) *max = lmax[i];
+   }
+   return n;
+}
+
+static INLINE unsigned
+util_minmax_index_ushort_sse2(const uint16_t *indices, unsigned count,
+                              int primitive_restart, unsigned restart_index,
+                              unsigned *min, unsigned *max)
+{
+   /* SSE2 only has signed 16-bit min/max, so flip the sign bits. */
+   const __m128i bias = _mm_set1_epi16((short)0x8000);
+   const __m128i restart = _mm_set1_epi16((short)restart_index);
+   __m128i vmin = _mm_set1_epi16(0x7fff);
+   __m128i vmax = _mm_set1_epi16((short)0x8000);
+   int16_t lmin[8], lmax[8];
+   unsigned i, n = count & ~7;
+
+   for (i = 0; i < n; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(indices + i));
+      if (primitive_restart) {
+         __m128i mask = _mm_cmpeq_epi16(v, restart);
+         vmin = _mm_min_epi16(vmin, _mm_xor_si128(_mm_or_si128(v, mask), bias));
+         vmax = _mm_max_epi16(vmax, _mm_xor_si128(_mm_andnot_si128(mask, v), bias));
+      } else {
+         v = _mm_xor_si128(v, bias);
+         vmin = _mm_min_epi16(vmin, v);
+         vmax = _mm_max_epi16(vmax, v);
+      }
+   }
+
+   _mm_storeu_si128((__m128i *)lmin, vmin);
+   _mm_storeu_si128((__m128i *)lmax, vmax);
+   for (i = 0; i < 8; i++) {
+      unsigned lo = (uint16_t)(lmin[i] ^ 0x8000);
+      unsigned hi = (uint16_t)(lmax[i] ^ 0x8000);
+      if (lo < *min) *min = lo;
+      if (hi > *max) *max = hi;
+   }
+   return n;
+}
+
+static INLINE unsigned
+util_minmax_index_uint_sse2(const uint32_t *indices, unsigned count,
+                            int primitive_restart, unsigned restart_index,
+                            unsigned *min, unsigned *max)
+{
+   /* SSE2 has neither 32-bit min/max nor unsigned compares, so compare
+    * biased values and select with masks. */
+   const __m128i bias = _mm_set1_epi32((int)0x80000000);
+   const __m128i restart = _mm_set1_epi32((int)restart_index);
+   __m128i vmin = _mm_set1_epi32(0x7fffffff);
+   __m128i vmax = _mm_set1_epi32((int)0x80000000);
+   int32_t lmin[4], lmax[4];
+   unsigned i, n = count & ~3;
+
+   for (i = 0; i < n; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(indices + i));
+      __m128i lo = v, hi = v, lt, gt;
+      if (primitive_restart) {
+         __m128i mask = _mm_cmpeq_epi32(v, restart);
+         lo = _mm_or_si128(v, mask);
+         hi = _mm_andnot_si128(mask, v);
+      }
+      lo = _mm_xor_si128(lo, bias);
+      hi = _mm_xor_si128(hi, bias);
+      lt = _mm_cmplt_epi32(lo, vmin);
+      gt = _mm_cmpgt_epi32(hi, vmax);
+      vmin = _mm_or_si128(_mm_and_si128(lt, lo), _mm_andnot_si128(lt, vmin));
+      vmax = _mm_or_si128(_mm_and_si128(gt, hi), _mm_andnot_si128(gt, vmax));
+   }
+
+   _mm_storeu_si128((__m128i *)lmin, vmin);
+   _mm_storeu_si128((__m128i *)lmax, vmax);
+   for (i = 0; i < 4; i++) {
+      unsigned lo = (uint32_t)lmin[i] ^ 0x80000000;
+      unsigned hi = (uint32_t)lmax[i] ^ 0x80000000;
+      if (lo < *min) *min = lo;
+      if (hi > *max) *max = hi;
+   }
+   return n;
+}
+
+#endif /* UTIL_MINMAX_INDEX_SSE2 */
+
+
+#define UTIL_MINMAX_INDEX_SCAN(type)                                 \
+   do {                                                              \
+      const type *ind = (const type *)indices;                       \
+      if (primitive_restart) {                                       \
+         for (; i < count; i++) {                                    \
+            if (ind[i] != restart_index) {                           \
+               if (ind[i] > max_index) max_index = ind[i];           \
+               if (ind[i] < min_index) min_index = ind[i];           \
+            }                                                        \
+         }                                                           \
+      } else {                                                       \
+         for (; i < count; i++) {                                    \
+            if (ind[i] > max_index) max_index = ind[i];              \
+            if (ind[i] < min_index) min_index = ind[i];              \
+         }                                                           \
+      }                                                              \
+   } while (0)
+
+
+/**
+ * Compute the smallest and the largest index of count indices of
+ * index_size bytes, skipping restart_index if primitive_restart is set.
+ *
+ * If there are no indices other than restart indices, min is ~0 and max
+ * is 0.
+ */
+static INLINE void
+util_get_minmax_index(const void *indices, unsigned index_size,
+                      unsigned count, int primitive_restart,
+                      unsigned restart_index,
+                      unsigned *out_min_index, unsigned *out_max_index)
+{
+   unsigned min_index = ~0U;
+   unsigned max_index = 0;
+   unsigned i = 0;
+
+   /* A restart index which doesn't fit the index type never matches, and
+    * the vector paths would truncate it. */
+   if (index_size < 4 && restart_index >> (index_size * 8))
+      primitive_restart = 0;
+
+   switch (index_size) {
+   case 4:
+#ifdef UTIL_MINMAX_INDEX_SSE2
+      i = util_minmax_index_uint_sse2((const uint32_t *)indices, count,
+                                      primitive_restart, restart_index,
+                                      &min_index, &max_index);
+#endif
+      UTIL_MINMAX_INDEX_SCAN(uint32_t);
+      break;
+   case 2:
+#ifdef UTIL_MINMAX_INDEX_SSE2
+      i = util_minmax_index_ushort_sse2((const uint16_t *)indices, count,
+                                        primitive_restart, restart_index,
+                                        &min_index, &max_index);
+#endif
+      UTIL_MINMAX_INDEX_SCAN(uint16_t);
+      break;
+   case 1:
+#ifdef UTIL_MINMAX_INDEX_SSE2
+      i = util_minmax_index_ubyte_sse2((const uint8_t *)indices, count,
+                                       primitive_restart, restart_index,
+                                       &min_index, &max_index);
+#endif
+      UTIL_MINMAX_INDEX_SCAN(uint8_t);
+      break;
+   default:
+      break;
+   }
+
+   /* The vector paths fold restart lanes in as neutral values, which only
+    * shows when every index was a restart index. */
+   if (min_index > max_index) {
+      min_index = ~0U;
+      max_index = 0;
+   }
+
+   *out_min_index = min_index;
+   *out_max_index = max_index;
+}
+
+#undef UTIL_MINMAX_INDEX_SCAN
+
+
+/*
+ * Cache of min/max results of one index buffer.
+ *
+ * The owner of the buffer keeps a stamp which changes whenever the buffer
+ * contents change; the cache drops all its entries when it is looked up
+ * with a different stamp than they were computed with.
+ */
+
+#define UTIL_MINMAX_CACHE_SIZE 8
+
+struct util_minmax_cache_entry {
+   unsigned offset;        /* in bytes */
+   unsigned count;
+   unsigned index_size;    /* 0 if the entry is unused */
+   unsigned restart_index; /* ~0 if primitive restart is disabled */
+   int primitive_restart;
+   unsigned min_index;
+   unsigned max_index;
+};
+
+struct util_minmax_cache {
+   unsigned stamp;
+   unsigned next;          /* entry to replace next */
+   struct util_minmax_cache_entry entry[UTIL_MINMAX_CACHE_SIZE];
+};
+
+static INLINE void
+util_minmax_cache_init(struct util_minmax_cache *cache, unsigned stamp)
+{
+   unsigned i;
+
+   cache->stamp = stamp;
+   cache->next = 0;
+   for (i = 0; i < UTIL_MINMAX_CACHE_SIZE; i++)
+      cache->entry[i].index_size = 0;
+}
+
+/**
+ * Look up the min/max indices of the given range of the buffer.
+ * Return 1 and fill out_min_index/out_max_index on a hit.
+ */
+static INLINE int
+util_minmax_cache_lookup(struct util_minmax_cache *cache, unsigned stamp,
+                         unsigned offset, unsigned count, unsigned index_size,
+                         int primitive_restart, unsigned restart_index,
+                         unsigned *out_min_index, unsigned *out_max_index)
+{
+   unsigned i;
+
+   if (cache->stamp != stamp) {
+      util_minmax_cache_init(cache, stamp);
+      return 0;
+   }
+
+   primitive_restart = !!primitive_restart;
+   if (!primitive_restart)
+      restart_index = ~0U;
+
+   for (i = 0; i < UTIL_MINMAX_CACHE_SIZE; i++) {
+      const struct util_minmax_cache_entry *e = &cache->entry[i];
+
+      if (e->index_size == index_size &&
+          e->offset == offset &&
+          e->count == count &&
+          e->primitive_restart == primitive_restart &&
+          e->restart_index == restart_index) {
+         *out_min_index = e->min_index;
+         *out_max_index = e->max_index;
+         return 1;
+      }
+   }
+   return 0;
+}
+
+/**
+ * Add the result of util_get_minmax_index() for a range of the buffer whose
+ * contents match the given stamp.
+ */
+static INLINE void
+util_minmax_cache_add(struct util_minmax_cache *cache, unsigned stamp,
+                      unsigned offset, unsigned count, unsigned index_size,
+                      int primitive_restart, unsigned restart_index,
+                      unsigned min_index, unsigned max_index)
+{
+   struct util_minmax_cache_entry *e;
+
+   if (cache->stamp != stamp)
+      util_minmax_cache_init(cache, stamp);
+
+   e = &cache->entry[cache->next];
+   cache->next = (cache->next + 1) % UTIL_MINMAX_CACHE_SIZE;
+
+   e->offset = offset;
+   e->count = count;
+   e->index_size = index_size;
+   e->primitive_restart = !!primitive_restart;
+   e->restart_index = primitive_restart ? restart_index : ~0U;
+   e->min_index = min_index;
+   e->max_index = max_index;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_MINMAX_INDEX_H */